@@ -0,0 +1,239 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "netcode/detail/buffer.hh"
+
+namespace bench {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Get the number of calls to operator new since the start of the program
+std::size_t
+nb_allocations()
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Prevent the compiler from optimizing away the computation of @p x
+template <typename T>
+inline
+void
+do_not_optimize(const T& x)
+noexcept
+{
+  asm volatile("" : : "r"(&x) : "memory");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Given to a benchmark to tell it how many operations to do and to measure them
+///
+/// Only the loop driven by keep_running() is measured, thus the preparation of a benchmark can be
+/// done before it. The preparation of each operation (e.g. building a decoder) can be excluded
+/// from measures by surrounding it with pause() and resume().
+class state final
+{
+public:
+
+  /// @brief Constructor
+  explicit state(std::size_t nb_iterations)
+    : m_nb_iterations{nb_iterations}
+    , m_nb_remaining{nb_iterations}
+    , m_started{false}
+    , m_elapsed{0}
+    , m_nb_allocations{0}
+    , m_start{}
+    , m_start_allocations{0}
+  {}
+
+  /// @brief The number of operations to execute
+  std::size_t
+  iterations()
+  const noexcept
+  {
+    return m_nb_iterations;
+  }
+
+  /// @brief Tell if another operation should be executed
+  ///
+  /// Starts measuring on the first call, stops measuring when all operations have been executed.
+  bool
+  keep_running()
+  noexcept
+  {
+    if (not m_started)
+    {
+      m_started = true;
+      resume();
+    }
+    if (m_nb_remaining == 0)
+    {
+      pause();
+      return false;
+    }
+    --m_nb_remaining;
+    return true;
+  }
+
+  /// @brief Start measuring
+  void
+  resume()
+  noexcept
+  {
+    m_start_allocations = nb_allocations();
+    m_start = clock::now();
+  }
+
+  /// @brief Stop measuring
+  void
+  pause()
+  noexcept
+  {
+    const auto end = clock::now();
+    m_elapsed += end - m_start;
+    m_nb_allocations += nb_allocations() - m_start_allocations;
+  }
+
+  /// @brief The measured time
+  std::chrono::nanoseconds
+  elapsed()
+  const noexcept
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(m_elapsed);
+  }
+
+  /// @brief The number of allocations done while measuring
+  std::size_t
+  allocations()
+  const noexcept
+  {
+    return m_nb_allocations;
+  }
+
+private:
+
+  /// @brief The clock used for all measures
+  using clock = std::chrono::steady_clock;
+
+  /// @brief The number of operations to execute
+  const std::size_t m_nb_iterations;
+
+  /// @brief The number of operations still to execute
+  std::size_t m_nb_remaining;
+
+  /// @brief Tell if the measured loop has started
+  bool m_started;
+
+  /// @brief Accumulated measured time
+  clock::duration m_elapsed;
+
+  /// @brief Accumulated number of allocations
+  std::size_t m_nb_allocations;
+
+  /// @brief When the current measure started
+  clock::time_point m_start;
+
+  /// @brief The number of allocations when the current measure started
+  std::size_t m_start_allocations;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A measured operation
+struct benchmark
+{
+  /// @brief The measured component, e.g. "galois_field::multiply_add"
+  std::string component;
+
+  /// @brief The parameters of this measure, e.g. "w=8 symbol=1024"
+  std::string parameters;
+
+  /// @brief The number of bytes processed by one operation, to compute a throughput
+  ///
+  /// 0 if a throughput doesn't make sense for this operation.
+  std::size_t bytes_per_op;
+
+  /// @brief Prepare, then execute operations while state::keep_running() is true
+  std::function<void(state&)> run;
+};
+
+/// @brief All benchmarks, in the order of execution
+using registry = std::vector<benchmark>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The parameters swept by benchmarks
+struct sweep
+{
+  /// @brief Galois field sizes
+  std::vector<std::uint8_t> field_sizes;
+
+  /// @brief Sizes of symbols, in bytes
+  std::vector<std::size_t> symbol_sizes;
+
+  /// @brief Number of sources per repair
+  std::vector<std::size_t> window_sizes;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Make the parameters description of a benchmark
+inline
+std::string
+parameters(std::uint8_t w, const std::string& name, std::size_t value)
+{
+  return "w=" + std::to_string(w) + " " + name + "=" + std::to_string(value);
+}
+
+/// @brief Make the parameters description of a benchmark
+inline
+std::string
+parameters( std::uint8_t w, const std::string& name0, std::size_t value0, const std::string& name1
+          , std::size_t value1)
+{
+  return parameters(w, name0, value0) + " " + name1 + "=" + std::to_string(value1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Make a symbol filled with pseudo-random bytes, the same ones for a given @p seed
+inline
+ntc::detail::byte_buffer
+random_symbol(std::size_t size, std::uint32_t seed)
+{
+  auto gen = std::mt19937{seed};
+  auto dist = std::uniform_int_distribution<int>{0, 255};
+  auto symbol = ntc::detail::byte_buffer(size);
+  for (auto& byte : symbol)
+  {
+    byte = static_cast<char>(dist(gen));
+  }
+  return symbol;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+add_galois_field_benchmarks(registry&, const sweep&);
+
+void
+add_encoder_benchmarks(registry&, const sweep&);
+
+void
+add_invert_matrix_benchmarks(registry&, const sweep&);
+
+void
+add_packetizer_benchmarks(registry&, const sweep&);
+
+void
+add_decoder_benchmarks(registry&, const sweep&);
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace bench
@@ -0,0 +1,289 @@
+#include <algorithm> // max, min, sort
+#include <atomic>
+#include <cstdlib>   // exit, malloc, free
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Count allocations of the whole program, library included.
+
+namespace /* unnamed */ {
+
+std::atomic<std::size_t> allocations_counter{0};
+
+} // namespace unnamed
+
+void*
+operator new(std::size_t sz)
+{
+  allocations_counter.fetch_add(1, std::memory_order_relaxed);
+  if (const auto ptr = std::malloc(sz == 0 ? 1 : sz))
+  {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void*
+operator new[](std::size_t sz)
+{
+  return operator new(sz);
+}
+
+void
+operator delete(void* ptr)
+noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete[](void* ptr)
+noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t)
+noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete[](void* ptr, std::size_t)
+noexcept
+{
+  std::free(ptr);
+}
+
+std::size_t
+bench::nb_allocations()
+noexcept
+{
+  return allocations_counter.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+struct configuration
+{
+  // Only run benchmarks which contain this string in their component or parameters.
+  std::string filter;
+
+  // The minimal duration of a repetition.
+  std::chrono::milliseconds min_time{50};
+
+  // The number of measures of a benchmark, the median one is reported.
+  std::size_t repetitions = 5;
+
+  // Output comma-separated values.
+  bool csv = false;
+
+  // Sweep fewer parameters.
+  bool quick = false;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct result
+{
+  std::size_t iterations;
+  double ns_per_op;
+  double allocs_per_op;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+[[noreturn]]
+void
+usage(const char* name)
+{
+  std::cerr
+    << "Usage:\n" << name
+    << " [--filter string] [--min-time ms] [--repetitions n] [--csv] [--quick]\n\n"
+    << "Results are more stable when the process is pinned on an idle core (e.g. with\n"
+    << "taskset) and when frequency scaling is disabled.\n";
+  std::exit(1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+configuration
+read_configuration(int argc, const char** argv)
+{
+  auto conf = configuration{};
+  for (auto i = 1; i < argc; ++i)
+  {
+    const auto arg = std::string{argv[i]};
+    const auto has_value = i + 1 < argc;
+    try
+    {
+      if (arg == "--filter" and has_value)
+      {
+        conf.filter = argv[++i];
+      }
+      else if (arg == "--min-time" and has_value)
+      {
+        conf.min_time = std::chrono::milliseconds{std::stoul(argv[++i])};
+      }
+      else if (arg == "--repetitions" and has_value)
+      {
+        conf.repetitions = std::max(1ul, std::stoul(argv[++i]));
+      }
+      else if (arg == "--csv")
+      {
+        conf.csv = true;
+      }
+      else if (arg == "--quick")
+      {
+        conf.quick = true;
+      }
+      else
+      {
+        usage(argv[0]);
+      }
+    }
+    catch (const std::exception&)
+    {
+      usage(argv[0]);
+    }
+  }
+  return conf;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bench::state
+measure(const bench::benchmark& b, std::size_t nb_iterations)
+{
+  auto s = bench::state{nb_iterations};
+  b.run(s);
+  return s;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+result
+run(const bench::benchmark& b, const configuration& conf)
+{
+  // Warm caches and find a number of iterations which lasts at least min_time.
+  auto nb_iterations = 1ul;
+  while (true)
+  {
+    const auto elapsed = measure(b, nb_iterations).elapsed();
+    if (elapsed >= conf.min_time or nb_iterations >= (1ul << 30))
+    {
+      break;
+    }
+    const auto ratio = elapsed.count() > 0
+                     ? static_cast<double>(std::chrono::nanoseconds{conf.min_time}.count())
+                     / static_cast<double>(elapsed.count())
+                     : 10.;
+    nb_iterations = static_cast<std::size_t>( static_cast<double>(nb_iterations)
+                                            * std::min(10., std::max(2., ratio * 1.2)));
+  }
+
+  // Keep the median of all repetitions, less sensitive to interferences than the mean.
+  std::vector<double> ns_per_op;
+  auto nb_allocations = 0ul;
+  for (auto i = 0ul; i < conf.repetitions; ++i)
+  {
+    const auto s = measure(b, nb_iterations);
+    ns_per_op.push_back( static_cast<double>(s.elapsed().count())
+                       / static_cast<double>(nb_iterations));
+    nb_allocations += s.allocations();
+  }
+  std::sort(ns_per_op.begin(), ns_per_op.end());
+
+  return { nb_iterations, ns_per_op[ns_per_op.size() / 2]
+         , static_cast<double>(nb_allocations)
+         / static_cast<double>(nb_iterations * conf.repetitions)};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+report(const bench::benchmark& b, const result& r, const configuration& conf)
+{
+  // ns -> GB/s: bytes / ns = GB / s.
+  const auto gb_per_s = b.bytes_per_op > 0
+                      ? static_cast<double>(b.bytes_per_op) / r.ns_per_op
+                      : 0.;
+  if (conf.csv)
+  {
+    std::cout << b.component << ',' << b.parameters << ',' << r.iterations << ','
+              << std::fixed << std::setprecision(1) << r.ns_per_op << ','
+              << std::setprecision(3) << gb_per_s << ','
+              << std::setprecision(2) << r.allocs_per_op << '\n';
+  }
+  else
+  {
+    std::cout << std::left << std::setw(34) << b.component
+              << std::setw(30) << b.parameters
+              << std::right << std::fixed << std::setprecision(1) << std::setw(14) << r.ns_per_op;
+    if (b.bytes_per_op > 0)
+    {
+      std::cout << std::setprecision(3) << std::setw(10) << gb_per_s;
+    }
+    else
+    {
+      std::cout << std::setw(10) << '-';
+    }
+    std::cout << std::setprecision(2) << std::setw(12) << r.allocs_per_op << '\n';
+  }
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, const char** argv)
+{
+  const auto conf = read_configuration(argc, argv);
+
+  const auto sweep = conf.quick
+                   ? bench::sweep{{8, 32}, {256, 1024}, {4, 32}}
+                   : bench::sweep{{4, 8, 16, 32}, {64, 256, 1024, 1500, 4096}, {4, 16, 64, 128}};
+
+  auto benchmarks = bench::registry{};
+  bench::add_galois_field_benchmarks(benchmarks, sweep);
+  bench::add_encoder_benchmarks(benchmarks, sweep);
+  bench::add_invert_matrix_benchmarks(benchmarks, sweep);
+  bench::add_packetizer_benchmarks(benchmarks, sweep);
+  bench::add_decoder_benchmarks(benchmarks, sweep);
+
+  if (conf.csv)
+  {
+    std::cout << "component,parameters,iterations,ns_per_op,gb_per_s,allocs_per_op\n";
+  }
+  else
+  {
+    std::cout << std::left << std::setw(34) << "component" << std::setw(30) << "parameters"
+              << std::right << std::setw(14) << "ns/op" << std::setw(10) << "GB/s"
+              << std::setw(12) << "allocs/op" << '\n';
+  }
+
+  for (const auto& b : benchmarks)
+  {
+    if (  conf.filter.empty()
+       or (b.component + ' ' + b.parameters).find(conf.filter) != std::string::npos)
+    {
+      report(b, run(b, conf), conf);
+    }
+  }
+
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,107 @@
+#include <algorithm> // max
+#include <memory>
+#include <vector>
+
+#include "netcode/detail/decoder.hh"
+#include "netcode/detail/encoder.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/detail/source.hh"
+#include "netcode/detail/source_list.hh"
+
+#include "benchmarks/benchmark.hh"
+
+namespace bench {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+// Receive a window of sources, some of them lost, followed by as many repairs as lost sources.
+void
+decode_window( state& st, std::uint8_t w, std::size_t window_size, std::size_t symbol_size
+             , std::size_t nb_lost)
+{
+  // The same sources are lost at each run.
+  const auto lost = [&](std::uint32_t id)
+  {
+    return id % (window_size / nb_lost) == 0;
+  };
+
+  auto sources = ntc::detail::source_list{};
+  for (auto id = 0u; id < window_size; ++id)
+  {
+    sources.emplace(id, random_symbol(symbol_size, id));
+  }
+  auto repairs = std::vector<ntc::detail::encoder_repair>{};
+  auto encoder = ntc::detail::encoder{w};
+  for (auto id = 0u; id < nb_lost; ++id)
+  {
+    repairs.emplace_back(id);
+    encoder(repairs.back(), sources);
+  }
+
+  auto nb_decoded = 0ul;
+  const auto handler = [&](const ntc::detail::decoder_source&){++nb_decoded;};
+
+  auto decoder = std::unique_ptr<ntc::detail::decoder>{};
+  auto decoder_repairs = std::vector<ntc::detail::decoder_repair>{};
+  while (st.keep_running())
+  {
+    // Received packets borrow their symbols, as when they are read from a socket buffer.
+    st.pause();
+    decoder.reset(new ntc::detail::decoder{w, handler, ntc::in_order::yes});
+    decoder_repairs.clear();
+    for (const auto& r : repairs)
+    {
+      decoder_repairs.emplace_back( r.id(), r.encoded_size()
+                                  , ntc::detail::source_id_list{r.source_ids()}
+                                  , r.symbol().data(), r.symbol().size());
+    }
+    st.resume();
+
+    for (auto cit = sources.cbegin(); cit != sources.cend(); ++cit)
+    {
+      if (not lost(cit->id()))
+      {
+        (*decoder)(ntc::detail::decoder_source{cit->id(), cit->symbol().data(), cit->size()});
+      }
+    }
+    for (auto& r : decoder_repairs)
+    {
+      (*decoder)(std::move(r));
+    }
+  }
+  do_not_optimize(nb_decoded);
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+add_decoder_benchmarks(registry& benchmarks, const sweep& s)
+{
+  for (const auto w : s.field_sizes)
+  {
+    for (const auto window_size : s.window_sizes)
+    {
+      for (const auto symbol_size : s.symbol_sizes)
+      {
+        // One source out of 8 is lost. An operation is the reception of a whole window.
+        const auto nb_lost = std::max(1ul, window_size / 8);
+        benchmarks.push_back({ "detail::decoder"
+                             , parameters(w, "window", window_size, "symbol", symbol_size)
+                               + " lost=" + std::to_string(nb_lost)
+                             , window_size * symbol_size
+                             , [=](state& st)
+                               {
+                                 decode_window(st, w, window_size, symbol_size, nb_lost);
+                               }});
+      }
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace bench
@@ -0,0 +1,47 @@
+#include "netcode/detail/encoder.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/detail/source_list.hh"
+
+#include "benchmarks/benchmark.hh"
+
+namespace bench {
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+add_encoder_benchmarks(registry& benchmarks, const sweep& s)
+{
+  for (const auto w : s.field_sizes)
+  {
+    for (const auto window_size : s.window_sizes)
+    {
+      for (const auto symbol_size : s.symbol_sizes)
+      {
+        // Generate one repair from a full window of sources.
+        benchmarks.push_back({ "detail::encoder"
+                             , parameters(w, "window", window_size, "symbol", symbol_size)
+                             , window_size * symbol_size
+                             , [=](state& st)
+                               {
+                                 auto sources = ntc::detail::source_list{};
+                                 for (auto id = 0u; id < window_size; ++id)
+                                 {
+                                   sources.emplace(id, random_symbol(symbol_size, id));
+                                 }
+                                 auto encoder = ntc::detail::encoder{w};
+                                 auto repair = ntc::detail::encoder_repair{0};
+                                 while (st.keep_running())
+                                 {
+                                   repair.reset();
+                                   encoder(repair, sources);
+                                   do_not_optimize(repair);
+                                 }
+                               }});
+      }
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace bench
@@ -0,0 +1,423 @@
+#include <algorithm> // all_of, copy_n, fill, sort
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>     // clock_gettime
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+
+#include "netcode/detail/packet_type.hh"
+#include "netcode/detail/spsc_queue.hh"
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/packet_capture.hh"
+
+#include "tools/loss/parse.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Wire an encoder and a decoder running on two threads through lock-free channels which lose
+// packets with a deterministic model, then report goodput, latencies and CPU usage as JSON.
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+using clock_type = std::chrono::steady_clock;
+using channel = ntc::detail::spsc_queue<ntc::packet>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct configuration
+{
+  std::size_t nb_packets = 100000;
+  std::uint16_t packet_size = 1024;
+  std::uint8_t galois_field_size = 8;
+  std::size_t rate = 5;
+  std::size_t window_size = 64;
+  std::string loss = "burst:95,5";
+  std::uint32_t seed = 1;
+  std::string capture;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+[[noreturn]]
+void
+usage(const char* name)
+{
+  std::cerr
+    << "Usage:\n" << name
+    << " [--packets n] [--size bytes] [--gf w] [--rate n] [--window n] [--loss model] [--seed n]\n"
+    << " [--capture file]\n"
+    << "\nLoss models, applied on both directions:\n"
+    << "  none\n"
+    << "  uniform:T     lose a packet with probability (100 - T)%\n"
+    << "  burst:G,B     Gilbert-Elliott, stay in good state with G%, in bad state with B%\n"
+    << "\nWith --capture, packets received by the decoder are captured for tools/replay.\n";
+  std::exit(1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+configuration
+read_configuration(int argc, const char** argv)
+{
+  auto conf = configuration{};
+  for (auto i = 1; i + 1 < argc; i += 2)
+  {
+    const auto arg = std::string{argv[i]};
+    const auto value = std::string{argv[i + 1]};
+    try
+    {
+      if (arg == "--packets")
+      {
+        conf.nb_packets = std::stoul(value);
+      }
+      else if (arg == "--size")
+      {
+        conf.packet_size = static_cast<std::uint16_t>(std::stoul(value));
+      }
+      else if (arg == "--gf")
+      {
+        conf.galois_field_size = static_cast<std::uint8_t>(std::stoul(value));
+      }
+      else if (arg == "--rate")
+      {
+        conf.rate = std::stoul(value);
+      }
+      else if (arg == "--window")
+      {
+        conf.window_size = std::stoul(value);
+      }
+      else if (arg == "--loss")
+      {
+        conf.loss = value;
+      }
+      else if (arg == "--seed")
+      {
+        conf.seed = static_cast<std::uint32_t>(std::stoul(value));
+      }
+      else if (arg == "--capture")
+      {
+        conf.capture = value;
+      }
+      else
+      {
+        usage(argv[0]);
+      }
+    }
+    catch (const std::exception&)
+    {
+      usage(argv[0]);
+    }
+  }
+  if (argc % 2 == 0 or conf.packet_size < 8 or conf.packet_size % sizeof(std::uint32_t) != 0)
+  {
+    usage(argv[0]);
+  }
+  return conf;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The CPU time consumed by the calling thread
+std::chrono::nanoseconds
+thread_cpu_time()
+noexcept
+{
+  timespec ts;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief What the encoder's thread knows about sent sources, shared with the decoder's thread
+///
+/// Entries of a source are written before any packet which depends on it is pushed to a channel,
+/// thus the decoder's thread can read them once it pops such a packet.
+struct sources_log
+{
+  explicit sources_log(std::size_t nb_sources)
+    : sent_date(nb_sources)
+    , lost(nb_sources, false)
+  {}
+
+  std::vector<clock_type::time_point> sent_date;
+  std::vector<bool> lost;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Push packets to a channel, unless they are lost
+struct channel_packet_handler
+{
+  channel& out;
+  std::function<bool()> loss;
+  // Null for acks.
+  sources_log* log;
+  ntc::packet current;
+  std::size_t nb_sent;
+  std::size_t nb_lost;
+
+  void
+  operator()(const char* data, std::size_t len)
+  {
+    const auto size = current.size();
+    current.resize(size + len);
+    std::copy_n(data, len, current.data() + size);
+  }
+
+  void
+  operator()()
+  {
+    ++nb_sent;
+    if (loss())
+    {
+      ++nb_lost;
+      // Remember lost sources to measure their recovery.
+      if (log and ntc::detail::get_packet_type(current) == ntc::detail::packet_type::source)
+      {
+        std::uint32_t id;
+        std::copy_n(current.data() + 1, sizeof(id), reinterpret_cast<char*>(&id));
+        log->lost[boost::endian::big_to_native(id)] = true;
+      }
+      current.clear();
+      return;
+    }
+    while (not out.try_push(std::move(current)))
+    {
+      if (not log)
+      {
+        // Don't wait for an encoder which may itself wait for the decoder, acks can be lost.
+        ++nb_lost;
+        current.clear();
+        return;
+      }
+      std::this_thread::yield();
+    }
+    current = ntc::packet{};
+    current.reserve(2048);
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check delivered data and measure their latencies
+struct measuring_data_handler
+{
+  const sources_log* log;
+  std::uint16_t packet_size;
+  std::vector<double> delivery_latencies;
+  std::vector<double> recovery_latencies;
+  std::size_t nb_corrupted;
+  std::size_t nb_bytes;
+
+  void
+  operator()(const char* data, std::size_t len)
+  {
+    const auto now = clock_type::now();
+    const auto data_as_int = reinterpret_cast<const std::uint32_t*>(data);
+    const auto id = *data_as_int;
+    const auto valid = len == packet_size and id < log->sent_date.size()
+                   and std::all_of( data_as_int, data_as_int + len / sizeof(std::uint32_t)
+                                  , [&](std::uint32_t x){return x == id;});
+    if (not valid)
+    {
+      ++nb_corrupted;
+      return;
+    }
+    nb_bytes += len;
+    const auto latency = std::chrono::duration<double, std::micro>{now - log->sent_date[id]};
+    delivery_latencies.push_back(latency.count());
+    if (log->lost[id])
+    {
+      recovery_latencies.push_back(latency.count());
+    }
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+ntc::data
+generate_data(std::uint32_t id, std::uint16_t packet_size)
+{
+  ntc::data data(packet_size);
+  auto data_as_int = reinterpret_cast<std::uint32_t*>(data.data());
+  std::fill(data_as_int, data_as_int + packet_size/sizeof(std::uint32_t), id);
+  data.resize(packet_size);
+  return data;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Print percentiles of latencies as a JSON object
+void
+print_percentiles(std::ostream& os, std::vector<double>& latencies)
+{
+  std::sort(latencies.begin(), latencies.end());
+  const auto percentile = [&](double p)
+  {
+    if (latencies.empty())
+    {
+      return 0.;
+    }
+    // Nearest-rank method.
+    const auto rank = static_cast<std::size_t>(p * static_cast<double>(latencies.size()) / 100.);
+    return latencies[std::min(rank, latencies.size() - 1)];
+  };
+  os << "{\"count\":" << latencies.size()
+     << ",\"p50\":" << percentile(50)
+     << ",\"p99\":" << percentile(99)
+     << ",\"p999\":" << percentile(99.9)
+     << ",\"max\":" << (latencies.empty() ? 0. : latencies.back()) << '}';
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, const char** argv)
+{
+  const auto conf = read_configuration(argc, argv);
+
+  auto to_decoder_loss = std::function<bool()>{};
+  auto to_encoder_loss = std::function<bool()>{};
+  try
+  {
+    to_decoder_loss = loss::parse(conf.loss, conf.seed);
+    to_encoder_loss = loss::parse(conf.loss, conf.seed + 1);
+  }
+  catch (const std::exception&)
+  {
+    usage(argv[0]);
+  }
+
+  auto log = sources_log{conf.nb_packets};
+  channel to_decoder{4096};
+  channel to_encoder{4096};
+  std::atomic<bool> encoder_done{false};
+
+  ntc::encoder<channel_packet_handler> enc{ conf.galois_field_size
+                                          , channel_packet_handler{ to_decoder, to_decoder_loss
+                                                                  , &log, {}, 0, 0}};
+  enc.set_rate(conf.rate);
+  enc.set_window_size(conf.window_size);
+
+  ntc::decoder<channel_packet_handler, measuring_data_handler>
+    dec{ conf.galois_field_size, ntc::in_order::yes
+       , channel_packet_handler{to_encoder, to_encoder_loss, nullptr, {}, 0, 0}
+       , measuring_data_handler{&log, conf.packet_size, {}, {}, 0, 0}};
+  dec.data_handler().delivery_latencies.reserve(conf.nb_packets);
+  dec.data_handler().recovery_latencies.reserve(conf.nb_packets);
+
+  auto capture = std::unique_ptr<ntc::packet_capture>{};
+  if (not conf.capture.empty())
+  {
+    auto capture_conf = ntc::packet_capture::configuration{};
+    capture_conf.galois_field_size = conf.galois_field_size;
+    capture_conf.ordered = ntc::in_order::yes;
+    capture.reset(new ntc::packet_capture{conf.capture, capture_conf});
+    dec.set_capture(capture.get());
+  }
+
+  auto encoder_cpu = std::chrono::nanoseconds{0};
+  auto decoder_cpu = std::chrono::nanoseconds{0};
+  const auto start = clock_type::now();
+
+  std::thread encoder_thread{[&]
+  {
+    const auto cpu_start = thread_cpu_time();
+    auto ack = ntc::packet{};
+    for (auto id = 0u; id < conf.nb_packets; ++id)
+    {
+      log.sent_date[id] = clock_type::now();
+      enc(generate_data(id, conf.packet_size));
+      while (to_encoder.try_pop(ack))
+      {
+        enc(std::move(ack));
+      }
+    }
+    // Protect the last sources.
+    enc.generate_repair();
+    encoder_done.store(true, std::memory_order_release);
+    encoder_cpu = thread_cpu_time() - cpu_start;
+  }};
+
+  std::thread decoder_thread{[&]
+  {
+    const auto cpu_start = thread_cpu_time();
+    auto pkt = ntc::packet{};
+    while (true)
+    {
+      if (to_decoder.try_pop(pkt))
+      {
+        dec(std::move(pkt));
+      }
+      else if (encoder_done.load(std::memory_order_acquire))
+      {
+        // Make sure nothing was pushed between the last pop and the end of the encoder.
+        if (not to_decoder.try_pop(pkt))
+        {
+          break;
+        }
+        dec(std::move(pkt));
+      }
+      else
+      {
+        std::this_thread::yield();
+      }
+    }
+    decoder_cpu = thread_cpu_time() - cpu_start;
+  }};
+
+  encoder_thread.join();
+  decoder_thread.join();
+  const auto elapsed = std::chrono::duration<double>{clock_type::now() - start}.count();
+
+  auto& data_handler = dec.data_handler();
+  const auto nb_bytes = static_cast<double>(data_handler.nb_bytes);
+  const auto per_byte = [&](std::chrono::nanoseconds cpu)
+  {
+    return nb_bytes > 0 ? static_cast<double>(cpu.count()) / nb_bytes : 0.;
+  };
+
+  std::cout
+    << "{\"packets\":" << conf.nb_packets
+    << ",\"packet_size\":" << conf.packet_size
+    << ",\"galois_field_size\":" << static_cast<unsigned int>(conf.galois_field_size)
+    << ",\"rate\":" << conf.rate
+    << ",\"window\":" << conf.window_size
+    << ",\"loss\":\"" << conf.loss << '"'
+    << ",\"seed\":" << conf.seed
+    << ",\"sent_packets\":" << enc.packet_handler().nb_sent
+    << ",\"sent_repairs\":" << enc.nb_sent_repairs()
+    << ",\"lost_packets\":" << enc.packet_handler().nb_lost
+    << ",\"lost_acks\":" << dec.packet_handler().nb_lost
+    << ",\"delivered\":" << data_handler.delivery_latencies.size()
+    << ",\"recovered\":" << data_handler.recovery_latencies.size()
+    << ",\"corrupted\":" << data_handler.nb_corrupted
+    << ",\"elapsed_s\":" << elapsed
+    << ",\"goodput_mbps\":" << (elapsed > 0 ? nb_bytes * 8 / elapsed / 1e6 : 0.)
+    << ",\"delivery_latency_us\":";
+  print_percentiles(std::cout, data_handler.delivery_latencies);
+  std::cout << ",\"recovery_latency_us\":";
+  print_percentiles(std::cout, data_handler.recovery_latencies);
+  std::cout
+    << ",\"encoder_cpu_ns_per_byte\":" << per_byte(encoder_cpu)
+    << ",\"decoder_cpu_ns_per_byte\":" << per_byte(decoder_cpu)
+    << "}\n";
+
+  return data_handler.nb_corrupted == 0 ? 0 : 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
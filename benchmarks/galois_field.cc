@@ -0,0 +1,64 @@
+#include "netcode/detail/buffer.hh"
+#include "netcode/detail/galois_field.hh"
+
+#include "benchmarks/benchmark.hh"
+
+namespace bench {
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+add_galois_field_benchmarks(registry& benchmarks, const sweep& s)
+{
+  for (const auto w : s.field_sizes)
+  {
+    for (const auto symbol_size : s.symbol_sizes)
+    {
+      benchmarks.push_back({ "galois_field::multiply", parameters(w, "symbol", symbol_size)
+                           , symbol_size
+                           , [=](state& st)
+                             {
+                               auto& gf = ntc::detail::thread_galois_field(w);
+                               const auto src = random_symbol(symbol_size, 0);
+                               auto dst = ntc::detail::byte_buffer(symbol_size);
+                               const auto coeff = gf.coefficient(1, 2);
+                               while (st.keep_running())
+                               {
+                                 gf.multiply(src.data(), dst.data(), symbol_size, coeff);
+                                 do_not_optimize(dst);
+                               }
+                             }});
+
+      benchmarks.push_back({ "galois_field::multiply_add", parameters(w, "symbol", symbol_size)
+                           , symbol_size
+                           , [=](state& st)
+                             {
+                               auto& gf = ntc::detail::thread_galois_field(w);
+                               const auto src = random_symbol(symbol_size, 0);
+                               auto dst = random_symbol(symbol_size, 1);
+                               const auto coeff = gf.coefficient(1, 2);
+                               while (st.keep_running())
+                               {
+                                 gf.multiply_add(src.data(), dst.data(), symbol_size, coeff);
+                                 do_not_optimize(dst);
+                               }
+                             }});
+    }
+
+    benchmarks.push_back({ "galois_field::multiply_size", parameters(w, "size", 1024), 0
+                         , [=](state& st)
+                           {
+                             auto& gf = ntc::detail::thread_galois_field(w);
+                             const auto coeff = gf.coefficient(1, 2);
+                             while (st.keep_running())
+                             {
+                               const auto res = gf.multiply_size(1024, coeff);
+                               do_not_optimize(res);
+                             }
+                           }});
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace bench
@@ -0,0 +1,50 @@
+#include "netcode/detail/galois_field.hh"
+#include "netcode/detail/invert_matrix.hh"
+#include "netcode/detail/square_matrix.hh"
+
+#include "benchmarks/benchmark.hh"
+
+namespace bench {
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+add_invert_matrix_benchmarks(registry& benchmarks, const sweep& s)
+{
+  for (const auto w : s.field_sizes)
+  {
+    for (const auto dimension : s.window_sizes)
+    {
+      // Invert the coefficients of as many repairs as missing sources, like a full decoding.
+      benchmarks.push_back({ "detail::invert", parameters(w, "dimension", dimension), 0
+                           , [=](state& st)
+                             {
+                               auto& gf = ntc::detail::thread_galois_field(w);
+                               auto coefficients = ntc::detail::square_matrix{dimension};
+                               for (auto col = 0u; col < dimension; ++col)
+                               {
+                                 for (auto row = 0u; row < dimension; ++row)
+                                 {
+                                   coefficients(row, col) = gf.coefficient(col, row);
+                                 }
+                               }
+                               auto mat = ntc::detail::square_matrix{dimension};
+                               auto inv = ntc::detail::square_matrix{dimension};
+                               while (st.keep_running())
+                               {
+                                 // invert() overwrites its input.
+                                 st.pause();
+                                 mat = coefficients;
+                                 st.resume();
+                                 const auto res = ntc::detail::invert(gf, mat, inv);
+                                 do_not_optimize(res);
+                                 do_not_optimize(inv);
+                               }
+                             }});
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace bench
@@ -0,0 +1,140 @@
+#include <algorithm> // copy_n
+#include <utility>   // move
+
+#include "netcode/detail/encoder.hh"
+#include "netcode/detail/packetizer.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/detail/source.hh"
+#include "netcode/detail/source_list.hh"
+
+#include "benchmarks/benchmark.hh"
+
+namespace bench {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+// Write packets in a buffer allocated once, like a socket would do.
+struct packet_handler
+{
+  ntc::detail::byte_buffer buffer = ntc::detail::byte_buffer(65536);
+  std::size_t size = 0;
+  std::size_t last_size = 0;
+
+  void
+  operator()(const char* data, std::size_t len)
+  noexcept
+  {
+    std::copy_n(data, len, buffer.data() + size);
+    size += len;
+  }
+
+  void
+  operator()()
+  noexcept
+  {
+    last_size = size;
+    size = 0;
+  }
+};
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+add_packetizer_benchmarks(registry& benchmarks, const sweep& s)
+{
+  for (const auto symbol_size : s.symbol_sizes)
+  {
+    benchmarks.push_back({ "packetizer::write_source", "symbol=" + std::to_string(symbol_size)
+                         , symbol_size
+                         , [=](state& st)
+                           {
+                             auto symbol = random_symbol(symbol_size, 0);
+                             const auto src = ntc::detail::encoder_source{0, std::move(symbol)};
+                             auto handler = packet_handler{};
+                             auto packetizer = ntc::detail::packetizer<packet_handler>{handler};
+                             while (st.keep_running())
+                             {
+                               packetizer.write_source(src);
+                               do_not_optimize(handler.buffer);
+                             }
+                           }});
+
+    benchmarks.push_back({ "packetizer::read_source", "symbol=" + std::to_string(symbol_size)
+                         , symbol_size
+                         , [=](state& st)
+                           {
+                             auto symbol = random_symbol(symbol_size, 0);
+                             const auto src = ntc::detail::encoder_source{0, std::move(symbol)};
+                             auto handler = packet_handler{};
+                             auto packetizer = ntc::detail::packetizer<packet_handler>{handler};
+                             packetizer.write_source(src);
+                             while (st.keep_running())
+                             {
+                               const auto res = packetizer.read_source( handler.buffer.data()
+                                                                      , handler.last_size);
+                               do_not_optimize(res);
+                             }
+                           }});
+  }
+
+  for (const auto w : s.field_sizes)
+  {
+    for (const auto window_size : s.window_sizes)
+    {
+      for (const auto symbol_size : s.symbol_sizes)
+      {
+        // A repair which encodes a full window, to measure the cost of its identifiers list.
+        const auto mk_repair = [=]
+        {
+          auto sources = ntc::detail::source_list{};
+          for (auto id = 0u; id < window_size; ++id)
+          {
+            sources.emplace(id, random_symbol(symbol_size, id));
+          }
+          auto repair = ntc::detail::encoder_repair{0};
+          ntc::detail::encoder{w}(repair, sources);
+          return repair;
+        };
+
+        benchmarks.push_back({ "packetizer::write_repair"
+                             , parameters(w, "window", window_size, "symbol", symbol_size)
+                             , symbol_size
+                             , [=](state& st)
+                               {
+                                 const auto repair = mk_repair();
+                                 auto handler = packet_handler{};
+                                 auto packetizer = ntc::detail::packetizer<packet_handler>{handler};
+                                 while (st.keep_running())
+                                 {
+                                   packetizer.write_repair(repair);
+                                   do_not_optimize(handler.buffer);
+                                 }
+                               }});
+
+        benchmarks.push_back({ "packetizer::read_repair"
+                             , parameters(w, "window", window_size, "symbol", symbol_size)
+                             , symbol_size
+                             , [=](state& st)
+                               {
+                                 auto handler = packet_handler{};
+                                 auto packetizer = ntc::detail::packetizer<packet_handler>{handler};
+                                 packetizer.write_repair(mk_repair());
+                                 while (st.keep_running())
+                                 {
+                                   const auto res = packetizer.read_repair( handler.buffer.data()
+                                                                          , handler.last_size);
+                                   do_not_optimize(res);
+                                 }
+                               }});
+      }
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace bench
@@ -1,10 +1,10 @@
 #include <chrono>
 #include <iostream>
-#include <memory>
 
 #include <boost/asio.hpp>
 
 #include "netcode/decoder.hh"
+#include "transport/mmsg.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -12,129 +12,59 @@ static constexpr auto buffer_size = 4096;
 
 /*------------------------------------------------------------------------------------------------*/
 
-namespace boost {
-namespace asio {
-
-/// @brief Make ntc::packet usable as a mutable buffer for Asio.
-inline
-mutable_buffers_1
-buffer(ntc::packet& p)
-{
-  return mutable_buffers_1{mutable_buffer{p.size() ? p.data() : nullptr, p.size()}};
-}
-
-} // namespace asio
-} // namespace boost
-
-/*------------------------------------------------------------------------------------------------*/
-
-using boost::asio::ip::address_v4;
 using boost::asio::ip::udp;
 
 /*------------------------------------------------------------------------------------------------*/
 
-/// @brief Called by encoder when a packet is ready to be written to the network
-class packet_handler
+/// @brief Convert an Asio IPv4 endpoint
+inline
+sockaddr_in
+to_sockaddr(const udp::endpoint& end)
 {
-public:
-
-  packet_handler(const packet_handler&) = delete;
-  packet_handler& operator=(const packet_handler&) = delete;
-
-  packet_handler(packet_handler&&) = default;
-
-  packet_handler(udp::socket& sock, udp::endpoint& end)
-    : m_socket(sock), m_endpoint(end), m_buffer()
-  {
-    m_buffer.reserve(buffer_size);
-  }
-
-  /// @brief This function is invoked repeatedly until the packet is complete
-  void
-  operator()(const char* data, std::size_t sz)
-  {
-    std::copy_n(data, sz, std::back_inserter(m_buffer));
-  }
-
-  /// @brief This function is invoked when the packet received by the previous callback is complete
-  void
-  operator()()
-  {
-    // End of packet, we can now send it.
-
-    auto buffer = std::make_shared<std::vector<char>>(std::move(m_buffer));
-    m_socket.async_send_to( boost::asio::buffer(*buffer), m_endpoint
-                          , [buffer](const boost::system::error_code& err, std::size_t len)
-                            {
-                              if (err)
-                              {
-                                throw std::runtime_error(err.message());
-                              }
-
-                              if (len != buffer->size())
-                              {
-                                throw std::runtime_error{"Invalid number of sent bytes"};
-                              }
-                            });
-    m_buffer.reserve(buffer_size);
-  }
-
-private:
-
-  udp::socket& m_socket;
-  udp::endpoint& m_endpoint;
-
-  std::vector<char> m_buffer;
-};
+  return *reinterpret_cast<const sockaddr_in*>(end.data());
+}
 
 /*------------------------------------------------------------------------------------------------*/
 
 /// @brief Called by decoder when a data has been decoded or received
+///
+/// Data are queued, then sent to the application with a single flush.
 class data_handler
 {
 public:
 
-  data_handler(udp::socket& sock, udp::endpoint& end)
-    : m_socket(sock), m_endpoint(end)
+  data_handler(transport::mmsg_udp& app)
+    : m_app(app)
   {}
 
   void
   operator()(const char* data, std::size_t sz)
   {
-    auto buffer = std::make_shared<std::vector<char>>(data, data + sz);
-    m_socket.async_send_to( boost::asio::buffer(*buffer), m_endpoint
-                          , [buffer](const boost::system::error_code& err, std::size_t len)
-                            {
-                              if (err)
-                              {
-                                throw std::runtime_error(err.message());
-                              }
-
-                              if (len != buffer->size())
-                              {
-                                throw std::runtime_error{"Invalid number of sent bytes"};
-                              }
-                            });
+    m_app.append(data, sz);
+    m_app.commit();
   }
 
 private:
 
-  udp::socket& m_socket;
-  udp::endpoint& m_endpoint;
+  transport::mmsg_udp& m_app;
 };
 
 /*------------------------------------------------------------------------------------------------*/
 
+using decoder_type = ntc::decoder<transport::mmsg_packet_handler, data_handler>;
+
+/*------------------------------------------------------------------------------------------------*/
+
 class netcode_handler
 {
 public:
 
-  netcode_handler( boost::asio::io_service& io, ntc::decoder<packet_handler, data_handler>& decoder
-                 , udp::socket& socket, udp::endpoint& end)
+  netcode_handler( boost::asio::io_service& io, decoder_type& decoder, udp::socket& socket
+                 , transport::mmsg_udp& netcode, transport::mmsg_udp& app)
     : m_decoder(decoder)
     , m_socket(socket)
-    , m_endpoint(end)
-    , m_packet(buffer_size)
+    , m_netcode(netcode)
+    , m_app(app)
     , m_ack_timer(io, std::chrono::milliseconds{1})
     , m_tunnel_up(false)
     , m_stats_timer(io, std::chrono::seconds(5))
@@ -146,27 +76,36 @@ public:
 
 private:
 
+  /// @brief Read all available packets in batches, then send acks and data
   void
   start()
   {
-    m_socket.async_receive_from( boost::asio::buffer(m_packet), m_endpoint
-                                , [this](const boost::system::error_code& err, std::size_t len)
-                                 {
-                                   if (err)
-                                   {
-                                     throw std::runtime_error(err.message());
-                                   }
-
-                                   if (len > 0)
-                                   {
-                                     m_packet.resize(len);
-                                     m_decoder(std::move(m_packet));
-                                     m_tunnel_up = true;
-                                     m_packet.resize(buffer_size);
-                                   }
-
-                                   start();
-                                 });
+    m_socket.async_wait( udp::socket::wait_read
+                       , [this](const boost::system::error_code& err)
+                        {
+                          if (err)
+                          {
+                            throw std::runtime_error(err.message());
+                          }
+
+                          const auto on_packet = [this](const char* data, std::size_t len)
+                          {
+                            if (len > 0)
+                            {
+                              // Acks go back to the sender of the last packet.
+                              m_netcode.set_destination(m_netcode.source());
+                              // Symbols are read in place from the receive slab.
+                              m_decoder(data, len);
+                              m_tunnel_up = true;
+                            }
+                          };
+                          while (m_netcode.receive(on_packet) != 0)
+                          {}
+                          m_app.flush();
+                          m_netcode.flush();
+
+                          start();
+                        });
   }
 
   void
@@ -182,6 +121,7 @@ private:
                              if (m_tunnel_up)
                              {
                                m_decoder.generate_ack();
+                               m_netcode.flush();
                              }
                              start_timer();
                            });
@@ -206,6 +146,8 @@ private:
                                  << "failed : " << m_decoder.nb_failed_full_decodings() << '\n'
                                  << "useless: " << m_decoder.nb_useless_repairs() << '\n'
                                  << "missing: " << m_decoder.nb_missing_sources() << '\n'
+                                 << "syscalls: " << m_netcode.stats().nb_syscalls << '\n'
+                                 << "GRO messages: " << m_netcode.stats().nb_gro_messages << '\n'
                                  << '\n'
                                  << std::endl;
 
@@ -216,10 +158,10 @@ private:
 
 private:
 
-  ntc::decoder<packet_handler, data_handler>& m_decoder;
+  decoder_type& m_decoder;
   udp::socket& m_socket;
-  udp::endpoint& m_endpoint;
-  ntc::packet m_packet;
+  transport::mmsg_udp& m_netcode;
+  transport::mmsg_udp& m_app;
   boost::asio::steady_timer m_ack_timer;
   bool m_tunnel_up;
   boost::asio::steady_timer m_stats_timer;
@@ -247,22 +189,30 @@ main(int argc, char** argv)
 
     udp::socket netcode_socket{io, udp::endpoint{udp::v4(), netcode_port}};
     netcode_socket.set_option(boost::asio::socket_base::receive_buffer_size{1 << 21});
-    udp::endpoint netcode_endpoint;
 
     udp::socket app_socket{io, udp::endpoint(udp::v4(), 0)};
     app_socket.set_option(boost::asio::socket_base::send_buffer_size{1 << 21});
     udp::resolver resolver(io);
     udp::endpoint app_endpoint = *resolver.resolve({udp::v4(), app_url, app_port});
 
-    ntc::decoder<packet_handler, data_handler>
-      decoder( 8, ntc::in_order::yes
-             , packet_handler{netcode_socket, netcode_endpoint}
-             , data_handler{app_socket, app_endpoint});
+    // Repairs hold the identifiers of their sources in addition to a symbol.
+    auto netcode_conf = transport::mmsg_udp::configuration{};
+    netcode_conf.max_packet_size = 2 * buffer_size;
+    transport::mmsg_udp netcode_transport{netcode_socket.native_handle(), netcode_conf};
 
+    auto app_conf = transport::mmsg_udp::configuration{};
+    app_conf.max_packet_size = buffer_size;
+    transport::mmsg_udp app_transport{app_socket.native_handle(), app_conf};
+    app_transport.set_destination(to_sockaddr(app_endpoint));
+
+    decoder_type
+      decoder( 8, ntc::in_order::yes
+             , transport::mmsg_packet_handler{&netcode_transport}
+             , data_handler{app_transport});
 
     decoder.set_ack_period(std::chrono::milliseconds{5});
     decoder.set_ack_nb_packets(64);
-    netcode_handler netcode{io, decoder, netcode_socket, netcode_endpoint};
+    netcode_handler netcode{io, decoder, netcode_socket, netcode_transport, app_transport};
     io.run();
   }
   catch (const ntc::packet_type_error& e)
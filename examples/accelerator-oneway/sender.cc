@@ -1,10 +1,10 @@
 #include <chrono>
 #include <iostream>
-#include <memory>
 
 #include <boost/asio.hpp>
 
 #include "netcode/encoder.hh"
+#include "transport/mmsg.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -12,89 +12,33 @@ static constexpr auto buffer_size = 4096;
 
 /*------------------------------------------------------------------------------------------------*/
 
-namespace boost {
-namespace asio {
-
-/// @brief Make ntc::packet usable as a mutable buffer for Asio.
-inline
-mutable_buffers_1
-buffer(ntc::packet& p)
-{
-  return mutable_buffers_1{mutable_buffer{p.size() ? p.data() : nullptr, p.size()}};
-}
-
-} // namespace asio
-} // namespace boost
-
-/*------------------------------------------------------------------------------------------------*/
-
-using boost::asio::ip::address_v4;
 using boost::asio::ip::udp;
 
 /*------------------------------------------------------------------------------------------------*/
 
-/// @brief Called by encoder when a packet is ready to be written to the network
-class packet_handler
+/// @brief Convert an Asio IPv4 endpoint
+inline
+sockaddr_in
+to_sockaddr(const udp::endpoint& end)
 {
-public:
-
-  packet_handler(const packet_handler&) = delete;
-  packet_handler& operator=(const packet_handler&) = delete;
-
-  packet_handler(packet_handler&&) = default;
-
-  packet_handler(udp::socket& sock, udp::endpoint& end)
-    : m_socket(sock), m_endpoint(end), m_buffer()
-  {
-    m_buffer.reserve(buffer_size);
-  }
-
-  /// @brief This function is invoked repeatedly until the packet is complete
-  void
-  operator()(const char* data, std::size_t sz)
-  {
-    std::copy_n(data, sz, std::back_inserter(m_buffer));
-  }
-
-  /// @brief This function is invoked when the packet received by the previous callback is complete
-  void
-  operator()()
-  {
-    auto buffer = std::make_shared<std::vector<char>>(std::move(m_buffer));
-    m_socket.async_send_to( boost::asio::buffer(*buffer), m_endpoint
-                           , [buffer](const boost::system::error_code& err, std::size_t len)
-                            {
-                              if (err)
-                              {
-                                throw std::runtime_error{err.message()};
-                              }
-
-                              if (len != buffer->size())
-                              {
-                                throw std::runtime_error{"Invalid number of sent bytes"};
-                              }
-                            });
-   m_buffer.reserve(buffer_size);
-  }
-
-private:
-
-  udp::socket& m_socket;
-  udp::endpoint& m_endpoint;
-  std::vector<char> m_buffer;
-};
+  return *reinterpret_cast<const sockaddr_in*>(end.data());
+}
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Gives data received from the application to the encoder
+///
+/// All available data are read in batches, encoded packets are then sent with a single flush.
 class app_handler
 {
 public:
 
-  app_handler(ntc::encoder<packet_handler>& encoder, udp::socket& socket, udp::endpoint& end)
+  app_handler( ntc::encoder<transport::mmsg_packet_handler>& encoder, udp::socket& socket
+             , transport::mmsg_udp& app, transport::mmsg_udp& netcode)
     : m_encoder(encoder)
     , m_socket(socket)
-    , m_endpoint(end)
-    , m_data(buffer_size)
+    , m_app(app)
+    , m_netcode(netcode)
   {
     start();
   }
@@ -104,46 +48,51 @@ private:
   void
   start()
   {
-    m_socket.async_receive_from( boost::asio::buffer(m_data), m_endpoint
-                                , [this](const boost::system::error_code& err, std::size_t len)
-                                 {
-                                   if (err)
-                                   {
-                                     throw std::runtime_error(err.message());
-                                   }
-
-                                   if (len > 0)
-                                   {
-                                     m_data.resize(len);
-                                     m_encoder(std::move(m_data));
-                                     m_data.resize(buffer_size);
-                                   }
-
-                                   start();
-                                 }
-                               );
+    m_socket.async_wait( udp::socket::wait_read
+                       , [this](const boost::system::error_code& err)
+                        {
+                          if (err)
+                          {
+                            throw std::runtime_error(err.message());
+                          }
+
+                          const auto on_data = [this](const char* data, std::size_t len)
+                          {
+                            if (len > 0)
+                            {
+                              m_encoder(ntc::data(data, data + len));
+                            }
+                          };
+                          while (m_app.receive(on_data) != 0)
+                          {}
+                          m_netcode.flush();
+
+                          start();
+                        });
   }
 
 private:
 
-  ntc::encoder<packet_handler>& m_encoder;
+  ntc::encoder<transport::mmsg_packet_handler>& m_encoder;
   udp::socket& m_socket;
-  udp::endpoint& m_endpoint;
-  ntc::data m_data;
+  transport::mmsg_udp& m_app;
+  transport::mmsg_udp& m_netcode;
 };
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Gives acks received from the decoder to the encoder
 class netcode_handler
 {
 public:
 
-  netcode_handler(boost::asio::io_service& io, ntc::encoder<packet_handler>& encoder, udp::socket& socket, udp::endpoint& end)
+  netcode_handler( boost::asio::io_service& io
+                 , ntc::encoder<transport::mmsg_packet_handler>& encoder, udp::socket& socket
+                 , transport::mmsg_udp& netcode)
     : m_encoder(encoder)
     , m_socket(socket)
-    , m_endpoint(end)
-    , m_packet(buffer_size)
-   , m_stats_timer(io, std::chrono::seconds(5))
+    , m_netcode(netcode)
+    , m_stats_timer(io, std::chrono::seconds(5))
   {
     start();
     start_stats_timer();
@@ -154,23 +103,25 @@ private:
   void
   start()
   {
-    m_socket.async_receive_from( boost::asio::buffer(m_packet), m_endpoint
-                                , [this](const boost::system::error_code& err, std::size_t len)
-                                 {
-                                   if (err)
-                                   {
-                                     throw std::runtime_error(err.message());
-                                   }
-
-                                   if (len > 0)
-                                   {
-                                     m_encoder(std::move(m_packet));
-                                     m_packet.resize(buffer_size);
-                                   }
-
-                                   start();
-                                 }
-                               );
+    m_socket.async_wait( udp::socket::wait_read
+                       , [this](const boost::system::error_code& err)
+                        {
+                          if (err)
+                          {
+                            throw std::runtime_error(err.message());
+                          }
+
+                          const auto on_ack = [this](const char* data, std::size_t len)
+                          {
+                            m_encoder(ntc::packet(data, data + len));
+                          };
+                          while (m_netcode.receive(on_ack) != 0)
+                          {}
+                          // Acks may trigger repairs.
+                          m_netcode.flush();
+
+                          start();
+                        });
   }
 
   void
@@ -190,6 +141,8 @@ private:
                                  << "out sources: " << m_encoder.nb_sent_sources() << '\n'
                                  << "window : " << m_encoder.window() << '\n'
                                  << "rate : " << m_encoder.rate() << '\n'
+                                 << "syscalls: " << m_netcode.stats().nb_syscalls << '\n'
+                                 << "GSO messages: " << m_netcode.stats().nb_gso_messages << '\n'
                                  << '\n'
                                  << std::endl;
 
@@ -199,10 +152,9 @@ private:
 
 private:
 
-  ntc::encoder<packet_handler>& m_encoder;
+  ntc::encoder<transport::mmsg_packet_handler>& m_encoder;
   udp::socket& m_socket;
-  udp::endpoint& m_endpoint;
-  ntc::packet m_packet;
+  transport::mmsg_udp& m_netcode;
   boost::asio::steady_timer m_stats_timer;
 };
 
@@ -227,19 +179,29 @@ main(int argc, char** argv)
 
     udp::socket app_socket{io, udp::endpoint{udp::v4(), app_port}};
     app_socket.set_option(boost::asio::socket_base::receive_buffer_size{1 << 21});
-    udp::endpoint app_endpoint;
 
     udp::socket netcode_socket{io, udp::endpoint(udp::v4(), 0)};
     netcode_socket.set_option(boost::asio::socket_base::send_buffer_size{1 << 21});
     udp::resolver resolver(io);
     udp::endpoint netcode_endpoint = *resolver.resolve({udp::v4(), server_url, server_port});
 
-    ntc::encoder<packet_handler> encoder(8, packet_handler{netcode_socket, netcode_endpoint});
+    auto app_conf = transport::mmsg_udp::configuration{};
+    app_conf.max_packet_size = buffer_size;
+    transport::mmsg_udp app_transport{app_socket.native_handle(), app_conf};
+
+    // Repairs hold the identifiers of their sources in addition to a symbol.
+    auto netcode_conf = transport::mmsg_udp::configuration{};
+    netcode_conf.max_packet_size = 2 * buffer_size;
+    transport::mmsg_udp netcode_transport{netcode_socket.native_handle(), netcode_conf};
+    netcode_transport.set_destination(to_sockaddr(netcode_endpoint));
+
+    ntc::encoder<transport::mmsg_packet_handler>
+      encoder(8, transport::mmsg_packet_handler{&netcode_transport});
     encoder.set_window_size(256);
     encoder.set_adaptive(true);
 
-    app_handler app{encoder, app_socket, app_endpoint};
-    netcode_handler netcode{io, encoder, netcode_socket, netcode_endpoint};
+    app_handler app{encoder, app_socket, app_transport, netcode_transport};
+    netcode_handler netcode{io, encoder, netcode_socket, netcode_transport};
 
     io.run();
   }
@@ -0,0 +1,520 @@
+#pragma once
+
+#include <algorithm> // copy_n, min
+#include <cerrno>
+#include <cstdint>
+#include <cstring>   // memcpy, strerror
+#include <stdexcept> // length_error, runtime_error
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>  // sockaddr_in
+#include <netinet/udp.h> // SOL_UDP, UDP_SEGMENT, UDP_GRO
+#include <poll.h>
+#include <sys/socket.h>  // sendmmsg, recvmmsg
+
+#include <netcode/packet.hh>
+
+namespace transport {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A UDP transport with sendmmsg/recvmmsg, and UDP GSO/GRO when the kernel supports them
+///
+/// - Outgoing packets are written by the encoder's or decoder's packet handler in a contiguous
+///   slab (see mmsg_packet_handler), then sent by flush() with a single sendmmsg. Consecutive
+///   packets of the same size, e.g. sources and repairs of fixed-size data, are given to the
+///   kernel as a single message segmented by UDP GSO.
+/// - Incoming datagrams are received by a single recvmmsg in one slab. With UDP GRO, the kernel
+///   coalesces datagrams of the same size, they are split back before being given to the
+///   application. Payloads are located like in a ntc::packet when possible, thus a decoder reads
+///   symbols in place.
+///
+/// It's a portable alternative to uring_udp: GSO needs Linux 4.18 and GRO Linux 5.0, older
+/// kernels fall back to plain sendmmsg/recvmmsg.
+/// A transport is not thread-safe: it's meant to be used by one event loop.
+class mmsg_udp final
+{
+public:
+
+  /// @brief The transport configuration
+  struct configuration
+  {
+    /// @brief The maximal number of packets sent by flush() or received by receive()
+    std::size_t batch = 64;
+
+    /// @brief The maximal size of a packet, larger received datagrams are truncated
+    std::size_t max_packet_size = 4096;
+
+    /// @brief Use UDP GSO to send packets if the kernel supports it
+    bool gso = true;
+
+    /// @brief Use UDP GRO to receive packets if the kernel supports it
+    bool gro = true;
+  };
+
+  /// @brief Statistics of a transport
+  struct statistics
+  {
+    std::size_t nb_sent = 0;
+    std::size_t nb_send_errors = 0;
+    std::size_t nb_received = 0;
+    std::size_t nb_truncated = 0;
+
+    /// @brief The number of sendmmsg and recvmmsg system calls
+    std::size_t nb_syscalls = 0;
+
+    /// @brief The number of messages sent with several GSO segments
+    std::size_t nb_gso_messages = 0;
+
+    /// @brief The number of received messages coalesced by GRO
+    std::size_t nb_gro_messages = 0;
+  };
+
+  mmsg_udp(const mmsg_udp&) = delete;
+  mmsg_udp& operator=(const mmsg_udp&) = delete;
+
+  /// @brief Constructor with the default configuration
+  /// @param fd A bound UDP socket, which shall outlive the transport
+  explicit mmsg_udp(int fd)
+    : mmsg_udp{fd, configuration{}}
+  {}
+
+  /// @brief Constructor
+  /// @param fd A bound UDP socket, which shall outlive the transport
+  /// @param conf The transport configuration
+  mmsg_udp(int fd, const configuration& conf)
+    : m_socket{fd}
+    , m_conf(conf)
+    , m_gso{conf.gso and supports_gso(fd)}
+    , m_gro{conf.gro and enable_gro(fd)}
+    , m_send_slab(conf.batch * conf.max_packet_size)
+    , m_sizes{}
+    , m_send_size{0}
+    , m_current_size{0}
+    , m_writing{false}
+    , m_send_messages(conf.batch)
+    , m_send_iovecs(conf.batch)
+    , m_send_controls(conf.batch)
+    , m_first_packets(conf.batch + 1)
+    , m_destination{}
+    , m_receive_stride{round_up(m_gro ? static_cast<std::size_t>(max_gro_size)
+                                      : conf.max_packet_size) + alignment}
+    , m_receive_slab(conf.batch * m_receive_stride + alignment)
+    , m_receive_messages(conf.batch)
+    , m_receive_iovecs(conf.batch)
+    , m_receive_controls(conf.batch)
+    , m_sources(conf.batch)
+    , m_source{}
+    , m_stats{}
+  {
+    m_sizes.reserve(conf.batch);
+  }
+
+  /// @brief Set where packets are sent
+  void
+  set_destination(const sockaddr_in& destination)
+  noexcept
+  {
+    m_destination = destination;
+  }
+
+  /// @brief Get where packets are sent
+  const sockaddr_in&
+  destination()
+  const noexcept
+  {
+    return m_destination;
+  }
+
+  /// @brief Get the sender of the last received datagram
+  const sockaddr_in&
+  source()
+  const noexcept
+  {
+    return m_source;
+  }
+
+  /// @brief Tell if packets are sent with UDP GSO
+  bool
+  gso()
+  const noexcept
+  {
+    return m_gso;
+  }
+
+  /// @brief Tell if packets are received with UDP GRO
+  bool
+  gro()
+  const noexcept
+  {
+    return m_gro;
+  }
+
+  /// @brief Append bytes to the packet being written
+  /// @throw std::length_error if the packet is larger than configuration::max_packet_size
+  void
+  append(const char* data, std::size_t size)
+  {
+    if (not m_writing)
+    {
+      if (m_sizes.size() == m_conf.batch)
+      {
+        flush();
+      }
+      m_writing = true;
+      m_current_size = 0;
+    }
+    if (m_current_size + size > m_conf.max_packet_size)
+    {
+      throw std::length_error{"packet too large"};
+    }
+    std::copy_n(data, size, m_send_slab.data() + m_send_size + m_current_size);
+    m_current_size += size;
+  }
+
+  /// @brief Queue the packet being written, it's sent by the next flush()
+  void
+  commit()
+  noexcept
+  {
+    if (not m_writing)
+    {
+      return;
+    }
+    m_sizes.push_back(m_current_size);
+    m_send_size += m_current_size;
+    m_writing = false;
+  }
+
+  /// @brief Send all queued packets
+  /// @note Must not be called while a packet is being written
+  /// @note Blocks until the socket accepts them, even if it's non-blocking
+  void
+  flush()
+  {
+    auto first = 0ul;
+    while (first != m_sizes.size())
+    {
+      const auto nb_messages = prepare_messages(first);
+      auto sent = 0u;
+      while (sent != nb_messages)
+      {
+        ++m_stats.nb_syscalls;
+        const auto res = ::sendmmsg(m_socket, &m_send_messages[sent], nb_messages - sent, 0);
+        if (res >= 0)
+        {
+          for (auto i = sent; i < sent + static_cast<unsigned int>(res); ++i)
+          {
+            m_stats.nb_sent += nb_segments(i);
+            m_stats.nb_gso_messages += nb_segments(i) > 1;
+          }
+          sent += static_cast<unsigned int>(res);
+        }
+        else if (errno == EAGAIN or errno == EWOULDBLOCK)
+        {
+          auto pfd = pollfd{m_socket, POLLOUT, 0};
+          ::poll(&pfd, 1, -1);
+        }
+        else if (errno == EINTR)
+        {
+          continue;
+        }
+        else if (m_gso and nb_segments(sent) > 1)
+        {
+          // The device can't segment, e.g. it has no checksum offload. Send packets one by one.
+          m_gso = false;
+          break;
+        }
+        else
+        {
+          m_stats.nb_send_errors += nb_segments(sent);
+          ++sent;
+        }
+      }
+      first = sent == nb_messages ? m_sizes.size() : m_first_packets[sent];
+    }
+    m_sizes.clear();
+    m_send_size = 0;
+  }
+
+  /// @brief Receive available datagrams with a single recvmmsg, give them to @p fn
+  /// @param fn Called with each received datagram as fn(const char*, std::size_t); it can send
+  /// packets, e.g. by giving the datagram to a decoder which sends acks
+  /// @return The number of received datagrams, 0 if none was available
+  /// @note Doesn't block, even if the socket is blocking
+  template <typename Fn>
+  std::size_t
+  receive(Fn&& fn)
+  {
+    const auto base = aligned_receive_slab();
+    for (auto i = 0ul; i < m_conf.batch; ++i)
+    {
+      m_receive_iovecs[i] = iovec{base + i * m_receive_stride, m_receive_stride - alignment};
+      auto& hdr = m_receive_messages[i].msg_hdr;
+      hdr = msghdr{};
+      hdr.msg_name = &m_sources[i];
+      hdr.msg_namelen = sizeof(sockaddr_in);
+      hdr.msg_iov = &m_receive_iovecs[i];
+      hdr.msg_iovlen = 1;
+      if (m_gro)
+      {
+        hdr.msg_control = m_receive_controls[i].buf;
+        hdr.msg_controllen = sizeof(m_receive_controls[i].buf);
+      }
+    }
+    ++m_stats.nb_syscalls;
+    const auto res = ::recvmmsg( m_socket, m_receive_messages.data()
+                               , static_cast<unsigned int>(m_conf.batch), MSG_DONTWAIT, nullptr);
+    if (res < 0)
+    {
+      if (errno == EAGAIN or errno == EWOULDBLOCK or errno == EINTR)
+      {
+        return 0;
+      }
+      throw std::runtime_error{std::string{"recvmmsg: "} + std::strerror(errno)};
+    }
+
+    auto nb_received = 0ul;
+    for (auto i = 0ul; i < static_cast<std::size_t>(res); ++i)
+    {
+      const auto& hdr = m_receive_messages[i].msg_hdr;
+      if (hdr.msg_flags & MSG_TRUNC)
+      {
+        ++m_stats.nb_truncated;
+        continue;
+      }
+      const auto data = static_cast<const char*>(m_receive_iovecs[i].iov_base);
+      const auto size = static_cast<std::size_t>(m_receive_messages[i].msg_len);
+      const auto segment_size = gro_segment_size(hdr, size);
+      m_stats.nb_gro_messages += segment_size < size;
+      m_source = m_sources[i];
+      for (auto offset = 0ul; offset < size; offset += segment_size)
+      {
+        ++m_stats.nb_received;
+        ++nb_received;
+        fn(data + offset, std::min(segment_size, size - offset));
+      }
+    }
+    return nb_received;
+  }
+
+  /// @brief Get the statistics of the transport
+  const statistics&
+  stats()
+  const noexcept
+  {
+    return m_stats;
+  }
+
+private:
+
+  /// @brief Storage for one control message of an int, aligned for cmsghdr
+  union control
+  {
+    char buf[CMSG_SPACE(sizeof(int))];
+    cmsghdr align;
+  };
+
+  /// @brief The alignment of symbols in receive buffers
+  static constexpr auto alignment = std::size_t{16};
+
+  /// @brief The maximal number of segments of a GSO message (UDP_MAX_SEGMENTS)
+  static constexpr auto max_gso_segments = std::size_t{64};
+
+  /// @brief The maximal payload of a GSO message, which is a single IPv4 datagram
+  static constexpr auto max_gso_size = std::size_t{65507};
+
+  /// @brief The size of a receive buffer with GRO, which may coalesce up to 64KB
+  static constexpr auto max_gro_size = std::size_t{65536};
+
+  static
+  std::size_t
+  round_up(std::size_t size)
+  noexcept
+  {
+    return (size + alignment - 1) / alignment * alignment;
+  }
+
+  static
+  bool
+  supports_gso(int fd)
+  noexcept
+  {
+    auto value = 0;
+    auto len = static_cast<socklen_t>(sizeof(value));
+    return ::getsockopt(fd, SOL_UDP, UDP_SEGMENT, &value, &len) == 0;
+  }
+
+  static
+  bool
+  enable_gro(int fd)
+  noexcept
+  {
+    const auto value = 1;
+    return ::setsockopt(fd, SOL_UDP, UDP_GRO, &value, sizeof(value)) == 0;
+  }
+
+  /// @brief The first receive buffer, such that payloads are located like in a ntc::packet
+  char*
+  aligned_receive_slab()
+  noexcept
+  {
+    const auto addr = reinterpret_cast<std::uintptr_t>(m_receive_slab.data());
+    const auto shift = static_cast<std::uintptr_t>(ntc::packet::shift);
+    return m_receive_slab.data() + (shift + alignment - addr % alignment) % alignment;
+  }
+
+  /// @brief Get the size of segments coalesced by GRO, @p size if there are none
+  static
+  std::size_t
+  gro_segment_size(const msghdr& hdr, std::size_t size)
+  noexcept
+  {
+    for (auto cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&hdr), cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_UDP and cmsg->cmsg_type == UDP_GRO)
+      {
+        auto segment_size = 0;
+        std::memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+        return segment_size > 0 ? static_cast<std::size_t>(segment_size) : size;
+      }
+    }
+    return size;
+  }
+
+  /// @brief Build messages for queued packets, from packet @p first
+  /// @return The number of messages
+  ///
+  /// With GSO, a message holds consecutive packets of the same size, the last one may be
+  /// shorter.
+  unsigned int
+  prepare_messages(std::size_t first)
+  {
+    auto offset = 0ul;
+    for (auto i = 0ul; i < first; ++i)
+    {
+      offset += m_sizes[i];
+    }
+    auto nb_messages = 0u;
+    for (auto i = first; i < m_sizes.size(); ++nb_messages)
+    {
+      const auto segment_size = m_sizes[i];
+      auto size = segment_size;
+      auto j = i + 1;
+      while (  m_gso and j < m_sizes.size() and j - i < max_gso_segments
+            and m_sizes[j] <= segment_size and size + m_sizes[j] <= max_gso_size)
+      {
+        size += m_sizes[j++];
+        if (m_sizes[j - 1] < segment_size)
+        {
+          break;
+        }
+      }
+
+      m_first_packets[nb_messages] = i;
+      m_send_iovecs[nb_messages] = iovec{m_send_slab.data() + offset, size};
+      auto& hdr = m_send_messages[nb_messages].msg_hdr;
+      hdr = msghdr{};
+      hdr.msg_name = &m_destination;
+      hdr.msg_namelen = sizeof(sockaddr_in);
+      hdr.msg_iov = &m_send_iovecs[nb_messages];
+      hdr.msg_iovlen = 1;
+      if (j - i > 1)
+      {
+        hdr.msg_control = m_send_controls[nb_messages].buf;
+        hdr.msg_controllen = CMSG_SPACE(sizeof(std::uint16_t));
+        auto cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+        const auto gso_size = static_cast<std::uint16_t>(segment_size);
+        std::memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+      }
+      offset += size;
+      i = j;
+    }
+    m_first_packets[nb_messages] = m_sizes.size();
+    return nb_messages;
+  }
+
+  /// @brief The number of packets in a prepared message
+  std::size_t
+  nb_segments(unsigned int message)
+  const noexcept
+  {
+    return m_first_packets[message + 1] - m_first_packets[message];
+  }
+
+  /// @brief The UDP socket
+  const int m_socket;
+
+  const configuration m_conf;
+
+  bool m_gso;
+  const bool m_gro;
+
+  /// @brief Queued packets, contiguous
+  std::vector<char> m_send_slab;
+
+  /// @brief The size of each queued packet
+  std::vector<std::size_t> m_sizes;
+
+  /// @brief The number of bytes of queued packets
+  std::size_t m_send_size;
+
+  /// @brief The size of the packet being written, after queued ones
+  std::size_t m_current_size;
+
+  /// @brief Tell if a packet is being written
+  bool m_writing;
+
+  std::vector<mmsghdr> m_send_messages;
+  std::vector<iovec> m_send_iovecs;
+  std::vector<control> m_send_controls;
+
+  /// @brief The index of the first packet of each message, followed by the number of packets
+  std::vector<std::size_t> m_first_packets;
+
+  sockaddr_in m_destination;
+
+  /// @brief The distance between two receive buffers
+  const std::size_t m_receive_stride;
+
+  /// @brief All receive buffers
+  std::vector<char> m_receive_slab;
+
+  std::vector<mmsghdr> m_receive_messages;
+  std::vector<iovec> m_receive_iovecs;
+  std::vector<control> m_receive_controls;
+  std::vector<sockaddr_in> m_sources;
+
+  /// @brief The sender of the last received datagram
+  sockaddr_in m_source;
+
+  statistics m_stats;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A packet handler for ntc::encoder and ntc::decoder which queues packets in a mmsg_udp
+struct mmsg_packet_handler
+{
+  mmsg_udp* transport;
+
+  void
+  operator()(const char* data, std::size_t size)
+  {
+    transport->append(data, size);
+  }
+
+  void
+  operator()()
+  {
+    transport->commit();
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace transport
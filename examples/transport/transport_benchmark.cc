@@ -0,0 +1,509 @@
+#include <algorithm> // fill_n
+#include <atomic>
+#include <chrono>
+#include <cstdlib>   // exit
+#include <cstring>   // strerror
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept> // runtime_error
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>  // htonl
+#include <netinet/in.h> // sockaddr_in
+#include <poll.h>
+#include <sys/socket.h> // socket, bind
+#include <unistd.h>     // close
+
+#include <boost/asio.hpp>
+
+#include <netcode/decoder.hh>
+#include <netcode/encoder.hh>
+
+#include "transport/mmsg.hh"
+#include "transport/uring.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Send data through an encoder and a decoder over loopback, with Asio (one system call per packet,
+// like examples/accelerator), with the sendmmsg/recvmmsg transport or with the io_uring transport,
+// then compare throughputs.
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+using clock_type = std::chrono::steady_clock;
+using boost::asio::ip::udp;
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct configuration
+{
+  std::vector<std::string> modes;
+  std::size_t nb_data = 100000;
+  std::size_t data_size = 1024;
+
+  // The number of data given to the encoder between two flushes of the mmsg and io_uring
+  // transports.
+  std::size_t batch = 32;
+
+  std::size_t code_rate = 5;
+  std::size_t window_size = 256;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct result
+{
+  std::chrono::nanoseconds duration{0};
+  std::size_t nb_sent_packets = 0;
+  std::size_t nb_received_packets = 0;
+  std::size_t nb_delivered = 0;
+  std::size_t nb_syscalls = 0;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+[[noreturn]]
+void
+usage(const char* name)
+{
+  std::cerr
+    << "Usage:\n" << name << " [asio|mmsg|uring]... [options]\n"
+    << "  --data n      number of data (100000)\n"
+    << "  --size bytes  size of data (1024)\n"
+    << "  --batch n     data between two flushes of mmsg and io_uring (32)\n"
+    << "  --rate n      sources per repair (5)\n"
+    << "  --window n    maximal window size (256)\n";
+  std::exit(1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+configuration
+read_configuration(int argc, const char** argv)
+{
+  auto conf = configuration{};
+  for (auto i = 1; i < argc; ++i)
+  {
+    const auto arg = std::string{argv[i]};
+    if (arg == "asio" or arg == "mmsg" or arg == "uring")
+    {
+      conf.modes.push_back(arg);
+      continue;
+    }
+    if (i + 1 == argc)
+    {
+      usage(argv[0]);
+    }
+    try
+    {
+      const auto value = std::stoul(argv[++i]);
+      if      (arg == "--data")   conf.nb_data = value;
+      else if (arg == "--size")   conf.data_size = value;
+      else if (arg == "--batch")  conf.batch = std::max(1ul, value);
+      else if (arg == "--rate")   conf.code_rate = value;
+      else if (arg == "--window") conf.window_size = value;
+      else                        usage(argv[0]);
+    }
+    catch (const std::exception&)
+    {
+      usage(argv[0]);
+    }
+  }
+  if (conf.modes.empty())
+  {
+    conf.modes = {"asio", "mmsg", "uring"};
+  }
+  return conf;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+ntc::data
+make_data(std::size_t size)
+{
+  auto data = ntc::data(size);
+  std::fill_n(data.data(), size, 'x');
+  data.resize(size);
+  return data;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Counts delivered data, and stops the receiver when all were delivered.
+struct data_handler
+{
+  std::size_t* nb_delivered;
+
+  void
+  operator()(const char*, std::size_t)
+  {
+    ++*nb_delivered;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Stop the receiver when nothing was received during this period, after the sender finished.
+constexpr auto idle_timeout = std::chrono::milliseconds{200};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Accumulate a packet in a vector, then send it with a blocking send_to, like
+// examples/accelerator/transcoder.hh.
+class asio_packet_handler
+{
+public:
+
+  asio_packet_handler(udp::socket& socket, udp::endpoint& endpoint, std::size_t& nb_sent)
+    : m_socket(socket), m_endpoint(endpoint), m_nb_sent(nb_sent), m_buffer()
+  {}
+
+  void
+  operator()(const char* data, std::size_t sz)
+  {
+    std::copy_n(data, sz, std::back_inserter(m_buffer));
+  }
+
+  void
+  operator()()
+  {
+    m_socket.send_to(boost::asio::buffer(m_buffer), m_endpoint);
+    m_buffer.clear();
+    ++m_nb_sent;
+  }
+
+private:
+
+  udp::socket& m_socket;
+  udp::endpoint& m_endpoint;
+  std::size_t& m_nb_sent;
+  std::vector<char> m_buffer;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+result
+run_asio(const configuration& conf)
+{
+  auto res = result{};
+  std::atomic<bool> sender_done{false};
+  boost::asio::io_service io;
+
+  udp::socket receiver_socket{io, udp::endpoint{boost::asio::ip::address_v4::loopback(), 0}};
+  receiver_socket.set_option(boost::asio::socket_base::receive_buffer_size{1 << 22});
+  udp::socket sender_socket{io, udp::endpoint{boost::asio::ip::address_v4::loopback(), 0}};
+  auto receiver_endpoint = receiver_socket.local_endpoint();
+  auto sender_endpoint = sender_socket.local_endpoint();
+  auto last_receive = clock_type::now();
+  const auto start = clock_type::now();
+
+  auto receiver = std::thread{[&]
+  {
+    auto nb_sent_acks = 0ul;
+    ntc::decoder<asio_packet_handler, data_handler> decoder{
+      8, ntc::in_order::yes, asio_packet_handler{receiver_socket, sender_endpoint, nb_sent_acks}
+      , data_handler{&res.nb_delivered}};
+    auto source = udp::endpoint{};
+    auto packet = ntc::packet(4096);
+    boost::asio::steady_timer idle_timer{io};
+    std::function<void()> receive = [&]
+    {
+      receiver_socket.async_receive_from( boost::asio::buffer(packet.data(), packet.size())
+                                        , source
+                                        , [&](const boost::system::error_code& err, std::size_t len)
+      {
+        if (err)
+        {
+          return;
+        }
+        last_receive = clock_type::now();
+        ++res.nb_received_packets;
+        packet.resize(len);
+        decoder(std::move(packet));
+        packet = ntc::packet(4096);
+        if (res.nb_delivered == conf.nb_data)
+        {
+          io.stop();
+          return;
+        }
+        receive();
+      });
+    };
+    std::function<void()> check_idle = [&]
+    {
+      idle_timer.expires_from_now(idle_timeout);
+      idle_timer.async_wait([&](const boost::system::error_code&)
+      {
+        if (sender_done and clock_type::now() - last_receive > idle_timeout)
+        {
+          io.stop();
+          return;
+        }
+        check_idle();
+      });
+    };
+    receive();
+    check_idle();
+    io.run();
+  }};
+
+  ntc::encoder<asio_packet_handler> encoder{
+    8, asio_packet_handler{sender_socket, receiver_endpoint, res.nb_sent_packets}};
+  encoder.set_rate(conf.code_rate);
+  encoder.set_window_size(conf.window_size);
+  auto ack = ntc::packet(4096);
+  for (auto i = 0ul; i < conf.nb_data; ++i)
+  {
+    encoder(make_data(conf.data_size));
+    while (sender_socket.available() != 0)
+    {
+      ack.resize(4096);
+      ack.resize(sender_socket.receive(boost::asio::buffer(ack.data(), ack.size())));
+      encoder(std::move(ack));
+      ack = ntc::packet(4096);
+    }
+  }
+  sender_done = true;
+  receiver.join();
+
+  res.duration = last_receive - start;
+  res.nb_syscalls = res.nb_sent_packets + res.nb_received_packets;
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+bound_socket(sockaddr_in& addr)
+{
+  const auto fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0)
+  {
+    throw std::runtime_error{std::string{"socket: "} + std::strerror(errno)};
+  }
+  const auto size = 1 << 22;
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  addr = sockaddr_in{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  auto len = static_cast<socklen_t>(sizeof(addr));
+  if (  ::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0
+     or ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+  {
+    ::close(fd);
+    throw std::runtime_error{std::string{"bind: "} + std::strerror(errno)};
+  }
+  return fd;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+result
+run_mmsg(const configuration& conf)
+{
+  auto res = result{};
+  std::atomic<bool> sender_done{false};
+  auto receiver_addr = sockaddr_in{};
+  auto sender_addr = sockaddr_in{};
+  const auto receiver_fd = bound_socket(receiver_addr);
+  const auto sender_fd = bound_socket(sender_addr);
+  auto last_receive = clock_type::now();
+  const auto start = clock_type::now();
+
+  transport::mmsg_udp receiver_mmsg{receiver_fd};
+  receiver_mmsg.set_destination(sender_addr);
+  transport::mmsg_udp sender_mmsg{sender_fd};
+  sender_mmsg.set_destination(receiver_addr);
+
+  auto receiver = std::thread{[&]
+  {
+    auto& mmsg = receiver_mmsg;
+    ntc::decoder<transport::mmsg_packet_handler, data_handler> decoder{
+      8, ntc::in_order::yes, transport::mmsg_packet_handler{&mmsg}
+      , data_handler{&res.nb_delivered}};
+    const auto on_packet = [&](const char* data, std::size_t size){decoder(data, size);};
+    while (res.nb_delivered != conf.nb_data)
+    {
+      auto pfd = pollfd{receiver_fd, POLLIN, 0};
+      ::poll(&pfd, 1, static_cast<int>(idle_timeout.count()));
+      auto nb = 0ul;
+      for (auto n = mmsg.receive(on_packet); n != 0; n = mmsg.receive(on_packet))
+      {
+        nb += n;
+      }
+      mmsg.flush();
+      if (nb != 0)
+      {
+        last_receive = clock_type::now();
+        res.nb_received_packets += nb;
+      }
+      else if (sender_done and clock_type::now() - last_receive > idle_timeout)
+      {
+        break;
+      }
+    }
+    res.nb_syscalls += mmsg.stats().nb_syscalls;
+  }};
+
+  {
+    auto& mmsg = sender_mmsg;
+    ntc::encoder<transport::mmsg_packet_handler> encoder{
+      8, transport::mmsg_packet_handler{&mmsg}};
+    encoder.set_rate(conf.code_rate);
+    encoder.set_window_size(conf.window_size);
+    const auto on_ack = [&](const char* data, std::size_t size)
+    {
+      encoder(ntc::packet(data, data + size));
+    };
+    for (auto i = 0ul; i < conf.nb_data; ++i)
+    {
+      encoder(make_data(conf.data_size));
+      if ((i + 1) % conf.batch == 0)
+      {
+        mmsg.flush();
+        while (mmsg.receive(on_ack) != 0)
+        {}
+      }
+    }
+    mmsg.flush();
+    res.nb_sent_packets = mmsg.stats().nb_sent;
+    res.nb_syscalls += mmsg.stats().nb_syscalls;
+  }
+  sender_done = true;
+  receiver.join();
+  ::close(receiver_fd);
+  ::close(sender_fd);
+
+  res.duration = last_receive - start;
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+result
+run_uring(const configuration& conf)
+{
+  auto res = result{};
+  std::atomic<bool> sender_done{false};
+  auto receiver_addr = sockaddr_in{};
+  auto sender_addr = sockaddr_in{};
+  const auto receiver_fd = bound_socket(receiver_addr);
+  const auto sender_fd = bound_socket(sender_addr);
+  auto last_receive = clock_type::now();
+  const auto start = clock_type::now();
+
+  // Set up both transports before starting the receiver, which may throw.
+  transport::uring_udp receiver_uring{receiver_fd};
+  receiver_uring.set_destination(sender_addr);
+  transport::uring_udp sender_uring{sender_fd};
+  sender_uring.set_destination(receiver_addr);
+
+  auto receiver = std::thread{[&]
+  {
+    auto& uring = receiver_uring;
+    ntc::decoder<transport::uring_packet_handler, data_handler> decoder{
+      8, ntc::in_order::yes, transport::uring_packet_handler{&uring}
+      , data_handler{&res.nb_delivered}};
+    while (res.nb_delivered != conf.nb_data)
+    {
+      // Symbols are read in place from the receive buffers.
+      const auto nb = uring.poll( [&](const char* data, std::size_t size){decoder(data, size);}
+                                    , idle_timeout);
+      uring.flush();
+      if (nb != 0)
+      {
+        last_receive = clock_type::now();
+        res.nb_received_packets += nb;
+      }
+      else if (sender_done and clock_type::now() - last_receive > idle_timeout)
+      {
+        break;
+      }
+    }
+    res.nb_syscalls += uring.stats().nb_syscalls;
+  }};
+
+  {
+    auto& uring = sender_uring;
+    ntc::encoder<transport::uring_packet_handler> encoder{
+      8, transport::uring_packet_handler{&uring}};
+    encoder.set_rate(conf.code_rate);
+    encoder.set_window_size(conf.window_size);
+    const auto on_ack = [&](const char* data, std::size_t size)
+    {
+      encoder(ntc::packet(data, data + size));
+    };
+    for (auto i = 0ul; i < conf.nb_data; ++i)
+    {
+      encoder(make_data(conf.data_size));
+      if ((i + 1) % conf.batch == 0)
+      {
+        uring.poll(on_ack, std::chrono::milliseconds{0});
+      }
+    }
+    uring.flush();
+    // Wait for the last sends.
+    while (uring.stats().nb_sent + uring.stats().nb_send_errors
+           < encoder.nb_sent_sources() + encoder.nb_sent_repairs())
+    {
+      uring.poll(on_ack, std::chrono::milliseconds{10});
+    }
+    res.nb_sent_packets = uring.stats().nb_sent;
+    res.nb_syscalls += uring.stats().nb_syscalls;
+  }
+  sender_done = true;
+  receiver.join();
+  ::close(receiver_fd);
+  ::close(sender_fd);
+
+  res.duration = last_receive - start;
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, const char** argv)
+{
+  const auto conf = read_configuration(argc, argv);
+  try
+  {
+    std::cout << "mode  sent      received  delivered  time(s)  data/s     Mbit/s  "
+              << "syscalls/packet\n";
+    for (const auto& mode : conf.modes)
+    {
+      const auto res = mode == "asio" ? run_asio(conf)
+                     : mode == "mmsg" ? run_mmsg(conf)
+                     : run_uring(conf);
+      const auto s = std::chrono::duration<double>(res.duration).count();
+      const auto rate = s > 0 ? static_cast<double>(res.nb_delivered) / s : 0.;
+      const auto nb_packets = std::max<std::size_t>(1, res.nb_sent_packets
+                                                       + res.nb_received_packets);
+      std::cout << std::left << std::setw(6) << mode << std::setw(10) << res.nb_sent_packets
+                << std::setw(10) << res.nb_received_packets << std::setw(11) << res.nb_delivered
+                << std::fixed << std::setprecision(3) << std::setw(9) << s
+                << std::setprecision(0) << std::setw(11) << rate
+                << std::setprecision(1) << std::setw(8)
+                << rate * static_cast<double>(conf.data_size) * 8 / 1e6
+                << std::setprecision(3)
+                << static_cast<double>(res.nb_syscalls) / static_cast<double>(nb_packets) << '\n';
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << '\n';
+    return 2;
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,741 @@
+#pragma once
+
+#include <algorithm> // copy_n, max
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>   // memset, strerror
+#include <stdexcept> // length_error, runtime_error
+#include <string>
+#include <utility>   // swap
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <netinet/in.h>  // sockaddr_in
+#include <signal.h>      // _NSIG
+#include <sys/mman.h>    // mmap
+#include <sys/socket.h>  // msghdr
+#include <sys/syscall.h> // __NR_io_uring_*
+#include <unistd.h>      // close, syscall
+
+#include <netcode/packet.hh>
+
+namespace transport {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A UDP transport on io_uring, without liburing
+///
+/// - Outgoing packets are written by the encoder's or decoder's packet handler directly in
+///   registered buffers (see uring_packet_handler), then sent in batches: a single system call
+///   submits all packets committed since the last flush() or poll().
+/// - Incoming datagrams are received by a single multishot recvmsg, in buffers the kernel picks
+///   from a ring of provided buffers. Their payload is located like in a ntc::packet, thus a
+///   decoder reads symbols in place.
+///
+/// A transport is not thread-safe: it's meant to be used by one event loop.
+class uring_udp final
+{
+public:
+
+  /// @brief The transport configuration
+  struct configuration
+  {
+    /// @brief The number of entries of the submission queue
+    unsigned int nb_entries = 512;
+
+    /// @brief The number of receive buffers, a power of 2
+    unsigned int nb_receive_buffers = 512;
+
+    /// @brief The size of a receive buffer, a multiple of 16, larger datagrams are truncated
+    std::size_t receive_buffer_size = 4096;
+
+    /// @brief The number of send buffers, which is the maximal number of packets in flight
+    unsigned int nb_send_buffers = 256;
+
+    /// @brief The size of a send buffer, which is the maximal size of a packet
+    std::size_t send_buffer_size = 4096;
+  };
+
+  /// @brief Statistics of a transport
+  struct statistics
+  {
+    std::size_t nb_sent = 0;
+    std::size_t nb_send_errors = 0;
+    std::size_t nb_received = 0;
+    std::size_t nb_truncated = 0;
+
+    /// @brief The number of io_uring_enter system calls
+    std::size_t nb_syscalls = 0;
+
+    /// @brief The number of times multishot receive stopped, e.g. when all buffers were used
+    std::size_t nb_rearms = 0;
+  };
+
+  uring_udp(const uring_udp&) = delete;
+  uring_udp& operator=(const uring_udp&) = delete;
+
+  /// @brief Constructor with the default configuration
+  /// @param fd A bound UDP socket, which shall outlive the transport
+  /// @throw std::runtime_error if io_uring is not available
+  explicit uring_udp(int fd)
+    : uring_udp{fd, configuration{}}
+  {}
+
+  /// @brief Constructor
+  /// @param fd A bound UDP socket, which shall outlive the transport
+  /// @param conf The transport configuration
+  /// @throw std::runtime_error if io_uring is not available
+  uring_udp(int fd, const configuration& conf)
+    : m_socket{fd}
+    , m_conf(conf)
+    , m_ring_fd{-1}
+    , m_params{}
+    , m_sq_ring{nullptr}
+    , m_sq_ring_size{0}
+    , m_cq_ring{nullptr}
+    , m_cq_ring_size{0}
+    , m_sqes{nullptr}
+    , m_nb_queued{0}
+    , m_send_buffers{nullptr}
+    , m_send_buffers_size{conf.nb_send_buffers * conf.send_buffer_size}
+    , m_fixed_send_buffers{false}
+    , m_free_send_buffers{}
+    , m_send_sizes(conf.nb_send_buffers)
+    , m_current{no_buffer}
+    , m_current_size{0}
+    , m_destination{}
+    , m_buffer_ring{nullptr}
+    , m_buffer_ring_size{conf.nb_receive_buffers * sizeof(io_uring_buf)}
+    , m_receive_buffers{nullptr}
+    , m_receive_buffers_size{conf.nb_receive_buffers * conf.receive_buffer_size}
+    , m_buffer_ring_tail{0}
+    , m_source{}
+    , m_msghdr{}
+    , m_receiving{false}
+    , m_completions{}
+    , m_deferred{}
+    , m_stats{}
+  {
+    if ((conf.nb_receive_buffers & (conf.nb_receive_buffers - 1)) != 0)
+    {
+      throw std::invalid_argument{"number of receive buffers should be a power of 2"};
+    }
+    try
+    {
+      setup_rings();
+      setup_send_buffers();
+      setup_receive_buffers();
+    }
+    catch (...)
+    {
+      release();
+      throw;
+    }
+    arm_receive();
+  }
+
+  ~uring_udp()
+  {
+    release();
+  }
+
+  /// @brief Set where packets are sent
+  void
+  set_destination(const sockaddr_in& destination)
+  noexcept
+  {
+    m_destination = destination;
+  }
+
+  /// @brief Get where packets are sent
+  const sockaddr_in&
+  destination()
+  const noexcept
+  {
+    return m_destination;
+  }
+
+  /// @brief Get the sender of the last received datagram
+  const sockaddr_in&
+  source()
+  const noexcept
+  {
+    return m_source;
+  }
+
+  /// @brief Append bytes to the packet being written
+  /// @throw std::length_error if the packet doesn't fit in a send buffer
+  void
+  append(const char* data, std::size_t size)
+  {
+    if (m_current == no_buffer)
+    {
+      m_current = acquire_send_buffer();
+      m_current_size = 0;
+    }
+    if (m_current_size + size > m_conf.send_buffer_size)
+    {
+      throw std::length_error{"packet too large for send buffers"};
+    }
+    std::copy_n(data, size, send_buffer(m_current) + m_current_size);
+    m_current_size += size;
+  }
+
+  /// @brief Queue the packet being written, it's sent by the next flush() or poll()
+  void
+  commit()
+  {
+    if (m_current == no_buffer)
+    {
+      return;
+    }
+    m_send_sizes[m_current] = m_current_size;
+    queue_send(m_current);
+    m_current = no_buffer;
+  }
+
+  /// @brief Submit all queued packets
+  void
+  flush()
+  {
+    enter(0, nullptr);
+  }
+
+  /// @brief Submit queued packets, wait for completions, give received datagrams to @p fn
+  /// @param fn Called with each received datagram as fn(const char*, std::size_t); it can send
+  /// packets, e.g. by giving the datagram to a decoder which sends acks
+  /// @param timeout The maximal time to wait for a completion
+  /// @return The number of received datagrams
+  template <typename Fn>
+  std::size_t
+  poll(Fn&& fn, std::chrono::milliseconds timeout)
+  {
+    if (m_deferred.empty())
+    {
+      enter(1, &timeout);
+    }
+    else
+    {
+      enter(0, nullptr);
+    }
+    reap();
+
+    auto nb_received = 0ul;
+    auto completions = std::vector<completion>{};
+    std::swap(completions, m_completions);
+    completions.insert(completions.end(), m_deferred.begin(), m_deferred.end());
+    m_deferred.clear();
+    for (const auto& c : completions)
+    {
+      nb_received += on_receive(c, fn);
+    }
+    completions.clear();
+    if (m_completions.empty())
+    {
+      // Keep the memory for the next call.
+      std::swap(completions, m_completions);
+    }
+    if (not m_receiving)
+    {
+      arm_receive();
+    }
+    return nb_received;
+  }
+
+  /// @brief Get the statistics of the transport
+  const statistics&
+  stats()
+  const noexcept
+  {
+    return m_stats;
+  }
+
+private:
+
+  /// @brief A completion of a receive, kept until it's given to the application
+  struct completion
+  {
+    std::int32_t res;
+    std::uint32_t flags;
+  };
+
+  static constexpr auto no_buffer = ~0u;
+  static constexpr auto tag_bits = 8u;
+  static constexpr std::uint64_t send_tag = 1;
+  static constexpr std::uint64_t receive_tag = 2;
+  static constexpr std::uint64_t fixed_tag = 4;
+  static constexpr std::uint16_t buffer_group = 0;
+
+  /// @brief Map the submission and completion queues
+  void
+  setup_rings()
+  {
+    // Not IORING_SETUP_SINGLE_ISSUER: a transport may be created by another thread than its user.
+    m_params.flags = IORING_SETUP_COOP_TASKRUN;
+    m_ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, m_conf.nb_entries, &m_params));
+    if (m_ring_fd < 0 and errno == EINVAL)
+    {
+      // Older kernels don't know this flag.
+      m_params = io_uring_params{};
+      m_ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, m_conf.nb_entries, &m_params));
+    }
+    if (m_ring_fd < 0)
+    {
+      throw std::runtime_error{std::string{"io_uring_setup: "} + std::strerror(errno)};
+    }
+
+    m_sq_ring_size = m_params.sq_off.array + m_params.sq_entries * sizeof(std::uint32_t);
+    m_cq_ring_size = m_params.cq_off.cqes + m_params.cq_entries * sizeof(io_uring_cqe);
+    if (m_params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+    }
+    m_sq_ring = map(m_sq_ring_size, IORING_OFF_SQ_RING);
+    m_cq_ring = (m_params.features & IORING_FEAT_SINGLE_MMAP)
+              ? m_sq_ring
+              : map(m_cq_ring_size, IORING_OFF_CQ_RING);
+    m_sqes = static_cast<io_uring_sqe*>(static_cast<void*>(
+               map(m_params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES)));
+  }
+
+  /// @brief Allocate and register the send buffers
+  void
+  setup_send_buffers()
+  {
+    m_send_buffers = map_anonymous(m_send_buffers_size);
+    auto iov = iovec{m_send_buffers, m_send_buffers_size};
+    // Registered buffers count against RLIMIT_MEMLOCK, fall back to regular sends.
+    m_fixed_send_buffers
+      = ::syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+    m_free_send_buffers.reserve(m_conf.nb_send_buffers);
+    for (auto i = m_conf.nb_send_buffers; i > 0; --i)
+    {
+      m_free_send_buffers.push_back(i - 1);
+    }
+  }
+
+  /// @brief Allocate the receive buffers and give them to the kernel with a buffer ring
+  void
+  setup_receive_buffers()
+  {
+    m_buffer_ring = static_cast<io_uring_buf_ring*>(static_cast<void*>(
+                      map_anonymous(m_buffer_ring_size)));
+    m_receive_buffers = map_anonymous(m_receive_buffers_size);
+
+    auto reg = io_uring_buf_reg{};
+    reg.ring_addr = reinterpret_cast<std::uintptr_t>(m_buffer_ring);
+    reg.ring_entries = m_conf.nb_receive_buffers;
+    reg.bgid = buffer_group;
+    if (::syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+    {
+      throw std::runtime_error{std::string{"IORING_REGISTER_PBUF_RING: "} + std::strerror(errno)};
+    }
+    for (auto i = 0u; i < m_conf.nb_receive_buffers; ++i)
+    {
+      provide_buffer(static_cast<std::uint16_t>(i));
+    }
+    publish_buffers();
+
+    // The kernel writes the sender's address before the payload.
+    m_msghdr.msg_namelen = sizeof(sockaddr_in);
+  }
+
+  void
+  release()
+  noexcept
+  {
+    if (m_receive_buffers)
+    {
+      ::munmap(m_receive_buffers, m_receive_buffers_size);
+    }
+    if (m_buffer_ring)
+    {
+      ::munmap(m_buffer_ring, m_buffer_ring_size);
+    }
+    if (m_send_buffers)
+    {
+      ::munmap(m_send_buffers, m_send_buffers_size);
+    }
+    if (m_sqes)
+    {
+      ::munmap(m_sqes, m_params.sq_entries * sizeof(io_uring_sqe));
+    }
+    if (m_cq_ring and m_cq_ring != m_sq_ring)
+    {
+      ::munmap(m_cq_ring, m_cq_ring_size);
+    }
+    if (m_sq_ring)
+    {
+      ::munmap(m_sq_ring, m_sq_ring_size);
+    }
+    if (m_ring_fd >= 0)
+    {
+      // Also unregisters buffers.
+      ::close(m_ring_fd);
+    }
+  }
+
+  char*
+  map(std::size_t size, off_t offset)
+  {
+    const auto addr = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE
+                            , m_ring_fd, offset);
+    if (addr == MAP_FAILED)
+    {
+      throw std::runtime_error{std::string{"mmap: "} + std::strerror(errno)};
+    }
+    return static_cast<char*>(addr);
+  }
+
+  static
+  char*
+  map_anonymous(std::size_t size)
+  {
+    const auto addr = ::mmap( nullptr, size, PROT_READ | PROT_WRITE
+                            , MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (addr == MAP_FAILED)
+    {
+      throw std::runtime_error{std::string{"mmap: "} + std::strerror(errno)};
+    }
+    return static_cast<char*>(addr);
+  }
+
+  template <typename T>
+  T*
+  sq_field(std::uint32_t offset)
+  const noexcept
+  {
+    return reinterpret_cast<T*>(m_sq_ring + offset);
+  }
+
+  template <typename T>
+  T*
+  cq_field(std::uint32_t offset)
+  const noexcept
+  {
+    return reinterpret_cast<T*>(m_cq_ring + offset);
+  }
+
+  /// @brief Get a free submission queue entry, submit queued ones if there are none
+  io_uring_sqe*
+  get_sqe()
+  {
+    const auto tail = *sq_field<std::uint32_t>(m_params.sq_off.tail);
+    if (tail - __atomic_load_n(sq_field<std::uint32_t>(m_params.sq_off.head), __ATOMIC_ACQUIRE)
+        >= m_params.sq_entries)
+    {
+      enter(0, nullptr);
+    }
+    const auto index = tail & *sq_field<std::uint32_t>(m_params.sq_off.ring_mask);
+    auto sqe = &m_sqes[index];
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+    sq_field<std::uint32_t>(m_params.sq_off.array)[index] = index;
+    return sqe;
+  }
+
+  /// @brief Make the last entry given by get_sqe() visible to the kernel
+  void
+  publish_sqe()
+  noexcept
+  {
+    auto tail = sq_field<std::uint32_t>(m_params.sq_off.tail);
+    __atomic_store_n(tail, *tail + 1, __ATOMIC_RELEASE);
+    ++m_nb_queued;
+  }
+
+  /// @brief Submit queued entries, wait for @p min_complete completions
+  void
+  enter(unsigned int min_complete, const std::chrono::milliseconds* timeout)
+  {
+    if (m_nb_queued == 0 and min_complete == 0)
+    {
+      return;
+    }
+    auto flags = min_complete != 0 ? IORING_ENTER_GETEVENTS : 0u;
+    auto ts = __kernel_timespec{};
+    auto arg = io_uring_getevents_arg{};
+    const void* argp = nullptr;
+    auto argsz = std::size_t{0};
+    if (timeout)
+    {
+      ts.tv_sec = timeout->count() / 1000;
+      ts.tv_nsec = (timeout->count() % 1000) * 1000000;
+      arg.sigmask_sz = _NSIG / 8;
+      arg.ts = reinterpret_cast<std::uintptr_t>(&ts);
+      argp = &arg;
+      argsz = sizeof(arg);
+      flags |= IORING_ENTER_EXT_ARG;
+    }
+    ++m_stats.nb_syscalls;
+    const auto res = ::syscall( __NR_io_uring_enter, m_ring_fd, m_nb_queued, min_complete, flags
+                              , argp, argsz);
+    if (res < 0 and errno != ETIME and errno != EINTR and errno != EBUSY and errno != EAGAIN)
+    {
+      throw std::runtime_error{std::string{"io_uring_enter: "} + std::strerror(errno)};
+    }
+    if (res > 0)
+    {
+      m_nb_queued -= static_cast<unsigned int>(res);
+    }
+  }
+
+  /// @brief Read all completions: release send buffers, keep receives in m_completions
+  void
+  reap()
+  {
+    auto head_ptr = cq_field<std::uint32_t>(m_params.cq_off.head);
+    auto head = *head_ptr;
+    const auto tail = __atomic_load_n(cq_field<std::uint32_t>(m_params.cq_off.tail)
+                                     , __ATOMIC_ACQUIRE);
+    const auto mask = *cq_field<std::uint32_t>(m_params.cq_off.ring_mask);
+    const auto cqes = cq_field<io_uring_cqe>(m_params.cq_off.cqes);
+    for (; head != tail; ++head)
+    {
+      const auto& cqe = cqes[head & mask];
+      if (cqe.user_data & send_tag)
+      {
+        const auto index = static_cast<unsigned int>(cqe.user_data >> tag_bits);
+        if (cqe.res == -EINVAL and (cqe.user_data & fixed_tag))
+        {
+          // Some kernels support registered buffers only for zero-copy sends, send it again
+          // without registration.
+          m_fixed_send_buffers = false;
+          queue_send(index);
+          continue;
+        }
+        m_free_send_buffers.push_back(index);
+        if (cqe.res < 0)
+        {
+          ++m_stats.nb_send_errors;
+        }
+        else
+        {
+          ++m_stats.nb_sent;
+        }
+      }
+      else
+      {
+        m_completions.push_back(completion{cqe.res, cqe.flags});
+      }
+    }
+    __atomic_store_n(head_ptr, head, __ATOMIC_RELEASE);
+  }
+
+  /// @brief Queue the send of a buffer
+  void
+  queue_send(unsigned int index)
+  {
+    auto sqe = get_sqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = m_socket;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(send_buffer(index));
+    sqe->len = static_cast<std::uint32_t>(m_send_sizes[index]);
+    sqe->addr2 = reinterpret_cast<std::uintptr_t>(&m_destination);
+    sqe->addr_len = sizeof(sockaddr_in);
+    sqe->user_data = (static_cast<std::uint64_t>(index) << tag_bits) | send_tag;
+    if (m_fixed_send_buffers)
+    {
+      sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+      sqe->buf_index = 0;
+      sqe->user_data |= fixed_tag;
+    }
+    publish_sqe();
+  }
+
+  /// @brief Get a free send buffer, wait for sends to complete if there are none
+  unsigned int
+  acquire_send_buffer()
+  {
+    while (m_free_send_buffers.empty())
+    {
+      enter(1, nullptr);
+      const auto nb = m_completions.size();
+      reap();
+      // Receives are given to the application at the next poll().
+      m_deferred.insert(m_deferred.end(), m_completions.begin() + static_cast<long>(nb)
+                       , m_completions.end());
+      m_completions.resize(nb);
+    }
+    const auto index = m_free_send_buffers.back();
+    m_free_send_buffers.pop_back();
+    return index;
+  }
+
+  char*
+  send_buffer(unsigned int index)
+  const noexcept
+  {
+    return m_send_buffers + index * m_conf.send_buffer_size;
+  }
+
+  /// @brief The offset of a receive buffer in its slot, to locate payloads like in a ntc::packet
+  static constexpr std::size_t
+  receive_offset()
+  noexcept
+  {
+    return (ntc::packet::shift + 16 - (sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in)) % 16)
+           % 16;
+  }
+
+  char*
+  receive_buffer(std::uint16_t bid)
+  const noexcept
+  {
+    return m_receive_buffers + bid * m_conf.receive_buffer_size + receive_offset();
+  }
+
+  /// @brief Add a buffer to the ring, visible to the kernel after publish_buffers()
+  void
+  provide_buffer(std::uint16_t bid)
+  noexcept
+  {
+    // Not m_buffer_ring->bufs: in C++, the empty struct of __DECLARE_FLEX_ARRAY shifts it.
+    auto& buf = reinterpret_cast<io_uring_buf*>(m_buffer_ring)[  m_buffer_ring_tail
+                                                               & (m_conf.nb_receive_buffers - 1)];
+    buf.addr = reinterpret_cast<std::uintptr_t>(receive_buffer(bid));
+    buf.len = static_cast<std::uint32_t>(m_conf.receive_buffer_size - receive_offset());
+    buf.bid = bid;
+    ++m_buffer_ring_tail;
+  }
+
+  void
+  publish_buffers()
+  noexcept
+  {
+    __atomic_store_n(&m_buffer_ring->tail, m_buffer_ring_tail, __ATOMIC_RELEASE);
+  }
+
+  /// @brief Start a multishot recvmsg
+  void
+  arm_receive()
+  {
+    auto sqe = get_sqe();
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = m_socket;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&m_msghdr);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffer_group;
+    sqe->user_data = receive_tag;
+    publish_sqe();
+    m_receiving = true;
+  }
+
+  /// @brief Give a received datagram to the application, then give its buffer back to the kernel
+  template <typename Fn>
+  std::size_t
+  on_receive(const completion& c, Fn& fn)
+  {
+    if (not (c.flags & IORING_CQE_F_MORE))
+    {
+      // Multishot receive stopped, e.g. there were no buffers left.
+      m_receiving = false;
+      ++m_stats.nb_rearms;
+    }
+    if (c.res < 0 or not (c.flags & IORING_CQE_F_BUFFER))
+    {
+      return 0;
+    }
+    const auto bid = static_cast<std::uint16_t>(c.flags >> IORING_CQE_BUFFER_SHIFT);
+    const auto buffer = receive_buffer(bid);
+    io_uring_recvmsg_out out;
+    std::memcpy(&out, buffer, sizeof(out));
+    if (out.flags & MSG_TRUNC)
+    {
+      ++m_stats.nb_truncated;
+    }
+    else
+    {
+      const auto name = buffer + sizeof(io_uring_recvmsg_out);
+      std::memcpy(&m_source, name, std::min<std::size_t>(out.namelen, sizeof(sockaddr_in)));
+      const auto payload = name + m_msghdr.msg_namelen + m_msghdr.msg_controllen;
+      ++m_stats.nb_received;
+      fn(static_cast<const char*>(payload), static_cast<std::size_t>(out.payloadlen));
+    }
+    provide_buffer(bid);
+    publish_buffers();
+    return 1;
+  }
+
+  /// @brief The UDP socket
+  const int m_socket;
+
+  const configuration m_conf;
+
+  int m_ring_fd;
+  io_uring_params m_params;
+  char* m_sq_ring;
+  std::size_t m_sq_ring_size;
+  char* m_cq_ring;
+  std::size_t m_cq_ring_size;
+  io_uring_sqe* m_sqes;
+
+  /// @brief The number of entries not yet submitted
+  unsigned int m_nb_queued;
+
+  /// @brief The send buffers, contiguous and registered as a single buffer
+  char* m_send_buffers;
+  const std::size_t m_send_buffers_size;
+  bool m_fixed_send_buffers;
+  std::vector<unsigned int> m_free_send_buffers;
+
+  /// @brief The size of the packet in each send buffer
+  std::vector<std::size_t> m_send_sizes;
+
+  /// @brief The send buffer of the packet being written, no_buffer if there are none
+  unsigned int m_current;
+  std::size_t m_current_size;
+
+  sockaddr_in m_destination;
+
+  /// @brief The ring of provided buffers, shared with the kernel
+  io_uring_buf_ring* m_buffer_ring;
+  const std::size_t m_buffer_ring_size;
+
+  char* m_receive_buffers;
+  const std::size_t m_receive_buffers_size;
+  std::uint16_t m_buffer_ring_tail;
+
+  /// @brief The sender of the last received datagram
+  sockaddr_in m_source;
+
+  /// @brief The template of the multishot recvmsg, only namelen and controllen are used
+  msghdr m_msghdr;
+
+  /// @brief Tell if the multishot recvmsg is armed
+  bool m_receiving;
+
+  /// @brief Receives read from the completion queue
+  std::vector<completion> m_completions;
+
+  /// @brief Receives read while waiting for a send buffer
+  std::vector<completion> m_deferred;
+
+  statistics m_stats;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A packet handler for ntc::encoder and ntc::decoder which writes packets in the
+/// registered buffers of a uring_udp
+struct uring_packet_handler
+{
+  uring_udp* transport;
+
+  void
+  operator()(const char* data, std::size_t size)
+  {
+    transport->append(data, size);
+  }
+
+  void
+  operator()()
+  {
+    transport->commit();
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace transport
@@ -1,6 +1,8 @@
-#include <new> // nothrow
+#include <memory> // unique_ptr
+#include <new>    // nothrow
 
 #include "netcode/c/detail/check_error.hh"
+#include "netcode/c/detail/statistics.hh"
 #include "netcode/c/decoder.h"
 #include "netcode/errors.hh"
 
@@ -14,7 +16,28 @@ noexcept
   return new (std::nothrow) ntc_decoder_t{ galois_field_size
                                          , order == ntc_in_order_yes ? ntc::in_order::yes
                                                                      : ntc::in_order::no
-                                         , ntc::detail::c_packet_handler{packet_handler}
+                                         , ntc::detail::c_packet_handler{packet_handler, nullptr}
+                                         , ntc::detail::c_data_handler{data_handler}};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+ntc_decoder_t*
+ntc_new_decoder_iov( uint8_t galois_field_size, ntc_ordering_type order
+                   , ntc_packet_iov_handler packet_handler, ntc_data_handler data_handler)
+noexcept
+{
+  auto gatherer = std::unique_ptr<ntc::detail::c_iov_gatherer>
+                    {new (std::nothrow) ntc::detail::c_iov_gatherer{packet_handler}};
+  if (not gatherer)
+  {
+    return nullptr;
+  }
+  return new (std::nothrow) ntc_decoder_t{ galois_field_size
+                                         , order == ntc_in_order_yes ? ntc::in_order::yes
+                                                                     : ntc::in_order::no
+                                         , ntc::detail::c_packet_handler{ ntc_packet_handler{}
+                                                                        , std::move(gatherer)}
                                          , ntc::detail::c_data_handler{data_handler}};
 }
 
@@ -38,6 +61,24 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+size_t
+ntc_decoder_add_packet_buffers( ntc_decoder_t* dec, const struct iovec* packets, size_t nb
+                              , ntc_error* error)
+noexcept
+{
+  auto i = 0ul;
+  ntc::detail::check_error([&]
+  {
+    for (; i < nb; ++i)
+    {
+      (*dec)(static_cast<const char*>(packets[i].iov_base), packets[i].iov_len);
+    }
+  }, error);
+  return i;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
 ntc_decoder_generate_ack(ntc_decoder_t* dec, ntc_error* error)
 noexcept
@@ -64,3 +105,88 @@ noexcept
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_decoder_set_histograms(ntc_decoder_t* dec, bool enabled, ntc_error* error)
+noexcept
+{
+  ntc::detail::check_error([&]{dec->set_histograms(enabled);}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const ntc_histogram_t*
+ntc_decoder_loss_to_recovery_histogram(const ntc_decoder_t* dec)
+noexcept
+{
+  const auto histograms = dec->histograms();
+  return histograms ? &histograms->loss_to_recovery : nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const ntc_histogram_t*
+ntc_decoder_in_order_hold_histogram(const ntc_decoder_t* dec)
+noexcept
+{
+  const auto histograms = dec->histograms();
+  return histograms ? &histograms->in_order_hold : nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const ntc_histogram_t*
+ntc_decoder_full_decoding_histogram(const ntc_decoder_t* dec)
+noexcept
+{
+  const auto histograms = dec->histograms();
+  return histograms ? &histograms->full_decoding : nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_decoder_get_statistics(const ntc_decoder_t* dec, ntc_decoder_statistics* stats)
+noexcept
+{
+  *stats = ntc::detail::to_c(dec->statistics());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+ntc_decoder_statistics_seqlock_t*
+ntc_new_decoder_statistics_seqlock(void)
+noexcept
+{
+  return new (std::nothrow) ntc_decoder_statistics_seqlock_t;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_delete_decoder_statistics_seqlock(ntc_decoder_statistics_seqlock_t* lock)
+noexcept
+{
+  delete lock;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_decoder_publish_statistics(const ntc_decoder_t* dec, ntc_decoder_statistics_seqlock_t* lock)
+noexcept
+{
+  lock->store(ntc::detail::to_c(dec->statistics()));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_decoder_statistics_seqlock_load( const ntc_decoder_statistics_seqlock_t* lock
+                                 , ntc_decoder_statistics* stats)
+noexcept
+{
+  *stats = lock->load();
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -7,7 +7,9 @@
 #include "netcode/c/detail/noexcept.hh"
 #include "netcode/c/error.h"
 #include "netcode/c/handlers.h"
+#include "netcode/c/histogram.h"
 #include "netcode/c/packet.h"
+#include "netcode/c/statistics.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +40,16 @@ noexcept;
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_decoder
+/// @brief Create a decoder which gives each packet at once, as a list of chunks
+/// @return A new decoder if allocation suceeded; a null pointer otherwise
+ntc_decoder_t*
+ntc_new_decoder_iov( uint8_t galois_field_size, ntc_ordering_type order
+                   , ntc_packet_iov_handler packet_handler, ntc_data_handler data_handler)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_decoder
 /// @brief Release the memory of a decoder
 /// @param dec The decoder to delete
@@ -64,6 +76,25 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_decoder
+/// @brief Notify a decoder with a batch of incoming packets held in the application's buffers
+/// @param dec The decoder to notify
+/// @param packets The incoming packets, as (pointer, size) pairs
+/// @param nb The number of packets in @p packets
+/// @param error The reported error, if any
+/// @return The number of packets read before an error occurred, @p nb if there was no error
+/// @note Packets are parsed in place, the decoder only copies what it has to keep. Symbols are
+/// read in place if a packet starts 9 bytes after a 16-bytes boundary, e.g. at offset 9 of a
+/// buffer allocated with posix_memalign(..., 16, ...)
+/// @note Buffers can be reused as soon as this function returns
+size_t
+ntc_decoder_add_packet_buffers( ntc_decoder_t* dec, const struct iovec* packets, size_t nb
+                              , ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_decoder
 /// @brief Force an decoder to generate an acknowledgment packet
 /// @param dec The decoder to force
@@ -96,6 +127,111 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_decoder
+/// @brief Enable or disable the measure of latencies
+/// @param dec The decoder to configure
+/// @param enabled Set to true to measure latencies
+/// @param error The reported error, if any
+/// @note Measures are disabled by default
+/// @note Disabling measures releases the histograms
+void
+ntc_decoder_set_histograms(ntc_decoder_t* dec, bool enabled, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Get the time between the detection of a missing source and its decoding
+/// @return A null pointer if measures are disabled
+const ntc_histogram_t*
+ntc_decoder_loss_to_recovery_histogram(const ntc_decoder_t* dec)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Get the time during which sources are held back to give them in order
+/// @return A null pointer if measures are disabled
+const ntc_histogram_t*
+ntc_decoder_in_order_hold_histogram(const ntc_decoder_t* dec)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Get the time spent by full decodings
+/// @return A null pointer if measures are disabled
+const ntc_histogram_t*
+ntc_decoder_full_decoding_histogram(const ntc_decoder_t* dec)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifndef __cplusplus
+/// @brief The type of a seqlock which publishes snapshots of a decoder to other threads
+/// @ingroup c_statistics
+typedef struct ntc_decoder_statistics_seqlock_t ntc_decoder_statistics_seqlock_t;
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief Get a snapshot of the counters and of the state of a decoder
+/// @param dec The decoder to query
+/// @param stats Filled with the snapshot
+void
+ntc_decoder_get_statistics(const ntc_decoder_t* dec, ntc_decoder_statistics* stats)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @return A new seqlock if allocation suceeded; a null pointer otherwise
+ntc_decoder_statistics_seqlock_t*
+ntc_new_decoder_statistics_seqlock(void)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief Release the memory of a seqlock
+void
+ntc_delete_decoder_statistics_seqlock(ntc_decoder_statistics_seqlock_t* lock)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief Publish a snapshot of a decoder
+/// @param dec The decoder to query
+/// @param lock Where to publish the snapshot
+/// @note Call it from the thread which uses @p dec
+void
+ntc_decoder_publish_statistics(const ntc_decoder_t* dec, ntc_decoder_statistics_seqlock_t* lock)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief Read the last snapshot published in a seqlock
+/// @param lock The seqlock to read
+/// @param stats Filled with the snapshot
+/// @note Can be called from any thread
+void
+ntc_decoder_statistics_seqlock_load( const ntc_decoder_statistics_seqlock_t* lock
+                                 , ntc_decoder_statistics* stats)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
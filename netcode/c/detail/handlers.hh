@@ -1,29 +1,137 @@
 #pragma once
 
+#include <algorithm> // copy_n
+#include <memory>    // unique_ptr
+#include <vector>
+
 #include "netcode/c/handlers.h"
 
 namespace ntc { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+/// @brief Gather the chunks of a packet to give them all at once to an iovec-based C callback.
+///
+/// The packetizer writes headers from temporaries, thus small chunks are copied in a scratch
+/// buffer. Larger chunks, i.e. symbols, stay where they are until the packet is sent.
+class c_iov_gatherer final
+{
+public:
+
+  /// @brief Constructor.
+  explicit c_iov_gatherer(ntc_packet_iov_handler h)
+    : m_handler(h)
+    , m_scratch()
+    , m_offsets()
+    , m_iov()
+  {
+    m_scratch.reserve(256);
+    m_offsets.reserve(16);
+    m_iov.reserve(16);
+  }
+
+  /// @brief Add a chunk to the current packet.
+  void
+  operator()(const char* data, std::size_t sz)
+  {
+    if (sz > max_copied_chunk)
+    {
+      m_offsets.push_back(static_cast<std::size_t>(no_offset));
+      m_iov.push_back(iovec{const_cast<char*>(data), sz});
+    }
+    else if (not m_iov.empty() and m_offsets.back() != no_offset)
+    {
+      // Append to the previous copied chunk.
+      m_scratch.insert(m_scratch.end(), data, data + sz);
+      m_iov.back().iov_len += sz;
+    }
+    else
+    {
+      m_offsets.push_back(m_scratch.size());
+      m_iov.push_back(iovec{nullptr, sz});
+      m_scratch.insert(m_scratch.end(), data, data + sz);
+    }
+  }
+
+  /// @brief Give the current packet to the C callback.
+  void
+  operator()()
+  noexcept
+  {
+    // The scratch buffer may have grown while the packet was written, addresses of copied chunks
+    // are only known now.
+    for (auto i = 0ul; i < m_iov.size(); ++i)
+    {
+      if (m_offsets[i] != no_offset)
+      {
+        m_iov[i].iov_base = m_scratch.data() + m_offsets[i];
+      }
+    }
+    m_handler.send_packet(m_handler.context, m_iov.data(), m_iov.size());
+    m_scratch.clear();
+    m_offsets.clear();
+    m_iov.clear();
+  }
+
+private:
+
+  /// @brief Chunks up to this size are copied rather than referenced.
+  static constexpr std::size_t max_copied_chunk = 16;
+
+  /// @brief Mark a chunk which is not in the scratch buffer.
+  static constexpr std::size_t no_offset = static_cast<std::size_t>(-1);
+
+  /// @brief The C callback.
+  ntc_packet_iov_handler m_handler;
+
+  /// @brief Copied chunks of the current packet.
+  std::vector<char> m_scratch;
+
+  /// @brief For each chunk, its location in the scratch buffer, if it has been copied.
+  std::vector<std::size_t> m_offsets;
+
+  /// @brief The chunks of the current packet.
+  std::vector<iovec> m_iov;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @internal
 /// @brief Wrap C callbacks.
+///
+/// If @p iov is set, packets are given as lists of chunks rather than chunk by chunk.
 struct c_packet_handler
 {
   ntc_packet_handler handler;
 
+  std::unique_ptr<c_iov_gatherer> iov;
+
   void
   operator()(const char* data, std::size_t sz)
-  noexcept
   {
-    handler.prepare_packet(handler.context, data, sz);
+    if (iov)
+    {
+      (*iov)(data, sz);
+    }
+    else
+    {
+      handler.prepare_packet(handler.context, data, sz);
+    }
   }
 
   void
   operator()()
   noexcept
   {
-    handler.send_packet(handler.context);
+    if (iov)
+    {
+      (*iov)();
+    }
+    else
+    {
+      handler.send_packet(handler.context);
+    }
   }
 };
 
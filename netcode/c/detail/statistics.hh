@@ -0,0 +1,62 @@
+#pragma once
+
+#include "netcode/c/statistics.h"
+#include "netcode/statistics.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Convert a snapshot for the C API.
+inline
+ntc_encoder_statistics
+to_c(const encoder_statistics& s)
+noexcept
+{
+  ntc_encoder_statistics c;
+  c.nb_sent_sources = s.nb_sent_sources;
+  c.nb_sent_repairs = s.nb_sent_repairs;
+  c.nb_received_acks = s.nb_received_acks;
+  c.nb_sent_bytes = s.nb_sent_bytes;
+  c.nb_received_bytes = s.nb_received_bytes;
+  c.repair_overhead = s.repair_overhead;
+  c.window = s.window;
+  c.window_size = s.window_size;
+  c.rate = s.rate;
+  c.estimated_loss_rate = s.estimated_loss_rate;
+  return c;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Convert a snapshot for the C API.
+inline
+ntc_decoder_statistics
+to_c(const decoder_statistics& s)
+noexcept
+{
+  ntc_decoder_statistics c;
+  c.nb_received_sources = s.nb_received_sources;
+  c.nb_received_repairs = s.nb_received_repairs;
+  c.nb_sent_acks = s.nb_sent_acks;
+  c.nb_received_bytes = s.nb_received_bytes;
+  c.nb_sent_bytes = s.nb_sent_bytes;
+  c.nb_decoded = s.nb_decoded;
+  c.nb_failed_full_decodings = s.nb_failed_full_decodings;
+  c.nb_useless_repairs = s.nb_useless_repairs;
+  c.nb_missing_sources = s.nb_missing_sources;
+  c.nb_held_sources = s.nb_held_sources;
+  c.nb_held_repairs = s.nb_held_repairs;
+  c.nb_ordered_sources = s.nb_ordered_sources;
+  c.nb_full_decodings = s.nb_full_decodings;
+  c.full_decoding_mean_ns = s.full_decoding_mean_ns;
+  c.full_decoding_p99_ns = s.full_decoding_p99_ns;
+  c.full_decoding_max_ns = s.full_decoding_max_ns;
+  return c;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -3,7 +3,10 @@
 #include "netcode/data.hh"
 #include "netcode/decoder.hh"
 #include "netcode/encoder.hh"
+#include "netcode/histogram.hh"
 #include "netcode/packet.hh"
+#include "netcode/seqlock.hh"
+#include "netcode/c/statistics.h"
 #include "netcode/c/detail/handlers.hh"
 
 /*------------------------------------------------------------------------------------------------*/
@@ -18,6 +21,11 @@ using ntc_packet_t = ntc::packet;
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+using ntc_histogram_t = ntc::histogram;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @internal
 /// @brief The type of a decoder for C handlers.
 using ntc_decoder_t = ntc::decoder<ntc::detail::c_packet_handler, ntc::detail::c_data_handler>;
@@ -29,3 +37,15 @@ using ntc_decoder_t = ntc::decoder<ntc::detail::c_packet_handler, ntc::detail::c
 using ntc_encoder_t = ntc::encoder<ntc::detail::c_packet_handler>;
 
 /*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The type of a seqlock which publishes snapshots of an encoder.
+using ntc_encoder_statistics_seqlock_t = ntc::seqlock<ntc_encoder_statistics>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The type of a seqlock which publishes snapshots of a decoder.
+using ntc_decoder_statistics_seqlock_t = ntc::seqlock<ntc_decoder_statistics>;
+
+/*------------------------------------------------------------------------------------------------*/
@@ -1,6 +1,9 @@
-#include <new> // nothrow
+#include <cstdint>
+#include <memory>    // shared_ptr
+#include <new>       // nothrow
 
 #include "netcode/c/detail/check_error.hh"
+#include "netcode/c/detail/statistics.hh"
 #include "netcode/c/encoder.h"
 
 /*------------------------------------------------------------------------------------------------*/
@@ -10,7 +13,24 @@ ntc_new_encoder(uint8_t galois_field_size, ntc_packet_handler handler)
 noexcept
 {
   return new (std::nothrow) ntc_encoder_t{ galois_field_size
-                                         , ntc::detail::c_packet_handler{handler}};
+                                         , ntc::detail::c_packet_handler{handler, nullptr}};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+ntc_encoder_t*
+ntc_new_encoder_iov(uint8_t galois_field_size, ntc_packet_iov_handler handler)
+noexcept
+{
+  auto gatherer = std::unique_ptr<ntc::detail::c_iov_gatherer>
+                    {new (std::nothrow) ntc::detail::c_iov_gatherer{handler}};
+  if (not gatherer)
+  {
+    return nullptr;
+  }
+  return new (std::nothrow) ntc_encoder_t{ galois_field_size
+                                         , ntc::detail::c_packet_handler{ ntc_packet_handler{}
+                                                                        , std::move(gatherer)}};
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -33,6 +53,60 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+size_t
+ntc_encoder_add_data_buffers( ntc_encoder_t* enc, const struct iovec* data, size_t nb
+                            , ntc_error* error)
+noexcept
+{
+  auto i = 0ul;
+  ntc::detail::check_error([&]
+  {
+    for (; i < nb; ++i)
+    {
+      const auto begin = static_cast<const char*>(data[i].iov_base);
+      (*enc)(ntc::data(begin, begin + data[i].iov_len));
+    }
+  }, error);
+  return i;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+size_t
+ntc_encoder_add_data_views( ntc_encoder_t* enc, const struct iovec* data, size_t nb
+                          , ntc_release_handler release, ntc_error* error)
+noexcept
+{
+  auto i = 0ul;
+  ntc::detail::check_error([&]
+  {
+    for (; i < nb; ++i)
+    {
+      const auto begin = static_cast<const char*>(data[i].iov_base);
+      if (reinterpret_cast<std::uintptr_t>(begin) % ntc::detail::symbol_alignment != 0)
+      {
+        // The encoder reads symbols with aligned loads.
+        (*enc)(ntc::data(begin, begin + data[i].iov_len));
+        release.release_data(release.context, begin);
+      }
+      else
+      {
+        const auto owner = std::shared_ptr<const void>{ begin
+                                                      , [release](const void* p)
+                                                        {
+                                                          release.release_data
+                                                            ( release.context
+                                                            , static_cast<const char*>(p));
+                                                        }};
+        (*enc)(ntc::data_view{begin, data[i].iov_len, owner});
+      }
+    }
+  }, error);
+  return i;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 size_t
 ntc_encoder_add_packet(ntc_encoder_t* enc, ntc_packet_t* packet, ntc_error* error)
 noexcept
@@ -42,6 +116,24 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+size_t
+ntc_encoder_add_packet_buffers( ntc_encoder_t* enc, const struct iovec* packets, size_t nb
+                              , ntc_error* error)
+noexcept
+{
+  auto i = 0ul;
+  ntc::detail::check_error([&]
+  {
+    for (; i < nb; ++i)
+    {
+      (*enc)(static_cast<const char*>(packets[i].iov_base), packets[i].iov_len);
+    }
+  }, error);
+  return i;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
 ntc_encoder_generate_repair(ntc_encoder_t* enc, ntc_error* error)
 noexcept
@@ -96,3 +188,58 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+void
+ntc_encoder_set_target_loss(ntc_encoder_t* enc, double loss)
+noexcept
+{
+  enc->set_target_loss(loss);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+void
+ntc_encoder_get_statistics(const ntc_encoder_t* enc, ntc_encoder_statistics* stats)
+noexcept
+{
+  *stats = ntc::detail::to_c(enc->statistics());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+ntc_encoder_statistics_seqlock_t*
+ntc_new_encoder_statistics_seqlock(void)
+noexcept
+{
+  return new (std::nothrow) ntc_encoder_statistics_seqlock_t;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_delete_encoder_statistics_seqlock(ntc_encoder_statistics_seqlock_t* lock)
+noexcept
+{
+  delete lock;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_publish_statistics(const ntc_encoder_t* enc, ntc_encoder_statistics_seqlock_t* lock)
+noexcept
+{
+  lock->store(ntc::detail::to_c(enc->statistics()));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_statistics_seqlock_load( const ntc_encoder_statistics_seqlock_t* lock
+                                 , ntc_encoder_statistics* stats)
+noexcept
+{
+  *stats = lock->load();
+}
+
+/*------------------------------------------------------------------------------------------------*/
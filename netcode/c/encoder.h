@@ -9,6 +9,7 @@
 #include "netcode/c/error.h"
 #include "netcode/c/handlers.h"
 #include "netcode/c/packet.h"
+#include "netcode/c/statistics.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +39,15 @@ noexcept;
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Create an encoder which gives each packet at once, as a list of chunks
+/// @return A new encoder if allocation suceeded; a null pointer otherwise
+ntc_encoder_t*
+ntc_new_encoder_iov(uint8_t galois_field_size, ntc_packet_iov_handler handler)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_encoder
 /// @brief Release the memory of an encoder
 /// @param enc The encoder to delete
@@ -63,6 +73,46 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Let an encoder handle a batch of new data, copied from the application's buffers
+/// @param enc The encoder to notify
+/// @param data The data to add, as (pointer, size) pairs
+/// @param nb The number of data in @p data
+/// @param error The reported error, if any
+/// @return The number of data added before an error occurred, @p nb if there was no error
+/// @pre each data size > 0
+/// @note Buffers can be reused as soon as this function returns
+size_t
+ntc_encoder_add_data_buffers( ntc_encoder_t* enc, const struct iovec* data, size_t nb
+                            , ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Let an encoder handle a batch of new data, read in place from the application's buffers
+/// @param enc The encoder to notify
+/// @param data The data to add, as (pointer, size) pairs
+/// @param nb The number of data in @p data
+/// @param release Called for each buffer once the encoder no longer needs it
+/// @param error The reported error, if any
+/// @return The number of data added before an error occurred, @p nb if there was no error
+/// @pre each data size > 0
+/// @attention Buffers must not be modified until they are released
+/// @note A buffer is released when its data is acknowledged or evicted from the window. A buffer
+/// which is not aligned on 16 bytes is copied, then released immediately.
+/// @note Symbols are not copied, but the reference count which tracks the release of a buffer is
+/// allocated for each data
+/// @note If an error occurs, the buffers following the one which failed are never released
+size_t
+ntc_encoder_add_data_views( ntc_encoder_t* enc, const struct iovec* data, size_t nb
+                          , ntc_release_handler release, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_encoder
 /// @brief Notify an encoder with a new incoming packet
 /// @param enc The encoder to notify
@@ -79,6 +129,24 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Notify an encoder with a batch of incoming packets held in the application's buffers
+/// @param enc The encoder to notify
+/// @param packets The incoming packets, as (pointer, size) pairs
+/// @param nb The number of packets in @p packets
+/// @param error The reported error, if any
+/// @return The number of packets read before an error occurred, @p nb if there was no error
+/// @note Acks are parsed in place, no ntc_packet_t is allocated. The list of acknowledged
+/// identifiers of each ack is still allocated.
+/// @note Buffers can be reused as soon as this function returns
+size_t
+ntc_encoder_add_packet_buffers( ntc_encoder_t* enc, const struct iovec* packets, size_t nb
+                              , ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_encoder
 /// @brief Force an encoder to generate a repair
 /// @param enc The encoder to force
@@ -150,6 +218,80 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Configure the fraction of data the adaptive mode accepts not to recover
+/// @param enc The encoder to configure
+/// @param loss The target residual loss
+/// @pre 0 < @p loss < 1
+/// @note The default target is 0.001
+void
+ntc_encoder_set_target_loss(ntc_encoder_t* enc, double loss)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifndef __cplusplus
+/// @brief The type of a seqlock which publishes snapshots of an encoder to other threads
+/// @ingroup c_statistics
+typedef struct ntc_encoder_statistics_seqlock_t ntc_encoder_statistics_seqlock_t;
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief Get a snapshot of the counters and of the state of an encoder
+/// @param enc The encoder to query
+/// @param stats Filled with the snapshot
+void
+ntc_encoder_get_statistics(const ntc_encoder_t* enc, ntc_encoder_statistics* stats)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @return A new seqlock if allocation suceeded; a null pointer otherwise
+ntc_encoder_statistics_seqlock_t*
+ntc_new_encoder_statistics_seqlock(void)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief Release the memory of a seqlock
+void
+ntc_delete_encoder_statistics_seqlock(ntc_encoder_statistics_seqlock_t* lock)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief Publish a snapshot of an encoder
+/// @param enc The encoder to query
+/// @param lock Where to publish the snapshot
+/// @note Call it from the thread which uses @p enc
+void
+ntc_encoder_publish_statistics(const ntc_encoder_t* enc, ntc_encoder_statistics_seqlock_t* lock)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief Read the last snapshot published in a seqlock
+/// @param lock The seqlock to read
+/// @param stats Filled with the snapshot
+/// @note Can be called from any thread
+void
+ntc_encoder_statistics_seqlock_load( const ntc_encoder_statistics_seqlock_t* lock
+                                 , ntc_encoder_statistics* stats)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <sys/uio.h> // iovec
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -46,6 +48,64 @@ typedef struct
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_handlers
+/// @brief The type of the callback called each time a packet is completely ready to be sent, as a
+/// list of chunks to give to writev(), sendmsg() or sendmmsg().
+///
+/// @p cxt is the context given when constructing a ntc_packet_iov_handler
+///
+/// @p iov points to the chunks of the packet, in order
+///
+/// @p iovcnt is the number of chunks
+/// @note Chunks are only valid during the call: they point into the encoder's or the decoder's
+/// memory, which is modified by the next packet
+typedef void (*ntc_send_packet_iov)(void* cxt, const struct iovec* iov, size_t iovcnt);
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_handlers
+/// @brief The type of the handler called by encoder and decoder each time a packet is ready to be
+/// sent, without copying it into a contiguous buffer.
+///
+/// Symbols are given in place; only headers, a few bytes each, are gathered by the library.
+typedef struct
+{
+  /// @brief Let user have a pointer to a context each time a callback is called.
+  void* context;
+
+  /// @brief The callback called each time a packet is completely ready to be sent.
+  ntc_send_packet_iov send_packet;
+
+} ntc_packet_iov_handler;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_handlers
+/// @brief The type of the callback called each time the encoder no longer needs a buffer given
+/// with ntc_encoder_add_data_views().
+///
+/// @p cxt is the context given when constructing a ntc_release_handler
+///
+/// @p data points to the beginning of the released buffer
+typedef void (*ntc_release_data)(void* cxt, const char* data);
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_handlers
+/// @brief The type of the handler called by encoder when a buffer it reads in place is either
+/// acknowledged or evicted from its window.
+typedef struct
+{
+  /// @brief Let user have a pointer to a context each time a callback is called.
+  void* context;
+
+  /// @brief The callback called each time a buffer is released.
+  ntc_release_data release_data;
+
+} ntc_release_handler;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_handlers
 /// @brief The type of the callback called each time a data has been received or decoded by the
 /// decoder.
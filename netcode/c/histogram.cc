@@ -0,0 +1,48 @@
+#include "netcode/c/histogram.h"
+
+/*------------------------------------------------------------------------------------------------*/
+
+uint64_t
+ntc_histogram_count(const ntc_histogram_t* h)
+noexcept
+{
+  return h->count();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+uint64_t
+ntc_histogram_min(const ntc_histogram_t* h)
+noexcept
+{
+  return h->min();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+uint64_t
+ntc_histogram_max(const ntc_histogram_t* h)
+noexcept
+{
+  return h->max();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+double
+ntc_histogram_mean(const ntc_histogram_t* h)
+noexcept
+{
+  return h->mean();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+uint64_t
+ntc_histogram_percentile(const ntc_histogram_t* h, double p)
+noexcept
+{
+  return h->percentile(p);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,76 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#include "netcode/c/detail/types.hh"
+#else
+#include <stdint.h>
+#endif
+
+#include "netcode/c/detail/noexcept.hh"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifndef __cplusplus
+/// @brief A histogram of durations in nanoseconds
+/// @ingroup c_decoder
+typedef struct ntc_histogram_t ntc_histogram_t;
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Get the number of recorded values
+uint64_t
+ntc_histogram_count(const ntc_histogram_t* h)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Get the smallest recorded value, 0 if there are none
+uint64_t
+ntc_histogram_min(const ntc_histogram_t* h)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Get the largest recorded value, 0 if there are none
+uint64_t
+ntc_histogram_max(const ntc_histogram_t* h)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Get the mean of recorded values, 0 if there are none
+double
+ntc_histogram_mean(const ntc_histogram_t* h)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Get the value below which a percentage of recorded values fall
+/// @param h The histogram to read
+/// @param p The percentage, in [0, 100]
+/// @return 0 if there are no values
+uint64_t
+ntc_histogram_percentile(const ntc_histogram_t* h, double p)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
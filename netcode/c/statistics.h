@@ -0,0 +1,111 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief A snapshot of the counters and of the state of an encoder
+/// @see ntc_encoder_get_statistics()
+typedef struct
+{
+  /// @brief The number of sent sources
+  uint64_t nb_sent_sources;
+
+  /// @brief The number of sent repairs
+  uint64_t nb_sent_repairs;
+
+  /// @brief The number of received acks
+  uint64_t nb_received_acks;
+
+  /// @brief The number of bytes given to the packet handler
+  uint64_t nb_sent_bytes;
+
+  /// @brief The number of bytes of received acks
+  uint64_t nb_received_bytes;
+
+  /// @brief The number of repairs sent for each source
+  double repair_overhead;
+
+  /// @brief The number of sources which have not been acknowledged
+  uint64_t window;
+
+  /// @brief The maximal number of sources which are kept, as chosen by the adaptive mode if set
+  uint64_t window_size;
+
+  /// @brief How many sources are sent before a repair is generated
+  uint64_t rate;
+
+  /// @brief The loss rate of the channel, as estimated by the adaptive mode
+  double estimated_loss_rate;
+} ntc_encoder_statistics;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_statistics
+/// @brief A snapshot of the counters and of the state of a decoder
+/// @see ntc_decoder_get_statistics()
+typedef struct
+{
+  /// @brief The number of received sources
+  uint64_t nb_received_sources;
+
+  /// @brief The number of received repairs
+  uint64_t nb_received_repairs;
+
+  /// @brief The number of sent acks
+  uint64_t nb_sent_acks;
+
+  /// @brief The number of bytes of received packets
+  uint64_t nb_received_bytes;
+
+  /// @brief The number of bytes given to the packet handler
+  uint64_t nb_sent_bytes;
+
+  /// @brief The number of decoded sources
+  uint64_t nb_decoded;
+
+  /// @brief The number of times a full decoding failed
+  uint64_t nb_failed_full_decodings;
+
+  /// @brief The number of repairs dropped because they were useless
+  uint64_t nb_useless_repairs;
+
+  /// @brief The number of sources currently known to be missing
+  uint64_t nb_missing_sources;
+
+  /// @brief The number of sources currently kept to decode future repairs
+  uint64_t nb_held_sources;
+
+  /// @brief The number of repairs currently kept to decode missing sources
+  uint64_t nb_held_repairs;
+
+  /// @brief The number of sources currently waiting for older ones to be given in order
+  uint64_t nb_ordered_sources;
+
+  /// @brief The number of measured full decodings, 0 if histograms are disabled
+  uint64_t nb_full_decodings;
+
+  /// @brief The mean time spent by a full decoding, in nanoseconds
+  double full_decoding_mean_ns;
+
+  /// @brief The 99th percentile of the time spent by a full decoding, in nanoseconds
+  uint64_t full_decoding_p99_ns;
+
+  /// @brief The maximal time spent by a full decoding, in nanoseconds
+  uint64_t full_decoding_max_ns;
+} ntc_decoder_statistics;
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "netcode/detail/visibility.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A clock which gives a date stored by the application rather than reading the system
+///
+/// Reading it is a single relaxed atomic load. The application updates it at its own pace, e.g.
+/// once per batch of received packets, or sets it to a virtual date to simulate time. Dates have
+/// the type of std::chrono::steady_clock dates.
+///
+/// A clock is given to a decoder with decoder::set_clock; it can be shared by several decoders and
+/// updated by another thread.
+/// @ingroup ntc_decoder
+class NTC_PUBLIC cached_clock final
+{
+public:
+
+  /// @brief The type of dates
+  using time_point = std::chrono::steady_clock::time_point;
+
+  /// @brief Can't copy-construct a clock
+  cached_clock(const cached_clock&) = delete;
+
+  /// @brief Can't copy a clock
+  cached_clock& operator=(const cached_clock&) = delete;
+
+  /// @brief Constructor, the clock starts at the current date of std::chrono::steady_clock
+  cached_clock()
+    : cached_clock{std::chrono::steady_clock::now()}
+  {}
+
+  /// @brief Constructor, the clock starts at a given date
+  explicit cached_clock(time_point date)
+    : m_date{date.time_since_epoch().count()}
+  {}
+
+  /// @brief Get the stored date
+  time_point
+  now()
+  const noexcept
+  {
+    return time_point{time_point::duration{m_date.load(std::memory_order_relaxed)}};
+  }
+
+  /// @brief Store the current date of std::chrono::steady_clock
+  void
+  update()
+  noexcept
+  {
+    set(std::chrono::steady_clock::now());
+  }
+
+  /// @brief Store a date
+  void
+  set(time_point date)
+  noexcept
+  {
+    m_date.store(date.time_since_epoch().count(), std::memory_order_relaxed);
+  }
+
+  /// @brief Move the stored date forward
+  void
+  advance(time_point::duration d)
+  noexcept
+  {
+    m_date.fetch_add(d.count(), std::memory_order_relaxed);
+  }
+
+private:
+
+  /// @brief The stored date, in ticks of std::chrono::steady_clock since its epoch
+  std::atomic<time_point::rep> m_date;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>   // memcmp, memcpy
+
+#include "netcode/detail/visibility.hh"
+#include "netcode/errors.hh"
+#include "netcode/in_order.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The version of the capture format written by this library
+/// @ingroup ntc_capture
+constexpr std::uint16_t capture_version = 1;
+
+/// @brief The first bytes of a capture file
+/// @ingroup ntc_capture
+constexpr char capture_magic[8] = {'N','T','C','C','A','P','T','\0'};
+
+/// @brief The last bytes of a capture file which has an index
+/// @ingroup ntc_capture
+constexpr char capture_index_magic[8] = {'N','T','C','I','N','D','X','\0'};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tell if a captured packet was received or sent
+/// @ingroup ntc_capture
+enum class capture_direction : std::uint8_t {received, sent};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The header of a capture file
+/// @ingroup ntc_capture
+struct NTC_PUBLIC capture_header
+{
+  /// @brief Always capture_magic
+  char magic[8];
+
+  /// @brief The version of the format
+  std::uint16_t version;
+
+  /// @brief The size of the Galois field of the captured codec
+  std::uint8_t galois_field_size;
+
+  /// @brief 1 if the captured decoder gives data in order, 0 otherwise
+  std::uint8_t in_order;
+
+  /// @brief The size of a capture_record, to let future versions extend it
+  std::uint32_t record_header_size;
+
+  /// @brief When the capture started, in nanoseconds since the epoch of the system clock
+  std::int64_t date;
+
+  /// @brief Unused, always 0
+  std::uint8_t reserved[8];
+};
+
+static_assert(sizeof(capture_header) == 32, "capture_header should have a fixed size");
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The header which precedes each packet in a capture file
+/// @ingroup ntc_capture
+struct NTC_PUBLIC capture_record
+{
+  /// @brief When the packet was captured, in nanoseconds since the epoch of the system clock
+  std::int64_t date;
+
+  /// @brief The number of bytes of the packet
+  std::uint32_t size;
+
+  /// @brief Tell if the packet was received or sent
+  capture_direction direction;
+
+  /// @brief Unused, always 0
+  std::uint8_t reserved[3];
+};
+
+static_assert(sizeof(capture_record) == 16, "capture_record should have a fixed size");
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief An entry of the sparse index of a capture file, one every capture_index_period records
+/// @ingroup ntc_capture
+struct NTC_PUBLIC capture_index_entry
+{
+  /// @brief The offset of the record in the file
+  std::uint64_t offset;
+
+  /// @brief The date of the record
+  std::int64_t date;
+};
+
+/// @brief The number of records between two entries of the index
+/// @ingroup ntc_capture
+constexpr std::uint64_t capture_index_period = 1024;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The end of a capture file which has an index
+/// @ingroup ntc_capture
+struct NTC_PUBLIC capture_footer
+{
+  /// @brief The offset of the first index entry, which is also the end of records
+  std::uint64_t index_offset;
+
+  /// @brief The number of index entries
+  std::uint64_t nb_index_entries;
+
+  /// @brief The number of records
+  std::uint64_t nb_records;
+
+  /// @brief Always capture_index_magic
+  char magic[8];
+};
+
+static_assert(sizeof(capture_footer) == 32, "capture_footer should have a fixed size");
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A packet read from a capture
+/// @ingroup ntc_capture
+struct NTC_PUBLIC captured_packet
+{
+  /// @brief When the packet was captured, in nanoseconds since the epoch of the system clock
+  std::int64_t date;
+
+  /// @brief Tell if the packet was received or sent
+  capture_direction direction;
+
+  /// @brief The bytes of the packet, in the capture
+  const char* data;
+
+  /// @brief The number of bytes of the packet
+  std::size_t size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Read a capture file held in memory (e.g. mapped with mmap)
+///
+/// Nothing is copied, captured packets point into the given memory. A capture which was not
+/// closed (e.g. the process crashed) has no index; all its complete records are still readable.
+/// @ingroup ntc_capture
+class NTC_PUBLIC capture_reader final
+{
+public:
+
+  /// @brief Constructor
+  /// @param data The first byte of the capture file
+  /// @param size The number of bytes of the capture file
+  /// @throw capture_format_error if the capture header or an entry of the index is invalid
+  capture_reader(const char* data, std::size_t size)
+    : m_data{data}
+    , m_header{}
+    , m_footer{}
+    , m_end{size}
+    , m_index{nullptr}
+    , m_position{sizeof(capture_header)}
+  {
+    if (size < sizeof(capture_header))
+    {
+      throw capture_format_error{"capture too small"};
+    }
+    std::memcpy(&m_header, data, sizeof(capture_header));
+    if (std::memcmp(m_header.magic, capture_magic, sizeof(capture_magic)) != 0)
+    {
+      throw capture_format_error{"not a capture"};
+    }
+    if (m_header.version != capture_version)
+    {
+      throw capture_format_error{"unsupported capture version"};
+    }
+    if (m_header.record_header_size < sizeof(capture_record))
+    {
+      throw capture_format_error{"invalid record header size"};
+    }
+
+    if (size >= sizeof(capture_header) + sizeof(capture_footer))
+    {
+      std::memcpy(&m_footer, data + size - sizeof(capture_footer), sizeof(capture_footer));
+      // The index lies between the header and the footer, which also bounds the number of entries
+      // so that the size of the index doesn't overflow.
+      const auto max_index_size = size - sizeof(capture_header) - sizeof(capture_footer);
+      if (  std::memcmp(m_footer.magic, capture_index_magic, sizeof(capture_index_magic)) == 0
+        and m_footer.nb_index_entries <= max_index_size / sizeof(capture_index_entry)
+        and m_footer.index_offset
+            == size - sizeof(capture_footer)
+                    - m_footer.nb_index_entries * sizeof(capture_index_entry))
+      {
+        m_end = static_cast<std::size_t>(m_footer.index_offset);
+        m_index = data + m_end;
+        for (auto i = 0ul; i < m_footer.nb_index_entries; ++i)
+        {
+          const auto offset = index_entry(i).offset;
+          if (offset < sizeof(capture_header) or offset >= m_end)
+          {
+            throw capture_format_error{"invalid index entry"};
+          }
+        }
+      }
+    }
+  }
+
+  /// @brief Get the header of the capture
+  const capture_header&
+  header()
+  const noexcept
+  {
+    return m_header;
+  }
+
+  /// @brief Tell if the capture has an index
+  bool
+  indexed()
+  const noexcept
+  {
+    return m_index != nullptr;
+  }
+
+  /// @brief Get the number of records, only known if the capture has an index
+  std::uint64_t
+  nb_records()
+  const noexcept
+  {
+    return indexed() ? m_footer.nb_records : 0;
+  }
+
+  /// @brief Read the next packet
+  /// @return false if there are no more complete records
+  bool
+  next(captured_packet& p)
+  noexcept
+  {
+    if (m_end - m_position < m_header.record_header_size)
+    {
+      return false;
+    }
+    auto record = capture_record{};
+    std::memcpy(&record, m_data + m_position, sizeof(capture_record));
+    if (m_end - m_position - m_header.record_header_size < record.size)
+    {
+      return false;
+    }
+    p.date = record.date;
+    p.direction = record.direction;
+    p.data = m_data + m_position + m_header.record_header_size;
+    p.size = record.size;
+    m_position += m_header.record_header_size + record.size;
+    return true;
+  }
+
+  /// @brief Go back to the first record
+  void
+  rewind()
+  noexcept
+  {
+    m_position = sizeof(capture_header);
+  }
+
+  /// @brief Go to a record captured at most capture_index_period records before @p date
+  ///
+  /// Without an index, go back to the first record.
+  void
+  seek(std::int64_t date)
+  noexcept
+  {
+    rewind();
+    if (not indexed() or m_footer.nb_index_entries == 0)
+    {
+      return;
+    }
+    // Find the last entry which is not after date.
+    auto first = 0ul;
+    auto last = static_cast<std::size_t>(m_footer.nb_index_entries);
+    while (first < last)
+    {
+      const auto middle = first + (last - first) / 2;
+      if (index_entry(middle).date <= date)
+      {
+        first = middle + 1;
+      }
+      else
+      {
+        last = middle;
+      }
+    }
+    if (first > 0)
+    {
+      m_position = static_cast<std::size_t>(index_entry(first - 1).offset);
+    }
+  }
+
+private:
+
+  /// @brief Read an entry of the index
+  capture_index_entry
+  index_entry(std::size_t i)
+  const noexcept
+  {
+    auto entry = capture_index_entry{};
+    std::memcpy(&entry, m_index + i * sizeof(capture_index_entry), sizeof(capture_index_entry));
+    return entry;
+  }
+
+  /// @brief The first byte of the capture file
+  const char* m_data;
+
+  /// @brief The header of the capture
+  capture_header m_header;
+
+  /// @brief The footer of the capture, only valid if it has an index
+  capture_footer m_footer;
+
+  /// @brief The end of records
+  std::size_t m_end;
+
+  /// @brief The first byte of the index, nullptr if there are none
+  const char* m_index;
+
+  /// @brief The offset of the next record to read
+  std::size_t m_position;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>  // shared_ptr
+#include <utility> // move
+
+#include "netcode/detail/symbol_alignment.hh"
+#include "netcode/detail/visibility.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup ntc_data
+/// @brief A view on application data which the encoder reads without copying it
+///
+/// The bytes live in the application's memory, e.g. in a large receive buffer. The view shares the
+/// ownership of this memory with @p owner: the encoder keeps the view, and thus the memory, until
+/// the source built from it is acknowledged or evicted from the window, then releases it.
+///
+/// An owner can be a std::shared_ptr to the whole buffer; use the aliasing constructor of
+/// std::shared_ptr or a custom deleter to know when all views on the buffer are released.
+class NTC_PUBLIC data_view final
+{
+public:
+
+  /// @brief Constructor
+  /// @param data The first byte, aligned on 16 bytes
+  /// @param size The number of bytes
+  /// @param owner Keeps the memory of the bytes alive
+  /// @attention The bytes must not be modified while the view is alive
+  data_view(const char* data, std::size_t size, std::shared_ptr<const void> owner)
+    : m_data{data}
+    , m_size{size}
+    , m_owner{std::move(owner)}
+  {
+    assert(reinterpret_cast<std::uintptr_t>(data) % detail::symbol_alignment == 0
+           && "data must be aligned on 16 bytes");
+  }
+
+  /// @brief Get the first byte
+  const char*
+  data()
+  const noexcept
+  {
+    return m_data;
+  }
+
+  /// @brief Get the number of bytes
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+  /// @brief Get the owner of the memory
+  const std::shared_ptr<const void>&
+  owner()
+  const noexcept
+  {
+    return m_owner;
+  }
+
+private:
+
+  /// @brief The first byte
+  const char* m_data;
+
+  /// @brief The number of bytes
+  std::size_t m_size;
+
+  /// @brief Keeps the memory alive
+  std::shared_ptr<const void> m_owner;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
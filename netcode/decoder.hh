@@ -1,20 +1,23 @@
 #pragma once
 
-#ifdef NTC_DUMP_PACKETS
-#include <fstream>
-#include "netcode/detail/serialize_packet.hh"
-#endif
-
 #include <chrono>
+#include <cstdint> // uintptr_t
 
 #include "netcode/detail/decoder.hh"
 #include "netcode/detail/packet_type.hh"
 #include "netcode/detail/packetizer.hh"
 #include "netcode/detail/repair.hh"
 #include "netcode/detail/source.hh"
+#include "netcode/detail/symbol_alignment.hh"
 #include "netcode/detail/visibility.hh"
+#include "netcode/cached_clock.hh"
+#include "netcode/decoder_fwd.hh"
 #include "netcode/errors.hh"
+#include "netcode/histogram.hh"
 #include "netcode/in_order.hh"
+#include "netcode/packet_capture.hh"
+#include "netcode/statistics.hh"
+#include "netcode/tracing.hh"
 
 namespace ntc {
 
@@ -22,7 +25,8 @@ namespace ntc {
 
 /// @ingroup ntc_decoder
 /// @brief The class to interact with on the receiver side.
-template <typename PacketHandler, typename DataHandler>
+/// @tparam Tracer The policy notified of each event (see no_tracing).
+template <typename PacketHandler, typename DataHandler, typename Tracer>
 class NTC_PUBLIC decoder final
 {
 public:
@@ -33,6 +37,9 @@ public:
   /// @brief The type of the handler that processes decoded or received data.
   using data_handler_type = DataHandler;
 
+  /// @brief The type of the policy notified of each event.
+  using tracer_type = Tracer;
+
 public:
 
   /// @brief Can't copy-construct a decoder.
@@ -51,9 +58,19 @@ public:
   template <typename PacketHandler_, typename DataHandler_>
   decoder( std::uint8_t galois_field_size, in_order ordered, PacketHandler_&& packet_handler
          , DataHandler_&& data_handler)
+    : decoder{ galois_field_size, ordered, std::forward<PacketHandler_>(packet_handler)
+             , std::forward<DataHandler_>(data_handler), tracer_type{}}
+  {}
+
+  /// @brief Constructor with a tracing policy.
+  template <typename PacketHandler_, typename DataHandler_, typename Tracer_>
+  decoder( std::uint8_t galois_field_size, in_order ordered, PacketHandler_&& packet_handler
+         , DataHandler_&& data_handler, Tracer_&& tracer)
     : m_galois_field_size{galois_field_size}
-    , m_ack_period{std::chrono::milliseconds{100}}
+    , m_tracer(std::forward<Tracer_>(tracer))
     , m_ack_nb_packets{50}
+    , m_last_ack_nb_packets{0}
+    , m_ack_period{std::chrono::milliseconds{100}}
     , m_last_ack_date(std::chrono::steady_clock::now())
     , m_ack{}
     , m_decoder{ m_galois_field_size
@@ -66,9 +83,9 @@ public:
     , m_nb_received_repairs{0}
     , m_nb_received_sources{0}
     , m_nb_sent_ack{0}
-#ifdef NTC_DUMP_PACKETS
-    , m_dump_file{NTC_DUMP_PACKETS_FILE}
-#endif
+    , m_nb_received_bytes{0}
+    , m_capture{nullptr}
+    , m_clock{nullptr}
   {
     // Let's reserve some memory for the ack, it will most likely avoid memory re-allocations.
     // Uncomment the following when the undefined behavior spotted by GCC 5.1 -fsanitize=undefined
@@ -89,10 +106,12 @@ public:
   operator()(packet&& p)
   {
     assert(p.size() != 0 && "empty packet");
+    m_nb_received_bytes += p.size();
 
-#ifdef NTC_DUMP_PACKETS
-    detail::serialize_packet::write(m_dump_file, p);
-#endif
+    if (m_capture)
+    {
+      m_capture->record(p.data(), p.size(), capture_direction::received);
+    }
 
     switch (detail::get_packet_type(p))
     {
@@ -101,7 +120,7 @@ public:
         ++m_nb_received_repairs;
         ++m_ack.nb_packets();
         auto res = m_packetizer.read_repair(std::move(p));
-        m_decoder(std::move(res.first));
+        add_repair(std::move(res.first), res.second);
         return res.second;
       }
 
@@ -110,7 +129,7 @@ public:
         ++m_nb_received_sources;
         ++m_ack.nb_packets();
         auto res = m_packetizer.read_source(std::move(p));
-        m_decoder(std::move(res.first));
+        add_source(std::move(res.first), res.second);
         return res.second;
       }
 
@@ -121,6 +140,65 @@ public:
     }
   }
 
+  /// @brief Notify the decoder of an incoming packet held in a buffer it doesn't own
+  ///
+  /// The packet is parsed in place, no ntc::packet is needed. Only what the decoder has to keep
+  /// is copied: repairs which are useful for decoding, and sources. Outdated, duplicated or useless
+  /// packets are never copied, and a received source is given to the data handler directly from
+  /// @p data.
+  /// @attention Any future repair may encode a source, thus every new source is copied once, after
+  /// it's given to the data handler, until it's outdated. It saves the copy into a ntc::packet, not
+  /// the copy of the symbol.
+  /// @param data The first byte of the packet, as received from the network
+  /// @param size The number of bytes of the packet
+  /// @note Symbols are read in place only if @p data is located ntc::packet::shift bytes after a
+  /// 16-bytes boundary, as it is in a ntc::packet. Otherwise, the packet is first copied.
+  /// @note @p data can be reused as soon as this function returns.
+  std::size_t
+  operator()(const char* data, std::size_t size)
+  {
+    assert(size != 0 && "empty packet");
+
+    const auto symbol = reinterpret_cast<std::uintptr_t>(data) + detail::source_and_repair_headers;
+    if (symbol % detail::symbol_alignment != 0)
+    {
+      // Symbols must be aligned, we can't read them in place.
+      return operator()(packet(data, data + size));
+    }
+    m_nb_received_bytes += size;
+
+    if (m_capture)
+    {
+      m_capture->record(data, size, capture_direction::received);
+    }
+
+    switch (detail::get_packet_type(data, size))
+    {
+      case detail::packet_type::repair:
+      {
+        ++m_nb_received_repairs;
+        ++m_ack.nb_packets();
+        auto res = m_packetizer.read_repair(data, size);
+        add_repair(std::move(res.first), res.second);
+        return res.second;
+      }
+
+      case detail::packet_type::source:
+      {
+        ++m_nb_received_sources;
+        ++m_ack.nb_packets();
+        auto res = m_packetizer.read_source(data, size);
+        add_source(std::move(res.first), res.second);
+        return res.second;
+      }
+
+      default:
+      {
+        throw packet_type_error{packet(data, data + size)};
+      }
+    }
+  }
+
   /// @brief Get the data handler.
   const packet_handler_type&
   packet_handler()
@@ -153,6 +231,22 @@ public:
     return m_data_handler;
   }
 
+  /// @brief Get the tracing policy.
+  const tracer_type&
+  tracer()
+  const noexcept
+  {
+    return m_tracer;
+  }
+
+  /// @brief Get the tracing policy.
+  tracer_type&
+  tracer()
+  noexcept
+  {
+    return m_tracer;
+  }
+
   /// @brief Get the total number of decoded sources.
   std::size_t
   nb_decoded()
@@ -209,6 +303,36 @@ public:
     return m_decoder.nb_useless_repairs();
   }
 
+  /// @brief Get a snapshot of the counters and of the state of the decoder.
+  /// @note Decoding times are only measured if histograms are enabled (see set_histograms()).
+  /// @note Use a seqlock to read it from another thread.
+  decoder_statistics
+  statistics()
+  const noexcept
+  {
+    auto s = decoder_statistics{};
+    s.nb_received_sources = m_nb_received_sources;
+    s.nb_received_repairs = m_nb_received_repairs;
+    s.nb_sent_acks = m_nb_sent_ack;
+    s.nb_received_bytes = m_nb_received_bytes;
+    s.nb_sent_bytes = m_packetizer.nb_written_bytes();
+    s.nb_decoded = m_decoder.nb_decoded();
+    s.nb_failed_full_decodings = m_decoder.nb_failed_full_decodings();
+    s.nb_useless_repairs = m_decoder.nb_useless_repairs();
+    s.nb_missing_sources = m_decoder.missing_sources().size();
+    s.nb_held_sources = m_decoder.sources().size();
+    s.nb_held_repairs = m_decoder.repairs().size();
+    s.nb_ordered_sources = m_decoder.nb_ordered_sources();
+    if (const auto h = m_decoder.histograms())
+    {
+      s.nb_full_decodings = h->full_decoding.count();
+      s.full_decoding_mean_ns = h->full_decoding.mean();
+      s.full_decoding_p99_ns = h->full_decoding.percentile(99.);
+      s.full_decoding_max_ns = h->full_decoding.max();
+    }
+    return s;
+  }
+
   /// @brief Force the generation of an ack.
   void
   generate_ack()
@@ -222,6 +346,8 @@ public:
     // Ask packetizer to handle the bytes of the new ack (will be routed to user's handler).
     m_packetizer.write_ack(m_ack);
     ++m_nb_sent_ack;
+    m_last_ack_nb_packets = m_ack.nb_packets();
+    m_tracer(trace_event::ack_sent, static_cast<std::uint32_t>(m_ack.source_ids().size()), 0);
 
     // Start a fresh new ack.
     m_ack.reset();
@@ -231,22 +357,93 @@ public:
   void
   maybe_ack()
   {
-    if (m_ack.nb_packets() >= m_ack_nb_packets)
+    if (static_cast<std::uint16_t>(m_ack.nb_packets() - m_last_ack_nb_packets) >= m_ack_nb_packets)
     {
       generate_ack();
-      m_last_ack_date = std::chrono::steady_clock::now();
+      m_last_ack_date = now();
     }
     else if (m_ack_period != std::chrono::milliseconds{0})
     {
-      const auto now = std::chrono::steady_clock::now();
-      if ((now - m_last_ack_date) >= m_ack_period)
+      const auto date = now();
+      if ((date - m_last_ack_date) >= m_ack_period)
       {
         generate_ack();
-        m_last_ack_date = now;
+        m_last_ack_date = date;
       }
     }
   }
 
+  /// @brief Enable or disable the measure of latencies.
+  ///
+  /// When disabled, which is the default, the clock is never read to measure latencies. Disabling
+  /// measures drops the histograms.
+  decoder&
+  set_histograms(bool enabled)
+  {
+    m_decoder.set_histograms(enabled);
+    return *this;
+  }
+
+  /// @brief Get the measured latencies.
+  /// @return nullptr if measures are disabled.
+  const decoder_histograms*
+  histograms()
+  const noexcept
+  {
+    return m_decoder.histograms();
+  }
+
+  /// @brief Capture all incoming packets, or stop capturing them if @p capture is nullptr.
+  ///
+  /// Packets are captured before they are read, thus invalid ones are captured too.
+  /// @pre @p capture outlives this decoder, or is replaced before it's destroyed.
+  decoder&
+  set_capture(packet_capture* capture)
+  noexcept
+  {
+    m_capture = capture;
+    return *this;
+  }
+
+  /// @brief Get where incoming packets are captured, nullptr if they are not.
+  packet_capture*
+  capture()
+  const noexcept
+  {
+    return m_capture;
+  }
+
+  /// @brief Set the clock which dates acks, instead of std::chrono::steady_clock.
+  ///
+  /// By default, the system clock is read each time a source is delivered, to know if the ack
+  /// period has elapsed. With a cached_clock updated by the application, e.g. once per batch of
+  /// received packets, this costs a memory read. With a clock set to virtual dates, ack timing can
+  /// be tested and simulated.
+  /// @param clock The clock, which shall outlive the decoder; nullptr to read the system clock.
+  /// @note The ack period restarts at the current date of the new clock.
+  decoder&
+  set_clock(const cached_clock* clock)
+  {
+    m_clock = clock;
+    m_last_ack_date = now();
+    if (m_decoder.head_of_line())
+    {
+      // Waiting sources are dated with the same clock.
+      auto bounds = *m_decoder.head_of_line();
+      bounds.clock = clock;
+      m_decoder.set_head_of_line_bounds(std::move(bounds));
+    }
+    return *this;
+  }
+
+  /// @brief Get the clock which dates acks, nullptr if it's the system clock.
+  const cached_clock*
+  clock()
+  const noexcept
+  {
+    return m_clock;
+  }
+
   /// @brief Set the period at which ack will be sent from the decoder to the encoder.
   ///
   /// If 0, ack won't be sent automatically. The method @ref decoder::generate_ack can still be
@@ -286,12 +483,156 @@ public:
     return m_ack_nb_packets;
   }
 
+  /// @brief Set how long a source can wait for older missing ones, in in-order mode.
+  ///
+  /// A single unrecoverable loss blocks the delivery of all following sources until the loss
+  /// becomes outdated, i.e. until a repair which doesn't encode it anymore is received. With this
+  /// bound, when a source has waited longer than @p t, older missing sources are skipped (see
+  /// set_skip_handler()) and waiting sources are given to the data handler.
+  ///
+  /// Waiting sources are dated with the clock given to set_clock(), if any. The bound is checked
+  /// each time a packet is received, and by expire_held_sources().
+  /// @param t The maximal hold time, 0 for no bound (the default).
+  /// @note Only sources which start to wait after this call are bounded.
+  decoder&
+  set_max_hold_time(std::chrono::milliseconds t)
+  {
+    auto bounds = head_of_line_bounds();
+    bounds.max_hold_time = t;
+    m_decoder.set_head_of_line_bounds(std::move(bounds));
+    return *this;
+  }
+
+  /// @brief Get how long a source can wait for older missing ones, 0 if it's not bounded.
+  std::chrono::milliseconds
+  max_hold_time()
+  const noexcept
+  {
+    return m_decoder.head_of_line()
+         ? std::chrono::duration_cast<std::chrono::milliseconds>
+             (m_decoder.head_of_line()->max_hold_time)
+         : std::chrono::milliseconds{0};
+  }
+
+  /// @brief Set how many sources can be received ahead of a missing one, in in-order mode.
+  ///
+  /// When a source is @p depth identifiers or more ahead of the oldest missing source, missing
+  /// sources are skipped (see set_skip_handler()) until it's not the case anymore.
+  /// @param depth The maximal reorder depth, 0 for no bound (the default).
+  /// @note Even without bound, missing sources are skipped when a source is 2^20 identifiers or
+  /// more ahead of them, so a single packet can't make the decoder hold an unbounded window.
+  decoder&
+  set_max_reorder_depth(std::uint32_t depth)
+  {
+    auto bounds = head_of_line_bounds();
+    bounds.max_reorder_depth = depth;
+    m_decoder.set_head_of_line_bounds(std::move(bounds));
+    return *this;
+  }
+
+  /// @brief Get how many sources can be received ahead of a missing one, 0 if it's not bounded.
+  std::uint32_t
+  max_reorder_depth()
+  const noexcept
+  {
+    return m_decoder.head_of_line() ? m_decoder.head_of_line()->max_reorder_depth : 0;
+  }
+
+  /// @brief Set the handler notified of sources skipped in in-order mode.
+  ///
+  /// @p handler is called with the first and the last identifiers of each range of consecutive
+  /// sources which won't be given to the data handler, because the wait for them exceeded a bound
+  /// (see set_max_hold_time() and set_max_reorder_depth()) or because they became outdated.
+  /// @param handler A callable with the signature void(std::uint32_t, std::uint32_t).
+  template <typename Handler>
+  decoder&
+  set_skip_handler(Handler&& handler)
+  {
+    auto bounds = head_of_line_bounds();
+    bounds.skipped = std::forward<Handler>(handler);
+    m_decoder.set_head_of_line_bounds(std::move(bounds));
+    return *this;
+  }
+
+  /// @brief Skip missing sources if waiting ones exceed the maximal hold time.
+  ///
+  /// This check is also done each time a packet is received. Call this function periodically if
+  /// packets may stop arriving, e.g. at the end of a stream.
+  void
+  expire_held_sources()
+  {
+    m_decoder.expire_held_sources();
+  }
+
 private:
 
+  /// @brief Give a received source to the real decoder.
+  void
+  add_source(detail::decoder_source&& src, std::size_t packet_size)
+  {
+    m_tracer(trace_event::source_received, src.id(), static_cast<std::uint32_t>(packet_size));
+    const auto nb_failed = m_decoder.nb_failed_full_decodings();
+    m_decoder(std::move(src));
+    trace_failures(nb_failed);
+    m_decoder.expire_held_sources();
+  }
+
+  /// @brief Give a received repair to the real decoder.
+  void
+  add_repair(detail::decoder_repair&& r, std::size_t packet_size)
+  {
+    const auto id = r.id();
+    m_tracer(trace_event::repair_received, id, static_cast<std::uint32_t>(packet_size));
+    const auto nb_useless = m_decoder.nb_useless_repairs();
+    const auto nb_failed = m_decoder.nb_failed_full_decodings();
+    m_decoder(std::move(r));
+    if (m_decoder.nb_useless_repairs() != nb_useless)
+    {
+      m_tracer(trace_event::repair_useless, id, static_cast<std::uint32_t>(packet_size));
+    }
+    trace_failures(nb_failed);
+    m_decoder.expire_held_sources();
+  }
+
+  /// @brief Get the current bounds of the wait of sources, or default ones.
+  detail::decoder::head_of_line_bounds
+  head_of_line_bounds()
+  const
+  {
+    if (m_decoder.head_of_line())
+    {
+      return *m_decoder.head_of_line();
+    }
+    return {std::chrono::steady_clock::duration::zero(), 0, nullptr, m_clock};
+  }
+
+  /// @brief Get the current date from the clock given by the application, if any.
+  std::chrono::steady_clock::time_point
+  now()
+  const noexcept
+  {
+    return m_clock ? m_clock->now() : std::chrono::steady_clock::now();
+  }
+
+  /// @brief Report an inversion failure if the real decoder failed since @p nb_failed failures.
+  void
+  trace_failures(std::size_t nb_failed)
+  {
+    // Several failures caused by a same packet are reported once.
+    if (m_decoder.nb_failed_full_decodings() != nb_failed)
+    {
+      m_tracer( trace_event::inversion_failure
+              , static_cast<std::uint32_t>(m_decoder.nb_failed_full_decodings()), 0);
+    }
+  }
+
   /// @brief Callback given to the real encoder to be notified when a source is processed.
   void
   handle_source(const detail::decoder_source& src)
   {
+    m_tracer( trace_event::source_delivered, src.id()
+            , static_cast<std::uint32_t>(src.symbol_size()));
+
     // Ask user to read the bytes of this new source.
     m_data_handler(src.symbol(), src.symbol_size());
 
@@ -304,12 +645,19 @@ private:
   /// @brief The Galois field size.
   const std::uint8_t m_galois_field_size;
 
-  /// @brief The period at which ack will be sent back from the decoder to the encoder.
-  std::chrono::milliseconds m_ack_period;
+  /// @brief The policy notified of each event.
+  /// @note Declared next to small members, as it's usually empty, to save padding.
+  tracer_type m_tracer;
 
   /// @brief How many packets to receive before an ack is sent from the decoder to the encoder.
   std::uint16_t m_ack_nb_packets;
 
+  /// @brief The number of received packets, modulo 2^16, when the last ack was sent.
+  std::uint16_t m_last_ack_nb_packets;
+
+  /// @brief The period at which ack will be sent back from the decoder to the encoder.
+  std::chrono::milliseconds m_ack_period;
+
   /// @brief The last time an ack was sent.
   std::chrono::steady_clock::time_point m_last_ack_date;
 
@@ -337,9 +685,14 @@ private:
   /// @brief The number of ack sent back to the encoder.
   std::size_t m_nb_sent_ack;
 
-#ifdef NTC_DUMP_PACKETS
-  std::ofstream m_dump_file;
-#endif
+  /// @brief The number of received bytes.
+  std::size_t m_nb_received_bytes;
+
+  /// @brief Where incoming packets are captured, nullptr if they are not.
+  packet_capture* m_capture;
+
+  /// @brief The clock which dates acks, nullptr to read std::chrono::steady_clock.
+  const cached_clock* m_clock;
 };
 
 /*------------------------------------------------------------------------------------------------*/
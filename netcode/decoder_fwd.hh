@@ -1,10 +1,12 @@
 #pragma once
 
+#include "netcode/tracing.hh"
+
 namespace ntc {
 
 /*------------------------------------------------------------------------------------------------*/
 
-template <typename PacketHandler, typename DataHandler>
+template <typename PacketHandler, typename DataHandler, typename Tracer = no_tracing>
 class decoder;
 
 /*------------------------------------------------------------------------------------------------*/
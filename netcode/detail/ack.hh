@@ -54,16 +54,18 @@ public:
 
   /// @brief Reset this ack.
   ///
-  /// List of source identifiers is resized to 0.
+  /// List of source identifiers is resized to 0, the number of received packets is kept.
   void
   reset()
   noexcept
   {
     m_source_ids.clear();
-    m_nb_packets = 0;
   }
 
-  /// @brief Get the number of packets received by the decoder since the last ack.
+  /// @brief Get the number of packets received by the decoder, modulo 2^16.
+  ///
+  /// The count is not reset by acks, thus the encoder can tell how many packets were received
+  /// between two acks it got, even if some acks in between were lost.
   std::uint16_t
   nb_packets()
   const noexcept
@@ -71,7 +73,7 @@ public:
     return m_nb_packets;
   }
 
-  /// @brief Get the number of packets received by the decoder since the last ack.
+  /// @brief Get the number of packets received by the decoder, modulo 2^16.
   std::uint16_t&
   nb_packets()
   noexcept
@@ -84,7 +86,7 @@ private:
   /// @brief The list of acknowledged sources.
   source_id_list m_source_ids;
 
-  /// @brief The number of received packet since the last ack.
+  /// @brief The number of received packets, modulo 2^16.
   std::uint16_t m_nb_packets;
 };
 
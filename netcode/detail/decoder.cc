@@ -1,4 +1,4 @@
-#include <algorithm>  // all_of
+#include <algorithm>  // all_of, lower_bound, max, min, stable_sort, upper_bound
 #include <cassert>
 #include <vector>
 
@@ -9,9 +9,25 @@ namespace ntc { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
+namespace /* unnamed */ {
+
+/// @brief Convert a duration to a value of a histogram.
+template <typename Duration>
+std::uint64_t
+to_ns(Duration d)
+noexcept
+{
+  using std::chrono::duration_cast;
+  return static_cast<std::uint64_t>(duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
 decoder::decoder( std::uint8_t galois_field_size, std::function<void(const decoder_source&)> h
                 , in_order order)
-  : m_gf{galois_field_size}
+  : m_galois_field_size{galois_field_size}
   , m_in_order{order == in_order::yes}
   , m_first_missing_source_in_order{0}
   , m_ordered_sources{}
@@ -23,10 +39,22 @@ decoder::decoder( std::uint8_t galois_field_size, std::function<void(const decod
   , m_nb_useless_repairs{0}
   , m_nb_failed_full_decodings{0}
   , m_nb_decoded{0}
-  , m_coefficients{32}
-  , m_inv{32}
-  , m_index()
-{}
+  , m_scratch{}
+  , m_measures{}
+  , m_head_of_line{}
+{
+  // Check the size of the field.
+  gf();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+galois_field&
+decoder::gf()
+const
+{
+  return thread_galois_field(m_galois_field_size);
+}
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -45,6 +73,13 @@ decoder::operator()(decoder_source&& src)
     return;
   }
 
+  if (m_measures)
+  {
+    // All unseen sources older than this one are missing.
+    detect_missing_sources(src.id());
+    m_measures->next_unseen_id = std::max(m_measures->next_unseen_id, src.id() + 1);
+  }
+
   add_source_recursive(std::move(src));
   attempt_full_decoding();
 }
@@ -69,6 +104,12 @@ decoder::operator()(decoder_repair&& incoming_r)
     return;
   }
 
+  if (m_measures)
+  {
+    // All unseen sources encoded by this repair are missing.
+    detect_missing_sources(last_id_in_source_ids + 1);
+  }
+
   // Remove sources with an id strictly less than the smallest the current repair encodes.
   // Remove repairs which encodes sources with an id smaller than the smallest the current repair
   // encodes.
@@ -88,6 +129,9 @@ decoder::operator()(decoder_repair&& incoming_r)
     return;
   }
 
+  // This repair is going to be kept, it can no longer refer to memory it doesn't own.
+  incoming_r.retain();
+
   // Add this repair to the set of known repairs.
   const auto r_id = incoming_r.id(); // to force evaluation order in the following call.
   const auto insertion = m_repairs.emplace(r_id, std::move(incoming_r));
@@ -136,10 +180,9 @@ decoder::operator()(decoder_repair&& incoming_r)
     // Create missing source.
     auto src = create_source_from_repair(r);
 
-    // Source is no longer missing.
-    m_missing_sources.erase(src.id());
-
-    // This repair is no longer needed.
+    // This repair is no longer needed. Other repairs may still encode the source, they are updated
+    // by add_source_recursive().
+    unlink_repair(r_cit);
     m_repairs.erase(r_cit);
 
     // This newly decode source might trigger the decoding of several other sources.
@@ -161,18 +204,22 @@ noexcept
   const auto src_id = *r.source_ids().begin();
 
   // The inverse of the coefficient which was used to encode the missing source.
-  const auto inv = m_gf.invert(m_gf.coefficient(r.id(), src_id));
+  const auto inv = gf().invert(gf().coefficient(r.id(), src_id));
 
   // Reconstruct size.
-  const auto src_sz = m_gf.multiply_size(r.encoded_size(), inv);
+  const auto src_sz = gf().multiply_size(r.encoded_size(), inv);
 
   // The source that will be reconstructed.
   auto src = decoder_source{src_id, packet(src_sz + packet::alignment), src_sz};
 
   // Reconstruct missing source.
-  m_gf.multiply(r.symbol(), src.symbol(), src_sz, inv);
+  gf().multiply(r.symbol(), src.symbol(), src_sz, inv);
 
   m_nb_decoded += 1;
+  if (m_measures)
+  {
+    record_recovery(src_id, clock::now());
+  }
 
   return src;
 }
@@ -246,8 +293,80 @@ const noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+std::size_t
+decoder::nb_ordered_sources()
+const noexcept
+{
+  return m_ordered_sources.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::set_histograms(bool enabled)
+{
+  if (not enabled)
+  {
+    m_measures.reset();
+  }
+  else if (not m_measures)
+  {
+    m_measures.reset(new measures);
+    // Sources which were missing before measures started are not measured.
+    m_measures->next_unseen_id = m_sources.empty() ? (m_last_id ? *m_last_id : 0)
+                                                   : m_sources.rbegin()->first + 1;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const decoder_histograms*
+decoder::histograms()
+const noexcept
+{
+  return m_measures ? &m_measures->histograms : nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
 decoder::add_source_recursive(decoder_source&& src)
+{
+  // Identifiers of repairs which encode only one missing source. They are decoded in a loop rather
+  // than recursively, as a long chain of decodings would overflow the stack.
+  auto ready = std::vector<std::uint32_t>{};
+  add_source(std::move(src), ready);
+  while (not ready.empty())
+  {
+    const auto r_cit = m_repairs.find(ready.back());
+    ready.pop_back();
+    if (r_cit == m_repairs.end())
+    {
+      // Dropped as its source was decoded in the meantime.
+      continue;
+    }
+    const auto& r = r_cit->second;
+    assert(r.source_ids().size() == 1 && "Repair encodes more than 1 source");
+
+    // Check that this source wasn't decoded in the past.
+    assert(m_last_id ? *r.source_ids().begin() >= *m_last_id : true);
+    // Check that this source doesn't belong to the set of current sources.
+    assert(not m_sources.count(*r.source_ids().begin()));
+
+    auto decoded_src = create_source_from_repair(r);
+
+    // We can erase this repair, other repairs which encode the source are updated by add_source().
+    unlink_repair(r_cit);
+    m_repairs.erase(r_cit);
+
+    add_source(std::move(decoded_src), ready);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::add_source(decoder_source&& src, std::vector<std::uint32_t>& ready)
 {
   if (not m_in_order)
   {
@@ -262,68 +381,35 @@ decoder::add_source_recursive(decoder_source&& src)
     flush_ordered_sources();
   }
 
-  // First, remove this source from all repairs that encode it.
+  // Remove this source from all repairs that encode it.
   const auto search = m_missing_sources.find(src.id());
   if (search != m_missing_sources.end())
   {
-    for (auto r_cit : search->second)
+    for (const auto& r_cit : search->second)
     {
       auto& r = r_cit->second;
-      remove_source_from_repair(src, r);
-    }
-
-    // It's no longer a missing source.
-    m_missing_sources.erase(search);
-  }
-
-  // Now, look for repairs that encodes only 1 source. When one is found, the corresponding
-  // encoded source is decoded and the repair is erased.
-  for ( auto miss_cit = m_missing_sources.begin(), miss_end = m_missing_sources.end()
-      ; miss_cit != miss_end;)
-  {
-    const auto& repairs_cits = miss_cit->second;
-    // Does this missing source is referenced by only one repair?
-    if (repairs_cits.size() == 1)
-    {
-      // Some shortcuts.
-      const auto r_cit = *repairs_cits.begin();
-      const auto& r = r_cit->second;
-
-      // Does this repair encode only 1 source?
       if (r.source_ids().size() == 1)
       {
-        // Check that this source wasn't decoded in the past.
-        assert(m_last_id ? *r.source_ids().begin() >= *m_last_id : true);
-        // Check that this source doesn't belong to the set of current sources.
-        assert(not m_sources.count(*r.source_ids().begin()));
-
-        // This missing source is referenced by only 1 repair and this repair references only 1
-        // missing source. Thus, we can reconstruct the missing source.
-        auto decoded_src = create_source_from_repair(r);
-
-        // We can erase this repair.
+        // This repair encodes only this source, it's now useless.
         m_repairs.erase(r_cit);
-
-        // It's no longer a missing source.
-        miss_cit = m_missing_sources.erase(miss_cit);
-
-        // This newly decoded source might trigger the decoding of other sources.
-        add_source_recursive(std::move(decoded_src));
+        continue;
       }
-      else
+      remove_source_from_repair(src, r);
+      if (r.source_ids().size() == 1)
       {
-        // This repair encodes too much sources, other sources are needed to reconstruct *miss_cit.
-        // Try next missing source.
-        ++miss_cit;
+        // The remaining missing source can be decoded.
+        ready.emplace_back(r_cit->first);
       }
     }
-    else
-    {
-      // This missing source is referenced by multiple repairs. Try next missing source.
-      ++miss_cit;
-    }
+
+    // It's no longer a missing source.
+    m_missing_sources.erase(search);
   }
 
+  // This source is kept to be removed from future repairs, it can no longer refer to memory it
+  // doesn't own.
+  src.retain();
+
   // Insert-move this new source in the set of known sources.
   const auto src_id = src.id(); // to force evaluation order in the following call.
   const auto insertion = m_sources.emplace(src_id, std::move(src));
@@ -332,7 +418,23 @@ decoder::add_source_recursive(decoder_source&& src)
   if (m_in_order and insertion.first->second.id() > m_first_missing_source_in_order)
   {
     // We can't send the current source as there are some older sources which have not been sent.
-    m_ordered_sources.emplace(insertion.first->second.id(), &insertion.first->second);
+    hold_ordered_source(insertion.first->second);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::unlink_repair(repairs_set_type::iterator r_cit)
+noexcept
+{
+  for (const auto src_id : r_cit->second.source_ids())
+  {
+    const auto search = m_missing_sources.find(src_id);
+    if (search != m_missing_sources.end())
+    {
+      search->second.erase(r_cit);
+    }
   }
 }
 
@@ -355,10 +457,7 @@ noexcept
     // longer useful.
     if (id > *r.source_ids().begin())
     {
-      for (const auto src_id : r.source_ids())
-      {
-        m_missing_sources.find(src_id)->second.erase(cit);
-      }
+      unlink_repair(cit);
       cit = m_repairs.erase(cit);
     }
     else
@@ -371,21 +470,20 @@ noexcept
   {
     // flush_ordered_sources() won't give to user sources with identifier smaller than id, thus we
     // take care of it now.
-    for (auto cit = m_ordered_sources.begin(), end = m_ordered_sources.lower_bound(id); cit != end;)
-    {
-      m_callback(*cit->second);
-      cit = m_ordered_sources.erase(cit);
-    }
-    if (m_first_missing_source_in_order < id)
-    {
-      m_first_missing_source_in_order = id;
-    }
-    flush_ordered_sources();
+    skip_ordered_sources(id);
   }
 
   // Erase all sources and missing sources with an identifer smaller (strict) than id.
   m_sources.erase(m_sources.begin(), m_sources.lower_bound(id));
   m_missing_sources.erase(m_missing_sources.begin(), m_missing_sources.lower_bound(id));
+  if (m_measures)
+  {
+    auto& ranges = m_measures->missing_ranges;
+    while (not ranges.empty() and ranges.front().last < id)
+    {
+      ranges.pop_front();
+    }
+  }
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -397,14 +495,14 @@ noexcept
   assert(r.source_ids().size() > 1 && "Repair encodes only one source");
   assert(src.symbol_size() <= r.symbol_size());
 
-  const auto coeff = m_gf.coefficient(r.id(), src.id());
+  const auto coeff = gf().coefficient(r.id(), src.id());
 
   // Remove source size.
   r.encoded_size()
-    = static_cast<std::uint16_t>(m_gf.multiply_size(src.symbol_size(), coeff) ^ r.encoded_size());
+    = static_cast<std::uint16_t>(gf().multiply_size(src.symbol_size(), coeff) ^ r.encoded_size());
 
   // Remove symbol.
-  m_gf.multiply_add(src.symbol(), r.symbol(), src.symbol_size(), coeff);
+  gf().multiply_add(src.symbol(), r.symbol(), src.symbol_size(), coeff);
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -412,84 +510,250 @@ noexcept
 void
 decoder::attempt_full_decoding()
 {
-  if (m_repairs.empty() or m_missing_sources.empty())
+  // Most decoders never need to decode, thus memory for matrices is allocated on first use.
+  if (m_repairs.size() > 1 and not m_scratch)
   {
-    return;
+    m_scratch.reset(new full_decoding_scratch);
   }
 
-  // Do we have enough repairs to try to decode missing sources?
-  if (m_missing_sources.size() > m_repairs.size())
+  // A repair is decoded as soon as it encodes only one missing source, thus a subsystem which can
+  // be solved has at least two repairs. Each solved subsystem decodes sources or drops a repair.
+  while (m_repairs.size() > 1 and find_subsystem())
   {
-    return;
+    solve_subsystem();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+decoder::find_subsystem()
+{
+  auto& scratch = *m_scratch;
+
+  scratch.missing.clear();
+  scratch.missing.reserve(m_missing_sources.size());
+  for (const auto& miss : m_missing_sources)
+  {
+    scratch.missing.emplace_back(miss.first);
   }
 
-  assert(m_missing_sources.size() == m_repairs.size() && "More repairs than missing sources");
-  assert(m_missing_sources.size() > 1 && "Trying to create a matrix for only one missing source.");
+  const auto nb_missing = static_cast<std::uint32_t>(scratch.missing.size());
+  scratch.parent.resize(nb_missing);
+  for (auto i = 0u; i < nb_missing; ++i)
+  {
+    scratch.parent[i] = i;
+  }
 
-  // Build coefficient matrix.
-  m_coefficients.resize(m_repairs.size());
-  auto col = 0ul;
+  // Merge the components of all sources encoded by a same repair. The smallest index is kept as a
+  // root, thus roots are the oldest missing sources of their components.
   for (const auto& r : m_repairs)
   {
-    auto row = 0ul;
-    for (const auto& missing : m_missing_sources)
+    if (not encodes_missing_only(r.second))
     {
-      m_coefficients(row, col) = r.second.source_ids().count(missing.first)
-                               ? m_gf.coefficient(r.first, missing.first)
-                               : 0u; // repair doesn't encode the missing source.
-      ++row;
+      continue;
+    }
+    const auto& ids = r.second.source_ids();
+    auto root = component_root(missing_index(*ids.begin()));
+    for (auto cit = std::next(ids.begin()); cit != ids.end(); ++cit)
+    {
+      const auto other = component_root(missing_index(*cit));
+      if (other < root)
+      {
+        scratch.parent[root] = other;
+        root = other;
+      }
+      else if (other > root)
+      {
+        scratch.parent[other] = root;
+      }
     }
-    ++col;
   }
 
-  // Invert it.
-  m_inv.resize(m_coefficients.dimension());
-  const auto r_col = invert(m_gf, m_coefficients, m_inv);
-  if (r_col)
+  // Look at components from the oldest one, as sources may be given in order.
+  for (auto root = 0u; root < nb_missing; ++root)
   {
-    // Inversion failed, remove the faulty repair.
-    m_nb_failed_full_decodings += 1;
+    if (scratch.parent[root] != root)
+    {
+      continue;
+    }
 
-    // Find the repair corresponding to r_col.
-    auto r_cit = m_repairs.begin();
-    // To avoid a conversion warning with clang's -Wconversion.
-    using difference_type = std::iterator_traits<decltype(r_cit)>::difference_type;
-    std::advance(r_cit, static_cast<difference_type>(*r_col));
+    scratch.sources.clear();
+    for (auto i = root; i < nb_missing; ++i)
+    {
+      if (component_root(i) == root)
+      {
+        scratch.sources.emplace_back(scratch.missing[i]);
+      }
+    }
 
-    // Remove repair from missing sources that reference it.
-    for (const auto src : r_cit->second.source_ids())
+    scratch.repairs.clear();
+    for (auto r_it = m_repairs.begin(); r_it != m_repairs.end(); ++r_it)
     {
-      m_missing_sources[src].erase(r_cit);
+      if (  encodes_missing_only(r_it->second)
+        and component_root(missing_index(*r_it->second.source_ids().begin())) == root)
+      {
+        scratch.repairs.emplace_back(r_it);
+      }
+    }
+    if (scratch.repairs.size() < 2)
+    {
+      continue;
     }
 
-    // We can now effectively remove the repair.
-    m_repairs.erase(r_cit);
+    // Sort repairs by the newest source they encode, then find the smallest set of oldest sources
+    // which are encoded by as many repairs which don't encode any other source.
+    const auto newest = [](repairs_set_type::iterator r_it)
+    {
+      return *std::prev(r_it->second.source_ids().end());
+    };
+    std::stable_sort( scratch.repairs.begin(), scratch.repairs.end()
+                    , [&](repairs_set_type::iterator lhs, repairs_set_type::iterator rhs)
+                      {
+                        return newest(lhs) < newest(rhs);
+                      });
+    auto nb_repairs = 0ul;
+    for (auto nb_sources = 1ul; nb_sources <= scratch.sources.size(); ++nb_sources)
+    {
+      while ( nb_repairs < scratch.repairs.size()
+          and newest(scratch.repairs[nb_repairs]) <= scratch.sources[nb_sources - 1])
+      {
+        ++nb_repairs;
+      }
+      if (nb_repairs >= nb_sources)
+      {
+        scratch.sources.resize(nb_sources);
+        scratch.repairs.resize(nb_repairs);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint32_t
+decoder::component_root(std::uint32_t i)
+noexcept
+{
+  auto& parent = m_scratch->parent;
+  while (parent[i] != i)
+  {
+    // Path halving.
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint32_t
+decoder::missing_index(std::uint32_t id)
+const noexcept
+{
+  const auto& missing = m_scratch->missing;
+  const auto cit = std::lower_bound(missing.begin(), missing.end(), id);
+  if (cit == missing.end() or *cit != id)
+  {
+    return static_cast<std::uint32_t>(missing.size());
+  }
+  return static_cast<std::uint32_t>(cit - missing.begin());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+decoder::encodes_missing_only(const decoder_repair& r)
+const noexcept
+{
+  // Known and outdated sources are removed from repairs, thus it should always be true. Still, a
+  // repair which doesn't is left out of subsystems rather than corrupting them.
+  const auto nb_missing = m_scratch->missing.size();
+  return std::all_of( r.source_ids().begin(), r.source_ids().end()
+                    , [&](std::uint32_t id){return missing_index(id) < nb_missing;});
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::solve_subsystem()
+{
+  auto& coefficients = m_scratch->coefficients;
+  auto& inv = m_scratch->inv;
+  const auto& sources = m_scratch->sources;
+  auto& repairs = m_scratch->repairs;
+  auto& decoded = m_scratch->decoded;
+
+  assert(repairs.size() >= sources.size() && "Not enough repairs");
+  assert(not sources.empty());
+
+  // Remove a repair from the missing sources it encodes, then drop it.
+  const auto erase_repair = [this](repairs_set_type::iterator r_it)
+  {
+    unlink_repair(r_it);
+    m_repairs.erase(r_it);
+  };
+
+  if (sources.size() == 1)
+  {
+    // Several repairs encode only this source, no need for a matrix.
+    auto src = create_source_from_repair(repairs.front()->second);
+    for (const auto& r_it : repairs)
+    {
+      erase_repair(r_it);
+    }
+    add_source_recursive(std::move(src));
     return;
   }
 
-  // Matrix successfully inverted, we can now decode missing sources. Phew!
+  const auto start = measure_date();
 
-  // Build an index for fast retrieving of repairs from the inverted matrix.
-  m_index.clear();
-  m_index.reserve(m_repairs.size());
-  for (auto& rid_repair : m_repairs)
+  // Build coefficient matrix, with as many repairs as missing sources.
+  const auto dimension = sources.size();
+  coefficients.resize(dimension);
+  for (auto col = 0ul; col < dimension; ++col)
   {
-    m_index.emplace_back(&rid_repair.second);
+    const auto& r = *repairs[col];
+    for (auto row = 0ul; row < dimension; ++row)
+    {
+      coefficients(row, col) = r.second.source_ids().count(sources[row])
+                               ? gf().coefficient(r.first, sources[row])
+                               : 0u; // repair doesn't encode the missing source.
+    }
   }
 
-  auto src_col = 0u;
-  for (const auto& miss : m_missing_sources)
+  // Invert it.
+  inv.resize(coefficients.dimension());
+  const auto r_col = invert(gf(), coefficients, inv);
+  if (r_col)
+  {
+    // Inversion failed, remove the faulty repair.
+    m_nb_failed_full_decodings += 1;
+    erase_repair(repairs[*r_col]);
+    if (m_measures)
+    {
+      m_measures->histograms.full_decoding.record(to_ns(clock::now() - start));
+    }
+    return;
+  }
+
+  // Matrix successfully inverted, we can now decode missing sources. Phew!
+
+  decoded.clear();
+  for (auto src_col = 0ul; src_col < dimension; ++src_col)
   {
     // First, decode the size of the source.
     const auto src_sz = [&,this]
     {
       auto res = std::uint16_t{0};
-      for (auto repair_row = 0ul; repair_row < m_inv.dimension(); ++repair_row)
+      for (auto repair_row = 0ul; repair_row < inv.dimension(); ++repair_row)
       {
-        const auto coeff = m_inv(repair_row, src_col);
+        const auto coeff = inv(repair_row, src_col);
         if (coeff != 0)
         {
-          const auto tmp = m_gf.multiply_size(m_index[repair_row]->encoded_size(), coeff);
+          const auto tmp = gf().multiply_size(repairs[repair_row]->second.encoded_size(), coeff);
           res = static_cast<std::uint16_t>(tmp) ^ res;
         }
       }
@@ -500,69 +764,70 @@ decoder::attempt_full_decoding()
     // When sources are directly received from the network, they are constructed in a such way that
     // there is a padding before the symbol and the headers (to avoid copy). Here, we have to
     // construct the source in the same way.
-    auto src = decoder_source{ miss.first, packet( src_sz + packet::alignment
-                                                 , 0 /* zero out the buffer */)
-                             , src_sz};
+    decoded.emplace_back( sources[src_col], packet(src_sz + packet::alignment, 0 /* zero out */)
+                        , src_sz);
+    auto& src = decoded.back();
     auto repair_row = 0ul;
     auto coeff = 0u;
 
     // Find first non-zero coefficient.
-    for (; repair_row < repairs().size(); ++repair_row)
+    for (; repair_row < dimension; ++repair_row)
     {
-      coeff = m_inv(repair_row, src_col);
+      coeff = inv(repair_row, src_col);
       if (coeff != 0)
       {
         break;
       }
     }
-    assert(repair_row != m_repairs.size() && "No coefficients for missing source");
+    assert(repair_row != dimension && "No coefficients for missing source");
 
     // Repair's buffer might be smaller than the size of the source to decode, or it could be
     // the opposite situation. Thus, we need to make sure that we only read the right number of
     // bytes.
-    auto sz = std::min(src_sz, static_cast<std::uint16_t>(m_index[repair_row]->symbol_size()));
-    m_gf.multiply(m_index[repair_row]->symbol(), src.symbol(), sz, coeff);
+    const auto* r = &repairs[repair_row]->second;
+    auto sz = std::min(src_sz, static_cast<std::uint16_t>(r->symbol_size()));
+    gf().multiply(r->symbol(), src.symbol(), sz, coeff);
 
-    for (++repair_row; repair_row < m_inv.dimension(); ++repair_row)
+    for (++repair_row; repair_row < dimension; ++repair_row)
     {
-      coeff = m_inv(repair_row, src_col);
+      coeff = inv(repair_row, src_col);
       if (coeff != 0)
       {
-        sz = std::min(src_sz, static_cast<std::uint16_t>(m_index[repair_row]->symbol_size()));
-        m_gf.multiply_add(m_index[repair_row]->symbol(), src.symbol(), sz, coeff);
+        r = &repairs[repair_row]->second;
+        sz = std::min(src_sz, static_cast<std::uint16_t>(r->symbol_size()));
+        gf().multiply_add(r->symbol(), src.symbol(), sz, coeff);
       }
     }
-    ++src_col;
+  }
 
-    // Source decoded, add it to the set of known sources.
-    const auto insertion = m_sources.emplace(miss.first, std::move(src));
-    assert(insertion.second && "source already added");
+  // Repairs of the subsystem, extra ones included, only encode decoded sources.
+  for (const auto& r_it : repairs)
+  {
+    erase_repair(r_it);
+  }
 
-    const auto& inserted_src = insertion.first->second;
-    if (not m_in_order)
-    {
-      m_callback(inserted_src);
-    }
-    else if (inserted_src.id() == m_first_missing_source_in_order)
+  for (auto& src : decoded)
+  {
+    if (m_sources.count(src.id()))
     {
-      m_callback(inserted_src);
-      m_first_missing_source_in_order += 1;
-      // Send all sources that could not be previously sent because their ids were greater than
-      // first_missing_source_.
-      flush_ordered_sources();
+      // Already decoded from a newer repair, which was left with this source only when previous
+      // ones were removed from it.
+      continue;
     }
-    else
+    ++m_nb_decoded;
+    if (m_measures)
     {
-      // We can't send the current source as there are some older sources which have not been sent.
-      m_ordered_sources.emplace(inserted_src.id(), &inserted_src);
+      record_recovery(src.id(), clock::now());
     }
+    // Give the source and remove it from newer repairs, which might decode other sources.
+    add_source_recursive(std::move(src));
   }
+  decoded.clear();
 
-  m_nb_decoded += m_missing_sources.size();
-
-  // Cleanup.
-  m_repairs.clear();
-  m_missing_sources.clear();
+  if (m_measures)
+  {
+    m_measures->histograms.full_decoding.record(to_ns(clock::now() - start));
+  }
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -572,17 +837,133 @@ decoder::flush_ordered_sources()
 {
   // If we find the first missing source, we can give to user all sources with a identifier
   // that follow m_first_missing_source in sequence.
-  auto cit = m_ordered_sources.find(m_first_missing_source_in_order);
-  if (cit != m_ordered_sources.end())
+  m_ordered_sources.release( m_first_missing_source_in_order
+                           , [this](const ordered_source& o){release_ordered_source(o);});
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::release_ordered_source(const ordered_source& o)
+{
+  if (m_measures)
+  {
+    m_measures->histograms.in_order_hold.record(to_ns(clock::now() - o.date));
+  }
+  m_callback(*o.source);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::hold_ordered_source(const decoder_source& src)
+{
+  if (not m_ordered_sources.reaches(m_first_missing_source_in_order, src.id()))
   {
-    while (true)
+    // Waiting for older sources would need too much memory, as for an unbounded reorder depth.
+    skip_ordered_sources(src.id() - reorder_window<ordered_source>::max_capacity + 1);
+  }
+  m_ordered_sources.insert( m_first_missing_source_in_order, src.id()
+                          , ordered_source{&src, measure_date()});
+  if (m_head_of_line)
+  {
+    auto& hol = *m_head_of_line;
+    hol.newest = m_ordered_sources.size() == 1 ? src.id() : std::max(hol.newest, src.id());
+    if (hol.bounds.max_hold_time != clock::duration::zero())
     {
-      assert(cit->first == m_first_missing_source_in_order);
-      m_callback(*cit->second);
-      cit = m_ordered_sources.erase(cit);
-      m_first_missing_source_in_order += 1;
+      const auto date = hol.bounds.clock ? hol.bounds.clock->now() : clock::now();
+      hol.arrivals.push_back(arrival{src.id(), date});
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::skip_ordered_sources(std::uint32_t id)
+{
+  const auto skipped = [this](std::uint32_t first, std::uint32_t end)
+  {
+    if (first < end and m_head_of_line and m_head_of_line->bounds.skipped)
+    {
+      m_head_of_line->bounds.skipped(first, end - 1);
+    }
+  };
+
+  // Missing sources are between the given ones.
+  auto next = m_first_missing_source_in_order;
+  m_ordered_sources.release_before( m_first_missing_source_in_order, id
+                                  , [&](const ordered_source& o)
+                                    {
+                                      skipped(next, o.source->id());
+                                      next = o.source->id() + 1;
+                                      release_ordered_source(o);
+                                    });
+  skipped(next, m_first_missing_source_in_order);
+  flush_ordered_sources();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::set_head_of_line_bounds(head_of_line_bounds bounds)
+{
+  if (not m_head_of_line)
+  {
+    m_head_of_line.reset(new head_of_line_state{});
+  }
+  m_head_of_line->bounds = std::move(bounds);
+  if (m_head_of_line->bounds.max_hold_time == clock::duration::zero())
+  {
+    m_head_of_line->arrivals.clear();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const decoder::head_of_line_bounds*
+decoder::head_of_line()
+const noexcept
+{
+  return m_head_of_line ? &m_head_of_line->bounds : nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::expire_held_sources()
+{
+  if (not m_in_order or not m_head_of_line)
+  {
+    return;
+  }
+  auto& hol = *m_head_of_line;
+
+  // The newest waiting source is too far from the first missing one.
+  const auto depth = hol.bounds.max_reorder_depth;
+  if ( depth != 0 and not m_ordered_sources.empty()
+       and hol.newest - m_first_missing_source_in_order >= depth)
+  {
+    skip_ordered_sources(hol.newest - depth + 1);
+  }
 
-      if (cit == m_ordered_sources.end() or cit->first > m_first_missing_source_in_order)
+  // The oldest waiting source waited too long.
+  if (hol.bounds.max_hold_time != clock::duration::zero())
+  {
+    const auto now = hol.bounds.clock ? hol.bounds.clock->now() : clock::now();
+    while (not hol.arrivals.empty())
+    {
+      const auto oldest = hol.arrivals.front();
+      if (oldest.id < m_first_missing_source_in_order)
+      {
+        // Already given.
+        hol.arrivals.pop_front();
+      }
+      else if (now - oldest.date >= hol.bounds.max_hold_time)
+      {
+        skip_ordered_sources(oldest.id);
+      }
+      else
       {
         break;
       }
@@ -592,4 +973,49 @@ decoder::flush_ordered_sources()
 
 /*------------------------------------------------------------------------------------------------*/
 
+decoder::clock::time_point
+decoder::measure_date()
+const noexcept
+{
+  // Reading the clock is not free, don't do it if it's not needed.
+  return m_measures ? clock::now() : clock::time_point{};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::detect_missing_sources(std::uint32_t end)
+{
+  assert(m_measures);
+  auto& next = m_measures->next_unseen_id;
+  if (end > next)
+  {
+    m_measures->missing_ranges.push_back(missing_range{next, end - 1, clock::now()});
+    next = end;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::record_recovery(std::uint32_t id, clock::time_point now)
+noexcept
+{
+  assert(m_measures);
+  const auto& ranges = m_measures->missing_ranges;
+  // Ranges don't overlap, find the last one which starts before id.
+  auto search = std::upper_bound( ranges.begin(), ranges.end(), id
+                                , [](std::uint32_t x, const missing_range& r){return x < r.first;});
+  if (search != ranges.begin())
+  {
+    --search;
+    if (id <= search->last)
+    {
+      m_measures->histograms.loss_to_recovery.record(to_ns(now - search->date));
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 }} // namespace ntc::detail
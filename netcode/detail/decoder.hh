@@ -1,5 +1,9 @@
 #pragma once
 
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include <boost/container/flat_set.hpp>
@@ -7,9 +11,12 @@
 #include <boost/optional.hpp>
 
 #include "netcode/detail/galois_field.hh"
+#include "netcode/detail/reorder_window.hh"
 #include "netcode/detail/repair.hh"
 #include "netcode/detail/source.hh"
 #include "netcode/detail/square_matrix.hh"
+#include "netcode/cached_clock.hh"
+#include "netcode/histogram.hh"
 #include "netcode/in_order.hh"
 
 namespace ntc { namespace detail {
@@ -52,6 +59,22 @@ public:
   /// contain them.
   using missing_sources_type = boost::container::map<std::uint32_t, repairs_iterators_type>;
 
+  /// @brief Bounds of the wait of sources for older ones, in in-order mode.
+  struct head_of_line_bounds
+  {
+    /// @brief How long a source can wait, unbounded if 0.
+    std::chrono::steady_clock::duration max_hold_time;
+
+    /// @brief How far a source can be from the first missing one, unbounded if 0.
+    std::uint32_t max_reorder_depth;
+
+    /// @brief Called with the first and last identifiers of each range of skipped sources.
+    std::function<void(std::uint32_t, std::uint32_t)> skipped;
+
+    /// @brief The clock which dates waiting sources, nullptr to read std::chrono::steady_clock.
+    const cached_clock* clock;
+  };
+
 public:
 
   /// @brief Constructor.
@@ -59,10 +82,12 @@ public:
          , in_order order);
 
   /// @brief What to do when a source is received.
+  /// @note If @p src is borrowed, it's given to the callback before being retained.
   void
   operator()(decoder_source&& src);
 
   /// @brief What to do when a repair is received.
+  /// @note If @p incoming_r is borrowed, it's retained only if it's not dropped.
   void
   operator()(decoder_repair&& incoming_r);
 
@@ -108,12 +133,154 @@ public:
   nb_decoded()
   const noexcept;
 
+  /// @brief Get the number of sources waiting for older ones to be given in order.
+  std::size_t
+  nb_ordered_sources()
+  const noexcept;
+
+  /// @brief Bound the wait of sources for older ones, in in-order mode.
+  ///
+  /// When a bound is exceeded, missing sources are skipped: they won't be given to the callback,
+  /// even if they are decoded later, and waiting sources which follow them are given.
+  /// @note The hold time of sources which were already waiting is not bounded.
+  void
+  set_head_of_line_bounds(head_of_line_bounds bounds);
+
+  /// @brief Get the bounds of the wait of sources, nullptr if none were set.
+  const head_of_line_bounds*
+  head_of_line()
+  const noexcept;
+
+  /// @brief Skip missing sources if waiting sources exceed the bounds of their wait.
+  ///
+  /// Does nothing if no bounds are set.
+  void
+  expire_held_sources();
+
+  /// @brief Enable or disable the measure of latencies.
+  ///
+  /// Disabling measures drops all histograms.
+  void
+  set_histograms(bool enabled);
+
+  /// @brief Get the measured latencies.
+  /// @return nullptr if measures are disabled.
+  const decoder_histograms*
+  histograms()
+  const noexcept;
+
 private:
 
-  /// @brief Recursively decode any repair that encodes only one source.
+  /// @brief The clock used to measure latencies.
+  using clock = std::chrono::steady_clock;
+
+  /// @brief A source waiting for older ones to be given in order.
+  struct ordered_source
+  {
+    /// @brief The waiting source.
+    const decoder_source* source;
+
+    /// @brief When the source started to wait, only set if latencies are measured.
+    clock::time_point date;
+  };
+
+  /// @brief A range of sources known to be missing.
+  struct missing_range
+  {
+    /// @brief The identifier of the first missing source.
+    std::uint32_t first;
+
+    /// @brief The identifier of the last missing source.
+    std::uint32_t last;
+
+    /// @brief When these sources were detected as missing.
+    clock::time_point date;
+  };
+
+  /// @brief The state needed to measure latencies.
+  struct measures
+  {
+    /// @brief Measured latencies.
+    decoder_histograms histograms;
+
+    /// @brief The identifier following the greatest one seen in a source or a repair.
+    std::uint32_t next_unseen_id;
+
+    /// @brief Sources which were detected as missing, sorted by identifiers.
+    std::deque<missing_range> missing_ranges;
+  };
+
+  /// @brief When a source started to wait for older ones.
+  struct arrival
+  {
+    /// @brief The identifier of the waiting source.
+    std::uint32_t id;
+
+    /// @brief When it started to wait.
+    clock::time_point date;
+  };
+
+  /// @brief The state needed to bound the wait of sources.
+  struct head_of_line_state
+  {
+    /// @brief The bounds given by the application.
+    head_of_line_bounds bounds;
+
+    /// @brief The greatest identifier of a waiting source.
+    std::uint32_t newest;
+
+    /// @brief Waiting sources, sorted by date, only kept if the hold time is bounded.
+    ///
+    /// Sources which are not waiting anymore are removed lazily.
+    std::deque<arrival> arrivals;
+  };
+
+  /// @brief Memory re-used by full decodings.
+  struct full_decoding_scratch
+  {
+    /// @brief The matrix of coefficients.
+    square_matrix coefficients{0};
+
+    /// @brief The inverted matrix of coefficients.
+    square_matrix inv{0};
+
+    /// @brief Missing sources identifiers, sorted, to find their index.
+    std::vector<std::uint32_t> missing;
+
+    /// @brief The parent of each missing source in a forest of connected sources.
+    ///
+    /// The root of a tree is its oldest missing source.
+    std::vector<std::uint32_t> parent;
+
+    /// @brief Missing sources of the subsystem to solve, rows of the matrix.
+    std::vector<std::uint32_t> sources;
+
+    /// @brief Repairs of the subsystem to solve, columns of the matrix.
+    std::vector<repairs_set_type::iterator> repairs;
+
+    /// @brief Sources decoded from a subsystem.
+    std::vector<decoder_source> decoded;
+  };
+
+  /// @brief Get the Galois field of the calling thread (see thread_galois_field).
+  galois_field&
+  gf()
+  const;
+
+  /// @brief Add a source, then decode any repair that is left with only one source.
   void
   add_source_recursive(decoder_source&& src);
 
+  /// @brief Give a source to the callback, remove it from repairs, and keep it.
+  /// @param ready Where to put the identifiers of repairs left with only one source.
+  void
+  add_source(decoder_source&& src, std::vector<std::uint32_t>& ready);
+
+  /// @brief Remove a repair from the missing sources it encodes, before it's erased.
+  void
+  unlink_repair(repairs_set_type::iterator r_cit)
+  noexcept;
+
   /// @brief Drop outdated sources and repairs.
   /// @param id The oldest id to keep. 
   ///
@@ -132,17 +299,84 @@ private:
   noexcept;
 
   /// @brief Try to construct missing sources from the set of repairs.
+  ///
+  /// Missing sources are not decoded all at once: subsystems which can be solved on their own are
+  /// found and decoded as soon as they have enough repairs, whatever the other missing sources.
   void
   attempt_full_decoding();
 
+  /// @brief Find the oldest subsystem which has enough repairs to be solved.
+  /// @return false if there is none.
+  ///
+  /// Missing sources are first split in connected components, i.e. sources linked through the
+  /// repairs which encode them. Then, as repairs encode a sliding window, the oldest sources of a
+  /// component and the repairs which encode only these sources may have enough repairs, even if
+  /// the whole component doesn't. The subsystem is given by m_scratch->sources and
+  /// m_scratch->repairs.
+  bool
+  find_subsystem();
+
+  /// @brief Get the root of the connected component of the missing source at index @p i.
+  std::uint32_t
+  component_root(std::uint32_t i)
+  noexcept;
+
+  /// @brief Get the index of a missing source.
+  /// @return The number of missing sources if @p id is not missing.
+  std::uint32_t
+  missing_index(std::uint32_t id)
+  const noexcept;
+
+  /// @brief Tell if all sources encoded by a repair are missing.
+  bool
+  encodes_missing_only(const decoder_repair& r)
+  const noexcept;
+
+  /// @brief Decode the subsystem given by m_scratch->sources and m_scratch->repairs.
+  ///
+  /// Decoded sources are then removed from all other repairs which encode them.
+  /// @pre There are at least as many repairs as missing sources, and at least one.
+  /// @note If the matrix built from the first repairs can't be inverted, the faulty repair is
+  /// dropped.
+  void
+  solve_subsystem();
+
   /// @brief Give to callback ordered sources, if possible.
   void
   flush_ordered_sources();
 
+  /// @brief Give to callback a source which was waiting for older ones.
+  void
+  release_ordered_source(const ordered_source& o);
+
+  /// @brief Keep a source until older ones are given to callback, skip them if it is too far.
+  void
+  hold_ordered_source(const decoder_source& src);
+
+  /// @brief Give to callback all waiting sources older than @p id, skipping missing ones.
+  void
+  skip_ordered_sources(std::uint32_t id);
+
+  /// @brief Get the current date if latencies are measured, the epoch of the clock otherwise.
+  clock::time_point
+  measure_date()
+  const noexcept;
+
+  /// @brief Remember that sources up to @p end (excluded) which have not been seen are missing.
+  /// @pre Latencies are measured.
+  void
+  detect_missing_sources(std::uint32_t end);
+
+  /// @brief Measure the time it took to recover a missing source.
+  /// @pre Latencies are measured.
+  void
+  record_recovery(std::uint32_t id, clock::time_point now)
+  noexcept;
+
 private:
 
-  /// @brief The implementation of a Galois field.
-  galois_field m_gf;
+  /// @brief The size of the Galois field, the field itself is the one of the calling thread.
+  const std::uint8_t m_galois_field_size;
 
   /// @brief Indicates if sources should be given in-order to the callback.
   const bool m_in_order;
@@ -154,7 +388,7 @@ private:
 
   /// @brief Maintains a list of sources which could not be given to callback when some older
   /// sources are still missing.
-  boost::container::map<std::uint32_t, const decoder_source*> m_ordered_sources;
+  reorder_window<ordered_source> m_ordered_sources;
 
   /// @brief The callback to call when a source has been decoded or received.
   const std::function<void(const decoder_source&)> m_callback;
@@ -182,14 +416,16 @@ private:
   /// @brief The number of decoded sources.
   std::size_t m_nb_decoded;
 
-  /// @brief Re-use the same memory for the matrix of coefficients.
-  square_matrix m_coefficients;
+  /// @brief Memory re-used by full decodings, allocated by the first one.
+  std::unique_ptr<full_decoding_scratch> m_scratch;
 
-  /// @brief Re-use the same memory for the inverted matrix of coefficients.
-  square_matrix m_inv;
+  /// @brief The state of measures, nullptr if measures are disabled.
+  ///
+  /// Allocated on demand to keep idle decoders small.
+  std::unique_ptr<measures> m_measures;
 
-  /// @brief Re-use the same memory for the index of repairs in the inverted matrix.
-  std::vector<decoder_repair*> m_index;
+  /// @brief The bounds of the wait of sources, nullptr if the wait is unbounded.
+  std::unique_ptr<head_of_line_state> m_head_of_line;
 };
 
 /*------------------------------------------------------------------------------------------------*/
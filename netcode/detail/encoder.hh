@@ -26,8 +26,11 @@ public:
 
 private:
 
-  /// @brief The implementation of a Galois field.
-  detail::galois_field m_gf;
+  /// @brief The size of the Galois field.
+  ///
+  /// The field itself is the one of the calling thread, as an encoder may be used by several
+  /// threads in turn (see thread_galois_field).
+  std::uint8_t m_galois_field_size;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm> // copy_n
+#include <cstdint>
+
+#include <boost/endian/conversion.hpp>
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The number of bytes of the flow header which prefixes packets of a session_table.
+static constexpr auto flow_header_size = sizeof(std::uint32_t);
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Read the flow identifier of a packet.
+/// @pre @p data holds at least flow_header_size bytes.
+inline
+std::uint32_t
+read_flow_id(const char* data)
+noexcept
+{
+  std::uint32_t id;
+  std::copy_n(data, sizeof(id), reinterpret_cast<char*>(&id));
+  return boost::endian::big_to_native(id);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A packet handler which prefixes packets with a flow identifier.
+///
+/// All sessions of a session_table share the same user's handler, thus this handler only holds a
+/// pointer to it.
+template <typename PacketHandler>
+class flow_packet_handler final
+{
+public:
+
+  /// @brief Constructor.
+  flow_packet_handler(PacketHandler& handler, std::uint32_t id)
+    : m_handler{&handler}
+    , m_id{boost::endian::native_to_big(id)}
+    , m_started{false}
+  {}
+
+  /// @brief Forward a chunk of a packet, preceded by the flow header if it's the first one.
+  void
+  operator()(const char* data, std::size_t sz)
+  {
+    if (not m_started)
+    {
+      (*m_handler)(reinterpret_cast<const char*>(&m_id), sizeof(m_id));
+      m_started = true;
+    }
+    (*m_handler)(data, sz);
+  }
+
+  /// @brief Forward the end of a packet.
+  void
+  operator()()
+  {
+    m_started = false;
+    (*m_handler)();
+  }
+
+private:
+
+  /// @brief The user's handler.
+  PacketHandler* m_handler;
+
+  /// @brief The flow identifier, as written on the network.
+  std::uint32_t m_id;
+
+  /// @brief Tell if the flow header of the current packet has been written.
+  bool m_started;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A data handler which tells the user's handler from which flow data comes.
+template <typename DataHandler>
+class flow_data_handler final
+{
+public:
+
+  /// @brief Constructor.
+  flow_data_handler(DataHandler& handler, std::uint32_t id)
+    : m_handler{&handler}
+    , m_id{id}
+  {}
+
+  /// @brief Forward decoded data.
+  void
+  operator()(const char* data, std::size_t sz)
+  {
+    (*m_handler)(m_id, data, sz);
+  }
+
+private:
+
+  /// @brief The user's handler.
+  DataHandler* m_handler;
+
+  /// @brief The flow identifier.
+  std::uint32_t m_id;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -168,4 +168,27 @@ private:
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+/// @brief Get the Galois field of size @p w of the calling thread.
+///
+/// A field holds the multiplication tables of gf-complete, which take several kilobytes, thus it's
+/// shared by all encoders and decoders used by a thread. It's never shared between threads: some
+/// gf-complete methods write in the field when they multiply, e.g. the default region
+/// multiplication for w = 32 rebuilds its split tables in the field's scratch memory.
+inline
+galois_field&
+thread_galois_field(std::uint8_t w)
+{
+  switch (w)
+  {
+    case 4:  { static thread_local galois_field gf{4};  return gf; }
+    case 8:  { static thread_local galois_field gf{8};  return gf; }
+    case 16: { static thread_local galois_field gf{16}; return gf; }
+    case 32: { static thread_local galois_field gf{32}; return gf; }
+    default: throw std::runtime_error("Invalid galois field size");
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 }} // namespace galois::detail
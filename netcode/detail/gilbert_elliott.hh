@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm> // max, min
+#include <cstdint>
+#include <utility>   // pair
+#include <vector>
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Estimate the parameters of a Gilbert-Elliott channel and choose a code for it.
+///
+/// The channel has two states: packets are never lost in the good state, they are always lost in
+/// the bad state. It moves from the good state to the bad one with probability p_gb, and back with
+/// probability p_bg. The mean loss rate is p_gb / (p_gb + p_bg) and the mean burst length is
+/// 1 / p_bg.
+///
+/// The loss rate is estimated from the number of packets sent and received between two acks. The
+/// burst length is estimated from the runs of consecutive sources missing in acks.
+class gilbert_elliott final
+{
+public:
+
+  /// @brief The largest number of sources sent before a repair.
+  static constexpr std::size_t max_rate = 50;
+
+  /// @brief The largest window considered, to bound the cost of decoding.
+  static constexpr std::size_t max_window = 64;
+
+  /// @brief Constructor.
+  gilbert_elliott()
+    : m_nb_sent{0}
+    , m_nb_lost{0}
+    , m_runs_length{0}
+    , m_nb_runs{0}
+    , m_current_run{0}
+    , m_good{}
+    , m_bad{}
+  {}
+
+  /// @brief Take into account the packets sent and received since the last ack.
+  void
+  observe_counts(std::size_t nb_sent, std::size_t nb_received)
+  noexcept
+  {
+    // An ack can report more packets than what was sent since the previous received ack, e.g. when
+    // it was delayed.
+    const auto nb_lost = nb_sent > nb_received ? nb_sent - nb_received : 0ul;
+    m_nb_sent = m_nb_sent * counts_decay + static_cast<double>(nb_sent);
+    m_nb_lost = m_nb_lost * counts_decay + static_cast<double>(nb_lost);
+  }
+
+  /// @brief Take into account the next source in sending order.
+  /// @param lost Tell if the source was missing in an ack
+  void
+  observe_source(bool lost)
+  noexcept
+  {
+    if (lost)
+    {
+      ++m_current_run;
+    }
+    else if (m_current_run > 0)
+    {
+      m_runs_length = m_runs_length * runs_decay + static_cast<double>(m_current_run);
+      m_nb_runs = m_nb_runs * runs_decay + 1;
+      m_current_run = 0;
+    }
+  }
+
+  /// @brief Get the estimated mean loss rate.
+  double
+  loss_rate()
+  const noexcept
+  {
+    return m_nb_sent > 0 ? m_nb_lost / m_nb_sent : 0;
+  }
+
+  /// @brief Get the estimated mean length of a burst of losses.
+  ///
+  /// Until a burst has been observed, losses are assumed to be independent.
+  double
+  burst_length()
+  const noexcept
+  {
+    if (m_nb_runs > 0)
+    {
+      return std::max(1.0, m_runs_length / m_nb_runs);
+    }
+    return 1 / (1 - capped_loss_rate());
+  }
+
+  /// @brief Get the estimated probability to go from the good state to the bad state.
+  double
+  p_gb()
+  const noexcept
+  {
+    const auto loss = capped_loss_rate();
+    return std::min(1.0, loss * p_bg() / (1 - loss));
+  }
+
+  /// @brief Get the estimated probability to go from the bad state to the good state.
+  double
+  p_bg()
+  const noexcept
+  {
+    return 1 / burst_length();
+  }
+
+  /// @brief Compute the fraction of sources that can't be recovered.
+  /// @param nb_sources The number of sources covered by repairs
+  /// @param nb_repairs The number of repairs sent for @p nb_sources
+  ///
+  /// The sliding window is approximated by a block of @p nb_sources sources followed by
+  /// @p nb_repairs repairs, where all lost sources are recovered if there are at most
+  /// @p nb_repairs losses in the block, and none otherwise.
+  double
+  residual_loss(std::size_t nb_sources, std::size_t nb_repairs)
+  {
+    const auto p_gb = this->p_gb();
+    const auto p_bg = this->p_bg();
+    const auto loss = p_gb + p_bg > 0 ? p_gb / (p_gb + p_bg) : 0;
+    const auto nb_packets = nb_sources + nb_repairs;
+
+    // m_good[j] (resp. m_bad[j]) is the probability to be in the good (resp. bad) state with j
+    // losses, for j up to the number of repairs. Start from the stationary distribution.
+    m_good.assign(nb_repairs + 2, 0);
+    m_bad.assign(nb_repairs + 2, 0);
+    m_good[0] = 1 - loss;
+    m_bad[0] = loss;
+    for (auto i = 0ul; i < nb_packets; ++i)
+    {
+      for (auto j = nb_repairs + 1; j > 0; --j)
+      {
+        const auto good = m_good[j - 1];
+        const auto bad = m_bad[j - 1];
+        m_good[j - 1] = good * (1 - p_gb) + bad * p_bg;
+        // Losses beyond the number of repairs are not tracked, the last cell is a sink.
+        m_bad[j] = j == nb_repairs + 1 ? 0 : good * p_gb + bad * (1 - p_bg);
+      }
+      m_bad[0] = 0;
+    }
+
+    // Losses which are not recovered: all of them, minus the ones of the recoverable cases.
+    auto recovered = 0.0;
+    for (auto j = 1ul; j <= nb_repairs; ++j)
+    {
+      recovered += static_cast<double>(j) * (m_good[j] + m_bad[j]);
+    }
+    const auto unrecovered = loss * static_cast<double>(nb_packets) - recovered;
+    return std::max(0.0, unrecovered / static_cast<double>(nb_packets));
+  }
+
+  /// @brief Choose the cheapest code which achieves a target residual loss.
+  /// @param target The maximal fraction of sources that can't be recovered
+  /// @param window_size The maximal window size
+  /// @return The number of sources sent before a repair and the window size
+  ///
+  /// The smallest window is preferred among codes with the same rate, as it costs less to decode.
+  /// If no code achieves @p target, the most robust one is returned.
+  std::pair<std::size_t, std::size_t>
+  choose(double target, std::size_t window_size)
+  {
+    const auto max_window_size = window_size < max_window ? window_size : max_window;
+    for (auto rate = max_rate; rate > 0; --rate)
+    {
+      for (auto nb_repairs = 1ul; rate * nb_repairs <= max_window_size; nb_repairs *= 2)
+      {
+        if (residual_loss(rate * nb_repairs, nb_repairs) <= target)
+        {
+          return std::make_pair(rate, rate * nb_repairs);
+        }
+      }
+    }
+    return std::make_pair(1ul, max_window_size);
+  }
+
+private:
+
+  /// @brief Get the estimated loss rate, bounded to keep estimates finite.
+  double
+  capped_loss_rate()
+  const noexcept
+  {
+    return loss_rate() < max_loss ? loss_rate() : max_loss;
+  }
+
+private:
+
+  /// @brief The weight of past acks in the loss rate.
+  static constexpr double counts_decay = 0.9;
+
+  /// @brief The weight of past bursts in the burst length, as bursts are less frequent than acks.
+  static constexpr double runs_decay = 0.98;
+
+  /// @brief The largest loss rate considered.
+  static constexpr double max_loss = 0.99;
+
+  /// @brief The decayed number of sent packets.
+  double m_nb_sent;
+
+  /// @brief The decayed number of lost packets.
+  double m_nb_lost;
+
+  /// @brief The decayed sum of the lengths of observed bursts.
+  double m_runs_length;
+
+  /// @brief The decayed number of observed bursts.
+  double m_nb_runs;
+
+  /// @brief The length of the burst being observed.
+  std::size_t m_current_run;
+
+  /// @brief Re-use the same memory to compute residual losses.
+  std::vector<double> m_good;
+
+  /// @brief Re-use the same memory to compute residual losses.
+  std::vector<double> m_bad;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
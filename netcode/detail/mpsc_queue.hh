@@ -0,0 +1,248 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>   // size_t
+#include <memory>
+#include <utility>   // forward, swap
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A bounded lock-free queue for any number of producer threads and one consumer thread.
+///
+/// Each slot has a sequence number which tells if it's free or full for a given lap of the ring:
+/// producers reserve a slot by incrementing the tail, then publish it by updating its sequence.
+/// The consumer never writes the tail, producers never write the head.
+template <typename T>
+class mpsc_queue final
+{
+public:
+
+  /// @brief Can't copy-construct a queue.
+  mpsc_queue(const mpsc_queue&) = delete;
+
+  /// @brief Can't copy a queue.
+  mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+  /// @brief Constructor.
+  /// @param capacity The maximal number of elements, rounded up to the next power of 2.
+  explicit mpsc_queue(std::size_t capacity)
+    : m_mask{round_up(capacity) - 1}
+    , m_slots{new slot[m_mask + 1]}
+    , m_head{0}
+    , m_tail{0}
+  {
+    for (auto i = 0ul; i <= m_mask; ++i)
+    {
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /// @brief Add an element, to be called by producers.
+  /// @return false if the queue is full, in which case @p x is left untouched.
+  bool
+  try_push(T&& x)
+  {
+    return try_emplace(std::move(x));
+  }
+
+  /// @brief Construct an element from @p args, to be called by producers.
+  /// @return false if the queue is full, in which case @p args are left untouched.
+  template <typename... Args>
+  bool
+  try_emplace(Args&&... args)
+  {
+    slot* s = reserve();
+    if (not s)
+    {
+      return false;
+    }
+    s->value = T{std::forward<Args>(args)...};
+    publish(*s);
+    return true;
+  }
+
+  /// @brief Add an element by swapping it with the content of its slot, to be called by producers.
+  /// @return false if the queue is full, in which case @p x is left untouched.
+  ///
+  /// On success, @p x holds what the consumer left in the slot, e.g. a buffer to re-use.
+  bool
+  try_exchange(T& x)
+  {
+    using std::swap;
+    slot* s = reserve();
+    if (not s)
+    {
+      return false;
+    }
+    swap(s->value, x);
+    publish(*s);
+    return true;
+  }
+
+  /// @brief Remove the oldest element, to be called by the consumer.
+  /// @return false if the queue is empty, or if the oldest element is still being written.
+  bool
+  try_pop(T& x)
+  {
+    auto& s = m_slots[m_head & m_mask];
+    if (s.sequence.load(std::memory_order_acquire) != m_head + 1)
+    {
+      return false;
+    }
+    x = std::move(s.value);
+    release(s);
+    return true;
+  }
+
+  /// @brief Give up to @p max of the oldest elements to @p fn, to be called by the consumer.
+  /// @param fn Called with a reference to each element, in order. Elements are left in their
+  /// slots, thus @p fn can either move them away or let producers re-use them.
+  /// @param max The maximal number of elements to give.
+  /// @return The number of elements given to @p fn.
+  /// @note Stops at the first element which is still being written.
+  template <typename Fn>
+  std::size_t
+  consume(Fn&& fn, std::size_t max)
+  {
+    auto nb = 0ul;
+    for (; nb < max; ++nb)
+    {
+      auto& s = m_slots[m_head & m_mask];
+      if (s.sequence.load(std::memory_order_acquire) != m_head + 1)
+      {
+        break;
+      }
+      try
+      {
+        fn(s.value);
+      }
+      catch (...)
+      {
+        // The element which made fn throw is consumed.
+        release(s);
+        throw;
+      }
+      release(s);
+    }
+    return nb;
+  }
+
+  /// @brief Tell if there is no element to pop, to be called by the consumer.
+  bool
+  empty()
+  const noexcept
+  {
+    return m_slots[m_head & m_mask].sequence.load(std::memory_order_acquire) != m_head + 1;
+  }
+
+  /// @brief Get the maximal number of elements.
+  std::size_t
+  capacity()
+  const noexcept
+  {
+    return m_mask + 1;
+  }
+
+private:
+
+  /// @brief An element and its sequence number.
+  struct slot
+  {
+    /// @brief Equal to the index of the next push in this slot if it's free, to this index + 1 if
+    /// it's full.
+    std::atomic<std::size_t> sequence;
+
+    /// @brief The element.
+    T value;
+  };
+
+  /// @brief Reserve the slot of the next push.
+  /// @return nullptr if the queue is full.
+  slot*
+  reserve()
+  noexcept
+  {
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    while (true)
+    {
+      auto& s = m_slots[tail & m_mask];
+      const auto sequence = s.sequence.load(std::memory_order_acquire);
+      if (sequence == tail)
+      {
+        // The slot is free for this lap, try to take it. On failure, tail is updated.
+        if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+        {
+          return &s;
+        }
+      }
+      else if (sequence < tail)
+      {
+        // The consumer has not yet released this slot from the previous lap.
+        return nullptr;
+      }
+      else
+      {
+        // Another producer took this slot.
+        tail = m_tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// @brief Make a written slot visible to the consumer.
+  void
+  publish(slot& s)
+  noexcept
+  {
+    s.sequence.store(s.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /// @brief Give a slot back to producers for the next lap.
+  void
+  release(slot& s)
+  noexcept
+  {
+    s.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+    ++m_head;
+  }
+
+  /// @brief Round up to the next power of 2.
+  static
+  std::size_t
+  round_up(std::size_t n)
+  noexcept
+  {
+    assert(n > 0);
+    auto res = std::size_t{1};
+    while (res < n)
+    {
+      res *= 2;
+    }
+    return res;
+  }
+
+  /// @brief The size of a cache line, to avoid false sharing between producers and consumer.
+  static constexpr auto cache_line_size = 64ul;
+
+  /// @brief To find a slot from an index.
+  const std::size_t m_mask;
+
+  /// @brief Elements.
+  const std::unique_ptr<slot[]> m_slots;
+
+  /// @brief The index of the next element to pop, only used by the consumer.
+  std::size_t m_head;
+
+  /// @brief Keep producers' index on another cache line.
+  char m_padding[cache_line_size - sizeof(std::size_t)];
+
+  /// @brief The index of the next element to push, shared by producers.
+  std::atomic<std::size_t> m_tail;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
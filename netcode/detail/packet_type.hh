@@ -12,13 +12,13 @@ enum class packet_type : std::uint8_t {ack = 0, repair = 1, source = 2};
 
 /*------------------------------------------------------------------------------------------------*/
 
-/// @brief Get the type of a raw packet by looking at its first byte.
+/// @brief Get the type of a raw packet held in a buffer by looking at its first byte.
 /// @throw packet_type_error if the type could not have been read.
 inline
 packet_type
-get_packet_type(const packet& p)
+get_packet_type(const char* data, std::size_t size)
 {
-  const auto ty = *reinterpret_cast<const std::uint8_t*>(p.data());
+  const auto ty = *reinterpret_cast<const std::uint8_t*>(data);
   switch (ty)
   {
     case 0:
@@ -31,10 +31,21 @@ get_packet_type(const packet& p)
       return packet_type::source;
 
     default:
-      throw packet_type_error{p};
+      throw packet_type_error{packet(data, data + size)};
   }
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Get the type of a raw packet by looking at its first byte.
+/// @throw packet_type_error if the type could not have been read.
+inline
+packet_type
+get_packet_type(const packet& p)
+{
+  return get_packet_type(p.data(), p.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 }} // namespace ntc::detail
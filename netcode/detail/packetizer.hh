@@ -41,8 +41,17 @@ public:
     : m_packet_handler(h)
     , m_difference_buffer(32)
     , m_rle_buffer(32)
+    , m_nb_written_bytes{0}
   {}
 
+  /// @brief Get the number of bytes given to the handler since construction.
+  std::size_t
+  nb_written_bytes()
+  const noexcept
+  {
+    return m_nb_written_bytes;
+  }
+
   void
   write_ack(const ack& a)
   {
@@ -50,7 +59,7 @@ public:
     static const auto packet_ty = static_cast<std::uint8_t>(packet_type::ack);
     write<std::uint8_t>(packet_ty);
 
-    // Write the number of packets received since last ack.
+    // Write the number of received packets, modulo 2^16.
     write<std::uint16_t>(a.nb_packets());
 
     // Write source identifiers.
@@ -64,12 +73,16 @@ public:
   std::pair<ack, std::size_t>
   read_ack(packet&& p)
   {
-    // Packet type should have been verified by the caller.
-    assert(get_packet_type(p) == packet_type::ack);
+    return read_ack(static_cast<const packet&>(p).data(), p.size());
+  }
 
-    const char* data = p.data();
-    // To prevent overrun
-    auto max_len = p.size();
+  /// @brief Read an ack directly from a buffer.
+  /// @throw overflow_error
+  std::pair<ack, std::size_t>
+  read_ack(const char* data, std::size_t max_len)
+  {
+    // Packet type should have been verified by the caller.
+    assert(get_packet_type(data, max_len) == packet_type::ack);
 
     // Keep the initial memory location.
     const auto begin = reinterpret_cast<std::size_t>(data);
@@ -77,7 +90,7 @@ public:
     // Skip packet type
     read<std::uint8_t>(data, max_len);
 
-    // Read the number of packets received since last ack.
+    // Read the number of received packets, modulo 2^16.
     const auto nb_packets = read<std::uint16_t>(data, max_len);
 
     // Read source identifiers
@@ -125,12 +138,22 @@ public:
   std::pair<decoder_repair, std::size_t>
   read_repair(packet&& p)
   {
-    // Packet type should have been verified by the caller.
-    assert(get_packet_type(p) == packet_type::repair);
+    // Parse in place, then give the packet's memory to the repair.
+    auto res = read_repair(static_cast<const packet&>(p).data(), p.size());
+    auto& r = res.first;
+    return std::make_pair( decoder_repair{ r.id(), r.encoded_size(), std::move(r.source_ids())
+                                         , std::move(p), r.symbol_size()}
+                         , res.second);
+  }
 
-    const char* data = p.data();
-    // To prevent overrun
-    auto max_len = p.size();
+  /// @brief Read a repair directly from a buffer, without copying its symbol.
+  /// @return A repair which borrows its symbol from @p data.
+  /// @throw overflow_error
+  std::pair<decoder_repair, std::size_t>
+  read_repair(const char* data, std::size_t max_len)
+  {
+    // Packet type should have been verified by the caller.
+    assert(get_packet_type(data, max_len) == packet_type::repair);
 
     // Keep the initial memory location.
     const auto begin = reinterpret_cast<std::size_t>(data);
@@ -149,6 +172,7 @@ public:
     {
       throw overflow_error{};
     }
+    const auto symbol = data;
     max_len -= symbol_size;
     data += symbol_size;
 
@@ -158,7 +182,7 @@ public:
     // Read encoded size.
     const auto encoded_sz = read<std::uint16_t>(data, max_len);
 
-    return std::make_pair( decoder_repair{id, encoded_sz, std::move(ids), std::move(p), symbol_size}
+    return std::make_pair( decoder_repair{id, encoded_sz, std::move(ids), symbol, symbol_size}
                          , reinterpret_cast<std::size_t>(data) - begin); // Number of read bytes.
   }
 
@@ -186,12 +210,20 @@ public:
   std::pair<decoder_source, std::size_t>
   read_source(packet&& p)
   {
-    // Packet type should have been verified by the caller.
-    assert(get_packet_type(p) == packet_type::source);
+    // Parse in place, then give the packet's memory to the source.
+    const auto res = read_source(static_cast<const packet&>(p).data(), p.size());
+    return std::make_pair( decoder_source{res.first.id(), std::move(p), res.first.symbol_size()}
+                         , res.second);
+  }
 
-    const char* data = p.data();
-    // To prevent overrun
-    auto max_len = p.size();
+  /// @brief Read a source directly from a buffer, without copying its symbol.
+  /// @return A source which borrows its symbol from @p data.
+  /// @throw overflow_error
+  std::pair<decoder_source, std::size_t>
+  read_source(const char* data, std::size_t max_len)
+  {
+    // Packet type should have been verified by the caller.
+    assert(get_packet_type(data, max_len) == packet_type::source);
 
     // Keep the initial memory location.
     const auto begin = reinterpret_cast<std::size_t>(data);
@@ -210,10 +242,11 @@ public:
     {
       throw overflow_error{};
     }
+    const auto symbol = data;
     max_len -= symbol_size;
     data += symbol_size;
 
-    return std::make_pair( decoder_source{id, std::move(p), symbol_size}
+    return std::make_pair( decoder_source{id, symbol, symbol_size}
                          , reinterpret_cast<std::size_t>(data) - begin); // Number of read bytes.
   }
 
@@ -244,6 +277,7 @@ private:
   write(const char* data, std::size_t len)
   noexcept(noexcept(std::declval<PacketHandler>()(nullptr, 0ul)))
   {
+    m_nb_written_bytes += len;
     m_packet_handler(reinterpret_cast<const char*>(data), len);
   }
 
@@ -254,6 +288,7 @@ private:
   noexcept(noexcept(std::declval<PacketHandler>()(nullptr, 0ul)))
   {
     const auto big = boost::endian::native_to_big(static_cast<T>(data));
+    m_nb_written_bytes += sizeof(T);
     m_packet_handler(reinterpret_cast<const char*>(&big), sizeof(T));
   }
 
@@ -371,6 +406,9 @@ private:
 
   /// @brief A pre-allocated buffer to re-use when performing the running length encoding.
   std::vector<std::pair<std::uint8_t, std::uint16_t>> m_rle_buffer;
+
+  /// @brief The number of bytes given to the handler.
+  std::size_t m_nb_written_bytes;
 };
 
 /*------------------------------------------------------------------------------------------------*/
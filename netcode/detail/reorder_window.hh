@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm> // min
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>   // move
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Keep entries which arrive out of order until all older ones are given.
+///
+/// Entries are stored in a ring indexed by their identifier, along with a bitmap of ready slots.
+/// Thus, giving a run of consecutive entries is a scan over the bitmap, and keeping an entry never
+/// allocates, unless it's further than the capacity of the ring, in which case it's doubled.
+///
+/// The identifier of the next entry to give, @p first, is owned by the caller. All kept entries
+/// have an identifier in [first, first + capacity). The capacity never exceeds max_capacity, thus
+/// the caller has to skip entries to keep one which is further (see reaches()).
+/// @tparam T A default constructible and movable type.
+template <typename T>
+class reorder_window final
+{
+public:
+
+  /// @brief The maximal number of slots, so an entry far ahead can't allocate the whole memory.
+  static constexpr std::uint32_t max_capacity = std::uint32_t{1} << 20;
+
+public:
+
+  /// @brief Can't copy-construct a window.
+  reorder_window(const reorder_window&) = delete;
+
+  /// @brief Can't copy a window.
+  reorder_window& operator=(const reorder_window&) = delete;
+
+  /// @brief Constructor.
+  ///
+  /// Memory is not allocated until the first entry is kept.
+  reorder_window()
+    : m_entries{}
+    , m_ready{}
+    , m_capacity{0}
+    , m_size{0}
+  {}
+
+  /// @brief Keep an entry until all older ones are given.
+  /// @param first The identifier of the next entry to give.
+  /// @param id The identifier of the entry.
+  /// @param x The entry.
+  /// @pre @p id > @p first, reaches(first, id), and no entry with the same identifier is kept.
+  void
+  insert(std::uint32_t first, std::uint32_t id, T&& x)
+  {
+    assert(id > first);
+    assert(reaches(first, id) && "entry too far ahead");
+    if (id - first >= m_capacity)
+    {
+      grow(first, id - first + 1);
+    }
+    const auto slot = id & (m_capacity - 1);
+    assert(not (m_ready[slot / word_bits] & bit(slot)) && "entry already kept");
+    m_entries[slot] = std::move(x);
+    m_ready[slot / word_bits] |= bit(slot);
+    ++m_size;
+  }
+
+  /// @brief Tell if an entry can be kept without skipping older ones.
+  /// @param first The identifier of the next entry to give.
+  /// @param id The identifier of the entry.
+  static
+  bool
+  reaches(std::uint32_t first, std::uint32_t id)
+  noexcept
+  {
+    return id - first < max_capacity;
+  }
+
+  /// @brief Give entries which follow @p first in sequence, in order.
+  /// @param first The identifier of the next entry to give, updated.
+  /// @param fn Called with a reference to each given entry.
+  template <typename Fn>
+  void
+  release(std::uint32_t& first, Fn&& fn)
+  {
+    while (m_size > 0)
+    {
+      const auto slot = first & (m_capacity - 1);
+      const auto run = trailing_ones(m_ready[slot / word_bits] >> (slot % word_bits));
+      if (run == 0)
+      {
+        return;
+      }
+      // A run doesn't cross a word, as the capacity is a multiple of the size of a word.
+      for (auto i = 0u; i < run; ++i)
+      {
+        take(slot + i, fn);
+        ++first;
+      }
+    }
+  }
+
+  /// @brief Give entries older than @p id, in order, even if some older ones are missing.
+  /// @param first The identifier of the next entry to give, set to @p id if it's smaller.
+  /// @param id The identifier of the oldest entry to keep.
+  /// @param fn Called with a reference to each given entry.
+  template <typename Fn>
+  void
+  release_before(std::uint32_t& first, std::uint32_t id, Fn&& fn)
+  {
+    if (id <= first)
+    {
+      return;
+    }
+    // All kept entries are in [first, first + capacity).
+    const auto last = first + std::min(id - first, m_capacity);
+    while (m_size > 0 and first < last)
+    {
+      const auto slot = first & (m_capacity - 1);
+      const auto ready = m_ready[slot / word_bits] >> (slot % word_bits);
+      if (ready == 0)
+      {
+        // Skip the rest of the word.
+        first += std::min(word_bits - slot % word_bits, last - first);
+        continue;
+      }
+      const auto gap = static_cast<std::uint32_t>(__builtin_ctzll(ready));
+      if (gap >= last - first)
+      {
+        break;
+      }
+      first += gap;
+      take(first & (m_capacity - 1), fn);
+      ++first;
+    }
+    if (first < id)
+    {
+      first = id;
+    }
+  }
+
+  /// @brief Get the number of kept entries.
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+  /// @brief Tell if no entry is kept.
+  bool
+  empty()
+  const noexcept
+  {
+    return m_size == 0;
+  }
+
+private:
+
+  /// @brief A word of the bitmap of ready slots.
+  using word = std::uint64_t;
+
+  /// @brief The number of bits in a word.
+  static constexpr std::uint32_t word_bits = 64;
+
+  /// @brief Get the mask of a slot in its word.
+  static
+  word
+  bit(std::uint32_t slot)
+  noexcept
+  {
+    return word{1} << (slot % word_bits);
+  }
+
+  /// @brief Count the consecutive bits set from the least significant one.
+  static
+  std::uint32_t
+  trailing_ones(word w)
+  noexcept
+  {
+    return ~w == 0 ? word_bits : static_cast<std::uint32_t>(__builtin_ctzll(~w));
+  }
+
+  /// @brief Give an entry to @p fn, then forget it.
+  ///
+  /// If @p fn throws, the entry is kept.
+  template <typename Fn>
+  void
+  take(std::uint32_t slot, Fn& fn)
+  {
+    fn(m_entries[slot]);
+    m_ready[slot / word_bits] &= ~bit(slot);
+    --m_size;
+  }
+
+  /// @brief Make room for at least @p min_capacity entries from @p first.
+  void
+  grow(std::uint32_t first, std::uint32_t min_capacity)
+  {
+    assert(min_capacity <= max_capacity);
+    // In 64 bits, so doubling can't wrap around.
+    auto capacity64 = std::uint64_t{m_capacity == 0 ? word_bits : m_capacity};
+    while (capacity64 < min_capacity)
+    {
+      capacity64 *= 2;
+    }
+    // Powers of 2 from word_bits, thus no greater than max_capacity.
+    const auto capacity = static_cast<std::uint32_t>(capacity64);
+    const auto nb_words = capacity / word_bits;
+    std::unique_ptr<T[]> entries{new T[capacity]};
+    std::unique_ptr<word[]> ready{new word[nb_words]()};
+
+    // Entries are at the slot of their identifier, which depends on the capacity.
+    for (auto slot = 0u; slot < m_capacity; ++slot)
+    {
+      if (m_ready[slot / word_bits] & bit(slot))
+      {
+        const auto id = first + ((slot - first) & (m_capacity - 1));
+        const auto new_slot = id & (capacity - 1);
+        entries[new_slot] = std::move(m_entries[slot]);
+        ready[new_slot / word_bits] |= bit(new_slot);
+      }
+    }
+    m_entries = std::move(entries);
+    m_ready = std::move(ready);
+    m_capacity = capacity;
+  }
+
+private:
+
+  /// @brief Entries, at the slot given by the low bits of their identifier.
+  std::unique_ptr<T[]> m_entries;
+
+  /// @brief One bit per slot, set if it holds an entry.
+  std::unique_ptr<word[]> m_ready;
+
+  /// @brief The number of slots, a power of 2 which is a multiple of word_bits, or 0.
+  std::uint32_t m_capacity;
+
+  /// @brief The number of kept entries.
+  std::uint32_t m_size;
+};
+
+template <typename T>
+constexpr std::uint32_t reorder_window<T>::max_capacity;
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
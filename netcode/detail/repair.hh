@@ -1,5 +1,10 @@
 #pragma once
 
+#include <algorithm> // copy_n
+#include <cassert>
+
+#include <boost/optional.hpp>
+
 #include "netcode/detail/buffer.hh"
 #include "netcode/detail/source_id_list.hh"
 #include "netcode/packet.hh"
@@ -140,7 +145,8 @@ private:
 /// @brief A decoder repair packet.
 ///
 /// To avoid copies, a repair on the decoder side is constructed using directly the packet received
-/// from the network.
+/// from the network. It can also refer to a symbol in a buffer it doesn't own, in which case it
+/// must be retained before being modified or before the buffer is reused.
 class decoder_repair final
 {
 public:
@@ -164,6 +170,19 @@ public:
     , m_sources_ids{std::move(ids)}
     , m_encoded_size{encoded_size}
     , m_symbol_buffer{std::move(p)}
+    , m_symbol{m_symbol_buffer->symbol()}
+    , m_symbol_size{static_cast<std::uint16_t>(symbol_size)}
+  {}
+
+  /// @brief Construct a repair which refers to a symbol it doesn't own.
+  /// @attention The memory pointed by @p symbol must outlive this repair, unless retain() is called.
+  decoder_repair( std::uint32_t id, std::uint16_t encoded_size, source_id_list&& ids
+                , const char* symbol, std::size_t symbol_size)
+    : m_id{id}
+    , m_sources_ids{std::move(ids)}
+    , m_encoded_size{encoded_size}
+    , m_symbol_buffer{}
+    , m_symbol{symbol}
     , m_symbol_size{static_cast<std::uint16_t>(symbol_size)}
   {}
 
@@ -204,15 +223,18 @@ public:
   symbol()
   const noexcept
   {
-    return m_symbol_buffer.symbol();
+    return m_symbol;
   }
 
   /// @brief This repair's symbol (mutable).
+  /// @pre The symbol is not borrowed.
   char*
   symbol()
   noexcept
   {
-    return m_symbol_buffer.symbol();
+    assert(m_symbol_buffer && "Mutable access to a borrowed symbol");
+    // The symbol is in memory owned by this object.
+    return const_cast<char*>(m_symbol);
   }
 
   /// @brief Get the encoded sizes of all sources this repair contains.
@@ -239,6 +261,27 @@ public:
     return m_symbol_size;
   }
 
+  /// @brief Tell if the symbol lives in a buffer this repair doesn't own.
+  bool
+  borrowed()
+  const noexcept
+  {
+    return not m_symbol_buffer;
+  }
+
+  /// @brief Copy a borrowed symbol into memory owned by this repair.
+  /// @note Does nothing if the symbol is already owned.
+  void
+  retain()
+  {
+    if (not m_symbol_buffer)
+    {
+      m_symbol_buffer.emplace(m_symbol_size + packet::alignment);
+      std::copy_n(m_symbol, m_symbol_size, m_symbol_buffer->symbol());
+      m_symbol = m_symbol_buffer->symbol();
+    }
+  }
+
 private:
 
   /// @brief This repair's unique identifier.
@@ -250,8 +293,11 @@ private:
   /// @brief The encoded sizes of all sources this repair contains.
   std::uint16_t m_encoded_size;
 
-  /// @brief This repair's symbol.
-  packet m_symbol_buffer;
+  /// @brief The memory of this repair's symbol, unless it's borrowed.
+  boost::optional<packet> m_symbol_buffer;
+
+  /// @brief This repair's symbol, in m_symbol_buffer or in a borrowed buffer.
+  const char* m_symbol;
 
   /// @brief This repair's symbol size
   std::uint16_t m_symbol_size;
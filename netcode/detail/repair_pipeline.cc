@@ -0,0 +1,130 @@
+#include "netcode/detail/repair_pipeline.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief The maximal number of commands executed before the helper thread frees their slots.
+constexpr auto commands_batch = 32ul;
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+repair_pipeline::repair_pipeline(std::uint8_t galois_field_size, std::size_t capacity)
+  : m_encoder{galois_field_size}
+  , m_sources{}
+  , m_repair{}
+  , m_next{}
+  , m_nb_requested{0}
+  , m_nb_flushed{0}
+  , m_commands{capacity}
+  , m_results{capacity}
+  , m_mutex{}
+  , m_condition{}
+  , m_sleeping{false}
+  , m_stop{false}
+  , m_thread{[this]{run();}}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+repair_pipeline::~repair_pipeline()
+{
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop.store(true, std::memory_order_relaxed);
+    m_condition.notify_one();
+  }
+  m_thread.join();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+repair_pipeline::wake()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_sleeping.load(std::memory_order_relaxed))
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_condition.notify_one();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+repair_pipeline::run()
+{
+  while (not m_stop.load(std::memory_order_relaxed))
+  {
+    const auto nb = m_commands.consume( [this](repair_command& command){execute(command);}
+                                      , commands_batch);
+    if (nb == 0)
+    {
+      sleep_until([this]{return not m_commands.empty();});
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+repair_pipeline::execute(repair_command& command)
+{
+  switch (command.type)
+  {
+    case repair_command::kind::add:
+      m_sources.emplace(command.id, *command.view);
+      // Don't keep the symbol alive in the slot of the command.
+      command.view = boost::none;
+      break;
+
+    case repair_command::kind::pop_front:
+      m_sources.pop_front();
+      break;
+
+    case repair_command::kind::erase:
+      m_sources.erase(command.ids.begin(), command.ids.end());
+      break;
+
+    case repair_command::kind::repair:
+      build(command.id);
+      break;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+repair_pipeline::build(std::uint32_t id)
+{
+  if (m_stop.load(std::memory_order_relaxed))
+  {
+    return;
+  }
+  if (not m_repair)
+  {
+    m_repair.reset(new encoder_repair{id});
+  }
+  m_repair->reset();
+  m_repair->id() = id;
+  m_encoder(*m_repair, m_sources);
+
+  // Get back the memory of a flushed repair, if any.
+  while (not m_results.try_exchange(m_repair))
+  {
+    sleep_until([this]{return not m_results.full();});
+    if (m_stop.load(std::memory_order_relaxed))
+    {
+      return;
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <boost/optional.hpp>
+
+#include "netcode/detail/encoder.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/detail/source_id_list.hh"
+#include "netcode/detail/source_list.hh"
+#include "netcode/detail/spsc_queue.hh"
+#include "netcode/data_view.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief An order given to the helper thread of a repair_pipeline.
+struct repair_command
+{
+  /// @brief What the helper thread shall do.
+  enum class kind : std::uint8_t {add, pop_front, erase, repair};
+
+  /// @brief What the helper thread shall do.
+  kind type = kind::repair;
+
+  /// @brief The identifier of the added source, or of the repair to build.
+  std::uint32_t id = 0;
+
+  /// @brief The added source.
+  boost::optional<data_view> view;
+
+  /// @brief The identifiers of the erased sources.
+  source_id_list ids;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Build repairs on a helper thread.
+///
+/// The helper thread keeps its own copy of the encoder's window: each change of the window is sent
+/// to it, in order, along with requests of repairs. Thus, a repair is built from the window as it
+/// was when it was requested, whatever the encoder did since. Sources are shared with the encoder
+/// through data views, symbols are never copied.
+///
+/// Built repairs are given back, in order, to the thread which owns the encoder. All functions but
+/// the constructor and the destructor shall be called by this thread.
+class repair_pipeline final
+{
+public:
+
+  /// @brief Can't copy-construct a pipeline.
+  repair_pipeline(const repair_pipeline&) = delete;
+
+  /// @brief Can't copy a pipeline.
+  repair_pipeline& operator=(const repair_pipeline&) = delete;
+
+  /// @brief Constructor, starts the helper thread.
+  /// @param galois_field_size The size of the Galois field used to build repairs.
+  /// @param capacity The maximal number of pending commands and of built repairs.
+  repair_pipeline(std::uint8_t galois_field_size, std::size_t capacity);
+
+  /// @brief Destructor, stops the helper thread. Pending repairs are lost.
+  ~repair_pipeline();
+
+  /// @brief Add a source at the end of the window.
+  /// @param wait Called while the helper thread is late.
+  template <typename Wait>
+  void
+  add(std::uint32_t id, const data_view& view, Wait&& wait)
+  {
+    m_next.type = repair_command::kind::add;
+    m_next.id = id;
+    m_next.view = view;
+    submit(wait);
+  }
+
+  /// @brief Drop the first source of the window.
+  /// @param wait Called while the helper thread is late.
+  template <typename Wait>
+  void
+  pop_front(Wait&& wait)
+  {
+    m_next.type = repair_command::kind::pop_front;
+    submit(wait);
+  }
+
+  /// @brief Remove sources from the window.
+  /// @param wait Called while the helper thread is late.
+  template <typename Wait>
+  void
+  erase(const source_id_list& ids, Wait&& wait)
+  {
+    m_next.type = repair_command::kind::erase;
+    m_next.ids = ids;
+    submit(wait);
+  }
+
+  /// @brief Ask for a repair built from the current window.
+  /// @param wait Called while the helper thread is late.
+  template <typename Wait>
+  void
+  repair(std::uint32_t id, Wait&& wait)
+  {
+    m_next.type = repair_command::kind::repair;
+    m_next.id = id;
+    submit(wait);
+    ++m_nb_requested;
+  }
+
+  /// @brief Give built repairs to @p fn, in the order they were requested.
+  /// @return The number of repairs given to @p fn.
+  template <typename Fn>
+  std::size_t
+  flush(Fn&& fn)
+  {
+    const auto nb = m_results.consume( [&](std::unique_ptr<encoder_repair>& r)
+                                       {
+                                         ++m_nb_flushed;
+                                         fn(*r);
+                                       }
+                                     , m_results.capacity());
+    if (nb > 0)
+    {
+      // The helper thread may be waiting for room to give a repair.
+      wake();
+    }
+    return nb;
+  }
+
+  /// @brief The number of requested repairs which have not yet been flushed.
+  std::size_t
+  nb_pending()
+  const noexcept
+  {
+    return m_nb_requested - m_nb_flushed;
+  }
+
+private:
+
+  /// @brief Give the next command to the helper thread.
+  template <typename Wait>
+  void
+  submit(Wait& wait)
+  {
+    while (not m_commands.try_exchange(m_next))
+    {
+      wait();
+    }
+    wake();
+  }
+
+  /// @brief Wake the helper thread if it's sleeping.
+  void
+  wake();
+
+  /// @brief Put the helper thread to sleep until @p ready returns true or the pipeline is stopped.
+  template <typename Predicate>
+  void
+  sleep_until(Predicate&& ready)
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_sleeping.store(true, std::memory_order_relaxed);
+    // Pairs with the fence of wake(): either the helper thread sees the new command, or the owner
+    // of the encoder sees that it's sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_condition.wait(lock, [&]{return m_stop.load(std::memory_order_relaxed) or ready();});
+    m_sleeping.store(false, std::memory_order_relaxed);
+  }
+
+  /// @brief The loop of the helper thread.
+  void
+  run();
+
+  /// @brief Execute a command on the helper thread.
+  void
+  execute(repair_command& command);
+
+  /// @brief Build a repair on the helper thread and give it to the owner of the encoder.
+  void
+  build(std::uint32_t id);
+
+private:
+
+  /// @brief Build repairs, used by the helper thread.
+  detail::encoder m_encoder;
+
+  /// @brief The copy of the encoder's window, used by the helper thread.
+  source_list m_sources;
+
+  /// @brief The repair being built, used by the helper thread.
+  std::unique_ptr<encoder_repair> m_repair;
+
+  /// @brief The command being prepared, used by the owner of the encoder.
+  repair_command m_next;
+
+  /// @brief The number of requested repairs, used by the owner of the encoder.
+  std::size_t m_nb_requested;
+
+  /// @brief The number of flushed repairs, used by the owner of the encoder.
+  std::size_t m_nb_flushed;
+
+  /// @brief Commands from the owner of the encoder to the helper thread.
+  spsc_queue<repair_command> m_commands;
+
+  /// @brief Built repairs, from the helper thread to the owner of the encoder.
+  ///
+  /// Slots keep flushed repairs, so that their memory is re-used by the next ones.
+  spsc_queue<std::unique_ptr<encoder_repair>> m_results;
+
+  /// @brief Protects the sleep of the helper thread.
+  std::mutex m_mutex;
+
+  /// @brief Wakes up the helper thread.
+  std::condition_variable m_condition;
+
+  /// @brief Tell if the helper thread is sleeping or about to.
+  std::atomic<bool> m_sleeping;
+
+  /// @brief Tell the helper thread to stop.
+  std::atomic<bool> m_stop;
+
+  /// @brief The helper thread, started last.
+  std::thread m_thread;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
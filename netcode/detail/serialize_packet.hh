@@ -1,6 +1,5 @@
 #pragma once
 
-#include <algorithm> // copy
 #include <iostream>
 
 #include <boost/endian/conversion.hpp>
@@ -20,7 +19,7 @@ struct serialize_packet
   {
     const auto sz = boost::endian::native_to_big(static_cast<std::uint16_t>(p.m_buffer.size()));
     os.write(reinterpret_cast<const char*>(&sz), sizeof(sz));
-    std::copy(p.m_buffer.begin(), p.m_buffer.end(), std::ostreambuf_iterator<char>(os));
+    os.write(p.m_buffer.data(), static_cast<std::streamsize>(p.m_buffer.size()));
   }
 
   static
@@ -29,17 +28,16 @@ struct serialize_packet
   {
     auto p = packet{};
 
-    std::istreambuf_iterator<char> isb(is);
+    // Don't use istreambuf_iterator with copy_n: depending on the standard library, the last byte
+    // is consumed or not, thus the following ++ may skip a byte.
     auto sz = std::uint16_t{};
-    std::copy_n(isb, 2, reinterpret_cast<char*>(&sz));
-    ++isb;
+    is.read(reinterpret_cast<char*>(&sz), sizeof(sz));
 
     const auto sz_native = boost::endian::big_to_native(sz);
 
     p.m_buffer.resize(sz_native);
-    std::copy_n(isb, sz_native, p.m_buffer.begin());
+    is.read(p.m_buffer.data(), sz_native);
 
-    ++isb;
     return p;
   }
 };
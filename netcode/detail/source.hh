@@ -1,13 +1,84 @@
 #pragma once
 
+#include <algorithm> // copy_n
+#include <cassert>
+#include <memory> // shared_ptr
+
+#include <boost/optional.hpp>
+
+#include "netcode/data_view.hh"
 #include "netcode/packet.hh"
 
 namespace ntc { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+/// @brief A read-only range on the bytes of an encoder's source symbol
+class encoder_symbol final
+{
+public:
+
+  /// @brief Constructor
+  encoder_symbol(const char* data, std::size_t size)
+    : m_data{data}
+    , m_size{size}
+  {}
+
+  /// @brief Get the first byte
+  const char*
+  data()
+  const noexcept
+  {
+    return m_data;
+  }
+
+  /// @brief Get the number of bytes
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+  /// @brief Get an iterator to the first byte
+  const char*
+  begin()
+  const noexcept
+  {
+    return m_data;
+  }
+
+  /// @brief Get an iterator past the last byte
+  const char*
+  end()
+  const noexcept
+  {
+    return m_data + m_size;
+  }
+
+  /// @brief Get a byte
+  char
+  operator[](std::size_t pos)
+  const noexcept
+  {
+    return m_data[pos];
+  }
+
+private:
+
+  const char* m_data;
+  std::size_t m_size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @internal
 /// @brief An encoder's source packet holding a user's symbol
+///
+/// The symbol is either owned by the source, or it lives in the application's memory (see
+/// ntc::data_view). In the latter case, the source shares the ownership of this memory until it's
+/// destroyed, i.e. when it's acknowledged or evicted from the window.
 class encoder_source final
 {
 public:
@@ -19,6 +90,7 @@ public:
   encoder_source& operator=(const encoder_source&) = delete;
 
   /// @brief Can move-construct a source
+  /// @note Moving a byte_buffer keeps its memory, m_symbol stays valid
   encoder_source(encoder_source&&) = default;
 
   /// @brief Can move a source
@@ -28,6 +100,18 @@ public:
   encoder_source(std::uint32_t id, detail::byte_buffer&& p)
     : m_id{id}
     , m_symbol_buffer{std::move(p)}
+    , m_owner{}
+    , m_symbol{m_symbol_buffer.data()}
+    , m_size{static_cast<std::uint16_t>(m_symbol_buffer.size())}
+  {}
+
+  /// @brief Construct a source which refers to a symbol in the application's memory
+  encoder_source(std::uint32_t id, const data_view& view)
+    : m_id{id}
+    , m_symbol_buffer{}
+    , m_owner{view.owner()}
+    , m_symbol{view.data()}
+    , m_size{static_cast<std::uint16_t>(view.size())}
   {}
 
   /// @brief Get this source's identifier
@@ -39,19 +123,11 @@ public:
   }
 
   /// @brief Get the bytes of the symbol
-  const detail::byte_buffer&
+  encoder_symbol
   symbol()
   const noexcept
   {
-    return m_symbol_buffer;
-  }
-
-  /// @brief Get the bytes of the symbol
-  detail::byte_buffer&
-  symbol()
-  noexcept
-  {
-    return m_symbol_buffer;
+    return {m_symbol, m_size};
   }
 
   /// @brief Get the number of bytes in the user's symbol
@@ -59,7 +135,24 @@ public:
   size()
   const noexcept
   {
-    return static_cast<std::uint16_t>(m_symbol_buffer.size());
+    return m_size;
+  }
+
+  /// @brief Tell if the symbol lives in the application's memory
+  bool
+  borrowed()
+  const noexcept
+  {
+    return static_cast<bool>(m_owner);
+  }
+
+  /// @brief Get what keeps a borrowed symbol alive
+  /// @note Empty if the symbol is owned by this source
+  const std::shared_ptr<const void>&
+  owner()
+  const noexcept
+  {
+    return m_owner;
   }
 
 private:
@@ -67,8 +160,17 @@ private:
   /// @brief This source's unique identifier
   std::uint32_t m_id;
 
-  /// @brief This source's symbol
+  /// @brief The memory of this source's symbol, unless it's borrowed
   detail::byte_buffer m_symbol_buffer;
+
+  /// @brief Keeps a borrowed symbol alive
+  std::shared_ptr<const void> m_owner;
+
+  /// @brief This source's symbol, in m_symbol_buffer or in the application's memory
+  const char* m_symbol;
+
+  /// @brief This source's symbol size
+  std::uint16_t m_size;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -77,7 +179,9 @@ private:
 /// @brief A decoder source packet holding a user's symbol
 ///
 /// To avoid copies, a source on the decoder side is constructed using directly the packet received
-/// from the network.
+/// from the network. It can also refer to a symbol in a buffer it doesn't own (see
+/// decoder::operator()(const char*, std::size_t)), in which case it must be retained before the
+/// buffer is reused.
 class decoder_source final
 {
 public:
@@ -98,6 +202,16 @@ public:
   decoder_source(std::uint32_t id, packet&& p, std::size_t symbol_size)
     : m_id{id}
     , m_symbol_buffer{std::move(p)}
+    , m_symbol{m_symbol_buffer->symbol()}
+    , m_symbol_size{static_cast<std::uint16_t>(symbol_size)}
+  {}
+
+  /// @brief Construct a source which refers to a symbol it doesn't own
+  /// @attention The memory pointed by @p symbol must outlive this source, unless retain() is called
+  decoder_source(std::uint32_t id, const char* symbol, std::size_t symbol_size)
+    : m_id{id}
+    , m_symbol_buffer{}
+    , m_symbol{symbol}
     , m_symbol_size{static_cast<std::uint16_t>(symbol_size)}
   {}
 
@@ -114,15 +228,18 @@ public:
   symbol()
   const noexcept
   {
-    return m_symbol_buffer.symbol();
+    return m_symbol;
   }
 
   /// @brief Get the bytes of the symbol
+  /// @pre The symbol is not borrowed
   char*
   symbol()
   noexcept
   {
-    return m_symbol_buffer.symbol();
+    assert(m_symbol_buffer && "Mutable access to a borrowed symbol");
+    // The symbol is in memory owned by this object.
+    return const_cast<char*>(m_symbol);
   }
 
   /// @brief Get the number of bytes in the user's symbol
@@ -133,13 +250,37 @@ public:
     return m_symbol_size;
   }
 
+  /// @brief Tell if the symbol lives in a buffer this source doesn't own
+  bool
+  borrowed()
+  const noexcept
+  {
+    return not m_symbol_buffer;
+  }
+
+  /// @brief Copy a borrowed symbol into memory owned by this source
+  /// @note Does nothing if the symbol is already owned
+  void
+  retain()
+  {
+    if (not m_symbol_buffer)
+    {
+      m_symbol_buffer.emplace(m_symbol_size + packet::alignment);
+      std::copy_n(m_symbol, m_symbol_size, m_symbol_buffer->symbol());
+      m_symbol = m_symbol_buffer->symbol();
+    }
+  }
+
 private:
 
   /// @brief This source's unique identifier
   std::uint32_t m_id;
 
-  /// @brief This source's symbol
-  packet m_symbol_buffer;
+  /// @brief The memory of this source's symbol, unless it's borrowed
+  boost::optional<packet> m_symbol_buffer;
+
+  /// @brief This source's symbol, in m_symbol_buffer or in a borrowed buffer
+  const char* m_symbol;
 
   /// @brief This source's symbol size
   std::uint16_t m_symbol_size;
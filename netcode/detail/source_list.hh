@@ -29,6 +29,15 @@ public:
     return m_sources.back();
   }
 
+  /// @brief Add a source packet which refers to a symbol in the application's memory.
+  /// @return A reference to the added source.
+  const encoder_source&
+  emplace(std::uint32_t id, const data_view& symbol)
+  {
+    m_sources.emplace_back(id, symbol);
+    return m_sources.back();
+  }
+
   /// @brief Remove source packets from a list of identifiers.
   void
   erase(source_id_list::const_iterator id_cit, source_id_list::const_iterator id_end)
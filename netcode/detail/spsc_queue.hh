@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm> // min
+#include <atomic>
+#include <cassert>
+#include <cstddef> // size_t
+#include <memory>
+#include <utility> // forward, swap
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A bounded lock-free queue for exactly one producer thread and one consumer thread.
+///
+/// The consumer may change over time, as long as a happens-before relationship exists between the
+/// last pop of the previous consumer and the first pop of the new one.
+template <typename T>
+class spsc_queue final
+{
+public:
+
+  /// @brief Can't copy-construct a queue.
+  spsc_queue(const spsc_queue&) = delete;
+
+  /// @brief Can't copy a queue.
+  spsc_queue& operator=(const spsc_queue&) = delete;
+
+  /// @brief Constructor.
+  /// @param capacity The maximal number of elements, rounded up to the next power of 2.
+  explicit spsc_queue(std::size_t capacity)
+    : m_mask{round_up(capacity) - 1}
+    , m_slots{new T[m_mask + 1]}
+    , m_head{0}
+    , m_cached_tail{0}
+    , m_tail{0}
+    , m_cached_head{0}
+  {}
+
+  /// @brief Add an element, to be called by the producer.
+  /// @return false if the queue is full, in which case @p x is left untouched.
+  bool
+  try_push(T&& x)
+  {
+    return try_emplace(std::move(x));
+  }
+
+  /// @brief Construct an element from @p args, to be called by the producer.
+  /// @return false if the queue is full, in which case @p args are left untouched.
+  template <typename... Args>
+  bool
+  try_emplace(Args&&... args)
+  {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cached_head > m_mask)
+    {
+      m_cached_head = m_head.load(std::memory_order_acquire);
+      if (tail - m_cached_head > m_mask)
+      {
+        return false;
+      }
+    }
+    m_slots[tail & m_mask] = T{std::forward<Args>(args)...};
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Add an element by swapping it with the content of its slot, to be called by the
+  /// producer.
+  /// @return false if the queue is full, in which case @p x is left untouched.
+  ///
+  /// On success, @p x holds what the consumer left in the slot, e.g. a buffer to re-use.
+  bool
+  try_exchange(T& x)
+  {
+    using std::swap;
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cached_head > m_mask)
+    {
+      m_cached_head = m_head.load(std::memory_order_acquire);
+      if (tail - m_cached_head > m_mask)
+      {
+        return false;
+      }
+    }
+    swap(m_slots[tail & m_mask], x);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Remove the oldest element, to be called by the consumer.
+  /// @return false if the queue is empty.
+  bool
+  try_pop(T& x)
+  {
+    const auto head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cached_tail)
+    {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head == m_cached_tail)
+      {
+        return false;
+      }
+    }
+    x = std::move(m_slots[head & m_mask]);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Give up to @p max of the oldest elements to @p fn, to be called by the consumer.
+  /// @param fn Called with a reference to each element, in order. Elements are left in their
+  /// slots, thus @p fn can either move them away or let producers re-use them.
+  /// @param max The maximal number of elements to give.
+  /// @return The number of elements given to @p fn.
+  /// @note Indexes are synchronized once for the whole batch.
+  template <typename Fn>
+  std::size_t
+  consume(Fn&& fn, std::size_t max)
+  {
+    const auto head = m_head.load(std::memory_order_relaxed);
+    if (m_cached_tail - head < max)
+    {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+    }
+    const auto nb = std::min(m_cached_tail - head, max);
+    auto i = head;
+    try
+    {
+      for (; i != head + nb; ++i)
+      {
+        fn(m_slots[i & m_mask]);
+      }
+    }
+    catch (...)
+    {
+      // The element which made fn throw is consumed.
+      m_head.store(i + 1, std::memory_order_release);
+      throw;
+    }
+    m_head.store(head + nb, std::memory_order_release);
+    return nb;
+  }
+
+  /// @brief Tell if the queue is empty.
+  /// @note The result may be outdated as soon as it's returned if called by the producer.
+  bool
+  empty()
+  const noexcept
+  {
+    return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+  }
+
+  /// @brief Tell if there is no room for a new element, to be called by the producer.
+  /// @note The consumer may make room as soon as true is returned.
+  bool
+  full()
+  const noexcept
+  {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    return tail - m_head.load(std::memory_order_acquire) > m_mask;
+  }
+
+  /// @brief Get the maximal number of elements.
+  std::size_t
+  capacity()
+  const noexcept
+  {
+    return m_mask + 1;
+  }
+
+private:
+
+  /// @brief Round up to the next power of 2.
+  static
+  std::size_t
+  round_up(std::size_t n)
+  noexcept
+  {
+    assert(n > 0);
+    auto res = std::size_t{1};
+    while (res < n)
+    {
+      res *= 2;
+    }
+    return res;
+  }
+
+  /// @brief The size of a cache line, to avoid false sharing between producer and consumer.
+  static constexpr auto cache_line_size = 64ul;
+
+  /// @brief To find a slot from an index.
+  const std::size_t m_mask;
+
+  /// @brief Elements.
+  const std::unique_ptr<T[]> m_slots;
+
+  /// @brief The index of the next element to pop, written by the consumer.
+  std::atomic<std::size_t> m_head;
+
+  /// @brief The last known value of m_tail, to avoid reading it at each pop.
+  std::size_t m_cached_tail;
+
+  /// @brief Keep producer's data on another cache line.
+  char m_padding[cache_line_size - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+
+  /// @brief The index of the next element to push, written by the producer.
+  std::atomic<std::size_t> m_tail;
+
+  /// @brief The last known value of m_head, to avoid reading it at each push.
+  std::size_t m_cached_head;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -17,8 +17,8 @@ struct is_encoder
 
 /// @internal
 /// @brief Trait to detect if a type is ntc::encoder.
-template <typename PacketHandler>
-struct is_encoder<ntc::encoder<PacketHandler>>
+template <typename PacketHandler, typename Tracer>
+struct is_encoder<ntc::encoder<PacketHandler, Tracer>>
 {
   static constexpr auto value = true;
 };
@@ -33,8 +33,8 @@ struct is_decoder
 
 /// @internal
 /// @brief Trait to detect if a type is ntc::encoder.
-template <typename PacketHandler, typename DataHandler>
-struct is_decoder<ntc::decoder<PacketHandler, DataHandler>>
+template <typename PacketHandler, typename DataHandler, typename Tracer>
+struct is_decoder<ntc::decoder<PacketHandler, DataHandler, Tracer>>
 {
   static constexpr auto value = true;
 };
@@ -17,6 +17,17 @@
 /// @defgroup ntc_error Error reporting
 /// @ingroup ntc
 
+/// @defgroup ntc_statistics Monitoring encoders and decoders
+/// @ingroup ntc
+
+/// @defgroup ntc_capture Capturing and replaying packets
+/// @ingroup ntc
+///
+/// A capture file starts with a capture_header, followed by records. Each record is a
+/// capture_record followed by the bytes of the packet. When the capture is closed, a sparse index
+/// (capture_index_entry) and a capture_footer are appended. All fields are in the native byte
+/// order, as a capture is meant to be replayed on the same kind of host.
+
 /*------------------------------------------------------------------------------------------------*/
 
 /// @defgroup c_ntc C interfaces
@@ -37,6 +48,9 @@
 /// @defgroup c_handlers Signature of handlers to interact with encoder and decoder
 /// @ingroup c_ntc
 
+/// @defgroup c_statistics Monitoring encoders and decoders
+/// @ingroup c_ntc
+
 /// @defgroup c_error Error reporting
 /// @ingroup c_ntc
 ///
@@ -3,28 +3,37 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
-#include <cmath>
 #include <limits> // numeric_limits
+#include <memory>
+#include <thread> // this_thread
 
 #include "netcode/detail/encoder.hh"
+#include "netcode/detail/gilbert_elliott.hh"
 #include "netcode/detail/packet_type.hh"
 #include "netcode/detail/packetizer.hh"
 #include "netcode/detail/repair.hh"
+#include "netcode/detail/repair_pipeline.hh"
 #include "netcode/detail/source.hh"
 #include "netcode/detail/source_list.hh"
 #include "netcode/detail/visibility.hh"
 #include "netcode/data.hh"
+#include "netcode/data_view.hh"
+#include "netcode/encoder_fwd.hh"
 #include "netcode/errors.hh"
 #include "netcode/packet.hh"
+#include "netcode/repair_policy.hh"
+#include "netcode/statistics.hh"
 #include "netcode/systematic.hh"
+#include "netcode/tracing.hh"
 
 namespace ntc {
 
 /*------------------------------------------------------------------------------------------------*/
 
 /// @brief The class to interact with on the sender side
+/// @tparam Tracer The policy notified of each event (see no_tracing)
 /// @ingroup ntc_encoder
-template <typename PacketHandler>
+template <typename PacketHandler, typename Tracer>
 class NTC_PUBLIC encoder final
 {
 public:
@@ -32,6 +41,9 @@ public:
   /// @brief The type of the handler that processes data ready to be sent on the network
   using packet_handler_type = PacketHandler;
 
+  /// @brief The type of the policy notified of each event
+  using tracer_type = Tracer;
+
 public:
 
   /// @brief Can't copy-construct an encoder
@@ -49,11 +61,24 @@ public:
   /// @brief Constructor
   template <typename PacketHandler_>
   encoder(std::uint8_t galois_field_size, PacketHandler_&& packet_handler)
+    : encoder{galois_field_size, std::forward<PacketHandler_>(packet_handler), tracer_type{}}
+  {}
+
+  /// @brief Constructor with a tracing policy
+  template <typename PacketHandler_, typename Tracer_>
+  encoder(std::uint8_t galois_field_size, PacketHandler_&& packet_handler, Tracer_&& tracer)
     : m_galois_field_size{galois_field_size}
+    , m_adaptive{false}
     , m_code_type{systematic::yes}
+    , m_tracer(std::forward<Tracer_>(tracer))
+    , m_last_ack_nb_packets{0}
+    , m_next_observed_id{0}
     , m_rate{5}
     , m_window_size{std::numeric_limits<std::size_t>::max()}
-    , m_adaptive{false}
+    , m_target_loss{0.001}
+    , m_channel{}
+    , m_adaptive_window_size{std::numeric_limits<std::size_t>::max()}
+    , m_repair_policy{new fixed_rate_policy}
     , m_current_source_id{0}
     , m_current_repair_id{0}
     , m_sources{}
@@ -64,16 +89,12 @@ public:
     , m_nb_sent_repairs{0ul}
     , m_nb_acks{0ul}
     , m_nb_sent_sources{0ul}
-    , m_nb_sent_packets{0}
+    , m_nb_sent_packets{0ul}
+    , m_nb_received_bytes{0ul}
+    , m_pipeline{}
   {
-    // Let's reserve some memory for the repair, it will most likely avoid initial memory
-    // allocations.
-    m_repair.symbol().reserve(2048);
-    // Same thing for the list of source identifiers.
-    // Uncomment the following when the undefined behavior spotted by GCC 5.1 -fsanitize=undefined
-    // is fixed. In the meantime, it's not a real problem,it will just cost a few initial
-    // allocations before the source ids list grows to a suitable size.
-    // m_repair.source_ids().reserve(128);
+    // Memory for the repair is not reserved here, but by the first generated repair. Thus, an
+    // encoder which doesn't send anything stays small (see session_table).
   }
 
   /// @brief Give the encoder a new data
@@ -92,14 +113,39 @@ public:
             or (m_galois_field_size == 16 and d.size() % (16/8) == 0));
     assert( m_galois_field_size != 32
             or (m_galois_field_size == 32 and d.size() % (32/8) == 0));
-    commit_impl(std::move(d));
+    if (m_pipeline)
+    {
+      // The helper thread shares the symbol rather than copying it.
+      const auto owner = std::make_shared<data>(std::move(d));
+      commit_impl(data_view{owner->data(), owner->size(), owner});
+    }
+    else
+    {
+      commit_impl(std::move(d));
+    }
+  }
+
+  /// @brief Give the encoder a new data which lives in the application's memory
+  ///
+  /// The bytes are not copied: the encoder keeps the view, and thus shares the ownership of the
+  /// memory, until the source is acknowledged or evicted from the window.
+  void
+  operator()(const data_view& d)
+  {
+    assert(d.size() != 0 && "empty data");
+    assert( m_galois_field_size != 16
+            or (m_galois_field_size == 16 and d.size() % (16/8) == 0));
+    assert( m_galois_field_size != 32
+            or (m_galois_field_size == 32 and d.size() % (32/8) == 0));
+    commit_impl(d);
   }
 
   /// @brief Notify the decoder of an incoming packet
   std::size_t
   operator()(const packet& p)
   {
-    return operator()(packet{p});
+    assert(p.size() != 0 && "empty packet");
+    return notify_impl(p.data(), p.size());
   }
 
   /// @brief Notify the decoder of an incoming packet
@@ -107,7 +153,18 @@ public:
   operator()(packet&& p)
   {
     assert(p.size() != 0 && "empty packet");
-    return notify_impl(std::move(p));
+    return notify_impl(static_cast<const packet&>(p).data(), p.size());
+  }
+
+  /// @brief Notify the encoder of an incoming packet held in a buffer it doesn't own
+  ///
+  /// The ack is parsed in place, no ntc::packet is needed.
+  /// @note @p data can be reused as soon as this function returns.
+  std::size_t
+  operator()(const char* data, std::size_t size)
+  {
+    assert(size != 0 && "empty packet");
+    return notify_impl(data, size);
   }
 
   /// @brief The number of packets which have not been acknowledged
@@ -142,6 +199,27 @@ public:
     return m_nb_sent_sources;
   }
 
+  /// @brief Get a snapshot of the counters and of the state of the encoder
+  /// @note Use a seqlock to read it from another thread
+  encoder_statistics
+  statistics()
+  const noexcept
+  {
+    auto s = encoder_statistics{};
+    s.nb_sent_sources = m_nb_sent_sources;
+    s.nb_sent_repairs = m_nb_sent_repairs;
+    s.nb_received_acks = m_nb_acks;
+    s.nb_sent_bytes = m_packetizer.nb_written_bytes();
+    s.nb_received_bytes = m_nb_received_bytes;
+    s.repair_overhead = m_nb_sent_sources == 0 ? 0 : static_cast<double>(m_nb_sent_repairs)
+                                                   / static_cast<double>(m_nb_sent_sources);
+    s.window = m_sources.size();
+    s.window_size = m_adaptive ? std::min(m_window_size, m_adaptive_window_size) : m_window_size;
+    s.rate = m_rate;
+    s.estimated_loss_rate = m_channel.loss_rate();
+    return s;
+  }
+
   /// @brief Get the data handler
   const packet_handler_type&
   packet_handler()
@@ -158,14 +236,93 @@ public:
     return m_packet_handler;
   }
 
+  /// @brief Get the tracing policy
+  const tracer_type&
+  tracer()
+  const noexcept
+  {
+    return m_tracer;
+  }
+
+  /// @brief Get the tracing policy
+  tracer_type&
+  tracer()
+  noexcept
+  {
+    return m_tracer;
+  }
+
   /// @brief Force the generation of a repair
   void
   generate_repair()
   {
-    m_repair.reset();
-    mk_repair();
-    ++m_nb_sent_packets;
-    m_packetizer.write_repair(m_repair);
+    send_repair();
+    m_repair_policy->on_repair(m_pipeline ? max_symbol_size() : m_repair.symbol().size());
+  }
+
+  /// @brief Build repairs on a helper thread
+  ///
+  /// When a repair is due, the calling thread doesn't encode the window anymore: it only tells a
+  /// helper thread to build the repair from the window as it is at this moment. Sources are thus
+  /// sent without waiting for the encoding of repairs. Built repairs are given to the packet
+  /// handler, in order, by the calling thread at the next call to operator() or to
+  /// flush_repairs(). The packet handler is never called by the helper thread.
+  ///
+  /// The helper thread reads the symbols of the window, which are shared with it rather than
+  /// copied: in this mode, data are kept in memory until the helper thread is done with them.
+  /// @note Disabling this mode waits for pending repairs and sends them
+  encoder&
+  set_async_repairs(bool async)
+  {
+    if (async and not m_pipeline)
+    {
+      m_pipeline.reset(new detail::repair_pipeline{m_galois_field_size, pipeline_capacity});
+      for (auto cit = m_sources.cbegin(); cit != m_sources.cend(); ++cit)
+      {
+        m_pipeline->add(cit->id(), shared_view(*cit), [this]{wait_pipeline();});
+      }
+    }
+    else if (not async and m_pipeline)
+    {
+      wait_repairs();
+      m_pipeline.reset();
+    }
+    return *this;
+  }
+
+  /// @brief Tell if repairs are built on a helper thread
+  bool
+  async_repairs()
+  const noexcept
+  {
+    return static_cast<bool>(m_pipeline);
+  }
+
+  /// @brief Send the repairs built by the helper thread
+  /// @return The number of sent repairs
+  /// @note Does nothing if repairs are not built on a helper thread (see set_async_repairs())
+  ///
+  /// Repairs are also sent at each call to operator(). Call this function when the encoder is idle
+  /// to avoid delaying them.
+  std::size_t
+  flush_repairs()
+  {
+    if (not m_pipeline)
+    {
+      return 0;
+    }
+    return m_pipeline->flush([this](detail::encoder_repair& r){emit_repair(r);});
+  }
+
+  /// @brief Wait for the helper thread to build all pending repairs, then send them
+  /// @note Does nothing if repairs are not built on a helper thread (see set_async_repairs())
+  void
+  wait_repairs()
+  {
+    while (m_pipeline and m_pipeline->nb_pending() > 0)
+    {
+      wait_pipeline();
+    }
   }
 
   /// @brief Get the Galois's field size
@@ -195,6 +352,7 @@ public:
 
   /// @brief Set how many sources are sent before a repair is generated
   /// @pre @p rate > 0
+  /// @note Only the default repair policy, fixed_rate_policy, follows this rate
   encoder&
   set_rate(std::size_t rate)
   noexcept
@@ -212,6 +370,26 @@ public:
     return m_rate;
   }
 
+  /// @brief Set the policy which decides when repairs are sent
+  /// @pre @p policy is not null
+  /// @note The default policy sends a repair every rate() sources (see fixed_rate_policy)
+  encoder&
+  set_repair_policy(std::unique_ptr<ntc::repair_policy> policy)
+  noexcept
+  {
+    assert(policy);
+    m_repair_policy = std::move(policy);
+    return *this;
+  }
+
+  /// @brief Get the policy which decides when repairs are sent
+  const ntc::repair_policy&
+  repair_policy()
+  const noexcept
+  {
+    return *m_repair_policy;
+  }
+
   /// @brief Set the maximal permitted size of the encoder's window
   /// @pre @p sz > 0
   encoder&
@@ -248,20 +426,81 @@ public:
     return m_adaptive;
   }
 
+  /// @brief Set the fraction of sources the adaptive mode accepts not to recover
+  /// @pre 0 < @p loss < 1
+  ///
+  /// In adaptive mode, each ack updates an estimation of the loss rate and of the burst length of
+  /// the channel. The encoder then sends as few repairs as possible, and uses the smallest window,
+  /// to keep the residual loss under @p loss.
+  encoder&
+  set_target_loss(double loss)
+  noexcept
+  {
+    assert(loss > 0 and loss < 1);
+    m_target_loss = loss;
+    return *this;
+  }
+
+  /// @brief Get the fraction of sources the adaptive mode accepts not to recover
+  double
+  target_loss()
+  const noexcept
+  {
+    return m_target_loss;
+  }
+
+  /// @brief Get the window size chosen by the adaptive mode
+  /// @note The window never exceeds window_size()
+  std::size_t
+  adaptive_window_size()
+  const noexcept
+  {
+    return m_adaptive_window_size;
+  }
+
+  /// @brief Get the loss rate of the channel, as estimated by the adaptive mode
+  double
+  estimated_loss_rate()
+  const noexcept
+  {
+    return m_channel.loss_rate();
+  }
+
+  /// @brief Get the mean length of bursts of losses, as estimated by the adaptive mode
+  double
+  estimated_burst_length()
+  const noexcept
+  {
+    return m_channel.burst_length();
+  }
+
 private:
 
   /// @brief Create a source from the given data and generate a repair if needed
-  /// @param d The data to add
+  /// @param d The data to add, a data or a data_view
+  template <typename Data>
   void
-  commit_impl(data&& d)
+  commit_impl(Data&& d)
   {
-    if (m_sources.size() == m_window_size)
+    flush_repairs();
+
+    const auto window_size = m_adaptive ? std::min(m_window_size, m_adaptive_window_size)
+                                        : m_window_size;
+    while (m_sources.size() >= window_size)
     {
       m_sources.pop_front();
+      if (m_pipeline)
+      {
+        m_pipeline->pop_front([this]{wait_pipeline();});
+      }
     }
 
     // Create a new source in-place at the end of the list of sources.
-    const auto& insertion = m_sources.emplace(m_current_source_id, std::move(d));
+    const auto& insertion = m_sources.emplace(m_current_source_id, std::forward<Data>(d));
+    if (m_pipeline)
+    {
+      m_pipeline->add(m_current_source_id, shared_view(insertion), [this]{wait_pipeline();});
+    }
 
     if (m_code_type == systematic::yes)
     {
@@ -272,11 +511,17 @@ private:
     }
     else // non_systematic code
     {
-      generate_repair();
+      // This repair replaces the source, it's not accounted as redundancy by the repair policy.
+      send_repair();
     }
+    m_tracer(trace_event::source_committed, m_current_source_id, insertion.size());
 
     /// @todo Should we generate a repair if window_size() == 1?
-    if ((m_current_source_id + 1) % m_rate == 0)
+    const auto event = source_event{ m_current_source_id, insertion.size(), m_rate
+                                   , m_repair_policy->uses_time()
+                                   ? std::chrono::steady_clock::now()
+                                   : std::chrono::steady_clock::time_point{}};
+    for (auto nb = m_repair_policy->on_source(event); nb > 0; --nb)
     {
       generate_repair();
     }
@@ -288,35 +533,100 @@ private:
   /// @return The number of bytes that have been read (0 if the packet was not decoded)
   /// @throw packet_type_error
   std::size_t
-  notify_impl(packet&& p)
+  notify_impl(const char* data, std::size_t size)
   {
-    if (detail::get_packet_type(p) != detail::packet_type::ack)
+    if (detail::get_packet_type(data, size) != detail::packet_type::ack)
     {
-      throw packet_type_error{p};
+      throw packet_type_error{packet(data, data + size)};
     }
     else
     {
+      flush_repairs();
       ++m_nb_acks;
-      const auto res = m_packetizer.read_ack(std::move(p));
+      m_nb_received_bytes += size;
+      const auto res = m_packetizer.read_ack(data, size);
+      m_tracer( trace_event::ack_received, static_cast<std::uint32_t>(res.first.source_ids().size())
+              , static_cast<std::uint32_t>(res.second));
       if (m_adaptive)
       {
-        if (m_nb_sent_packets > 0)
-        {
-          const auto loss_rate
-            = (m_nb_sent_packets - res.first.nb_packets()) / static_cast<double>(m_nb_sent_packets);
-          m_rate = rate_for_loss(loss_rate);
-        }
-        else
-        {
-          m_rate = rate_for_loss(0.0);
-        }
+        adapt(res.first);
       }
       m_nb_sent_packets = 0;
+      m_last_ack_nb_packets = res.first.nb_packets();
       m_sources.erase(begin(res.first.source_ids()), end(res.first.source_ids()));
+      if (m_pipeline)
+      {
+        m_pipeline->erase(res.first.source_ids(), [this]{wait_pipeline();});
+      }
       return res.second;
     }
   }
 
+  /// @brief Build a repair and give it to the packetizer, or ask the helper thread to build it
+  void
+  send_repair()
+  {
+    if (m_pipeline)
+    {
+      assert(m_sources.size() > 0 && "Empty source list");
+      m_pipeline->repair(m_current_repair_id, [this]{wait_pipeline();});
+      ++m_current_repair_id;
+      return;
+    }
+    m_repair.reset();
+    mk_repair();
+    emit_repair(m_repair);
+  }
+
+  /// @brief Give a built repair to the packetizer
+  void
+  emit_repair(detail::encoder_repair& repair)
+  {
+    ++m_nb_sent_repairs;
+    ++m_nb_sent_packets;
+    m_packetizer.write_repair(repair);
+    m_tracer( trace_event::repair_emitted, repair.id()
+            , static_cast<std::uint32_t>(repair.symbol().size()));
+  }
+
+  /// @brief Let the helper thread catch up, called while it can't accept more commands
+  void
+  wait_pipeline()
+  {
+    // The helper thread may be waiting for repairs to be flushed.
+    if (flush_repairs() == 0)
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  /// @brief Get a view on the symbol of a source, to share it with the helper thread
+  static
+  data_view
+  shared_view(const detail::encoder_source& src)
+  {
+    if (src.borrowed())
+    {
+      return {src.symbol().data(), src.size(), src.owner()};
+    }
+    // Only sources added before the helper thread was started own their symbol.
+    const auto owner = std::make_shared<data>(src.symbol().begin(), src.symbol().end());
+    return {owner->data(), owner->size(), owner};
+  }
+
+  /// @brief Get the size of the largest symbol of the window, i.e. the size of a repair
+  std::size_t
+  max_symbol_size()
+  const noexcept
+  {
+    auto res = std::size_t{0};
+    for (auto cit = m_sources.cbegin(); cit != m_sources.cend(); ++cit)
+    {
+      res = std::max(res, static_cast<std::size_t>(cit->size()));
+    }
+    return res;
+  }
+
   /// @brief Launch the generation of a repair
   void
   mk_repair()
@@ -329,18 +639,45 @@ private:
     m_encoder(m_repair, m_sources);
 
     ++m_current_repair_id;
-    ++m_nb_sent_repairs;
   }
 
-  /// @brief Compute the code rate needed for a given loss rate
-  static
-  std::size_t
-  rate_for_loss(double loss)
-  noexcept
+  /// @brief Update the estimation of the channel with an ack, then choose rate and window
+  void
+  adapt(const detail::ack& a)
   {
-    return loss < 0.01
-         ? 50
-         : static_cast<std::size_t>(ceil((1/loss)/2));
+    // The decoder counts received packets modulo 2^16 and doesn't reset the count when it sends
+    // an ack, thus packets reported by lost acks are also reported by this one. More than 65535
+    // packets can be received between two acks, as long as less than 65536 of them are lost.
+    auto nb_received
+      = std::size_t{static_cast<std::uint16_t>(a.nb_packets() - m_last_ack_nb_packets)};
+    if (m_nb_sent_packets > nb_received)
+    {
+      nb_received += (m_nb_sent_packets - nb_received) & ~std::size_t{0xffff};
+    }
+    m_channel.observe_counts(m_nb_sent_packets, nb_received);
+
+    // Sources not yet acknowledged and older than the most recent acknowledged one are missing on
+    // the decoder side. Each source is observed once, even if it's recovered later.
+    if (not a.source_ids().empty())
+    {
+      const auto last_id = *a.source_ids().rbegin();
+      auto id_cit = a.source_ids().begin();
+      for (auto cit = m_sources.cbegin(); cit != m_sources.cend() and cit->id() <= last_id; ++cit)
+      {
+        if (cit->id() < m_next_observed_id)
+        {
+          continue;
+        }
+        // Can't reach the end of acknowledged sources, as last_id is one of them.
+        id_cit = std::lower_bound(id_cit, a.source_ids().end(), cit->id());
+        m_channel.observe_source(*id_cit != cit->id());
+        m_next_observed_id = cit->id() + 1;
+      }
+    }
+
+    const auto code = m_channel.choose(m_target_loss, m_window_size);
+    m_rate = code.first;
+    m_adaptive_window_size = code.second;
   }
 
 private:
@@ -348,17 +685,39 @@ private:
   /// @brief The Galois field size
   const std::uint8_t m_galois_field_size;
 
+  /// @brief Tell if the code is adaptive
+  bool m_adaptive;
+
   /// @brief Tell if the code is systematic or not
   systematic m_code_type;
 
+  /// @brief The policy notified of each event
+  /// @note Declared with the other small members, as it's usually empty, to save padding
+  tracer_type m_tracer;
+
+  /// @brief The number of packets received by the decoder, modulo 2^16, in the last ack
+  std::uint16_t m_last_ack_nb_packets;
+
+  /// @brief The identifier of the next source to be observed by the adaptive mode
+  std::uint32_t m_next_observed_id;
+
   /// @brief How many sources to send before a repair is generated
   std::size_t m_rate;
 
   /// @brief The maximal number of sources to keep on the encoder side before discarding them
   std::size_t m_window_size;
 
-  /// @brief Tell if the code is adaptive
-  bool m_adaptive;
+  /// @brief The fraction of sources the adaptive mode accepts not to recover
+  double m_target_loss;
+
+  /// @brief The estimation of the channel used by the adaptive mode
+  detail::gilbert_elliott m_channel;
+
+  /// @brief The window size chosen by the adaptive mode
+  std::size_t m_adaptive_window_size;
+
+  /// @brief Decide when repairs are sent
+  std::unique_ptr<ntc::repair_policy> m_repair_policy;
 
   /// @brief The counter for source packets identifiers
   std::uint32_t m_current_source_id;
@@ -391,7 +750,16 @@ private:
   std::size_t m_nb_sent_sources;
 
   /// @brief The number of sent packets since last ack
-  std::uint16_t m_nb_sent_packets;
+  std::size_t m_nb_sent_packets;
+
+  /// @brief The number of received bytes
+  std::size_t m_nb_received_bytes;
+
+  /// @brief Build repairs on a helper thread, if set
+  std::unique_ptr<detail::repair_pipeline> m_pipeline;
+
+  /// @brief The maximal number of pending commands and built repairs of the helper thread
+  static constexpr std::size_t pipeline_capacity = 256;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -1,10 +1,12 @@
 #pragma once
 
+#include "netcode/tracing.hh"
+
 namespace ntc {
 
 /*------------------------------------------------------------------------------------------------*/
 
-template <typename PacketHandler>
+template <typename PacketHandler, typename Tracer = no_tracing>
 class encoder;
 
 /*------------------------------------------------------------------------------------------------*/
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <exception>
+#include <stdexcept> // runtime_error
 
 #include "netcode/detail/visibility.hh"
 #include "netcode/packet.hh"
@@ -31,4 +32,14 @@ struct NTC_PUBLIC overflow_error
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Exception raised when a capture file can't be read.
+/// @ingroup ntc_error
+struct NTC_PUBLIC capture_format_error
+  : public std::runtime_error
+{
+  using std::runtime_error::runtime_error;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 } // namespace ntc
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm> // fill
+#include <cmath>     // ceil
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "netcode/detail/visibility.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A histogram of durations, with a bounded relative error
+///
+/// Values are stored in log-linear buckets, like HdrHistogram does: each power of two is split in
+/// 32 buckets, thus a value is known with a relative error smaller than 3.2%, whatever its
+/// magnitude. Recording a value is done in constant time, without any allocation.
+/// @note Values are in nanoseconds and are capped to about 18 minutes
+/// @ingroup ntc_decoder
+class NTC_PUBLIC histogram final
+{
+public:
+
+  /// @brief Constructor
+  histogram()
+    : m_counts(nb_buckets, 0)
+    , m_count{0}
+    , m_sum{0}
+    , m_min{std::numeric_limits<std::uint64_t>::max()}
+    , m_max{0}
+  {}
+
+  /// @brief Add a value
+  void
+  record(std::uint64_t value)
+  noexcept
+  {
+    if (value > max_value)
+    {
+      value = max_value;
+    }
+    m_counts[bucket(value)] += 1;
+    m_count += 1;
+    m_sum += value;
+    m_min = value < m_min ? value : m_min;
+    m_max = value > m_max ? value : m_max;
+  }
+
+  /// @brief Add all values of another histogram
+  void
+  merge(const histogram& other)
+  noexcept
+  {
+    for (auto i = 0ul; i < nb_buckets; ++i)
+    {
+      m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_min = other.m_min < m_min ? other.m_min : m_min;
+    m_max = other.m_max > m_max ? other.m_max : m_max;
+  }
+
+  /// @brief Remove all values
+  void
+  reset()
+  noexcept
+  {
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = std::numeric_limits<std::uint64_t>::max();
+    m_max = 0;
+  }
+
+  /// @brief Get the number of recorded values
+  std::uint64_t
+  count()
+  const noexcept
+  {
+    return m_count;
+  }
+
+  /// @brief Get the smallest recorded value, 0 if there are none
+  std::uint64_t
+  min()
+  const noexcept
+  {
+    return m_count != 0 ? m_min : 0;
+  }
+
+  /// @brief Get the largest recorded value, 0 if there are none
+  std::uint64_t
+  max()
+  const noexcept
+  {
+    return m_max;
+  }
+
+  /// @brief Get the mean of recorded values, 0 if there are none
+  double
+  mean()
+  const noexcept
+  {
+    return m_count != 0 ? static_cast<double>(m_sum) / static_cast<double>(m_count) : 0.;
+  }
+
+  /// @brief Get the value below which a percentage of recorded values fall
+  /// @param p The percentage, in [0, 100]
+  /// @return 0 if there are no values
+  /// @note The result is the largest value of the bucket, thus it's never smaller than the exact
+  /// percentile
+  std::uint64_t
+  percentile(double p)
+  const noexcept
+  {
+    if (m_count == 0)
+    {
+      return 0;
+    }
+    p = p < 0. ? 0. : (p > 100. ? 100. : p);
+    const auto rank
+      = static_cast<std::uint64_t>(std::ceil(p / 100. * static_cast<double>(m_count)));
+    auto nb = std::uint64_t{0};
+    for (auto i = 0ul; i < nb_buckets; ++i)
+    {
+      nb += m_counts[i];
+      if (nb >= rank and nb != 0)
+      {
+        const auto res = highest_value(i);
+        return res < m_max ? res : m_max;
+      }
+    }
+    return m_max;
+  }
+
+private:
+
+  /// @brief The number of bits used to split each power of 2
+  static constexpr auto sub_bucket_bits = 5u;
+
+  /// @brief The number of buckets for each power of 2
+  static constexpr auto sub_bucket_count = std::uint64_t{1} << sub_bucket_bits;
+
+  /// @brief The largest recorded value, larger ones are clamped
+  static constexpr auto max_value = (std::uint64_t{1} << 40) - 1;
+
+  /// @brief The total number of buckets
+  static constexpr auto nb_buckets = (40 - sub_bucket_bits + 1) * sub_bucket_count;
+
+  /// @brief Get the index of the bucket of a value
+  static
+  std::size_t
+  bucket(std::uint64_t value)
+  noexcept
+  {
+    if (value < sub_bucket_count)
+    {
+      // Small values are exact.
+      return static_cast<std::size_t>(value);
+    }
+    // Keep the sub_bucket_bits most significant bits.
+    const auto msb = 63u - static_cast<unsigned int>(__builtin_clzll(value));
+    const auto shift = msb - sub_bucket_bits;
+    return static_cast<std::size_t>(shift * sub_bucket_count + (value >> shift));
+  }
+
+  /// @brief Get the largest value of a bucket
+  static
+  std::uint64_t
+  highest_value(std::size_t index)
+  noexcept
+  {
+    if (index < sub_bucket_count)
+    {
+      return index;
+    }
+    const auto shift = index / sub_bucket_count - 1;
+    const auto mantissa = index % sub_bucket_count + sub_bucket_count;
+    return ((mantissa + 1) << shift) - 1;
+  }
+
+  /// @brief The number of values per bucket
+  std::vector<std::uint64_t> m_counts;
+
+  /// @brief The number of recorded values
+  std::uint64_t m_count;
+
+  /// @brief The sum of recorded values
+  std::uint64_t m_sum;
+
+  /// @brief The smallest recorded value
+  std::uint64_t m_min;
+
+  /// @brief The largest recorded value
+  std::uint64_t m_max;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Latencies measured by a decoder
+/// @see decoder::set_histograms
+/// @ingroup ntc_decoder
+struct NTC_PUBLIC decoder_histograms
+{
+  /// @brief Time between the detection of a missing source and its decoding
+  ///
+  /// A source is known to be missing when a source or a repair with a greater identifier is
+  /// received.
+  histogram loss_to_recovery;
+
+  /// @brief Time during which received or decoded sources are held back to give them in order
+  histogram in_order_hold;
+
+  /// @brief Time spent to invert the matrix of coefficients and to decode all missing sources
+  ///
+  /// It includes the time spent by the data handler to read decoded sources.
+  histogram full_decoding;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>   // memcpy
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept> // runtime_error
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "netcode/detail/visibility.hh"
+#include "netcode/capture_file.hh"
+#include "netcode/in_order.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Capture packets to a file without slowing down the thread which processes them
+///
+/// Captured packets are copied in a preallocated ring; a background thread periodically writes
+/// all pending packets to the file in a single block. Memory is bounded by the size of the ring:
+/// when it's full, packets are dropped and counted rather than blocking the capturing thread.
+///
+/// A capture is given to a decoder with decoder::set_capture. As record() is lock-free for a
+/// single producer, a capture shall be used by only one thread at a time.
+///
+/// The file follows the format described in @ref ntc_capture; it can be read with
+/// capture_reader. The index is written when the capture is destroyed.
+/// @ingroup ntc_capture
+class NTC_PUBLIC packet_capture final
+{
+public:
+
+  /// @brief The capture configuration
+  struct configuration
+  {
+    /// @brief The size of the ring, in bytes, rounded up to the next power of 2
+    std::size_t buffer_size = 4 * 1024 * 1024;
+
+    /// @brief The period at which pending packets are written to the file
+    std::chrono::milliseconds flush_period{10};
+
+    /// @brief The size of the Galois field of the captured codec, written in the file header
+    std::uint8_t galois_field_size = 8;
+
+    /// @brief Tell if the captured decoder gives data in order, written in the file header
+    in_order ordered = in_order::yes;
+  };
+
+  /// @brief Can't copy-construct a capture
+  packet_capture(const packet_capture&) = delete;
+
+  /// @brief Can't copy a capture
+  packet_capture& operator=(const packet_capture&) = delete;
+
+  /// @brief Can't move-construct a capture
+  packet_capture(packet_capture&&) = delete;
+
+  /// @brief Can't move a capture
+  packet_capture& operator=(packet_capture&&) = delete;
+
+  /// @brief Constructor with the default configuration
+  /// @param path The file to write, truncated if it already exists
+  /// @throw std::runtime_error if the file can't be opened
+  explicit packet_capture(const std::string& path)
+    : packet_capture{path, configuration{}}
+  {}
+
+  /// @brief Constructor, open the file and start the writer thread
+  /// @param path The file to write, truncated if it already exists
+  /// @param conf The capture configuration
+  /// @throw std::runtime_error if the file can't be opened
+  packet_capture(const std::string& path, const configuration& conf)
+    : m_capacity{round_up(conf.buffer_size)}
+    , m_buffer{new char[m_capacity]}
+    , m_head{0}
+    , m_cached_tail{0}
+    , m_nb_captured{0}
+    , m_nb_dropped{0}
+    , m_padding{}
+    , m_tail{0}
+    , m_nb_written_bytes{0}
+    , m_flush_period{conf.flush_period}
+    , m_file{path, std::ios::binary | std::ios::trunc}
+    , m_next_record{0}
+    , m_nb_records{0}
+    , m_index{}
+    , m_mutex{}
+    , m_stop_condition{}
+    , m_stop{false}
+    , m_writer{}
+  {
+    if (not m_file.is_open())
+    {
+      throw std::runtime_error{"Can't open capture file " + path};
+    }
+    auto header = capture_header{};
+    std::memcpy(header.magic, capture_magic, sizeof(capture_magic));
+    header.version = capture_version;
+    header.galois_field_size = conf.galois_field_size;
+    header.in_order = conf.ordered == in_order::yes ? 1 : 0;
+    header.record_header_size = sizeof(capture_record);
+    header.date = now();
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_writer = std::thread{[this]{write_loop();}};
+  }
+
+  /// @brief Destructor, write all pending packets and the index, then close the file
+  ~packet_capture()
+  {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_stop = true;
+    }
+    m_stop_condition.notify_one();
+    m_writer.join();
+    write_index();
+  }
+
+  /// @brief Copy a packet in the ring, to be called by the capturing thread
+  /// @return false if the ring is full, in which case the packet is dropped
+  bool
+  record(const char* data, std::size_t size, capture_direction direction)
+  noexcept
+  {
+    const auto total = sizeof(capture_record) + size;
+    const auto head = m_head.load(std::memory_order_relaxed);
+    if (m_capacity - (head - m_cached_tail) < total)
+    {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (m_capacity - (head - m_cached_tail) < total)
+      {
+        m_nb_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+
+    const auto header = capture_record{now(), static_cast<std::uint32_t>(size), direction, {}};
+    copy_in(head, reinterpret_cast<const char*>(&header), sizeof(header));
+    copy_in(head + sizeof(header), data, size);
+    m_head.store(head + total, std::memory_order_release);
+    m_nb_captured.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// @brief Get the number of packets copied in the ring
+  std::uint64_t
+  nb_captured()
+  const noexcept
+  {
+    return m_nb_captured.load(std::memory_order_relaxed);
+  }
+
+  /// @brief Get the number of packets dropped because the ring was full
+  std::uint64_t
+  nb_dropped()
+  const noexcept
+  {
+    return m_nb_dropped.load(std::memory_order_relaxed);
+  }
+
+  /// @brief Get the number of bytes written to the file, headers included
+  std::uint64_t
+  nb_written_bytes()
+  const noexcept
+  {
+    return m_nb_written_bytes.load(std::memory_order_relaxed);
+  }
+
+private:
+
+  /// @brief Get the current date, in nanoseconds since the epoch of the system clock
+  static
+  std::int64_t
+  now()
+  noexcept
+  {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+  }
+
+  /// @brief Round up to the next power of 2
+  static
+  std::size_t
+  round_up(std::size_t n)
+  noexcept
+  {
+    auto res = std::size_t{sizeof(capture_record)};
+    while (res < n)
+    {
+      res *= 2;
+    }
+    return res;
+  }
+
+  /// @brief Copy bytes in the ring at index @p pos, wrapping at its end
+  void
+  copy_in(std::size_t pos, const char* src, std::size_t n)
+  noexcept
+  {
+    const auto offset = pos & (m_capacity - 1);
+    const auto first = n < m_capacity - offset ? n : m_capacity - offset;
+    std::memcpy(m_buffer.get() + offset, src, first);
+    std::memcpy(m_buffer.get(), src + first, n - first);
+  }
+
+  /// @brief Copy bytes from the ring at index @p pos, wrapping at its end
+  void
+  copy_out(std::size_t pos, char* dst, std::size_t n)
+  const noexcept
+  {
+    const auto offset = pos & (m_capacity - 1);
+    const auto first = n < m_capacity - offset ? n : m_capacity - offset;
+    std::memcpy(dst, m_buffer.get() + offset, first);
+    std::memcpy(dst + first, m_buffer.get(), n - first);
+  }
+
+  /// @brief Body of the writer thread
+  void
+  write_loop()
+  {
+    auto stop = false;
+    while (not stop)
+    {
+      {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_stop_condition.wait_for(lock, m_flush_period, [this]{return m_stop;});
+        stop = m_stop;
+      }
+      flush();
+    }
+  }
+
+  /// @brief Write all pending bytes to the file
+  void
+  flush()
+  {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    const auto head = m_head.load(std::memory_order_acquire);
+    if (head == tail)
+    {
+      return;
+    }
+    // Index records before their bytes can be overwritten.
+    for (; m_next_record != head; ++m_nb_records)
+    {
+      auto record = capture_record{};
+      copy_out(m_next_record, reinterpret_cast<char*>(&record), sizeof(record));
+      if (m_nb_records % capture_index_period == 0)
+      {
+        m_index.push_back({sizeof(capture_header) + m_next_record, record.date});
+      }
+      m_next_record += sizeof(record) + record.size;
+    }
+
+    // At most two blocks, when pending bytes wrap at the end of the ring.
+    const auto offset = tail & (m_capacity - 1);
+    const auto n = head - tail;
+    const auto first = n < m_capacity - offset ? n : m_capacity - offset;
+    m_file.write(m_buffer.get() + offset, static_cast<std::streamsize>(first));
+    m_file.write(m_buffer.get(), static_cast<std::streamsize>(n - first));
+    m_file.flush();
+    m_tail.store(head, std::memory_order_release);
+    m_nb_written_bytes.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /// @brief Append the index and the footer, once all records have been written
+  void
+  write_index()
+  {
+    auto footer = capture_footer{};
+    footer.index_offset = sizeof(capture_header) + m_next_record;
+    footer.nb_index_entries = m_index.size();
+    footer.nb_records = m_nb_records;
+    std::memcpy(footer.magic, capture_index_magic, sizeof(capture_index_magic));
+    m_file.write( reinterpret_cast<const char*>(m_index.data())
+                , static_cast<std::streamsize>(m_index.size() * sizeof(capture_index_entry)));
+    m_file.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    m_file.flush();
+  }
+
+  /// @brief The size of a cache line, to avoid false sharing between producer and writer
+  static constexpr auto cache_line_size = 64ul;
+
+  /// @brief The size of the ring, a power of 2
+  const std::size_t m_capacity;
+
+  /// @brief The ring
+  const std::unique_ptr<char[]> m_buffer;
+
+  /// @brief The index following the last captured byte, written by the producer
+  std::atomic<std::size_t> m_head;
+
+  /// @brief The last known value of m_tail, to avoid reading it at each record
+  std::size_t m_cached_tail;
+
+  /// @brief The number of captured packets
+  std::atomic<std::uint64_t> m_nb_captured;
+
+  /// @brief The number of dropped packets
+  std::atomic<std::uint64_t> m_nb_dropped;
+
+  /// @brief Keep the writer's data on another cache line
+  char m_padding[cache_line_size];
+
+  /// @brief The index of the first byte not yet written to the file, written by the writer
+  std::atomic<std::size_t> m_tail;
+
+  /// @brief The number of bytes written to the file
+  std::atomic<std::uint64_t> m_nb_written_bytes;
+
+  /// @brief The period at which pending packets are written to the file
+  const std::chrono::milliseconds m_flush_period;
+
+  /// @brief The capture file
+  std::ofstream m_file;
+
+  /// @brief The ring index of the next record to index, only used by the writer
+  std::size_t m_next_record;
+
+  /// @brief The number of indexed records, only used by the writer
+  std::uint64_t m_nb_records;
+
+  /// @brief The sparse index, only used by the writer
+  std::vector<capture_index_entry> m_index;
+
+  /// @brief Protect m_stop
+  std::mutex m_mutex;
+
+  /// @brief Wake the writer up when the capture stops
+  std::condition_variable m_stop_condition;
+
+  /// @brief Tell the writer to write pending bytes one last time, then to stop
+  bool m_stop;
+
+  /// @brief The writer thread
+  std::thread m_writer;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <limits>  // numeric_limits
+#include <utility> // forward, move
+
+#include "netcode/detail/mpsc_queue.hh"
+#include "netcode/detail/spsc_queue.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A bounded lock-free queue to hand packets over between threads
+///
+/// Packets are moved, never copied. Moreover, a slot keeps the packet its consumer left in it, so
+/// that the next producer gets it back when it pushes a new one: buffers go round the ring and, once
+/// they have grown to the size of the largest packet, no allocation happens anymore.
+/// @code
+/// // I/O thread, producer.
+/// ntc::packet p;
+/// p.resize(max_size);
+/// p.resize(recv(fd, p.data(), p.size(), 0));
+/// while (not queue.try_push(p)) {}
+/// // p is now an empty packet, with the capacity of a previously consumed one.
+///
+/// // Coding thread, consumer.
+/// queue.pop_batch([&](ntc::packet& p){decoder(p.data(), p.size());});
+/// @endcode
+/// @tparam Queue The lock-free ring, see spsc_packet_queue and mpsc_packet_queue
+/// @ingroup ntc_packets
+template <typename Queue>
+class basic_packet_queue final
+{
+public:
+
+  /// @brief Can't copy-construct a queue
+  basic_packet_queue(const basic_packet_queue&) = delete;
+
+  /// @brief Can't copy a queue
+  basic_packet_queue& operator=(const basic_packet_queue&) = delete;
+
+  /// @brief Constructor
+  /// @param capacity The maximal number of packets, rounded up to the next power of 2
+  explicit basic_packet_queue(std::size_t capacity)
+    : m_queue{capacity}
+  {}
+
+  /// @brief Add a packet, to be called by a producer
+  /// @return false if the queue is full, in which case @p p is left untouched
+  ///
+  /// On success, @p p is an empty packet which re-uses the memory of a consumed one.
+  bool
+  try_push(packet& p)
+  {
+    if (m_queue.try_exchange(p))
+    {
+      p.clear();
+      return true;
+    }
+    return false;
+  }
+
+  /// @brief Add a packet, to be called by a producer
+  /// @return false if the queue is full, in which case @p p is left untouched
+  bool
+  try_push(packet&& p)
+  {
+    return m_queue.try_exchange(p);
+  }
+
+  /// @brief Remove the oldest packet, to be called by the consumer
+  /// @return false if the queue is empty, in which case @p p is left untouched
+  ///
+  /// On success, the previous content of @p p is kept by the queue to be re-used by a producer.
+  bool
+  try_pop(packet& p)
+  {
+    using std::swap;
+    return m_queue.consume([&](packet& q){swap(p, q);}, 1) == 1;
+  }
+
+  /// @brief Give the oldest packets to @p fn, to be called by the consumer
+  /// @param fn Called with a reference to each packet, in order
+  /// @param max The maximal number of packets to give
+  /// @return The number of packets given to @p fn
+  ///
+  /// Packets given to @p fn stay in the queue to be re-used by producers, unless @p fn moves them
+  /// away. For instance, a decoder can read them in place with decoder::operator()(const char*,
+  /// std::size_t).
+  template <typename Fn>
+  std::size_t
+  pop_batch(Fn&& fn, std::size_t max = std::numeric_limits<std::size_t>::max())
+  {
+    return m_queue.consume(std::forward<Fn>(fn), max);
+  }
+
+  /// @brief Tell if there is no packet to pop, to be called by the consumer
+  bool
+  empty()
+  const noexcept
+  {
+    return m_queue.empty();
+  }
+
+  /// @brief Get the maximal number of packets
+  std::size_t
+  capacity()
+  const noexcept
+  {
+    return m_queue.capacity();
+  }
+
+private:
+
+  /// @brief The lock-free ring
+  Queue m_queue;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A packet queue for exactly one producer thread and one consumer thread
+/// @ingroup ntc_packets
+using spsc_packet_queue = basic_packet_queue<detail::spsc_queue<packet>>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A packet queue for any number of producer threads and one consumer thread
+/// @ingroup ntc_packets
+using mpsc_packet_queue = basic_packet_queue<detail::mpsc_queue<packet>>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,429 @@
+#pragma once
+
+#include <algorithm> // max, min
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "netcode/detail/visibility.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Describe a source which has just been sent by an encoder
+/// @see repair_policy::on_source
+/// @ingroup ntc_encoder
+struct NTC_PUBLIC source_event
+{
+  /// @brief The identifier of the sent source
+  std::uint32_t id;
+
+  /// @brief The number of bytes of the source's symbol
+  std::size_t size;
+
+  /// @brief The current code rate of the encoder (see encoder::rate)
+  std::size_t rate;
+
+  /// @brief When the source was sent
+  /// @note Only set if the policy asked for it with repair_policy::uses_time
+  std::chrono::steady_clock::time_point date;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decide when an encoder sends repairs
+///
+/// Each time a source is sent, the encoder asks its policy how many repairs should be sent right
+/// away. Then, the policy is notified of each repair that has been sent, including the ones forced
+/// with encoder::generate_repair.
+/// @see encoder::set_repair_policy
+/// @ingroup ntc_encoder
+class NTC_PUBLIC repair_policy
+{
+public:
+
+  /// @brief Destructor
+  virtual ~repair_policy() = default;
+
+  /// @brief Called after a source has been sent
+  /// @return How many repairs should be sent now
+  virtual
+  std::size_t
+  on_source(const source_event& e) = 0;
+
+  /// @brief Called after a repair has been sent
+  /// @param size The number of bytes of the repair's symbol
+  virtual
+  void
+  on_repair(std::size_t /*size*/)
+  {}
+
+  /// @brief Tell if this policy needs the date of sources
+  ///
+  /// Reading the clock is not free, thus the encoder does so only when it's needed.
+  virtual
+  bool
+  uses_time()
+  const noexcept
+  {
+    return false;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send a repair every encoder::rate sources
+///
+/// This is the default policy of an encoder. It's the only one which follows the rate changes
+/// made by the adaptive mode.
+/// @ingroup ntc_encoder
+class NTC_PUBLIC fixed_rate_policy final
+  : public repair_policy
+{
+public:
+
+  std::size_t
+  on_source(const source_event& e)
+  override
+  {
+    assert(e.rate > 0);
+    return (e.id + 1) % e.rate == 0 ? 1 : 0;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace detail {
+
+/// @internal
+/// @brief Guess the size of the next repair, at least 1, so an empty source can't make it free
+/// @param last_repair_size The size of the previous repair, 0 if none was sent
+/// @param source_size The size of the current source
+inline
+double
+repair_cost(std::size_t last_repair_size, std::size_t source_size)
+noexcept
+{
+  // The next repair will most likely be as large as the previous one.
+  return static_cast<double>(std::max<std::size_t>(1, last_repair_size != 0 ? last_repair_size
+                                                                             : source_size));
+}
+
+} // namespace detail
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send repairs to reach a target redundancy ratio, in bytes
+///
+/// Each sent source earns @p ratio times its size in credit, each sent repair costs its size. A
+/// repair is sent as soon as the credit covers the size of the previous repair. Thus, the overhead
+/// in bytes stays close to @p ratio, whatever the mix of sources' sizes.
+/// @note A large source might trigger several repairs at once, use spread_policy to avoid bursts.
+/// @ingroup ntc_encoder
+class NTC_PUBLIC byte_ratio_policy final
+  : public repair_policy
+{
+public:
+
+  /// @brief Constructor
+  /// @param ratio The number of repair bytes to send for each source byte
+  /// @pre @p ratio > 0
+  explicit byte_ratio_policy(double ratio)
+    : m_ratio{ratio}
+    , m_credit{0}
+    , m_last_repair_size{0}
+  {
+    assert(ratio > 0);
+  }
+
+  std::size_t
+  on_source(const source_event& e)
+  override
+  {
+    m_credit += m_ratio * static_cast<double>(e.size);
+
+    const auto cost = detail::repair_cost(m_last_repair_size, e.size);
+    auto credit = m_credit;
+    auto nb = 0ul;
+    while (credit >= cost)
+    {
+      credit -= cost;
+      ++nb;
+    }
+    return nb;
+  }
+
+  void
+  on_repair(std::size_t size)
+  override
+  {
+    m_credit -= static_cast<double>(size);
+    m_last_repair_size = size;
+  }
+
+private:
+
+  /// @brief The number of repair bytes per source byte
+  const double m_ratio;
+
+  /// @brief The number of repair bytes which can be sent
+  double m_credit;
+
+  /// @brief The size of the last sent repair
+  std::size_t m_last_repair_size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send at most one repair per source
+///
+/// Repairs asked by another policy are delayed to the following sources rather than being sent in
+/// a burst.
+/// @ingroup ntc_encoder
+class NTC_PUBLIC spread_policy final
+  : public repair_policy
+{
+public:
+
+  /// @brief Constructor
+  /// @param policy The policy to spread
+  /// @param max_pending How many delayed repairs to remember at most
+  explicit spread_policy(std::unique_ptr<repair_policy> policy, std::size_t max_pending = 16)
+    : m_policy{std::move(policy)}
+    , m_max_pending{max_pending}
+    , m_pending{0}
+  {
+    assert(m_policy);
+  }
+
+  std::size_t
+  on_source(const source_event& e)
+  override
+  {
+    m_pending = std::min(m_pending + m_policy->on_source(e), m_max_pending);
+    if (m_pending == 0)
+    {
+      return 0;
+    }
+    --m_pending;
+    return 1;
+  }
+
+  void
+  on_repair(std::size_t size)
+  override
+  {
+    m_policy->on_repair(size);
+  }
+
+  bool
+  uses_time()
+  const noexcept
+  override
+  {
+    return m_policy->uses_time();
+  }
+
+private:
+
+  /// @brief The spread policy
+  const std::unique_ptr<repair_policy> m_policy;
+
+  /// @brief How many delayed repairs to remember at most
+  const std::size_t m_max_pending;
+
+  /// @brief The number of delayed repairs
+  std::size_t m_pending;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Pace repairs with a token bucket
+///
+/// The bucket is filled at a constant rate, up to a maximal burst size, and each sent repair takes
+/// as many tokens as its size. Repairs asked by another policy are delayed to the following sources
+/// until the bucket holds enough tokens.
+/// @ingroup ntc_encoder
+class NTC_PUBLIC token_bucket_policy final
+  : public repair_policy
+{
+public:
+
+  /// @brief Constructor
+  /// @param policy The policy to pace
+  /// @param bytes_per_second The rate at which the bucket is filled
+  /// @param burst The capacity of the bucket, in bytes
+  /// @param max_pending How many delayed repairs to remember at most
+  token_bucket_policy( std::unique_ptr<repair_policy> policy, double bytes_per_second
+                     , std::size_t burst, std::size_t max_pending = 16)
+    : m_policy{std::move(policy)}
+    , m_bytes_per_second{bytes_per_second}
+    , m_burst{static_cast<double>(burst)}
+    , m_max_pending{max_pending}
+    , m_tokens{static_cast<double>(burst)}
+    , m_last_date{}
+    , m_pending{0}
+    , m_last_repair_size{0}
+  {
+    assert(m_policy);
+    assert(bytes_per_second > 0);
+  }
+
+  std::size_t
+  on_source(const source_event& e)
+  override
+  {
+    // Fill the bucket.
+    if (m_last_date != std::chrono::steady_clock::time_point{})
+    {
+      const auto elapsed = std::chrono::duration<double>(e.date - m_last_date).count();
+      m_tokens = std::min(m_burst, m_tokens + elapsed * m_bytes_per_second);
+    }
+    m_last_date = e.date;
+
+    m_pending = std::min(m_pending + m_policy->on_source(e), m_max_pending);
+
+    const auto cost = detail::repair_cost(m_last_repair_size, e.size);
+    auto tokens = m_tokens;
+    auto nb = 0ul;
+    while (m_pending > 0 and tokens >= cost)
+    {
+      tokens -= cost;
+      --m_pending;
+      ++nb;
+    }
+    return nb;
+  }
+
+  void
+  on_repair(std::size_t size)
+  override
+  {
+    m_tokens -= static_cast<double>(size);
+    m_last_repair_size = size;
+    m_policy->on_repair(size);
+  }
+
+  bool
+  uses_time()
+  const noexcept
+  override
+  {
+    return true;
+  }
+
+private:
+
+  /// @brief The paced policy
+  const std::unique_ptr<repair_policy> m_policy;
+
+  /// @brief The rate at which the bucket is filled
+  const double m_bytes_per_second;
+
+  /// @brief The capacity of the bucket
+  const double m_burst;
+
+  /// @brief How many delayed repairs to remember at most
+  const std::size_t m_max_pending;
+
+  /// @brief The current number of tokens
+  double m_tokens;
+
+  /// @brief When the bucket was last filled
+  std::chrono::steady_clock::time_point m_last_date;
+
+  /// @brief The number of delayed repairs
+  std::size_t m_pending;
+
+  /// @brief The size of the last sent repair
+  std::size_t m_last_repair_size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Record the emission timeline of another policy
+///
+/// Useful to check how a policy behaves, or to plot the overhead of a code.
+/// @ingroup ntc_encoder
+class NTC_PUBLIC repair_timeline final
+  : public repair_policy
+{
+public:
+
+  /// @brief An entry of the timeline
+  struct event
+  {
+    /// @brief Was a source or a repair sent?
+    enum class kind {source, repair} type;
+
+    /// @brief The number of bytes of the sent symbol
+    std::size_t size;
+
+    /// @brief When a source was sent, if the recorded policy uses time
+    std::chrono::steady_clock::time_point date;
+  };
+
+  /// @brief Constructor
+  /// @param policy The policy to record
+  explicit repair_timeline(std::unique_ptr<repair_policy> policy)
+    : m_policy{std::move(policy)}
+    , m_events{}
+  {
+    assert(m_policy);
+  }
+
+  std::size_t
+  on_source(const source_event& e)
+  override
+  {
+    m_events.push_back(event{event::kind::source, e.size, e.date});
+    return m_policy->on_source(e);
+  }
+
+  void
+  on_repair(std::size_t size)
+  override
+  {
+    m_events.push_back(event{event::kind::repair, size, {}});
+    m_policy->on_repair(size);
+  }
+
+  bool
+  uses_time()
+  const noexcept
+  override
+  {
+    return m_policy->uses_time();
+  }
+
+  /// @brief Get all recorded events, in emission order
+  const std::vector<event>&
+  events()
+  const noexcept
+  {
+    return m_events;
+  }
+
+  /// @brief Forget all recorded events
+  void
+  clear()
+  noexcept
+  {
+    m_events.clear();
+  }
+
+private:
+
+  /// @brief The recorded policy
+  const std::unique_ptr<repair_policy> m_policy;
+
+  /// @brief The timeline
+  std::vector<event> m_events;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits> // is_trivially_copyable
+#include <utility>     // pair
+#include <vector>
+
+#include "netcode/detail/spsc_queue.hh"
+#include "netcode/detail/visibility.hh"
+#include "netcode/tracing.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A binary record of an event, as stored by ring_tracing
+/// @ingroup ntc
+struct NTC_PUBLIC trace_record
+{
+  /// @brief When the event occurred, in nanoseconds since the epoch of std::chrono::steady_clock
+  std::int64_t date;
+
+  /// @brief An identifier or a count, depending on event (see trace_event)
+  std::uint32_t id;
+
+  /// @brief A size in bytes, depending on event (see trace_event)
+  std::uint32_t size;
+
+  /// @brief The tag given to the ring_tracing which recorded this event
+  std::uint32_t tag;
+
+  /// @brief What happened
+  trace_event event;
+};
+
+static_assert(sizeof(trace_record) == 24, "trace_record should stay small and fixed-size");
+static_assert(std::is_trivially_copyable<trace_record>::value, "trace_record should be raw bytes");
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A bounded lock-free ring of records, written by one thread and drained by another one
+///
+/// When the ring is full, new records are dropped and counted rather than blocking the writer.
+/// @ingroup ntc
+class NTC_PUBLIC trace_ring final
+{
+public:
+
+  /// @brief Can't copy-construct a ring
+  trace_ring(const trace_ring&) = delete;
+
+  /// @brief Can't copy a ring
+  trace_ring& operator=(const trace_ring&) = delete;
+
+  /// @brief Constructor
+  /// @param capacity The maximal number of records, rounded up to the next power of 2
+  explicit trace_ring(std::size_t capacity)
+    : m_records{capacity}
+    , m_nb_dropped{0}
+  {}
+
+  /// @brief Add a record, to be called by the writer thread
+  void
+  push(const trace_record& r)
+  noexcept
+  {
+    if (not m_records.try_emplace(r))
+    {
+      m_nb_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /// @brief Give all available records to @p f, to be called by the draining thread
+  /// @return The number of drained records
+  template <typename Function>
+  std::size_t
+  drain(Function&& f)
+  {
+    auto nb = 0ul;
+    auto r = trace_record{};
+    while (m_records.try_pop(r))
+    {
+      f(r);
+      ++nb;
+    }
+    return nb;
+  }
+
+  /// @brief Get the number of records dropped because the ring was full
+  std::uint64_t
+  nb_dropped()
+  const noexcept
+  {
+    return m_nb_dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+
+  /// @brief Records not yet drained
+  detail::spsc_queue<trace_record> m_records;
+
+  /// @brief The number of records dropped because the ring was full
+  std::atomic<std::uint64_t> m_nb_dropped;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Owns one ring per thread which records events, and drains all of them
+///
+/// Writers never contend: each thread gets its own ring the first time it records an event
+/// through this collector. Only this first access takes a lock.
+/// @pre A collector outlives all ring_tracing which refer to it
+/// @ingroup ntc
+class NTC_PUBLIC trace_collector final
+{
+public:
+
+  /// @brief Can't copy-construct a collector
+  trace_collector(const trace_collector&) = delete;
+
+  /// @brief Can't copy a collector
+  trace_collector& operator=(const trace_collector&) = delete;
+
+  /// @brief Constructor
+  /// @param ring_capacity The maximal number of records of each thread's ring
+  explicit trace_collector(std::size_t ring_capacity = 65536)
+    : m_id{next_id()}
+    , m_ring_capacity{ring_capacity}
+    , m_mutex{}
+    , m_rings{}
+  {}
+
+  /// @brief Get the ring of the calling thread
+  trace_ring&
+  local_ring()
+  {
+    // Most of the time, a thread records events for a single collector.
+    thread_local auto cache = std::pair<std::uint64_t, trace_ring*>{0, nullptr};
+    if (cache.first != m_id)
+    {
+      cache = std::make_pair(m_id, &register_thread());
+    }
+    return *cache.second;
+  }
+
+  /// @brief Give all available records of all threads to @p f
+  /// @return The number of drained records
+  /// @note Records are ordered within a thread, not across threads
+  template <typename Function>
+  std::size_t
+  drain(Function&& f)
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    auto nb = 0ul;
+    for (auto& thread_ring : m_rings)
+    {
+      nb += thread_ring.second->drain(f);
+    }
+    return nb;
+  }
+
+  /// @brief Get the number of records dropped by all threads because their ring was full
+  std::uint64_t
+  nb_dropped()
+  const
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    auto nb = std::uint64_t{0};
+    for (const auto& thread_ring : m_rings)
+    {
+      nb += thread_ring.second->nb_dropped();
+    }
+    return nb;
+  }
+
+private:
+
+  /// @brief Get a unique identifier, never 0
+  static
+  std::uint64_t
+  next_id()
+  noexcept
+  {
+    static std::atomic<std::uint64_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  /// @brief Find or create the ring of the calling thread
+  trace_ring&
+  register_thread()
+  {
+    const auto id = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock{m_mutex};
+    for (auto& thread_ring : m_rings)
+    {
+      if (thread_ring.first == id)
+      {
+        return *thread_ring.second;
+      }
+    }
+    m_rings.emplace_back(id, std::unique_ptr<trace_ring>{new trace_ring{m_ring_capacity}});
+    return *m_rings.back().second;
+  }
+
+  /// @brief Distinguish this collector from others in threads' caches
+  const std::uint64_t m_id;
+
+  /// @brief The maximal number of records of each thread's ring
+  const std::size_t m_ring_capacity;
+
+  /// @brief Protect the list of rings
+  mutable std::mutex m_mutex;
+
+  /// @brief The ring of each thread
+  std::vector<std::pair<std::thread::id, std::unique_ptr<trace_ring>>> m_rings;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A tracing policy which stores timestamped records in the calling thread's ring
+///
+/// Use it as the last template parameter of ntc::encoder or ntc::decoder, then periodically call
+/// trace_collector::drain from another thread.
+/// @ingroup ntc
+class NTC_PUBLIC ring_tracing final
+{
+public:
+
+  /// @brief Constructor
+  /// @param collector Where records are stored
+  /// @param tag Copied in all records, to tell apart encoders and decoders sharing a collector
+  explicit ring_tracing(trace_collector& collector, std::uint32_t tag = 0)
+  noexcept
+    : m_collector(&collector)
+    , m_tag{tag}
+  {}
+
+  /// @brief Record an event
+  void
+  operator()(trace_event event, std::uint32_t id, std::uint32_t size)
+  const
+  {
+    using namespace std::chrono;
+    const auto date = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    m_collector->local_ring().push(trace_record{date, id, size, m_tag, event});
+  }
+
+  /// @brief Get the tag copied in all records
+  std::uint32_t
+  tag()
+  const noexcept
+  {
+    return m_tag;
+  }
+
+private:
+
+  /// @brief Where records are stored
+  trace_collector* m_collector;
+
+  /// @brief Copied in all records
+  std::uint32_t m_tag;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
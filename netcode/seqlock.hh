@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>     // memcpy
+#include <type_traits> // is_trivially_copyable
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Publish a plain value from one thread, read it from any number of other threads
+///
+/// The writer never waits. A reader retries while a write is in progress, thus it always gets a
+/// consistent copy, never a mix of two values. Typically used to monitor an encoder or a decoder
+/// from another thread:
+/// @code
+/// // Owner of the encoder, e.g. after each batch.
+/// lock.store(encoder.statistics());
+/// // Monitoring thread.
+/// const auto stats = lock.load();
+/// @endcode
+/// @tparam T A trivially copyable type, e.g. encoder_statistics or decoder_statistics
+/// @attention Only one thread at a time may call store()
+/// @ingroup ntc_statistics
+template <typename T>
+class seqlock final
+{
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+public:
+
+  /// @brief Can't copy-construct a seqlock
+  seqlock(const seqlock&) = delete;
+
+  /// @brief Can't copy a seqlock
+  seqlock& operator=(const seqlock&) = delete;
+
+  /// @brief Constructor, publishes a value-initialized T
+  seqlock()
+    : m_sequence{0}
+  {
+    store(T{});
+  }
+
+  /// @brief Publish a new value
+  void
+  store(const T& value)
+  noexcept
+  {
+    std::uint64_t words[nb_words] = {};
+    std::memcpy(words, &value, sizeof(T));
+
+    const auto seq = m_sequence.load(std::memory_order_relaxed);
+    // An odd sequence tells readers that a write is in progress.
+    m_sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (auto i = 0ul; i < nb_words; ++i)
+    {
+      m_words[i].store(words[i], std::memory_order_relaxed);
+    }
+    m_sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  /// @brief Get a copy of the last published value
+  T
+  load()
+  const noexcept
+  {
+    std::uint64_t words[nb_words];
+    while (true)
+    {
+      const auto before = m_sequence.load(std::memory_order_acquire);
+      if (before % 2 != 0)
+      {
+        continue;
+      }
+      for (auto i = 0ul; i < nb_words; ++i)
+      {
+        words[i] = m_words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (m_sequence.load(std::memory_order_relaxed) == before)
+      {
+        break;
+      }
+    }
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+private:
+
+  /// @brief The number of words needed to store a T
+  static constexpr std::size_t nb_words = (sizeof(T) + sizeof(std::uint64_t) - 1)
+                                        / sizeof(std::uint64_t);
+
+  /// @brief Incremented before and after each write
+  std::atomic<std::uint64_t> m_sequence;
+
+  /// @brief The published value, stored in words which can be read while they are written
+  std::atomic<std::uint64_t> m_words[nb_words];
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,370 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <tuple>         // forward_as_tuple
+#include <unordered_map>
+#include <utility>       // piecewise_construct
+
+#include "netcode/detail/flow.hh"
+#include "netcode/detail/packet_type.hh"
+#include "netcode/detail/visibility.hh"
+#include "netcode/data.hh"
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/errors.hh"
+#include "netcode/in_order.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Host an encoder and a decoder for each of many flows
+///
+/// Each packet sent or received by a session_table starts with a 4 bytes flow header, which holds
+/// the identifier of the flow in network byte order. Incoming packets are dispatched to the
+/// session of their flow in constant time.
+///
+/// All sessions share the Galois field of the calling thread and the user's handlers. The
+/// PacketHandler receives packets of all flows, flow header included. The DataHandler is called
+/// with the flow identifier as its first parameter. Decoding memory is only allocated by sessions
+/// which need it, thus an idle session costs a few hundred bytes.
+///
+/// Any peer can open sessions by sending packets with new flow identifiers. Use set_max_sessions or
+/// set_admission_handler to bound the memory they can take.
+/// @ingroup ntc
+template <typename PacketHandler, typename DataHandler>
+class NTC_PUBLIC session_table final
+{
+public:
+
+  /// @brief The type of the handler that processes data ready to be sent on the network
+  using packet_handler_type = PacketHandler;
+
+  /// @brief The type of the handler that processes decoded or received data
+  using data_handler_type = DataHandler;
+
+  /// @brief The type of an encoder of a session
+  using encoder_type = ntc::encoder<detail::flow_packet_handler<packet_handler_type>>;
+
+  /// @brief The type of a decoder of a session
+  using decoder_type = ntc::decoder< detail::flow_packet_handler<packet_handler_type>
+                                   , detail::flow_data_handler<data_handler_type>>;
+
+  /// @brief The encoder and the decoder of a flow
+  class session final
+  {
+  public:
+
+    /// @brief Constructor
+    session( std::uint8_t galois_field_size, in_order ordered, packet_handler_type& packet_handler
+           , data_handler_type& data_handler, std::uint32_t id)
+      : m_encoder{ galois_field_size
+                 , detail::flow_packet_handler<packet_handler_type>{packet_handler, id}}
+      , m_decoder{ galois_field_size, ordered
+                 , detail::flow_packet_handler<packet_handler_type>{packet_handler, id}
+                 , detail::flow_data_handler<data_handler_type>{data_handler, id}}
+    {}
+
+    /// @brief Get the encoder which sends data on this flow
+    encoder_type&
+    encoder()
+    noexcept
+    {
+      return m_encoder;
+    }
+
+    /// @brief Get the encoder which sends data on this flow
+    const encoder_type&
+    encoder()
+    const noexcept
+    {
+      return m_encoder;
+    }
+
+    /// @brief Get the decoder which receives data from this flow
+    decoder_type&
+    decoder()
+    noexcept
+    {
+      return m_decoder;
+    }
+
+    /// @brief Get the decoder which receives data from this flow
+    const decoder_type&
+    decoder()
+    const noexcept
+    {
+      return m_decoder;
+    }
+
+  private:
+
+    /// @brief Send data on this flow
+    encoder_type m_encoder;
+
+    /// @brief Receive data from this flow
+    decoder_type m_decoder;
+  };
+
+public:
+
+  /// @brief Can't copy-construct a session table
+  session_table(const session_table&) = delete;
+
+  /// @brief Can't copy a session table
+  session_table& operator=(const session_table&) = delete;
+
+  /// @brief Can't move-construct a session table
+  session_table(session_table&&) = delete;
+
+  /// @brief Can't move a session table
+  session_table& operator=(session_table&&) = delete;
+
+  /// @brief Constructor
+  /// @param galois_field_size The size of the Galois field used by all sessions
+  /// @param ordered Tell if the decoders of all sessions give data in order
+  /// @param packet_handler The handler which sends packets of all flows
+  /// @param data_handler The handler which receives data of all flows
+  template <typename PacketHandler_, typename DataHandler_>
+  session_table( std::uint8_t galois_field_size, in_order ordered
+               , PacketHandler_&& packet_handler, DataHandler_&& data_handler)
+    : m_galois_field_size{galois_field_size}
+    , m_in_order{ordered}
+    , m_packet_handler(std::forward<PacketHandler_>(packet_handler))
+    , m_data_handler(std::forward<DataHandler_>(data_handler))
+    , m_sessions{}
+    , m_new_session_handler{}
+    , m_admission_handler{}
+    , m_max_sessions{0}
+  {}
+
+  /// @brief Get the session of a flow, create it if needed
+  session&
+  open(std::uint32_t id)
+  {
+    const auto res = m_sessions.emplace( std::piecewise_construct
+                                       , std::forward_as_tuple(id)
+                                       , std::forward_as_tuple( m_galois_field_size, m_in_order
+                                                              , m_packet_handler, m_data_handler
+                                                              , id));
+    if (res.second and m_new_session_handler)
+    {
+      m_new_session_handler(id, res.first->second);
+    }
+    return res.first->second;
+  }
+
+  /// @brief Get the session of a flow
+  /// @return nullptr if there's no such session
+  session*
+  find(std::uint32_t id)
+  noexcept
+  {
+    const auto search = m_sessions.find(id);
+    return search != m_sessions.end() ? &search->second : nullptr;
+  }
+
+  /// @brief Remove the session of a flow
+  /// @return false if there was no such session
+  bool
+  close(std::uint32_t id)
+  {
+    return m_sessions.erase(id) != 0;
+  }
+
+  /// @brief Get the number of sessions
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_sessions.size();
+  }
+
+  /// @brief Give data to send on a flow, create its session if needed
+  void
+  operator()(std::uint32_t id, data&& d)
+  {
+    open(id).encoder()(std::move(d));
+  }
+
+  /// @brief Notify the table of an incoming packet, flow header included
+  /// @return The number of bytes that have been read (0 if the packet was not decoded)
+  /// @throw packet_type_error
+  ///
+  /// Sources and repairs create the session of their flow if needed and if it's admitted (see
+  /// set_max_sessions and set_admission_handler), which is then configured by the handler given to
+  /// set_new_session_handler. Packets of refused flows and acks of unknown flows are ignored.
+  /// @note Sources and repairs are read in place (see decoder) if the byte following the flow
+  /// header is located ntc::packet::shift bytes after a 16-bytes boundary.
+  std::size_t
+  operator()(const char* data, std::size_t size)
+  {
+    if (size <= detail::flow_header_size)
+    {
+      throw packet_type_error{packet(data, data + size)};
+    }
+    const auto id = detail::read_flow_id(data);
+    const auto payload = data + detail::flow_header_size;
+    const auto payload_size = size - detail::flow_header_size;
+
+    std::size_t nb_read = 0;
+    if (detail::get_packet_type(payload, payload_size) == detail::packet_type::ack)
+    {
+      const auto search = m_sessions.find(id);
+      if (search == m_sessions.end())
+      {
+        return 0;
+      }
+      nb_read = search->second.encoder()(payload, payload_size);
+    }
+    else
+    {
+      auto s = find(id);
+      if (not s)
+      {
+        if (not admit(id))
+        {
+          return 0;
+        }
+        s = &open(id);
+      }
+      nb_read = s->decoder()(payload, payload_size);
+    }
+    return nb_read != 0 ? nb_read + detail::flow_header_size : 0;
+  }
+
+  /// @brief Notify the table of an incoming packet, flow header included
+  /// @return The number of bytes that have been read (0 if the packet was not decoded)
+  /// @throw packet_type_error
+  /// @attention The flow header moves the symbol of a source or a repair 4 bytes away from the
+  /// alignment of a ntc::packet, thus @p p is always copied by the decoder. To read packets in
+  /// place, receive them in a buffer where the byte following the flow header is located
+  /// ntc::packet::shift bytes after a 16-bytes boundary, and give it to
+  /// operator()(const char*, std::size_t).
+  std::size_t
+  operator()(const packet& p)
+  {
+    return operator()(p.data(), p.size());
+  }
+
+  /// @brief Set the handler called when a session is created
+  ///
+  /// It's the place to configure the encoder and the decoder of a new session.
+  session_table&
+  set_new_session_handler(std::function<void(std::uint32_t, session&)> handler)
+  {
+    m_new_session_handler = std::move(handler);
+    return *this;
+  }
+
+  /// @brief Set the maximal number of sessions created by incoming packets, unbounded if 0
+  ///
+  /// When the table holds that many sessions, packets of unknown flows are ignored. Sessions opened
+  /// by the application are always created.
+  session_table&
+  set_max_sessions(std::size_t max)
+  noexcept
+  {
+    m_max_sessions = max;
+    return *this;
+  }
+
+  /// @brief Get the maximal number of sessions created by incoming packets, unbounded if 0
+  std::size_t
+  max_sessions()
+  const noexcept
+  {
+    return m_max_sessions;
+  }
+
+  /// @brief Set the handler which tells if an incoming packet of an unknown flow opens a session
+  ///
+  /// It's called with the flow identifier, if set_max_sessions allows a new session. When it
+  /// returns false, the packet is ignored.
+  session_table&
+  set_admission_handler(std::function<bool(std::uint32_t)> handler)
+  {
+    m_admission_handler = std::move(handler);
+    return *this;
+  }
+
+  /// @brief Get the packet handler
+  const packet_handler_type&
+  packet_handler()
+  const noexcept
+  {
+    return m_packet_handler;
+  }
+
+  /// @brief Get the packet handler
+  packet_handler_type&
+  packet_handler()
+  noexcept
+  {
+    return m_packet_handler;
+  }
+
+  /// @brief Get the data handler
+  const data_handler_type&
+  data_handler()
+  const noexcept
+  {
+    return m_data_handler;
+  }
+
+  /// @brief Get the data handler
+  data_handler_type&
+  data_handler()
+  noexcept
+  {
+    return m_data_handler;
+  }
+
+private:
+
+  /// @brief Tell if an incoming packet of an unknown flow opens a session
+  bool
+  admit(std::uint32_t id)
+  {
+    if (m_max_sessions != 0 and m_sessions.size() >= m_max_sessions)
+    {
+      return false;
+    }
+    return not m_admission_handler or m_admission_handler(id);
+  }
+
+private:
+
+  /// @brief The Galois field size of all sessions
+  const std::uint8_t m_galois_field_size;
+
+  /// @brief Tell if decoders give data in order
+  const in_order m_in_order;
+
+  /// @brief The user's handler to output data on network
+  packet_handler_type m_packet_handler;
+
+  /// @brief The user's handler to read decoded data
+  data_handler_type m_data_handler;
+
+  /// @brief All sessions, indexed by flow identifier
+  ///
+  /// Sessions hold pointers to the handlers of this table and can't be moved, which is fine as
+  /// std::unordered_map never moves its elements.
+  std::unordered_map<std::uint32_t, session> m_sessions;
+
+  /// @brief Called when a session is created
+  std::function<void(std::uint32_t, session&)> m_new_session_handler;
+
+  /// @brief Tell if an incoming packet of an unknown flow opens a session
+  std::function<bool(std::uint32_t)> m_admission_handler;
+
+  /// @brief The maximal number of sessions created by incoming packets, unbounded if 0
+  std::size_t m_max_sessions;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
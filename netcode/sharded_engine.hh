@@ -0,0 +1,545 @@
+#pragma once
+
+#include <algorithm> // max
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "netcode/detail/flow.hh"
+#include "netcode/detail/spsc_queue.hh"
+#include "netcode/detail/visibility.hh"
+#include "netcode/data.hh"
+#include "netcode/in_order.hh"
+#include "netcode/packet.hh"
+#include "netcode/session_table.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Run sessions of many flows on several worker threads
+///
+/// Flows are hashed to shards, each holding a session_table. A shard is processed by at most one
+/// worker at a time, thus encoders and decoders are never shared between threads. Each shard has
+/// its own copy of the user's handlers, which are called by the worker currently processing it.
+///
+/// Producers (e.g. threads reading sockets) give packets and data to shards through lock-free
+/// single-producer single-consumer queues, one per producer and per shard. Each producer shall be
+/// used by only one thread at a time.
+///
+/// Shards are assigned to workers in a round-robin fashion. If work stealing is enabled, a worker
+/// without pending work processes shards of other workers. As a flow is always processed
+/// sequentially, a single hot flow can't use more than one core; stealing spreads the other flows
+/// of a busy worker. A worker which finds no work for a while sleeps until something is pushed.
+///
+/// Invalid incoming packets are dropped. Any other exception thrown while processing a task, e.g.
+/// by a user's handler, is given to the error handler (see set_error_handler()), then the task is
+/// dropped and the worker goes on.
+/// @ingroup ntc
+template <typename PacketHandler, typename DataHandler>
+class NTC_PUBLIC sharded_engine final
+{
+public:
+
+  /// @brief The type of the sessions tables of shards
+  using session_table_type = session_table<PacketHandler, DataHandler>;
+
+  /// @brief The engine configuration
+  struct configuration
+  {
+    /// @brief The number of worker threads
+    std::size_t nb_workers = std::max(1u, std::thread::hardware_concurrency());
+
+    /// @brief The number of threads giving packets and data to the engine
+    std::size_t nb_producers = 1;
+
+    /// @brief The number of shards per worker
+    ///
+    /// More shards make work stealing more effective, fewer shards make workers scan less queues.
+    std::size_t nb_shards_per_worker = 8;
+
+    /// @brief The capacity of each queue between a producer and a shard
+    std::size_t queue_capacity = 1024;
+
+    /// @brief Let idle workers process shards of other workers
+    bool work_stealing = true;
+  };
+
+  /// @brief Can't copy-construct an engine
+  sharded_engine(const sharded_engine&) = delete;
+
+  /// @brief Can't copy an engine
+  sharded_engine& operator=(const sharded_engine&) = delete;
+
+  /// @brief Can't move-construct an engine
+  sharded_engine(sharded_engine&&) = delete;
+
+  /// @brief Can't move an engine
+  sharded_engine& operator=(sharded_engine&&) = delete;
+
+  /// @brief Constructor
+  /// @param conf The engine configuration
+  /// @param galois_field_size The size of the Galois field used by all sessions
+  /// @param ordered Tell if decoders give data in order
+  /// @param packet_handler Copied for each shard
+  /// @param data_handler Copied for each shard
+  ///
+  /// Workers are not started, as sessions tables may need to be configured first (see shard()).
+  sharded_engine( const configuration& conf, std::uint8_t galois_field_size, in_order ordered
+                , const PacketHandler& packet_handler, const DataHandler& data_handler)
+    : m_conf(conf)
+    , m_shards{}
+    , m_workers{}
+    , m_running{false}
+    , m_error_handler{}
+    , m_mutex{}
+    , m_condition{}
+    , m_nb_sleeping{0}
+  {
+    assert(m_conf.nb_workers > 0);
+    assert(m_conf.nb_producers > 0);
+    assert(m_conf.nb_shards_per_worker > 0);
+    const auto nb_shards = m_conf.nb_workers * m_conf.nb_shards_per_worker;
+    m_shards.reserve(nb_shards);
+    for (auto i = 0ul; i < nb_shards; ++i)
+    {
+      m_shards.emplace_back(new shard_impl{ m_conf, galois_field_size, ordered, packet_handler
+                                     , data_handler});
+    }
+  }
+
+  /// @brief Destructor, stop workers
+  ~sharded_engine()
+  {
+    stop();
+  }
+
+  /// @brief Launch worker threads
+  void
+  start()
+  {
+    if (m_running.exchange(true))
+    {
+      return;
+    }
+    for (auto i = 0ul; i < m_conf.nb_workers; ++i)
+    {
+      m_workers.emplace_back([this, i]{work(i);});
+    }
+  }
+
+  /// @brief Wait for workers to process all pending work, then stop them
+  void
+  stop()
+  {
+    if (not m_running.exchange(false))
+    {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_condition.notify_all();
+    }
+    for (auto& worker : m_workers)
+    {
+      worker.join();
+    }
+    m_workers.clear();
+  }
+
+  /// @brief Give an incoming packet, flow header included
+  /// @param producer The index of the calling producer
+  /// @param p The packet
+  /// @return false if the queue of the packet's shard is full, in which case @p p is untouched
+  /// @throw packet_type_error if @p p is too small to hold a flow header
+  bool
+  push(std::size_t producer, packet&& p)
+  {
+    if (p.size() <= detail::flow_header_size)
+    {
+      throw packet_type_error{std::move(p)};
+    }
+    const auto id = detail::read_flow_id(p.data());
+    return wake(shard_of(id).queue(producer).try_emplace(id, std::move(p), data{}));
+  }
+
+  /// @brief Give data to send on a flow
+  /// @param producer The index of the calling producer
+  /// @param id The flow identifier
+  /// @param d The data
+  /// @return false if the queue of the flow's shard is full, in which case @p d is untouched
+  bool
+  push(std::size_t producer, std::uint32_t id, data&& d)
+  {
+    return wake(shard_of(id).queue(producer).try_emplace(id, packet{}, std::move(d)));
+  }
+
+  /// @brief Get the number of shards
+  std::size_t
+  nb_shards()
+  const noexcept
+  {
+    return m_shards.size();
+  }
+
+  /// @brief Get the sessions table of a shard
+  /// @attention Shall not be called while workers are running
+  session_table_type&
+  shard(std::size_t i)
+  noexcept
+  {
+    assert(not m_running);
+    return m_shards[i]->table;
+  }
+
+  /// @brief Get the index of the shard of a flow
+  std::size_t
+  shard_index(std::uint32_t id)
+  const noexcept
+  {
+    // Flow identifiers may be allocated sequentially or with a common suffix, mix their bits.
+    auto h = static_cast<std::uint64_t>(id) * 0x9E3779B97F4A7C15ull;
+    return static_cast<std::size_t>((h >> 32) % m_shards.size());
+  }
+
+  /// @brief Set the handler of exceptions thrown while processing a task
+  /// @param handler A callable with the signature void(std::uint32_t, std::exception_ptr), called
+  /// by workers with the flow identifier of the dropped task; it shall not throw
+  /// @attention Shall not be called while workers are running
+  template <typename Handler>
+  void
+  set_error_handler(Handler&& handler)
+  {
+    assert(not m_running);
+    m_error_handler = std::forward<Handler>(handler);
+  }
+
+  /// @brief Get the number of tasks dropped because an exception was thrown while processing them
+  /// @note While workers run, the result may be outdated as soon as it's returned.
+  std::size_t
+  nb_errors()
+  const noexcept
+  {
+    auto res = 0ul;
+    for (const auto& s : m_shards)
+    {
+      res += s->nb_errors.load(std::memory_order_relaxed);
+    }
+    return res;
+  }
+
+  /// @brief Get the number of tasks processed by a worker on shards of other workers
+  /// @note While workers run, the result may be outdated as soon as it's returned.
+  std::size_t
+  nb_stolen()
+  const noexcept
+  {
+    auto res = 0ul;
+    for (const auto& s : m_shards)
+    {
+      res += s->nb_stolen.load(std::memory_order_relaxed);
+    }
+    return res;
+  }
+
+private:
+
+  /// @brief Some data to send or an incoming packet
+  struct task
+  {
+    /// @brief The flow identifier
+    std::uint32_t id;
+
+    /// @brief The incoming packet, if not empty
+    packet pkt;
+
+    /// @brief The data to send, if pkt is empty
+    data d;
+  };
+
+  /// @brief A subset of flows
+  struct shard_impl
+  {
+    shard_impl( const configuration& conf, std::uint8_t galois_field_size, in_order ordered
+              , const PacketHandler& packet_handler, const DataHandler& data_handler)
+      : table{galois_field_size, ordered, packet_handler, data_handler}
+      , queues{}
+      , busy{false}
+      , nb_stolen{0}
+      , nb_errors{0}
+    {
+      queues.reserve(conf.nb_producers);
+      for (auto i = 0ul; i < conf.nb_producers; ++i)
+      {
+        queues.emplace_back(new detail::spsc_queue<task>{conf.queue_capacity});
+      }
+    }
+
+    /// @brief Get the queue of a producer
+    detail::spsc_queue<task>&
+    queue(std::size_t producer)
+    noexcept
+    {
+      assert(producer < queues.size());
+      return *queues[producer];
+    }
+
+    /// @brief The sessions of this shard's flows
+    session_table_type table;
+
+    /// @brief One queue per producer
+    std::vector<std::unique_ptr<detail::spsc_queue<task>>> queues;
+
+    /// @brief Tell if a worker is processing this shard
+    std::atomic<bool> busy;
+
+    /// @brief The number of tasks processed by workers which don't own this shard
+    ///
+    /// Only a statistic, thus it's not ordered with anything else.
+    std::atomic<std::size_t> nb_stolen;
+
+    /// @brief The number of tasks dropped because of an exception, only a statistic
+    std::atomic<std::size_t> nb_errors;
+  };
+
+  /// @brief Let other workers process a shard, even if processing it throws
+  struct release_shard
+  {
+    ~release_shard()
+    {
+      s.busy.store(false, std::memory_order_release);
+    }
+
+    shard_impl& s;
+  };
+
+  /// @brief Get the shard of a flow
+  shard_impl&
+  shard_of(std::uint32_t id)
+  noexcept
+  {
+    return *m_shards[shard_index(id)];
+  }
+
+  /// @brief Process pending tasks of a shard, if no other worker does
+  /// @return The number of processed tasks
+  std::size_t
+  process(shard_impl& s, bool stolen)
+  {
+    auto expected = false;
+    if (not s.busy.compare_exchange_strong(expected, true, std::memory_order_acquire))
+    {
+      return 0;
+    }
+
+    const release_shard release{s};
+
+    // Bound the work done on a shard to be fair with other ones.
+    static constexpr auto max_batch = 64ul;
+    auto nb = 0ul;
+    task t;
+    for (auto& q : s.queues)
+    {
+      for (auto i = 0ul; i < max_batch and q->try_pop(t); ++i, ++nb)
+      {
+        try
+        {
+          if (not t.pkt.empty())
+          {
+            s.table(t.pkt.data(), t.pkt.size());
+          }
+          else
+          {
+            s.table(t.id, std::move(t.d));
+          }
+        }
+        catch (const packet_type_error&)
+        {
+          // Drop invalid packets, as the network can deliver anything.
+        }
+        catch (const overflow_error&)
+        {
+        }
+        catch (...)
+        {
+          // An exception escaping a worker would terminate the program.
+          s.nb_errors.fetch_add(1, std::memory_order_relaxed);
+          if (m_error_handler)
+          {
+            m_error_handler(t.id, std::current_exception());
+          }
+        }
+      }
+    }
+    if (stolen)
+    {
+      s.nb_stolen.fetch_add(nb, std::memory_order_relaxed);
+    }
+    return nb;
+  }
+
+  /// @brief Tell if all queues of a shard are empty
+  static
+  bool
+  idle(const shard_impl& s)
+  noexcept
+  {
+    for (const auto& q : s.queues)
+    {
+      if (not q->empty())
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// @brief Tell if a worker may find something to do
+  bool
+  has_work(std::size_t worker)
+  const noexcept
+  {
+    const auto step = m_conf.work_stealing ? 1 : m_conf.nb_workers;
+    for (auto i = m_conf.work_stealing ? 0 : worker; i < m_shards.size(); i += step)
+    {
+      if (not idle(*m_shards[i]))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// @brief Wake sleeping workers if a task was pushed
+  /// @param pushed Tell if a task was pushed
+  /// @return @p pushed
+  bool
+  wake(bool pushed)
+  {
+    if (pushed)
+    {
+      // Pairs with the fence of sleep(): either the worker sees the new task, or the producer sees
+      // that it's sleeping.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (m_nb_sleeping.load(std::memory_order_relaxed) > 0)
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_condition.notify_all();
+      }
+    }
+    return pushed;
+  }
+
+  /// @brief Put a worker to sleep until it may find something to do or the engine is stopped
+  void
+  sleep(std::size_t worker)
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_nb_sleeping.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_condition.wait(lock, [&]
+                           {
+                             return not m_running.load(std::memory_order_relaxed)
+                                 or has_work(worker);
+                           });
+    m_nb_sleeping.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /// @brief The loop of a worker
+  void
+  work(std::size_t worker)
+  {
+    // Yield a few times before sleeping, as new tasks usually follow closely.
+    static constexpr auto max_idle_rounds = 64u;
+    auto nb_idle_rounds = 0u;
+    const auto nb_workers = m_conf.nb_workers;
+    while (true)
+    {
+      // Shards are assigned to workers in a round-robin fashion.
+      auto nb = 0ul;
+      for (auto i = worker; i < m_shards.size(); i += nb_workers)
+      {
+        nb += process(*m_shards[i], false);
+      }
+
+      if (nb == 0 and m_conf.work_stealing)
+      {
+        for (auto i = 0ul; i < m_shards.size(); ++i)
+        {
+          if (i % nb_workers != worker)
+          {
+            nb += process(*m_shards[i], true);
+          }
+        }
+      }
+
+      if (nb == 0)
+      {
+        if (not m_running.load(std::memory_order_acquire))
+        {
+          // Make sure that nothing was pushed between the last scan and the end of the engine.
+          auto all_idle = true;
+          for (auto i = worker; i < m_shards.size(); i += nb_workers)
+          {
+            all_idle = all_idle and idle(*m_shards[i]);
+          }
+          if (all_idle)
+          {
+            return;
+          }
+        }
+        else if (++nb_idle_rounds < max_idle_rounds)
+        {
+          std::this_thread::yield();
+        }
+        else
+        {
+          // A shard held by another worker may keep this one awake until it's released.
+          sleep(worker);
+          nb_idle_rounds = 0;
+        }
+      }
+      else
+      {
+        nb_idle_rounds = 0;
+      }
+    }
+  }
+
+private:
+
+  /// @brief The engine configuration
+  const configuration m_conf;
+
+  /// @brief All shards
+  std::vector<std::unique_ptr<shard_impl>> m_shards;
+
+  /// @brief Worker threads
+  std::vector<std::thread> m_workers;
+
+  /// @brief Tell if workers should keep running
+  std::atomic<bool> m_running;
+
+  /// @brief Called with exceptions thrown while processing a task
+  std::function<void(std::uint32_t, std::exception_ptr)> m_error_handler;
+
+  /// @brief Protects the sleep of workers
+  std::mutex m_mutex;
+
+  /// @brief Wakes up sleeping workers
+  std::condition_variable m_condition;
+
+  /// @brief The number of workers sleeping or about to
+  std::atomic<std::size_t> m_nb_sleeping;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
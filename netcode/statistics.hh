@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A snapshot of the counters and of the state of an encoder
+///
+/// Plain data, cheap to copy. Publish it with a seqlock to read it from another thread.
+/// @see encoder::statistics()
+/// @ingroup ntc_statistics
+struct encoder_statistics
+{
+  /// @brief The number of sent sources
+  std::uint64_t nb_sent_sources;
+
+  /// @brief The number of sent repairs
+  std::uint64_t nb_sent_repairs;
+
+  /// @brief The number of received acks
+  std::uint64_t nb_received_acks;
+
+  /// @brief The number of bytes given to the packet handler
+  std::uint64_t nb_sent_bytes;
+
+  /// @brief The number of bytes of received acks
+  std::uint64_t nb_received_bytes;
+
+  /// @brief The number of repairs sent for each source
+  double repair_overhead;
+
+  /// @brief The number of sources which have not been acknowledged
+  std::uint64_t window;
+
+  /// @brief The maximal number of sources which are kept, as chosen by the adaptive mode if set
+  std::uint64_t window_size;
+
+  /// @brief How many sources are sent before a repair is generated
+  std::uint64_t rate;
+
+  /// @brief The loss rate of the channel, as estimated by the adaptive mode
+  double estimated_loss_rate;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A snapshot of the counters and of the state of a decoder
+///
+/// Plain data, cheap to copy. Publish it with a seqlock to read it from another thread.
+/// @see decoder::statistics()
+/// @ingroup ntc_statistics
+struct decoder_statistics
+{
+  /// @brief The number of received sources
+  std::uint64_t nb_received_sources;
+
+  /// @brief The number of received repairs
+  std::uint64_t nb_received_repairs;
+
+  /// @brief The number of sent acks
+  std::uint64_t nb_sent_acks;
+
+  /// @brief The number of bytes of received packets
+  std::uint64_t nb_received_bytes;
+
+  /// @brief The number of bytes given to the packet handler
+  std::uint64_t nb_sent_bytes;
+
+  /// @brief The number of decoded sources
+  std::uint64_t nb_decoded;
+
+  /// @brief The number of times a full decoding failed
+  std::uint64_t nb_failed_full_decodings;
+
+  /// @brief The number of repairs dropped because they were useless
+  std::uint64_t nb_useless_repairs;
+
+  /// @brief The number of sources currently known to be missing
+  std::uint64_t nb_missing_sources;
+
+  /// @brief The number of sources currently kept to decode future repairs
+  std::uint64_t nb_held_sources;
+
+  /// @brief The number of repairs currently kept to decode missing sources
+  std::uint64_t nb_held_repairs;
+
+  /// @brief The number of sources currently waiting for older ones to be given in order
+  std::uint64_t nb_ordered_sources;
+
+  /// @brief The number of measured full decodings, 0 if histograms are disabled
+  std::uint64_t nb_full_decodings;
+
+  /// @brief The mean time spent by a full decoding, in nanoseconds
+  double full_decoding_mean_ns;
+
+  /// @brief The 99th percentile of the time spent by a full decoding, in nanoseconds
+  std::uint64_t full_decoding_p99_ns;
+
+  /// @brief The maximal time spent by a full decoding, in nanoseconds
+  std::uint64_t full_decoding_max_ns;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
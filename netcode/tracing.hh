@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#include "netcode/detail/visibility.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The events reported by encoders and decoders to their tracing policy
+/// @see no_tracing
+/// @see ring_tracing
+/// @ingroup ntc
+enum class trace_event : std::uint8_t
+{
+  /// @brief An encoder sent a new source (id: source, size: data size)
+  source_committed,
+  /// @brief An encoder sent a repair (id: repair, size: symbol size)
+  repair_emitted,
+  /// @brief An encoder received an ack (id: number of acknowledged sources, size: packet size)
+  ack_received,
+  /// @brief A decoder received a source (id: source, size: packet size)
+  source_received,
+  /// @brief A decoder received a repair (id: repair, size: packet size)
+  repair_received,
+  /// @brief A decoder dropped a repair which didn't encode any missing source (id: repair)
+  repair_useless,
+  /// @brief A decoder could not invert its matrix of coefficients (id: number of failures)
+  inversion_failure,
+  /// @brief A decoder gave a received or decoded source to its data handler (id: source)
+  source_delivered,
+  /// @brief A decoder sent an ack (id: number of acknowledged sources)
+  ack_sent,
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The default tracing policy, which does nothing
+///
+/// A tracing policy is a callable with the same signature as this one. Encoders and decoders call
+/// it on each event, thus it should be fast and shouldn't throw. As calls to this policy are
+/// inlined and empty, tracing costs nothing when it's not used.
+/// @ingroup ntc
+struct NTC_PUBLIC no_tracing
+{
+  /// @brief Called on each event
+  /// @param event What happened
+  /// @param id An identifier or a count, depending on @p event
+  /// @param size A size in bytes, depending on @p event
+  void
+  operator()(trace_event /*event*/, std::uint32_t /*id*/, std::uint32_t /*size*/)
+  const noexcept
+  {}
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
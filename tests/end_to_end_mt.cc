@@ -1,35 +1,36 @@
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <iostream>
 #include <mutex>
-#include <queue>
 #include <thread>
-#include <vector>
 
 #include <netcode/decoder.hh>
 #include <netcode/encoder.hh>
+#include <netcode/packet_queue.hh>
 
 #include "tools/loss/burst.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
 static constexpr auto buffer_sz = 4096ul;
-using queue_type = std::queue<std::vector<char>>;
+static constexpr auto queue_capacity = 4096ul;
+using queue_type = ntc::spsc_packet_queue;
 
 /*------------------------------------------------------------------------------------------------*/
 
 struct packet_handler
 {
-  std::vector<char> buffer;
+  ntc::packet buffer;
   loss::burst& loss;
   bool lost_current_packet;
   std::size_t nb_loss;
+  std::size_t nb_overflows;
   queue_type& queue;
-  std::mutex& mutex;
 
-  packet_handler(loss::burst& l, queue_type& q, std::mutex& m)
+  packet_handler(loss::burst& l, queue_type& q)
     : buffer(), loss(l), lost_current_packet(loss()), nb_loss(lost_current_packet ? 1u : 0u)
-    , queue(q), mutex(m)
+    , nb_overflows(0), queue(q)
   {
     buffer.reserve(buffer_sz);
   }
@@ -39,22 +40,22 @@ struct packet_handler
   {
     if (not lost_current_packet)
     {
-      std::copy_n(src, len, std::back_inserter(buffer));
+      const auto sz = buffer.size();
+      buffer.resize(sz + len);
+      std::copy_n(src, len, buffer.data() + sz);
     }
   }
 
   void
   operator()()
   {
+    // On success, buffer is replaced by an empty packet which was consumed by the other thread.
+    if (not lost_current_packet and not queue.try_push(buffer))
     {
-      std::lock_guard<std::mutex> lock{mutex};
-      if (not lost_current_packet)
-      {
-        queue.push(std::move(buffer));
-      }
+      // Like a full socket buffer.
+      ++nb_overflows;
     }
     buffer.clear();
-    buffer.reserve(buffer_sz);
     lost_current_packet = loss();
     nb_loss += lost_current_packet ? 1u : 0u;
   }
@@ -113,62 +114,47 @@ generate_data(std::uint32_t id, std::uint16_t packet_size)
 /*------------------------------------------------------------------------------------------------*/
 
 void
-encoder( queue_type& to_dec, std::mutex& to_dec_mutex, queue_type& to_enc, std::mutex& to_enc_mutex
-       , const bool* run, std::uint16_t packet_size)
+encoder( queue_type& to_dec, queue_type& to_enc, std::mutex& out_mutex, const std::atomic<bool>& run
+       , std::uint16_t packet_size)
 {
   loss::burst loss{85, 15};
-  ntc::encoder<packet_handler> enc{8, packet_handler{loss, to_dec, to_dec_mutex}};
+  ntc::encoder<packet_handler> enc{8, packet_handler{loss, to_dec}};
   std::uint32_t id = 0;
 
-  while (*run)
+  while (run)
   {
     enc(generate_data(id++, packet_size));
 
-    // Read ack if any.
-    {
-      std::lock_guard<std::mutex> lock{to_enc_mutex};
-      if (not to_enc.empty())
-      {
-        ntc::packet pkt{to_enc.front().data(), to_enc.front().data() + to_enc.front().size()};
-        enc(std::move(pkt));
-        to_enc.pop();
-      }
-    }
+    // Read acks if any.
+    to_enc.pop_batch([&](ntc::packet& ack){enc(std::move(ack));});
   }
 
-  std::lock_guard<std::mutex> out_lock{to_enc_mutex}; // to serialize output
+  std::lock_guard<std::mutex> out_lock{out_mutex}; // to serialize output
   std::cout << "Encoder\n";
   std::cout << "Sent " << (id + 1) << '\n';
   std::cout << "Lost " << enc.packet_handler().nb_loss << '\n';
+  std::cout << "Overflows " << enc.packet_handler().nb_overflows << '\n';
   std::cout << '\n';
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-decoder( queue_type& to_dec, std::mutex& to_dec_mutex, queue_type& to_enc, std::mutex& to_enc_mutex
-       , const bool* run, std::uint16_t packet_size)
+decoder( queue_type& to_dec, queue_type& to_enc, std::mutex& out_mutex, const std::atomic<bool>& run
+       , std::uint16_t packet_size)
 {
   loss::burst loss{85, 15};
   ntc::decoder<packet_handler, in_order_data_handler>
-    dec{ 8, ntc::in_order::yes, packet_handler{loss, to_enc, to_enc_mutex}
+    dec{ 8, ntc::in_order::yes, packet_handler{loss, to_enc}
        , in_order_data_handler{packet_size}};
 
-  while (*run)
+  while (run)
   {
-    // Read source or repair if any.
-    {
-      std::lock_guard<std::mutex> lock{to_dec_mutex};
-      if (not to_dec.empty())
-      {
-        ntc::packet pkt{to_dec.front().data(), to_dec.front().data() + to_dec.front().size()};
-        dec(std::move(pkt));
-        to_dec.pop();
-      }
-    }
+    // Read sources and repairs if any, in place: packets stay in the queue to be re-used.
+    to_dec.pop_batch([&](const ntc::packet& pkt){dec(pkt.data(), pkt.size());}, 64);
   }
 
-  std::lock_guard<std::mutex> out_lock{to_enc_mutex}; // to serialize output
+  std::lock_guard<std::mutex> out_lock{out_mutex}; // to serialize output
   std::cout << "Decoder\n";
   std::cout << "Handled data " << dec.data_handler().nb_received << '\n';
   std::cout << "Received repairs " << dec.nb_received_repairs() << '\n';
@@ -209,24 +195,20 @@ int main(int argc, char** argv)
     }
   }();
 
-  // Avoid warning with clang static analyser.
-  bool _run = true;
-  bool* run = &_run;
-
-  queue_type to_dec;
-  std::mutex to_dec_mutex;
+  std::atomic<bool> run{true};
 
-  queue_type to_enc;
-  std::mutex to_enc_mutex;
+  queue_type to_dec{queue_capacity};
+  queue_type to_enc{queue_capacity};
+  std::mutex out_mutex;
 
-  std::thread encoder_thread{ encoder, std::ref(to_dec), std::ref(to_dec_mutex), std::ref(to_enc)
-                            , std::ref(to_enc_mutex), run, packet_size};
-  std::thread decoder_thread{ decoder, std::ref(to_dec), std::ref(to_dec_mutex), std::ref(to_enc)
-                            , std::ref(to_enc_mutex), run, packet_size};
+  std::thread encoder_thread{ encoder, std::ref(to_dec), std::ref(to_enc), std::ref(out_mutex)
+                            , std::cref(run), packet_size};
+  std::thread decoder_thread{ decoder, std::ref(to_dec), std::ref(to_enc), std::ref(out_mutex)
+                            , std::cref(run), packet_size};
 
   std::this_thread::sleep_for(std::chrono::seconds{test_time});
 
-  *run = false;
+  run = false;
 
   encoder_thread.join();
   decoder_thread.join();
@@ -10,6 +10,7 @@ typedef struct
 
 /*------------------------------------------------------------------------------------------------*/
 
+inline
 void
 prepare_packet(void* c, const char* packet, size_t sz)
 {
@@ -20,6 +21,7 @@ prepare_packet(void* c, const char* packet, size_t sz)
 
 /*------------------------------------------------------------------------------------------------*/
 
+inline
 void
 send_packet(void* cxt)
 {
@@ -28,6 +30,7 @@ send_packet(void* cxt)
 
 /*------------------------------------------------------------------------------------------------*/
 
+inline
 void
 receive_data(void* cxt, const char* data, size_t sz)
 {
@@ -22,3 +22,34 @@ TEST_CASE("create/delete decoder")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("C decoder histograms")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    context cxt;
+    ntc_packet_handler packet_handler = {&cxt, prepare_packet, send_packet};
+    ntc_data_handler data_handler = {&cxt, receive_data};
+
+    auto* dec = ntc_new_decoder(gf_size, ntc_in_order_yes, packet_handler, data_handler);
+    REQUIRE(ntc_decoder_loss_to_recovery_histogram(dec) == nullptr);
+
+    ntc_error error;
+    ntc_decoder_set_histograms(dec, true, &error);
+    REQUIRE(error.type == ntc_no_error);
+
+    const auto* h = ntc_decoder_loss_to_recovery_histogram(dec);
+    REQUIRE(h != nullptr);
+    REQUIRE(ntc_histogram_count(h) == 0);
+    REQUIRE(ntc_histogram_percentile(h, 99.) == 0);
+    REQUIRE(ntc_decoder_in_order_hold_histogram(dec) != nullptr);
+    REQUIRE(ntc_decoder_full_decoding_histogram(dec) != nullptr);
+
+    ntc_decoder_set_histograms(dec, false, &error);
+    REQUIRE(ntc_decoder_full_decoding_histogram(dec) == nullptr);
+
+    ntc_delete_decoder(dec);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
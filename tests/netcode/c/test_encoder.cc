@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/launch.hh"
+#include "tests/netcode/c/handlers.h"
+
+#include "netcode/c/decoder.h"
+#include "netcode/c/encoder.h"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct iov_context
+{
+  std::vector<std::string> packets;
+  std::vector<std::size_t> nb_chunks;
+};
+
+void
+send_packet_iov(void* c, const struct iovec* iov, size_t iovcnt)
+{
+  auto& cxt = *static_cast<iov_context*>(c);
+  std::string packet;
+  for (auto i = 0ul; i < iovcnt; ++i)
+  {
+    packet.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+  }
+  cxt.packets.push_back(packet);
+  cxt.nb_chunks.push_back(iovcnt);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct data_context
+{
+  std::vector<std::string> data;
+  std::vector<const char*> released;
+};
+
+void
+read_data(void* c, const char* data, size_t sz)
+{
+  static_cast<data_context*>(c)->data.emplace_back(data, sz);
+}
+
+void
+release_data(void* c, const char* data)
+{
+  static_cast<data_context*>(c)->released.push_back(data);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("create/delete encoder")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    context cxt;
+    ntc_packet_handler packet_handler = {&cxt, prepare_packet, send_packet};
+    auto* enc = ntc_new_encoder(gf_size, packet_handler);
+    REQUIRE(enc != nullptr);
+    ntc_delete_encoder(enc);
+
+    iov_context iov_cxt;
+    auto* enc_iov = ntc_new_encoder_iov(gf_size, ntc_packet_iov_handler{&iov_cxt, send_packet_iov});
+    REQUIRE(enc_iov != nullptr);
+    ntc_delete_encoder(enc_iov);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("C batch entry points")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    iov_context enc_cxt;
+    iov_context dec_cxt;
+    data_context app;
+
+    auto* enc = ntc_new_encoder_iov(gf_size, ntc_packet_iov_handler{&enc_cxt, send_packet_iov});
+    ntc_encoder_set_rate(enc, 2);
+    auto* dec = ntc_new_decoder_iov( gf_size, ntc_in_order_yes
+                                   , ntc_packet_iov_handler{&dec_cxt, send_packet_iov}
+                                   , ntc_data_handler{&app, read_data});
+    ntc_decoder_set_ack_nb_packets(dec, 1000);
+
+    // Caller-owned, aligned buffers, read in place by the encoder.
+    alignas(16) char slab[4][64];
+    for (auto i = 0; i < 4; ++i)
+    {
+      std::fill_n(slab[i], 64, static_cast<char>('a' + i));
+    }
+    struct iovec views[2] = {{slab[0], 64}, {slab[1], 64}};
+    ntc_error error;
+    const auto release = ntc_release_handler{&app, release_data};
+    REQUIRE(ntc_encoder_add_data_views(enc, views, 2, release, &error) == 2);
+    REQUIRE(error.type == ntc_no_error);
+
+    // Copied buffers.
+    struct iovec copies[2] = {{slab[2], 64}, {slab[3], 64}};
+    REQUIRE(ntc_encoder_add_data_buffers(enc, copies, 2, &error) == 2);
+    REQUIRE(error.type == ntc_no_error);
+    REQUIRE(ntc_encoder_window(enc) == 4);
+    REQUIRE(app.released.empty());
+
+    // 4 sources and 2 repairs; symbols are given in place, headers are gathered.
+    REQUIRE(enc_cxt.packets.size() == 6);
+    REQUIRE(*std::max_element(enc_cxt.nb_chunks.begin(), enc_cxt.nb_chunks.end()) <= 5);
+
+    // Lose the first source, give all other packets at once to the decoder. The first repair is
+    // copied to be read in place.
+    alignas(16) char aligned[256];
+    const auto& repair = enc_cxt.packets[2];
+    REQUIRE(repair.size() + 9 <= sizeof(aligned));
+    std::copy(repair.begin(), repair.end(), aligned + 9);
+
+    std::vector<struct iovec> packets;
+    for (auto i = 1ul; i < enc_cxt.packets.size(); ++i)
+    {
+      if (i == 2)
+      {
+        packets.push_back({aligned + 9, repair.size()});
+      }
+      else
+      {
+        packets.push_back({&enc_cxt.packets[i][0], enc_cxt.packets[i].size()});
+      }
+    }
+    REQUIRE(ntc_decoder_add_packet_buffers(dec, packets.data(), packets.size(), &error)
+            == packets.size());
+    REQUIRE(error.type == ntc_no_error);
+    REQUIRE(app.data.size() == 4);
+    for (auto i = 0ul; i < 4; ++i)
+    {
+      REQUIRE(app.data[i] == std::string(slab[i], 64));
+    }
+
+    // The ack releases the buffers read in place.
+    ntc_decoder_generate_ack(dec, &error);
+    REQUIRE(dec_cxt.packets.size() == 1);
+    struct iovec ack = {&dec_cxt.packets[0][0], dec_cxt.packets[0].size()};
+    REQUIRE(ntc_encoder_add_packet_buffers(enc, &ack, 1, &error) == 1);
+    REQUIRE(error.type == ntc_no_error);
+    REQUIRE(ntc_encoder_window(enc) == 0);
+    REQUIRE(app.released.size() == 2);
+    REQUIRE(std::find(app.released.begin(), app.released.end(), slab[0]) != app.released.end());
+    REQUIRE(std::find(app.released.begin(), app.released.end(), slab[1]) != app.released.end());
+
+    // An invalid packet stops the batch.
+    char garbage[4] = {42, 0, 0, 0};
+    struct iovec bad[2] = {{garbage, 4}, {&enc_cxt.packets[0][0], enc_cxt.packets[0].size()}};
+    REQUIRE(ntc_decoder_add_packet_buffers(dec, bad, 2, &error) == 0);
+    REQUIRE(error.type == ntc_packet_type_error);
+
+    ntc_delete_decoder(dec);
+    ntc_delete_encoder(enc);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("C statistics snapshots")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    iov_context enc_cxt;
+    iov_context dec_cxt;
+    data_context app;
+
+    auto* enc = ntc_new_encoder_iov(gf_size, ntc_packet_iov_handler{&enc_cxt, send_packet_iov});
+    ntc_encoder_set_rate(enc, 1);
+    auto* dec = ntc_new_decoder_iov( gf_size, ntc_in_order_yes
+                                   , ntc_packet_iov_handler{&dec_cxt, send_packet_iov}
+                                   , ntc_data_handler{&app, read_data});
+
+    char data[16] = {};
+    struct iovec buffer = {data, sizeof(data)};
+    ntc_error error;
+    REQUIRE(ntc_encoder_add_data_buffers(enc, &buffer, 1, &error) == 1);
+
+    ntc_encoder_statistics enc_stats;
+    ntc_encoder_get_statistics(enc, &enc_stats);
+    REQUIRE(enc_stats.nb_sent_sources == 1);
+    REQUIRE(enc_stats.nb_sent_repairs == 1);
+    REQUIRE(enc_stats.nb_sent_bytes == enc_cxt.packets[0].size() + enc_cxt.packets[1].size());
+    REQUIRE(enc_stats.window == 1);
+
+    // Only the repair is received.
+    struct iovec repair = {&enc_cxt.packets[1][0], enc_cxt.packets[1].size()};
+    REQUIRE(ntc_decoder_add_packet_buffers(dec, &repair, 1, &error) == 1);
+
+    auto* lock = ntc_new_decoder_statistics_seqlock();
+    REQUIRE(lock != nullptr);
+    ntc_decoder_statistics dec_stats;
+    ntc_decoder_statistics_seqlock_load(lock, &dec_stats);
+    REQUIRE(dec_stats.nb_decoded == 0);
+
+    ntc_decoder_publish_statistics(dec, lock);
+    ntc_decoder_statistics_seqlock_load(lock, &dec_stats);
+    REQUIRE(dec_stats.nb_decoded == 1);
+    REQUIRE(dec_stats.nb_received_repairs == 1);
+    REQUIRE(dec_stats.nb_received_bytes == enc_cxt.packets[1].size());
+    ntc_delete_decoder_statistics_seqlock(lock);
+
+    ntc_delete_decoder(dec);
+    ntc_delete_encoder(enc);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
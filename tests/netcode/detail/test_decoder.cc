@@ -577,6 +577,80 @@ TEST_CASE("Decoder: several lost sources from several repairs")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Decoder: oldest lost sources are decoded before a later burst")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::encoder encoder{gf_size};
+    detail::decoder decoder{gf_size, [&](const detail::decoder_source&){}, in_order::no};
+
+    detail::byte_buffer s0_data{'a','b','c','d'};
+    detail::byte_buffer s1_data{'e','f','g','h','i','j','k','l'};
+    detail::byte_buffer s2_data{'m','n','o','p'};
+    detail::byte_buffer s3_data{'q','r','s','t','u','v','w','x'};
+    detail::byte_buffer s4_data{'y','z','0','1','2','3','4','5','6','7','8','9'};
+
+    // 2 repairs for s0 and s1.
+    detail::source_list sl;
+    add_source(sl, 0, detail::byte_buffer{s0_data});
+    add_source(sl, 1, detail::byte_buffer{s1_data});
+    detail::encoder_repair r0{0};
+    detail::encoder_repair r1{1};
+    encoder(r0, sl);
+    encoder(r1, sl);
+
+    // A later burst: 2 repairs for s0 to s4.
+    add_source(sl, 2, detail::byte_buffer{s2_data});
+    add_source(sl, 3, detail::byte_buffer{s3_data});
+    add_source(sl, 4, detail::byte_buffer{s4_data});
+    detail::encoder_repair r2{2};
+    detail::encoder_repair r3{3};
+    encoder(r2, sl);
+    encoder(r3, sl);
+
+    decoder(mk_decoder_repair(r0));
+    decoder(mk_decoder_repair(r2));
+    decoder(mk_decoder_repair(r3));
+    REQUIRE(decoder.sources().empty());
+    REQUIRE(decoder.missing_sources().size() == 5);
+    REQUIRE(decoder.repairs().size() == 3);
+
+    // Still less repairs than missing sources, but s0 and s1 can be decoded from r0 and r1.
+    decoder(mk_decoder_repair(r1));
+    REQUIRE(decoder.nb_failed_full_decodings() == 0);
+    REQUIRE(decoder.nb_decoded() == 2);
+    REQUIRE(decoder.sources().size() == 2);
+    REQUIRE(decoder.missing_sources().size() == 3);
+    REQUIRE(decoder.missing_sources().count(2));
+    REQUIRE(decoder.missing_sources().count(3));
+    REQUIRE(decoder.missing_sources().count(4));
+    REQUIRE(decoder.repairs().size() == 2);
+    REQUIRE(decoder.repairs().count(2));
+    REQUIRE(decoder.repairs().count(3));
+    REQUIRE(decoder.sources().find(0)->second.symbol_size() == s0_data.size());
+    REQUIRE(std::equal( s0_data.begin(), s0_data.end()
+                      , decoder.sources().find(0)->second.symbol()));
+    REQUIRE(decoder.sources().find(1)->second.symbol_size() == s1_data.size());
+    REQUIRE(std::equal( s1_data.begin(), s1_data.end()
+                      , decoder.sources().find(1)->second.symbol()));
+
+    // s3 is received, the burst can now be decoded.
+    decoder({3, detail::byte_buffer{s3_data}, s3_data.size()});
+    REQUIRE(decoder.nb_decoded() == 4);
+    REQUIRE(decoder.sources().size() == 5);
+    REQUIRE(decoder.missing_sources().empty());
+    REQUIRE(decoder.repairs().empty());
+    REQUIRE(decoder.sources().find(2)->second.symbol_size() == s2_data.size());
+    REQUIRE(std::equal( s2_data.begin(), s2_data.end()
+                      , decoder.sources().find(2)->second.symbol()));
+    REQUIRE(decoder.sources().find(4)->second.symbol_size() == s4_data.size());
+    REQUIRE(std::equal( s4_data.begin(), s4_data.end()
+                      , decoder.sources().find(4)->second.symbol()));
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Decoder: duplicate source")
 {
   launch([](std::uint8_t gf_size)
@@ -827,6 +901,65 @@ TEST_CASE("Decoder: repair with only one source")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Decoder: repair with only one source is removed from other repairs")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::encoder encoder{gf_size};
+    detail::decoder decoder{gf_size, [](const detail::decoder_source&){}, in_order::no};
+
+    // The payloads that should be reconstructed.
+    detail::byte_buffer s0_data{'a','b','c','d'};
+    detail::byte_buffer s1_data{'e','f','g','h','i','j','k','l'};
+    detail::byte_buffer s2_data{'m','n','o','p'};
+
+    // r0 encodes s0, s1 and s2.
+    detail::source_list sl0;
+    add_source(sl0, 0, detail::byte_buffer{s0_data});
+    add_source(sl0, 1, detail::byte_buffer{s1_data});
+    add_source(sl0, 2, detail::byte_buffer{s2_data});
+    detail::encoder_repair r0{0};
+    encoder(r0, sl0);
+
+    // r1 encodes s0 and s1.
+    detail::source_list sl1;
+    add_source(sl1, 0, detail::byte_buffer{s0_data});
+    add_source(sl1, 1, detail::byte_buffer{s1_data});
+    detail::encoder_repair r1{1};
+    encoder(r1, sl1);
+
+    // r2 encodes s0 only.
+    detail::source_list sl2;
+    add_source(sl2, 0, detail::byte_buffer{s0_data});
+    detail::encoder_repair r2{2};
+    encoder(r2, sl2);
+
+    decoder(mk_decoder_repair(r0));
+    decoder(mk_decoder_repair(r1));
+    REQUIRE(decoder.sources().empty());
+    REQUIRE(decoder.missing_sources().size() == 3);
+
+    // s0 is decoded from r2, then s1 from r1, then s2 from r0.
+    decoder(mk_decoder_repair(r2));
+    REQUIRE(decoder.sources().size() == 3);
+    REQUIRE(decoder.missing_sources().empty());
+    REQUIRE(decoder.repairs().empty());
+    REQUIRE(decoder.nb_decoded() == 3);
+
+    REQUIRE(decoder.sources().find(0)->second.symbol_size() == s0_data.size());
+    REQUIRE(std::equal( s0_data.begin(), s0_data.end()
+                      , decoder.sources().find(0)->second.symbol()));
+    REQUIRE(decoder.sources().find(1)->second.symbol_size() == s1_data.size());
+    REQUIRE(std::equal( s1_data.begin(), s1_data.end()
+                      , decoder.sources().find(1)->second.symbol()));
+    REQUIRE(decoder.sources().find(2)->second.symbol_size() == s2_data.size());
+    REQUIRE(std::equal( s2_data.begin(), s2_data.end()
+                      , decoder.sources().find(2)->second.symbol()));
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Decoder: 1 packet loss")
 {
   launch([](std::uint8_t gf_size)
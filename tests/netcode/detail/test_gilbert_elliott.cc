@@ -0,0 +1,134 @@
+#include <catch.hpp>
+
+#include "netcode/detail/gilbert_elliott.hh"
+
+#include "tools/loss/burst.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+// Feed an estimator with a channel, as if an ack was received every 50 packets.
+void
+observe(detail::gilbert_elliott& channel, loss::burst& loss, std::size_t nb_packets)
+{
+  auto nb_received = 0ul;
+  for (auto i = 1ul; i <= nb_packets; ++i)
+  {
+    const auto lost = loss();
+    channel.observe_source(lost);
+    nb_received += lost ? 0 : 1;
+    if (i % 50 == 0)
+    {
+      channel.observe_counts(50, nb_received);
+      nb_received = 0;
+    }
+  }
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Gilbert-Elliott estimation without losses")
+{
+  detail::gilbert_elliott channel;
+  channel.observe_counts(100, 100);
+  for (auto i = 0ul; i < 100; ++i)
+  {
+    channel.observe_source(false);
+  }
+
+  REQUIRE(channel.loss_rate() == Approx(0));
+  REQUIRE(channel.burst_length() == Approx(1));
+  REQUIRE(channel.residual_loss(50, 1) == Approx(0));
+  REQUIRE(channel.choose(0.001, 1000) == std::make_pair(50ul, 50ul));
+  REQUIRE(channel.choose(0.001, 10) == std::make_pair(10ul, 10ul));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Gilbert-Elliott estimation of a bursty channel")
+{
+  // A packet stays in the good state with probability 0.94, in the bad state with 0.49.
+  loss::burst loss{95, 50};
+  const auto p_gb = 0.06;
+  const auto p_bg = 0.51;
+
+  detail::gilbert_elliott channel;
+  observe(channel, loss, 100000);
+
+  REQUIRE(channel.p_gb() == Approx(p_gb).epsilon(0.25));
+  REQUIRE(channel.p_bg() == Approx(p_bg).epsilon(0.25));
+  REQUIRE(channel.loss_rate() == Approx(p_gb / (p_gb + p_bg)).epsilon(0.25));
+  REQUIRE(channel.burst_length() == Approx(1 / p_bg).epsilon(0.25));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Gilbert-Elliott residual loss matches a simulation")
+{
+  loss::burst loss{95, 50};
+  detail::gilbert_elliott channel;
+  observe(channel, loss, 100000);
+
+  for (const auto nb_repairs : {2ul, 4ul, 8ul})
+  {
+    const auto nb_sources = 5 * nb_repairs;
+
+    // Send blocks of sources and repairs, sources are lost if there are too many losses.
+    auto nb_lost_sources = 0ul;
+    const auto nb_blocks = 100000ul;
+    for (auto i = 0ul; i < nb_blocks; ++i)
+    {
+      auto nb_losses = 0ul;
+      for (auto j = 0ul; j < nb_sources + nb_repairs; ++j)
+      {
+        nb_losses += loss() ? 1 : 0;
+      }
+      if (nb_losses > nb_repairs)
+      {
+        nb_lost_sources += nb_losses;
+      }
+    }
+    const auto simulated = static_cast<double>(nb_lost_sources)
+                         / static_cast<double>(nb_blocks * (nb_sources + nb_repairs));
+
+    INFO("nb_repairs " << nb_repairs);
+    REQUIRE(channel.residual_loss(nb_sources, nb_repairs) == Approx(simulated).epsilon(0.3));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Gilbert-Elliott code choice")
+{
+  loss::burst loss{95, 50};
+  detail::gilbert_elliott channel;
+  observe(channel, loss, 100000);
+
+  const auto code = channel.choose(0.001, 1000);
+  INFO("rate " << code.first << ", window " << code.second);
+  REQUIRE(channel.residual_loss(code.second, code.second / code.first) <= 0.001);
+
+  // A cheaper code doesn't achieve the target.
+  const auto max_rate = detail::gilbert_elliott::max_rate;
+  const auto max_window = detail::gilbert_elliott::max_window;
+  REQUIRE(code.first < max_rate);
+  for (auto nb_repairs = 1ul; (code.first + 1) * nb_repairs <= max_window; nb_repairs *= 2)
+  {
+    REQUIRE(channel.residual_loss((code.first + 1) * nb_repairs, nb_repairs) > 0.001);
+  }
+
+  // A larger target loss needs less repairs.
+  REQUIRE(channel.choose(0.05, 1000).first > code.first);
+
+  // A small window needs more repairs.
+  REQUIRE(channel.choose(0.001, 16).first < code.first);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,89 @@
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "netcode/detail/mpsc_queue.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("MPSC queue is bounded")
+{
+  detail::mpsc_queue<int> q{3};
+  REQUIRE(q.capacity() == 4);
+  REQUIRE(q.empty());
+
+  for (auto i = 0; i < 4; ++i)
+  {
+    REQUIRE(q.try_push(int{i}));
+  }
+  REQUIRE_FALSE(q.try_push(42));
+  REQUIRE_FALSE(q.empty());
+
+  int x;
+  for (auto i = 0; i < 4; ++i)
+  {
+    REQUIRE(q.try_pop(x));
+    REQUIRE(x == i);
+  }
+  REQUIRE_FALSE(q.try_pop(x));
+  REQUIRE(q.empty());
+
+  // Indexes wrap around.
+  for (auto i = 0; i < 10; ++i)
+  {
+    REQUIRE(q.try_push(int{i}));
+    REQUIRE(q.consume([&](int y){x = y;}, 10) == 1);
+    REQUIRE(x == i);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("MPSC queue between several producers and one consumer")
+{
+  detail::mpsc_queue<std::pair<std::size_t, std::size_t>> q{16};
+  const auto nb_producers = 4ul;
+  const auto nb = 10000ul;
+
+  std::vector<std::thread> producers;
+  for (auto p = 0ul; p < nb_producers; ++p)
+  {
+    producers.emplace_back([&q, p, nb]
+    {
+      for (auto i = 0ul; i < nb; ++i)
+      {
+        auto x = std::make_pair(p, i);
+        while (not q.try_exchange(x))
+        {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Elements of each producer are popped in order.
+  std::vector<std::size_t> expected(nb_producers, 0);
+  auto nb_popped = 0ul;
+  auto in_order = true;
+  while (nb_popped < nb_producers * nb)
+  {
+    nb_popped += q.consume([&](const std::pair<std::size_t, std::size_t>& x)
+                           {
+                             in_order = in_order and x.second == expected[x.first];
+                             ++expected[x.first];
+                           }, 8);
+  }
+  for (auto& producer : producers)
+  {
+    producer.join();
+  }
+  REQUIRE(in_order);
+  REQUIRE(q.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -151,6 +151,51 @@ TEST_CASE("A source is (de)serialized by packetizer")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Sources and repairs are read in place by packetizer")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  SECTION("source")
+  {
+    const detail::encoder_source s_in{42, {'a', 'b', 'c', 'd'}};
+    serializer.write_source(s_in);
+
+    auto s_out = serializer.read_source(h.pkt.data(), h.pkt.size()).first;
+    REQUIRE(s_out.borrowed());
+    REQUIRE(s_out.id() == 42);
+    // Don't ask for mutable access to a borrowed symbol.
+    REQUIRE(static_cast<const detail::decoder_source&>(s_out).symbol() == h.pkt.symbol());
+
+    s_out.retain();
+    REQUIRE(not s_out.borrowed());
+    std::fill(h.pkt.begin(), h.pkt.end(), 'x');
+    REQUIRE(std::equal(s_in.symbol().begin(), s_in.symbol().end(), s_out.symbol()));
+  }
+
+  SECTION("repair")
+  {
+    const detail::encoder_repair r_in{ 42, 54, {0,1,4,5,6,100,101}
+                                     , detail::zero_byte_buffer{'a', 'b', 'c'}};
+    serializer.write_repair(r_in);
+
+    auto r_out = serializer.read_repair(h.pkt.data(), h.pkt.size()).first;
+    REQUIRE(r_out.borrowed());
+    REQUIRE(r_in.id() == r_out.id());
+    REQUIRE(r_in.source_ids() == r_out.source_ids());
+    REQUIRE(r_in.encoded_size() == r_out.encoded_size());
+    // Don't ask for mutable access to a borrowed symbol.
+    REQUIRE(static_cast<const detail::decoder_repair&>(r_out).symbol() == h.pkt.symbol());
+
+    r_out.retain();
+    REQUIRE(not r_out.borrowed());
+    std::fill(h.pkt.begin(), h.pkt.end(), 'x');
+    REQUIRE(std::equal(r_in.symbol().begin(), r_in.symbol().end(), r_out.symbol()));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Prevent buffer overflow")
 {
   handler h;
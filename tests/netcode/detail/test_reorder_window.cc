@@ -0,0 +1,116 @@
+#include <stdexcept>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "netcode/detail/reorder_window.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Reorder window gives runs of consecutive entries")
+{
+  detail::reorder_window<std::uint32_t> w;
+  auto first = std::uint32_t{10};
+  std::vector<std::uint32_t> given;
+  const auto give = [&](std::uint32_t x){given.push_back(x);};
+
+  // 10 and 13 are missing. Entries cross a word of the bitmap.
+  for (auto id : {12u, 11u, 70u, 14u, 63u, 64u})
+  {
+    w.insert(first, id, std::uint32_t{id});
+  }
+  REQUIRE(w.size() == 6);
+  w.release(first, give);
+  REQUIRE(given.empty());
+  REQUIRE(first == 10);
+
+  // 10 arrives, the run stops at 13.
+  first = 11;
+  w.release(first, give);
+  REQUIRE((given == std::vector<std::uint32_t>{11, 12}));
+  REQUIRE(first == 13);
+  REQUIRE(w.size() == 4);
+
+  // Fill from 13 to 69, across words.
+  given.clear();
+  for (auto id = 15u; id < 70; ++id)
+  {
+    if (id != 63 and id != 64)
+    {
+      w.insert(first, id, std::uint32_t{id});
+    }
+  }
+  first = 14;
+  w.release(first, give);
+  REQUIRE(given.size() == 57);
+  REQUIRE(given.front() == 14);
+  REQUIRE(given.back() == 70);
+  REQUIRE(first == 71);
+  REQUIRE(w.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Reorder window grows")
+{
+  detail::reorder_window<std::uint32_t> w;
+  auto first = std::uint32_t{100};
+  std::vector<std::uint32_t> given;
+
+  // Entries on both sides of a wrap of the ring, then far ones which make it grow.
+  for (auto id : {120u, 130u, 200u, 1000u, 5000u})
+  {
+    w.insert(first, id, std::uint32_t{id});
+  }
+  REQUIRE(w.size() == 5);
+
+  // Skip gaps up to 1000 excluded.
+  w.release_before(first, 1000, [&](std::uint32_t x){given.push_back(x);});
+  REQUIRE((given == std::vector<std::uint32_t>{120, 130, 200}));
+  REQUIRE(first == 1000);
+
+  w.release(first, [&](std::uint32_t x){given.push_back(x);});
+  REQUIRE(given.back() == 1000);
+  REQUIRE(first == 1001);
+
+  // Nothing is given when skipping to an older identifier.
+  w.release_before(first, 500, [&](std::uint32_t x){given.push_back(x);});
+  REQUIRE(first == 1001);
+
+  w.release_before(first, 6000, [&](std::uint32_t x){given.push_back(x);});
+  REQUIRE(given.back() == 5000);
+  REQUIRE(first == 6000);
+  REQUIRE(w.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Reorder window keeps an entry if it can't be given")
+{
+  detail::reorder_window<std::uint32_t> w;
+  auto first = std::uint32_t{0};
+  w.insert(first, 1, 1);
+  w.insert(first, 2, 2);
+  first = 1;
+  const auto fail_on_2 = [](std::uint32_t x)
+  {
+    if (x == 2)
+    {
+      throw std::runtime_error{""};
+    }
+  };
+  REQUIRE_THROWS_AS(w.release(first, fail_on_2), std::runtime_error);
+  REQUIRE(first == 2);
+  REQUIRE(w.size() == 1);
+
+  auto given = 0u;
+  w.release(first, [&](std::uint32_t x){given = x;});
+  REQUIRE(given == 2);
+  REQUIRE(w.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,109 @@
+#include <thread>
+
+#include <catch.hpp>
+
+#include "netcode/detail/spsc_queue.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("SPSC queue is bounded")
+{
+  detail::spsc_queue<int> q{3};
+  REQUIRE(q.capacity() == 4);
+  REQUIRE(q.empty());
+
+  for (auto i = 0; i < 4; ++i)
+  {
+    REQUIRE(q.try_push(int{i}));
+  }
+  REQUIRE_FALSE(q.try_push(42));
+  REQUIRE_FALSE(q.empty());
+
+  int x;
+  for (auto i = 0; i < 4; ++i)
+  {
+    REQUIRE(q.try_pop(x));
+    REQUIRE(x == i);
+  }
+  REQUIRE_FALSE(q.try_pop(x));
+  REQUIRE(q.empty());
+
+  // Indexes wrap around.
+  for (auto i = 0; i < 10; ++i)
+  {
+    REQUIRE(q.try_push(int{i}));
+    REQUIRE(q.try_pop(x));
+    REQUIRE(x == i);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("SPSC queue between two threads")
+{
+  detail::spsc_queue<std::vector<std::size_t>> q{8};
+  const auto nb = 10000ul;
+
+  std::thread producer{[&]
+  {
+    for (auto i = 0ul; i < nb; ++i)
+    {
+      auto v = std::vector<std::size_t>(4, i);
+      while (not q.try_push(std::move(v)))
+      {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  auto expected = 0ul;
+  std::vector<std::size_t> v;
+  while (expected < nb)
+  {
+    if (q.try_pop(v))
+    {
+      REQUIRE(v == std::vector<std::size_t>(4, expected));
+      ++expected;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  REQUIRE(q.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("SPSC queue consumes batches and gives slots back to the producer")
+{
+  detail::spsc_queue<std::vector<int>> q{4};
+
+  for (auto i = 0; i < 3; ++i)
+  {
+    auto v = std::vector<int>(1, i);
+    REQUIRE(q.try_exchange(v));
+    REQUIRE(v.empty());
+  }
+
+  std::vector<int> consumed;
+  REQUIRE(q.consume([&](std::vector<int>& v){consumed.push_back(v[0]); v.push_back(42);}, 2) == 2);
+  REQUIRE(consumed == (std::vector<int>{0, 1}));
+  REQUIRE(q.consume([&](std::vector<int>& v){consumed.push_back(v[0]);}, 10) == 1);
+  REQUIRE(consumed == (std::vector<int>{0, 1, 2}));
+  REQUIRE(q.consume([&](std::vector<int>&){}, 10) == 0);
+  REQUIRE(q.empty());
+
+  // The producer gets back what the consumer left in the slot.
+  auto v = std::vector<int>(1, 3);
+  REQUIRE(q.try_exchange(v));
+  REQUIRE(q.try_exchange(v));
+  REQUIRE(v == (std::vector<int>{0, 42}));
+}
+
+/*------------------------------------------------------------------------------------------------*/
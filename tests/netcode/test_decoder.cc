@@ -74,6 +74,115 @@ TEST_CASE("Decoder repairs a lost source")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Decoder measures latencies")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(2);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    REQUIRE(dec.histograms() == nullptr);
+    dec.set_histograms(true);
+    REQUIRE(dec.histograms() != nullptr);
+
+    auto& enc_packet_handler = enc.packet_handler();
+
+    const auto s0 = {'a','b','c','d'};
+    enc(data{begin(s0), end(s0)});
+    const auto s1 = {'e','f','g','h'};
+    enc(data{begin(s1), end(s1)});
+    REQUIRE(enc_packet_handler.nb_packets() == 3 /* 2 sources + 1 repair */);
+
+    // Lose first source, second one is held back until the first one is repaired.
+    REQUIRE(dec(enc_packet_handler[1]));
+    REQUIRE(dec.histograms()->in_order_hold.count() == 0);
+    REQUIRE(dec(enc_packet_handler[2]));
+    REQUIRE(dec.nb_decoded() == 1);
+    REQUIRE(dec.data_handler().nb_data() == 2);
+
+    const auto& histograms = *dec.histograms();
+    REQUIRE(histograms.loss_to_recovery.count() == 1);
+    REQUIRE(histograms.in_order_hold.count() == 1);
+    REQUIRE(histograms.in_order_hold.max() >= histograms.in_order_hold.min());
+
+    dec.set_histograms(false);
+    REQUIRE(dec.histograms() == nullptr);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder and decoder statistics snapshots")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(2);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_ack_nb_packets(100);
+    dec.set_histograms(true);
+
+    auto& enc_packet_handler = enc.packet_handler();
+
+    const auto s0 = {'a','b','c','d'};
+    enc(data{begin(s0), end(s0)});
+    const auto s1 = {'e','f','g','h'};
+    enc(data{begin(s1), end(s1)});
+    REQUIRE(enc_packet_handler.nb_packets() == 3 /* 2 sources + 1 repair */);
+
+    auto sent_bytes = 0ul;
+    for (auto i = 0ul; i < enc_packet_handler.nb_packets(); ++i)
+    {
+      sent_bytes += enc_packet_handler[i].size();
+    }
+
+    const auto enc_stats = enc.statistics();
+    REQUIRE(enc_stats.nb_sent_sources == 2);
+    REQUIRE(enc_stats.nb_sent_repairs == 1);
+    REQUIRE(enc_stats.nb_received_acks == 0);
+    REQUIRE(enc_stats.nb_sent_bytes == sent_bytes);
+    REQUIRE(enc_stats.nb_received_bytes == 0);
+    REQUIRE(enc_stats.repair_overhead == Approx(0.5));
+    REQUIRE(enc_stats.window == 2);
+    REQUIRE(enc_stats.rate == 2);
+
+    // Lose first source, second one is held back until the first one is repaired.
+    REQUIRE(dec(enc_packet_handler[1]));
+    auto dec_stats = dec.statistics();
+    REQUIRE(dec_stats.nb_received_sources == 1);
+    REQUIRE(dec_stats.nb_ordered_sources == 1);
+    REQUIRE(dec_stats.nb_held_sources == 1);
+    REQUIRE(dec_stats.nb_decoded == 0);
+
+    REQUIRE(dec(enc_packet_handler[2]));
+    dec_stats = dec.statistics();
+    REQUIRE(dec_stats.nb_received_sources == 1);
+    REQUIRE(dec_stats.nb_received_repairs == 1);
+    REQUIRE(dec_stats.nb_received_bytes == sent_bytes - enc_packet_handler[0].size());
+    REQUIRE(dec_stats.nb_decoded == 1);
+    REQUIRE(dec_stats.nb_ordered_sources == 0);
+    REQUIRE(dec_stats.nb_held_repairs == 0);
+    REQUIRE(dec_stats.nb_missing_sources == 0);
+    REQUIRE(dec_stats.nb_sent_bytes == 0);
+
+    dec.generate_ack();
+    const auto& ack = dec.packet_handler()[0];
+    REQUIRE(dec.statistics().nb_sent_bytes == ack.size());
+    REQUIRE(dec.statistics().nb_sent_acks == 1);
+
+    enc(ack);
+    REQUIRE(enc.statistics().nb_received_acks == 1);
+    REQUIRE(enc.statistics().nb_received_bytes == ack.size());
+    REQUIRE(enc.statistics().window == 0);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Decoder generate correct ack")
 {
   launch([](std::uint8_t gf_size)
@@ -164,6 +273,173 @@ TEST_CASE("Decoder generate acks when N packets are received")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Decoder dates acks with a cached clock")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    cached_clock clock{cached_clock::time_point{}};
+    dec.set_ack_period(std::chrono::milliseconds{100});
+    dec.set_clock(&clock);
+    REQUIRE(dec.clock() == &clock);
+
+    auto& enc_packet_handler = enc.packet_handler();
+    const auto s0 = {'a','b','c','d'};
+    for (auto i = 0; i < 4; ++i)
+    {
+      enc(data{begin(s0), end(s0)});
+    }
+
+    // The clock doesn't move by itself, whatever the real time.
+    dec(enc_packet_handler[0]);
+    std::this_thread::sleep_for(std::chrono::milliseconds{150});
+    dec(enc_packet_handler[1]);
+    REQUIRE(dec.nb_sent_acks() == 0);
+
+    clock.advance(std::chrono::milliseconds{99});
+    dec(enc_packet_handler[2]);
+    REQUIRE(dec.nb_sent_acks() == 0);
+
+    clock.advance(std::chrono::milliseconds{1});
+    dec(enc_packet_handler[3]);
+    REQUIRE(dec.nb_sent_acks() == 1);
+    REQUIRE(dec.packet_handler().nb_packets() == 1);
+    REQUIRE(detail::get_packet_type(dec.packet_handler()[0]) == detail::packet_type::ack);
+
+    // Back to the system clock.
+    dec.set_clock(nullptr);
+    REQUIRE(dec.clock() == nullptr);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("In order decoder bounds the wait of sources")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    // No repairs: missing sources are never recovered.
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+    for (auto i = 0; i < 10; ++i)
+    {
+      enc(data(4, static_cast<char>(i)));
+    }
+    const auto& packets = enc.packet_handler();
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_ack_period(std::chrono::milliseconds{0});
+    cached_clock clock{cached_clock::time_point{}};
+    dec.set_clock(&clock);
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> skipped;
+    dec.set_skip_handler([&](std::uint32_t first, std::uint32_t last)
+                         {
+                           skipped.emplace_back(first, last);
+                         });
+    dec.set_max_hold_time(std::chrono::milliseconds{50});
+    REQUIRE(dec.max_hold_time() == std::chrono::milliseconds{50});
+    REQUIRE(dec.max_reorder_depth() == 0);
+    const auto& delivered = dec.data_handler();
+
+    // Sources 1 and 2 are lost.
+    dec(packets[0]);
+    dec(packets[3]);
+    dec(packets[4]);
+    REQUIRE(delivered.nb_data() == 1);
+
+    clock.advance(std::chrono::milliseconds{49});
+    dec(packets[5]);
+    dec.expire_held_sources();
+    REQUIRE(delivered.nb_data() == 1);
+
+    // Source 3 waited too long.
+    clock.advance(std::chrono::milliseconds{1});
+    dec.expire_held_sources();
+    REQUIRE(delivered.nb_data() == 4);
+    REQUIRE(delivered[1][0] == 3);
+    REQUIRE(delivered[3][0] == 5);
+    REQUIRE((skipped == std::vector<std::pair<std::uint32_t, std::uint32_t>>{{1, 2}}));
+
+    // A skipped source is not given if it's received later.
+    dec(packets[1]);
+    REQUIRE(delivered.nb_data() == 4);
+
+    // Source 6 is lost, source 9 is too far ahead.
+    dec.set_max_reorder_depth(3);
+    REQUIRE(dec.max_reorder_depth() == 3);
+    dec(packets[7]);
+    dec(packets[8]);
+    REQUIRE(delivered.nb_data() == 4);
+    dec(packets[9]);
+    REQUIRE(delivered.nb_data() == 7);
+    REQUIRE(delivered[4][0] == 7);
+    REQUIRE(delivered[6][0] == 9);
+    REQUIRE(skipped.size() == 2);
+    REQUIRE(skipped.back() == std::make_pair(std::uint32_t{6}, std::uint32_t{6}));
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("In order decoder skips missing sources for a source far ahead")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+    enc(data(4, 'a'));
+    enc(data(4, 'b'));
+    const auto& packets = enc.packet_handler();
+
+    // A source packet with another identifier, big-endian after the packet type.
+    const auto with_id = [&](std::uint32_t id)
+    {
+      auto p = packet{packets[1]};
+      for (auto i = 0; i < 4; ++i)
+      {
+        p.data()[1 + i] = static_cast<char>(id >> (8 * (3 - i)));
+      }
+      return p;
+    };
+
+    const auto max_capacity = detail::reorder_window<int>::max_capacity;
+    for (const auto far : {std::uint32_t{0x10000000}, std::uint32_t{0x90000000}})
+    {
+      decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                               , data_handler{}};
+      std::vector<std::pair<std::uint32_t, std::uint32_t>> skipped;
+      dec.set_skip_handler([&](std::uint32_t first, std::uint32_t last)
+                           {
+                             skipped.emplace_back(first, last);
+                           });
+      const auto& delivered = dec.data_handler();
+
+      dec(packets[0]);
+      REQUIRE(delivered.nb_data() == 1);
+
+      // Older sources are skipped rather than waited for with a window of the whole gap.
+      dec(with_id(far));
+      REQUIRE(delivered.nb_data() == 1);
+      REQUIRE(dec.statistics().nb_ordered_sources == 1);
+      REQUIRE((skipped == std::vector<std::pair<std::uint32_t, std::uint32_t>>
+                            {{1, far - max_capacity}}));
+
+      // The window still holds sources up to the far one.
+      dec(with_id(far - 1));
+      REQUIRE(dec.statistics().nb_ordered_sources == 2);
+      dec(with_id(far - max_capacity + 1));
+      REQUIRE(delivered.nb_data() == 2);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
 test_case_0(ntc::in_order order)
 {
@@ -671,6 +947,75 @@ TEST_CASE("In order decoder, missing sources")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Decoder reads packets from a borrowed buffer")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(3);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_ack_period(std::chrono::milliseconds{0});
+
+    auto& enc_handler = enc.packet_handler();
+    auto& dec_data_handler = dec.data_handler();
+
+    const auto s0 = {'a','a','a','a'};
+    const auto s1 = {'b','b','b','b','b','b','b','b'};
+    const auto s2 = {'c','c','c','c'};
+    enc(data{begin(s0), end(s0)});
+    enc(data{begin(s1), end(s1)});
+    enc(data{begin(s2), end(s2)});
+    REQUIRE(enc_handler.nb_packets() == 4 /* 3 src + 1 repair */);
+
+    // Simulate a receive ring: all packets are received in the same slot.
+    detail::byte_buffer slab(4096);
+
+    // Copy a packet into the slab, give it to the decoder, then scribble over the slab.
+    const auto receive = [&](const packet& p, std::size_t offset)
+    {
+      std::copy(p.begin(), p.end(), slab.begin() + static_cast<std::ptrdiff_t>(offset));
+      const auto read = dec(slab.data() + offset, p.size());
+      std::fill(slab.begin(), slab.end(), 'x');
+      return read;
+    };
+
+    // s1 is decoded from the repair and sources which were retained by the decoder.
+    const auto check = [&]
+    {
+      REQUIRE(dec.nb_received_sources() == 2);
+      REQUIRE(dec.nb_received_repairs() == 1);
+      REQUIRE(dec.nb_decoded() == 1);
+      REQUIRE(dec_data_handler.nb_data() == 3);
+      REQUIRE(std::equal(begin(s0), end(s0), begin(dec_data_handler[0])));
+      REQUIRE(std::equal(begin(s1), end(s1), begin(dec_data_handler[1])));
+      REQUIRE(std::equal(begin(s2), end(s2), begin(dec_data_handler[2])));
+    };
+
+    SECTION("Aligned buffer")
+    {
+      REQUIRE(receive(enc_handler[0], packet::shift) == enc_handler[0].size());
+      // s1 is lost.
+      REQUIRE(receive(enc_handler[2], packet::shift) == enc_handler[2].size());
+      REQUIRE(receive(enc_handler[3], packet::shift) > 0);
+      check();
+    }
+
+    SECTION("Misaligned buffer")
+    {
+      REQUIRE(receive(enc_handler[0], 0) == enc_handler[0].size());
+      // s1 is lost.
+      REQUIRE(receive(enc_handler[2], 3) == enc_handler[2].size());
+      REQUIRE(receive(enc_handler[3], 1) > 0);
+      check();
+    }
+
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Decoder rejects ack")
 {
   launch([](std::uint8_t gf_size)
@@ -692,6 +1037,12 @@ TEST_CASE("Decoder rejects ack")
     {
       REQUIRE_THROWS_AS(dec(packet{33,35,1,0}), packet_type_error);
     }
+
+    SECTION("Garbage in a borrowed buffer")
+    {
+      const char garbage[] = {33,35,1,0};
+      REQUIRE_THROWS_AS(dec(garbage, sizeof(garbage)), packet_type_error);
+    }
   });
 }
 
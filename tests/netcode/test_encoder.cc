@@ -1,11 +1,15 @@
 #include <algorithm>
+#include <string>
 
 #include <catch.hpp>
 #include "tests/netcode/common.hh"
 #include "tests/netcode/launch.hh"
 
+#include "netcode/decoder.hh"
 #include "netcode/encoder.hh"
 
+#include "tools/loss/burst.hh"
+
 /*------------------------------------------------------------------------------------------------*/
 
 using namespace ntc;
@@ -89,6 +93,162 @@ TEST_CASE("Encoder generates repairs")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Encoder reads data views in place and releases them on ack or eviction")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    // The application's buffer, shared by all views.
+    auto slab = std::make_shared<ntc::data>(4 * 512);
+    for (auto i = 0ul; i < slab->size(); ++i)
+    {
+      (*slab)[i] = static_cast<char>(i * 7);
+    }
+
+    encoder<packet_handler> encoder_views{gf_size, packet_handler{}};
+    encoder_views.set_window_size(3);
+    encoder<packet_handler> encoder_copies{gf_size, packet_handler{}};
+    encoder_copies.set_window_size(3);
+    for (auto i = 0ul; i < 4; ++i)
+    {
+      const auto begin = slab->data() + i * 512;
+      encoder_views(data_view{begin, 512, slab});
+      encoder_copies(ntc::data(begin, begin + 512));
+    }
+
+    // The first source was evicted from the window.
+    REQUIRE(encoder_views.window() == 3);
+    REQUIRE(slab.use_count() == 1 + 3);
+
+    // Sources and repairs are the same as with copied data.
+    const auto& views_packets = encoder_views.packet_handler();
+    const auto& copies_packets = encoder_copies.packet_handler();
+    REQUIRE(views_packets.nb_packets() == copies_packets.nb_packets());
+    for (auto i = 0ul; i < views_packets.nb_packets(); ++i)
+    {
+      REQUIRE(views_packets[i].size() == copies_packets[i].size());
+      REQUIRE(std::equal( views_packets[i].begin(), views_packets[i].end()
+                        , copies_packets[i].begin()));
+    }
+
+    // Acknowledged sources are released.
+    struct handler
+    {
+      packet pkt;
+
+      void
+      operator()(const char* src, std::size_t len)
+      {
+        std::copy_n(src, len, std::back_inserter(pkt));
+      }
+
+      void operator()() const noexcept {}
+    };
+    handler h;
+    detail::packetizer<handler> serializer{h};
+    serializer.write_ack(detail::ack{{1,2}, 0});
+    encoder_views(packet{h.pkt});
+    REQUIRE(encoder_views.window() == 1);
+    REQUIRE(slab.use_count() == 1 + 1);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder builds repairs on a helper thread")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    auto slab = std::make_shared<ntc::data>(4 * 512);
+    for (auto i = 0ul; i < slab->size(); ++i)
+    {
+      (*slab)[i] = static_cast<char>(i * 3);
+    }
+
+    encoder<packet_handler> sync{gf_size, packet_handler{}};
+    encoder<packet_handler> async{gf_size, packet_handler{}};
+    for (auto* enc : {&sync, &async})
+    {
+      enc->set_rate(2);
+      enc->set_window_size(5);
+    }
+
+    // The helper thread gets the current window when it's started.
+    for (auto* enc : {&sync, &async})
+    {
+      (*enc)(ntc::data(slab->begin(), slab->begin() + 64));
+    }
+    async.set_async_repairs(true);
+    REQUIRE(async.async_repairs());
+
+    // An ack of the second and third sources, received midway.
+    struct handler
+    {
+      packet pkt;
+
+      void
+      operator()(const char* src, std::size_t len)
+      {
+        std::copy_n(src, len, std::back_inserter(pkt));
+      }
+
+      void operator()() const noexcept {}
+    };
+    handler h;
+    detail::packetizer<handler> serializer{h};
+    serializer.write_ack(detail::ack{{1,2}, 0});
+
+    for (auto i = 1ul; i < 24; ++i)
+    {
+      for (auto* enc : {&sync, &async})
+      {
+        const auto begin = slab->data() + (i % 4) * 512;
+        if (i % 3 == 0)
+        {
+          (*enc)(data_view{begin, 512, slab});
+        }
+        else
+        {
+          (*enc)(ntc::data(begin, begin + 4 * (i + 1)));
+        }
+        if (i == 10)
+        {
+          (*enc)(packet{h.pkt});
+        }
+      }
+    }
+    async.wait_repairs();
+    REQUIRE(async.flush_repairs() == 0);
+    REQUIRE(async.nb_sent_repairs() == sync.nb_sent_repairs());
+    REQUIRE(async.window() == sync.window());
+
+    // Repairs are sent later, but in order and built from the same windows.
+    const auto split = [](const packet_handler& handler)
+    {
+      auto res = std::make_pair(std::vector<std::string>{}, std::vector<std::string>{});
+      for (auto i = 0ul; i < handler.nb_packets(); ++i)
+      {
+        (detail::get_packet_type(handler[i]) == detail::packet_type::source ? res.first : res.second)
+          .emplace_back(handler[i].begin(), handler[i].end());
+      }
+      return res;
+    };
+    const auto sync_packets = split(sync.packet_handler());
+    const auto async_packets = split(async.packet_handler());
+    REQUIRE(sync_packets.second.size() == sync.nb_sent_repairs());
+    REQUIRE(sync_packets.first == async_packets.first);
+    REQUIRE(sync_packets.second == async_packets.second);
+
+    // Disabling the helper thread sends pending repairs.
+    async(ntc::data(slab->begin(), slab->begin() + 64));
+    async(ntc::data(slab->begin(), slab->begin() + 64));
+    async.set_async_repairs(false);
+    REQUIRE(not async.async_repairs());
+    REQUIRE(async.nb_sent_repairs() == sync.nb_sent_repairs() + 1);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Encoder correctly handles new incoming packets")
 {
   launch([](std::uint8_t gf_size)
@@ -426,24 +586,123 @@ TEST_CASE("Encoder adapts rate automatically")
     REQUIRE_NOTHROW(enc(packet{h_decoder[0]}));
     REQUIRE(enc.window() == 0);
     REQUIRE(enc.rate() == 50); // default maximal rate
+    REQUIRE(enc.adaptive_window_size() == 50); // a single repair is needed
 
     for (auto i = 100ul; i < 200; ++i)
     {
       enc(data(d.begin(), d.end()));
     }
-    REQUIRE(enc.window() == 100);
+    REQUIRE(enc.window() == 50);
 
-    // An ack that indicates that half of the packets were lost.
-    auto ids1 = detail::source_id_list{};
-    for (auto i = 0u; i < 50; ++i)
+    // Acks that indicate that half of the packets were lost. As past acks are taken into account,
+    // it takes a few of them for the encoder to adapt. The decoder counts all received packets.
+    auto nb_sent = enc.packet_handler().nb_packets();
+    auto nb_received = std::size_t{200};
+    for (auto round = 1u; round <= 20; ++round)
     {
-      ids1.insert(100 + 2*i);
+      if (round > 1)
+      {
+        for (auto i = 0ul; i < 100; ++i)
+        {
+          enc(data(d.begin(), d.end()));
+        }
+      }
+      auto ids1 = detail::source_id_list{};
+      for (auto i = 0u; i < 50; ++i)
+      {
+        ids1.insert(100 * round + 2*i);
+      }
+      nb_received += (enc.packet_handler().nb_packets() - nb_sent) / 2;
+      nb_sent = enc.packet_handler().nb_packets();
+      serializer.write_ack(detail::ack{std::move(ids1), static_cast<std::uint16_t>(nb_received)});
+      REQUIRE_NOTHROW(enc(packet{h_decoder[round]}));
     }
-    serializer.write_ack(detail::ack{std::move(ids1), 50});
-    
-    REQUIRE_NOTHROW(enc(packet{h_decoder[1]}));
+    REQUIRE(enc.estimated_loss_rate() > 0.45);
+    REQUIRE(enc.estimated_burst_length() == Approx(1));
     REQUIRE(enc.rate() == 1); // minimal rate
   });
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Adaptive encoder counts packets received between distant acks")
+{
+  encoder<packet_handler> enc{8, packet_handler{}};
+  enc.set_adaptive(true).set_window_size(8);
+
+  decoder<packet_handler, data_handler> dec{8, in_order::no, packet_handler{}, data_handler{}};
+  dec.set_ack_period(std::chrono::milliseconds{0});
+
+  // No packet is lost, but all acks are, until more than 2^16 packets were sent.
+  const auto d = std::vector<char>(8, 'x');
+  auto nb_sent = 0ul;
+  while (nb_sent <= 70000)
+  {
+    enc(data(d.begin(), d.end()));
+    for (; nb_sent < enc.packet_handler().nb_packets(); ++nb_sent)
+    {
+      dec(enc.packet_handler()[nb_sent]);
+    }
+  }
+  REQUIRE(dec.nb_sent_acks() > 1);
+
+  dec.generate_ack();
+  enc(dec.packet_handler()[dec.packet_handler().nb_packets() - 1]);
+  REQUIRE(enc.estimated_loss_rate() == Approx(0));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Adaptive encoder on a bursty channel")
+{
+  // Send sources through a channel with a mean loss rate of 11% and a mean burst length of 2,
+  // return the number of sources given to the user and the number of sent repairs.
+  const auto simulate = [](double target_loss, std::size_t nb_sources)
+  {
+    encoder<packet_handler> enc{8, packet_handler{}};
+    enc.set_adaptive(true).set_target_loss(target_loss);
+
+    decoder<packet_handler, data_handler> dec{8, in_order::no, packet_handler{}, data_handler{}};
+    dec.set_ack_period(std::chrono::milliseconds{0});
+
+    loss::burst loss{95, 50};
+
+    const auto d = std::vector<char>(32, 'x');
+    auto nb_sent = 0ul;
+    auto nb_acks = 0ul;
+    for (auto i = 0ul; i < nb_sources; ++i)
+    {
+      enc(data(d.begin(), d.end()));
+      for (; nb_sent < enc.packet_handler().nb_packets(); ++nb_sent)
+      {
+        if (not loss())
+        {
+          dec(enc.packet_handler()[nb_sent]);
+        }
+      }
+      for (; nb_acks < dec.packet_handler().nb_packets(); ++nb_acks)
+      {
+        enc(dec.packet_handler()[nb_acks]);
+      }
+    }
+
+    INFO("loss " << enc.estimated_loss_rate() << ", burst " << enc.estimated_burst_length());
+    REQUIRE(enc.estimated_loss_rate() == Approx(0.11).epsilon(0.3));
+    REQUIRE(enc.estimated_burst_length() > 1.5);
+    return std::make_pair(dec.data_handler().nb_data(), enc.nb_sent_repairs());
+  };
+
+  const auto nb_sources = 5000ul;
+  const auto strict = simulate(0.01, nb_sources);
+  const auto loose = simulate(0.05, nb_sources);
+
+  // The residual loss is close to the target.
+  REQUIRE(static_cast<double>(strict.first) >= 0.99 * nb_sources);
+  REQUIRE(static_cast<double>(loose.first) >= 0.93 * nb_sources);
+
+  // A looser target needs fewer repairs.
+  REQUIRE(loose.second < strict.second);
+  REQUIRE(strict.second < nb_sources);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,91 @@
+#include <catch.hpp>
+
+#include "netcode/histogram.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Empty histogram")
+{
+  histogram h;
+  REQUIRE(h.count() == 0);
+  REQUIRE(h.min() == 0);
+  REQUIRE(h.max() == 0);
+  REQUIRE(h.mean() == 0.);
+  REQUIRE(h.percentile(50) == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Histogram small values are exact")
+{
+  histogram h;
+  for (auto i = 1u; i <= 10; ++i)
+  {
+    h.record(i);
+  }
+  REQUIRE(h.count() == 10);
+  REQUIRE(h.min() == 1);
+  REQUIRE(h.max() == 10);
+  REQUIRE(h.mean() == Approx(5.5));
+  REQUIRE(h.percentile(50) == 5);
+  REQUIRE(h.percentile(90) == 9);
+  REQUIRE(h.percentile(100) == 10);
+
+  SECTION("reset")
+  {
+    h.reset();
+    REQUIRE(h.count() == 0);
+    REQUIRE(h.percentile(50) == 0);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Histogram large values have a bounded relative error")
+{
+  histogram h;
+  for (auto i = 1ul; i <= 100000; ++i)
+  {
+    h.record(i * 1000);
+  }
+  for (const auto p : {50., 99., 99.9})
+  {
+    const auto exact = static_cast<double>(p * 1000. * 1000.);
+    const auto value = static_cast<double>(h.percentile(p));
+    REQUIRE(value >= exact);
+    REQUIRE(value <= exact * 1.04);
+  }
+  REQUIRE(h.percentile(100) == 100000000);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Histogram clamps huge values")
+{
+  histogram h;
+  h.record(std::uint64_t{1} << 50);
+  REQUIRE(h.count() == 1);
+  REQUIRE(h.max() == (std::uint64_t{1} << 40) - 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Histograms merge")
+{
+  histogram h0;
+  histogram h1;
+  h0.record(10);
+  h1.record(20);
+  h1.record(30);
+  h0.merge(h1);
+  REQUIRE(h0.count() == 3);
+  REQUIRE(h0.min() == 10);
+  REQUIRE(h0.max() == 30);
+  REQUIRE(h0.mean() == Approx(20.));
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,228 @@
+#include <cstdio>  // remove
+#include <cstring> // memcpy
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/packet_capture.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+const auto capture_path = std::string{"test_packet_capture.bin"};
+
+std::vector<char>
+read_file(const std::string& path)
+{
+  std::ifstream file{path, std::ios::binary};
+  return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+std::vector<captured_packet>
+read_all(capture_reader& reader)
+{
+  auto res = std::vector<captured_packet>{};
+  auto p = captured_packet{};
+  while (reader.next(p))
+  {
+    res.push_back(p);
+  }
+  return res;
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet capture writes all records")
+{
+  auto conf = packet_capture::configuration{};
+  conf.buffer_size = 256;
+  conf.flush_period = std::chrono::milliseconds{1};
+  conf.galois_field_size = 16;
+  conf.ordered = in_order::no;
+  {
+    packet_capture capture{capture_path, conf};
+    // More than the ring size, wait for the writer when the ring is full.
+    for (auto i = 0; i < 100; ++i)
+    {
+      const auto bytes = std::string(static_cast<std::size_t>(i % 20 + 1), static_cast<char>(i));
+      while (not capture.record(bytes.data(), bytes.size(), capture_direction::received))
+      {
+        std::this_thread::yield();
+      }
+    }
+    REQUIRE(capture.nb_captured() == 100);
+  }
+
+  const auto file = read_file(capture_path);
+  std::remove(capture_path.c_str());
+  capture_reader reader{file.data(), file.size()};
+  REQUIRE(reader.header().version == capture_version);
+  REQUIRE(reader.header().galois_field_size == 16);
+  REQUIRE(reader.header().in_order == 0);
+  REQUIRE(reader.indexed());
+  REQUIRE(reader.nb_records() == 100);
+
+  const auto packets = read_all(reader);
+  REQUIRE(packets.size() == 100);
+  for (auto i = 0ul; i < packets.size(); ++i)
+  {
+    REQUIRE(packets[i].direction == capture_direction::received);
+    REQUIRE(packets[i].size == i % 20 + 1);
+    REQUIRE(packets[i].data[0] == static_cast<char>(i));
+    REQUIRE(packets[i].date >= reader.header().date);
+    if (i > 0)
+    {
+      REQUIRE(packets[i].date >= packets[i - 1].date);
+    }
+  }
+
+  SECTION("rewind")
+  {
+    reader.rewind();
+    REQUIRE(read_all(reader).size() == 100);
+  }
+
+  SECTION("seek")
+  {
+    // Only one entry in the index, for the first record.
+    reader.seek(packets.back().date);
+    REQUIRE(read_all(reader).size() == 100);
+  }
+
+  SECTION("without index")
+  {
+    // Drop the footer, as if the capture was not closed.
+    capture_reader truncated{file.data(), file.size() - sizeof(capture_footer)};
+    REQUIRE(not truncated.indexed());
+    REQUIRE(read_all(truncated).size() == 100);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet capture drops packets when its ring is full")
+{
+  auto conf = packet_capture::configuration{};
+  conf.buffer_size = 64;
+  conf.flush_period = std::chrono::milliseconds{10000};
+  packet_capture capture{capture_path, conf};
+
+  const auto bytes = std::string(16, 'x');
+  REQUIRE(capture.record(bytes.data(), bytes.size(), capture_direction::sent));
+  REQUIRE(capture.record(bytes.data(), bytes.size(), capture_direction::sent));
+  REQUIRE(not capture.record(bytes.data(), bytes.size(), capture_direction::sent));
+  REQUIRE(capture.nb_captured() == 2);
+  REQUIRE(capture.nb_dropped() == 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Capture index")
+{
+  {
+    packet_capture capture{capture_path};
+    const auto bytes = std::string(4, 'x');
+    for (auto i = 0u; i < 3 * capture_index_period; ++i)
+    {
+      while (not capture.record(bytes.data(), bytes.size(), capture_direction::sent))
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+  const auto file = read_file(capture_path);
+  std::remove(capture_path.c_str());
+  capture_reader reader{file.data(), file.size()};
+  REQUIRE(reader.nb_records() == 3 * capture_index_period);
+  const auto packets = read_all(reader);
+  REQUIRE(packets.size() == 3 * capture_index_period);
+
+  // Dates may be equal, seek to the first record of the last indexed block with this date.
+  const auto last = packets.back().date;
+  reader.seek(last);
+  const auto tail = read_all(reader);
+  REQUIRE(tail.size() <= capture_index_period);
+  REQUIRE(tail.back().date == last);
+
+  reader.seek(packets.front().date - 1);
+  REQUIRE(read_all(reader).size() == packets.size());
+
+  // Entries of the index are checked.
+  auto footer = capture_footer{};
+  std::memcpy(&footer, file.data() + file.size() - sizeof(capture_footer), sizeof(footer));
+  auto corrupted = file;
+  auto entry = capture_index_entry{};
+  std::memcpy(&entry, file.data() + footer.index_offset, sizeof(entry));
+  entry.offset = footer.index_offset;
+  std::memcpy(&corrupted[footer.index_offset], &entry, sizeof(entry));
+  REQUIRE_THROWS_AS(capture_reader(corrupted.data(), corrupted.size()), capture_format_error);
+
+  // An index which can't fit in the file is ignored.
+  corrupted = file;
+  footer.nb_index_entries = ~std::uint64_t{0} / sizeof(capture_index_entry) + 2;
+  std::memcpy(&corrupted[file.size() - sizeof(capture_footer)], &footer, sizeof(footer));
+  capture_reader unindexed{corrupted.data(), corrupted.size()};
+  REQUIRE(not unindexed.indexed());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Invalid capture")
+{
+  const auto bytes = std::vector<char>(64, 'x');
+  REQUIRE_THROWS_AS(capture_reader(bytes.data(), bytes.size()), capture_format_error);
+  REQUIRE_THROWS_AS(capture_reader(bytes.data(), 8), capture_format_error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder captures incoming packets")
+{
+  encoder<packet_handler> enc{8, packet_handler{}};
+  enc.set_rate(2);
+  decoder<packet_handler, data_handler> dec{8, in_order::yes, packet_handler{}, data_handler{}};
+
+  const auto s0 = {'a','b','c','d'};
+  enc(data{begin(s0), end(s0)});
+  enc(data{begin(s0), end(s0)});
+  REQUIRE(enc.packet_handler().nb_packets() == 3);
+
+  dec(enc.packet_handler()[0]);
+  {
+    packet_capture capture{capture_path};
+    dec.set_capture(&capture);
+    REQUIRE(dec.capture() == &capture);
+    dec(enc.packet_handler()[1]);
+    const auto& repair = enc.packet_handler()[2];
+    dec(repair.data(), repair.size());
+    dec.set_capture(nullptr);
+    REQUIRE(capture.nb_captured() == 2);
+  }
+
+  const auto file = read_file(capture_path);
+  std::remove(capture_path.c_str());
+  capture_reader reader{file.data(), file.size()};
+  const auto packets = read_all(reader);
+  REQUIRE(packets.size() == 2);
+  for (auto i = 0ul; i < 2; ++i)
+  {
+    const auto& p = enc.packet_handler()[i + 1];
+    REQUIRE(packets[i].size == p.size());
+    REQUIRE(std::equal(p.begin(), p.end(), packets[i].data));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <thread>
+
+#include <catch.hpp>
+
+#include "netcode/packet_queue.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packet queues re-use the memory of consumed packets")
+{
+  spsc_packet_queue q{2};
+
+  packet p(1000, 'a');
+  const auto data = p.data();
+  REQUIRE(q.try_push(p));
+  REQUIRE(p.size() == 0);
+
+  packet out;
+  REQUIRE(q.try_pop(out));
+  REQUIRE(out.size() == 1000);
+  REQUIRE(out.data() == data);
+  REQUIRE_FALSE(q.try_pop(out));
+
+  // Give the consumed packet back, it goes round the ring to the producer.
+  REQUIRE(q.pop_batch([](packet&){}) == 0);
+  REQUIRE(q.try_push(packet{'b'}));
+  REQUIRE(q.try_pop(out));
+  REQUIRE(out.size() == 1);
+  REQUIRE(q.try_push(p));
+  REQUIRE(q.try_push(p));
+  REQUIRE(p.capacity() >= 1000);
+  REQUIRE(p.size() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("MPSC packet queue hands packets over in batches")
+{
+  mpsc_packet_queue q{64};
+  const auto nb = 1000ul;
+
+  std::thread producer0{[&]
+  {
+    packet p;
+    for (auto i = 0ul; i < nb; ++i)
+    {
+      p.assign(16, 'x');
+      while (not q.try_push(p))
+      {
+        std::this_thread::yield();
+      }
+    }
+  }};
+  std::thread producer1{[&]
+  {
+    packet p;
+    for (auto i = 0ul; i < nb; ++i)
+    {
+      p.assign(32, 'y');
+      while (not q.try_push(p))
+      {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  auto nb_x = 0ul;
+  auto nb_y = 0ul;
+  auto valid = true;
+  while (nb_x + nb_y < 2 * nb)
+  {
+    q.pop_batch([&](const packet& p)
+                {
+                  if (p.size() == 16)
+                  {
+                    valid = valid and std::all_of(p.begin(), p.end(), [](char c){return c == 'x';});
+                    ++nb_x;
+                  }
+                  else
+                  {
+                    valid = valid and std::all_of(p.begin(), p.end(), [](char c){return c == 'y';});
+                    ++nb_y;
+                  }
+                }, 16);
+  }
+  producer0.join();
+  producer1.join();
+  REQUIRE(valid);
+  REQUIRE(nb_x == nb);
+  REQUIRE(nb_y == nb);
+  REQUIRE(q.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
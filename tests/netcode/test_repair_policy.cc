@@ -0,0 +1,169 @@
+#include <algorithm> // count_if
+#include <chrono>
+#include <memory>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+#include "tests/netcode/launch.hh"
+
+#include "netcode/detail/packet_type.hh"
+#include "netcode/encoder.hh"
+#include "netcode/repair_policy.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+// Drive a policy like an encoder would do, with a repair as large as the last source.
+std::size_t
+send(repair_policy& policy, std::uint32_t id, std::size_t size
+    , std::chrono::steady_clock::time_point date = {})
+{
+  const auto nb = policy.on_source(source_event{id, size, 5, date});
+  for (auto i = 0ul; i < nb; ++i)
+  {
+    policy.on_repair(size);
+  }
+  return nb;
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Fixed rate policy sends a repair every rate sources")
+{
+  fixed_rate_policy policy;
+
+  auto nb_repairs = 0ul;
+  for (auto id = 0u; id < 100; ++id)
+  {
+    nb_repairs += send(policy, id, 100);
+  }
+  REQUIRE(nb_repairs == 20);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Byte ratio policy follows the target ratio with mixed sizes")
+{
+  byte_ratio_policy policy{0.25};
+
+  auto source_bytes = 0ul;
+  auto repair_bytes = 0ul;
+  for (auto id = 0u; id < 1000; ++id)
+  {
+    const auto size = id % 3 == 0 ? 1000ul : 100ul;
+    source_bytes += size;
+    repair_bytes += send(policy, id, size) * size;
+  }
+
+  const auto ratio = static_cast<double>(repair_bytes) / static_cast<double>(source_bytes);
+  REQUIRE(ratio > 0.24);
+  REQUIRE(ratio < 0.26);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Spread policy sends at most one repair per source")
+{
+  spread_policy policy{std::unique_ptr<repair_policy>{new byte_ratio_policy{1.0}}};
+
+  // A large source followed by small ones: repairs are delayed rather than sent in a burst.
+  REQUIRE(send(policy, 0, 100) == 1);
+  REQUIRE(send(policy, 1, 400) == 1);
+  for (auto id = 2u; id < 100; ++id)
+  {
+    REQUIRE(send(policy, id, 100) <= 1);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Token bucket policy paces repairs")
+{
+  using namespace std::chrono;
+
+  // 1000 bytes per second, repairs are 100 bytes large, at most 2 repairs in a burst.
+  token_bucket_policy policy{ std::unique_ptr<repair_policy>{new byte_ratio_policy{1.0}}, 1000
+                            , 200};
+
+  // Send 1000 sources in one simulated second.
+  auto date = steady_clock::time_point{} + seconds{1};
+  auto nb_repairs = 0ul;
+  for (auto id = 0u; id < 1000; ++id)
+  {
+    nb_repairs += send(policy, id, 100, date);
+    date += milliseconds{1};
+  }
+
+  // The initial burst plus what the bucket received during a second.
+  REQUIRE(nb_repairs >= 10);
+  REQUIRE(nb_repairs <= 12);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Repair policies handle empty sources")
+{
+  // Before any repair, the cost of the next one is guessed from an empty source.
+  byte_ratio_policy ratio{1.0};
+  REQUIRE(ratio.on_source(source_event{0, 0, 5, {}}) == 0);
+
+  // An empty bucket doesn't let repairs through, even for empty sources.
+  token_bucket_policy bucket{std::unique_ptr<repair_policy>{new fixed_rate_policy}, 1000, 0};
+  for (auto id = 0u; id < 20; ++id)
+  {
+    REQUIRE(bucket.on_source(source_event{id, 0, 1, {}}) == 0);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder uses its repair policy")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_repair_policy(std::unique_ptr<repair_policy>{
+      new repair_timeline{std::unique_ptr<repair_policy>{new byte_ratio_policy{0.5}}}});
+
+    const auto& timeline = static_cast<const repair_timeline&>(enc.repair_policy()).events();
+
+    const auto s0 = {'a','a','a','a'};
+    const auto s1 = {'b','b','b','b','b','b','b','b'};
+    enc(data{begin(s0), end(s0)});
+    enc(data{begin(s0), end(s0)});
+    enc(data{begin(s1), end(s1)});
+    enc.generate_repair();
+
+    // Two sources of 4 bytes earn a repair, the larger third source earns another one, then a
+    // repair is forced. Repairs are as large as the largest source in the window.
+    REQUIRE(timeline.size() == 6);
+    REQUIRE(timeline[0].type == repair_timeline::event::kind::source);
+    REQUIRE(timeline[1].type == repair_timeline::event::kind::source);
+    REQUIRE(timeline[2].type == repair_timeline::event::kind::repair);
+    REQUIRE(timeline[2].size == 4);
+    REQUIRE(timeline[3].type == repair_timeline::event::kind::source);
+    REQUIRE(timeline[3].size == 8);
+    REQUIRE(timeline[4].type == repair_timeline::event::kind::repair);
+    REQUIRE(timeline[4].size == 8);
+    REQUIRE(timeline[5].type == repair_timeline::event::kind::repair);
+    REQUIRE(timeline[5].size == 8);
+
+    // The timeline matches what was really sent.
+    const auto& handler = enc.packet_handler();
+    REQUIRE(handler.nb_packets() == 6);
+    REQUIRE(detail::get_packet_type(handler[1]) == detail::packet_type::source);
+    REQUIRE(detail::get_packet_type(handler[2]) == detail::packet_type::repair);
+    REQUIRE(detail::get_packet_type(handler[3]) == detail::packet_type::source);
+    REQUIRE(detail::get_packet_type(handler[4]) == detail::packet_type::repair);
+    REQUIRE(detail::get_packet_type(handler[5]) == detail::packet_type::repair);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,64 @@
+#include <atomic>
+#include <thread>
+
+#include <catch.hpp>
+
+#include "netcode/seqlock.hh"
+#include "netcode/statistics.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Seqlock gives the last published value")
+{
+  seqlock<encoder_statistics> lock;
+  REQUIRE(lock.load().nb_sent_sources == 0);
+
+  auto stats = encoder_statistics{};
+  stats.nb_sent_sources = 42;
+  stats.repair_overhead = 0.25;
+  lock.store(stats);
+  REQUIRE(lock.load().nb_sent_sources == 42);
+  REQUIRE(lock.load().repair_overhead == 0.25);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Seqlock readers never see a torn value")
+{
+  seqlock<decoder_statistics> lock;
+  std::atomic<bool> done{false};
+
+  std::thread writer{[&]
+  {
+    auto stats = decoder_statistics{};
+    for (auto i = 1ul; i <= 100000; ++i)
+    {
+      // All fields of a published value are equal.
+      stats.nb_received_sources = i;
+      stats.nb_decoded = i;
+      stats.full_decoding_max_ns = i;
+      lock.store(stats);
+    }
+    done = true;
+  }};
+
+  auto last = 0ul;
+  auto torn = false;
+  while (not done)
+  {
+    const auto stats = lock.load();
+    torn = torn or stats.nb_received_sources != stats.nb_decoded
+                or stats.nb_decoded != stats.full_decoding_max_ns
+                or stats.nb_decoded < last;
+    last = stats.nb_decoded;
+  }
+  writer.join();
+  REQUIRE(not torn);
+  REQUIRE(lock.load().nb_decoded == 100000);
+}
+
+/*------------------------------------------------------------------------------------------------*/
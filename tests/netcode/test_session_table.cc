@@ -0,0 +1,216 @@
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+#include "tests/netcode/launch.hh"
+
+#include "netcode/session_table.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+struct flow_data_handler
+{
+  std::vector<std::pair<std::uint32_t, std::vector<char>>> data;
+
+  void
+  operator()(std::uint32_t id, const char* src, std::size_t len)
+  {
+    data.emplace_back(id, std::vector<char>(src, src + len));
+  }
+};
+
+using table_type = session_table<packet_handler, flow_data_handler>;
+
+// Forward packets written by a table since the last call to another table.
+void
+forward(table_type& from, std::size_t& nb_forwarded, table_type& to)
+{
+  for (; nb_forwarded < from.packet_handler().nb_packets(); ++nb_forwarded)
+  {
+    to(from.packet_handler()[nb_forwarded]);
+  }
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table prefixes packets with the flow identifier")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    table_type table{gf_size, in_order::yes, packet_handler{}, flow_data_handler{}};
+
+    const auto s0 = {'a','b','c','d'};
+    table(0x01020304, data{begin(s0), end(s0)});
+    REQUIRE(table.size() == 1);
+    REQUIRE(table.find(0x01020304) != nullptr);
+    REQUIRE(table.find(0) == nullptr);
+
+    const auto& p = table.packet_handler()[0];
+    REQUIRE(p.size() == detail::flow_header_size + 7 + s0.size());
+    REQUIRE(p[0] == 1);
+    REQUIRE(p[1] == 2);
+    REQUIRE(p[2] == 3);
+    REQUIRE(p[3] == 4);
+    REQUIRE(detail::get_packet_type(p.data() + 4, p.size() - 4) == detail::packet_type::source);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table dispatches packets by flow")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    table_type sender{gf_size, in_order::yes, packet_handler{}, flow_data_handler{}};
+    table_type receiver{gf_size, in_order::yes, packet_handler{}, flow_data_handler{}};
+
+    auto nb_new_sessions = 0ul;
+    receiver.set_new_session_handler([&](std::uint32_t, table_type::session& s)
+    {
+      ++nb_new_sessions;
+      s.decoder().set_ack_nb_packets(2).set_ack_period(std::chrono::milliseconds{0});
+    });
+
+    auto nb_to_receiver = 0ul;
+    auto nb_to_sender = 0ul;
+    for (auto i = 0u; i < 10; ++i)
+    {
+      for (auto flow = 0u; flow < 3; ++flow)
+      {
+        const auto d = std::vector<char>(8, static_cast<char>('a' + flow));
+        sender(flow * 1000, data(d.begin(), d.end()));
+      }
+    }
+    forward(sender, nb_to_receiver, receiver);
+    forward(receiver, nb_to_sender, sender);
+
+    REQUIRE(receiver.size() == 3);
+    REQUIRE(nb_new_sessions == 3);
+
+    // Each flow's data was given to the handler with its flow identifier.
+    REQUIRE(receiver.data_handler().data.size() == 30);
+    for (const auto& flow_data : receiver.data_handler().data)
+    {
+      REQUIRE(flow_data.second == std::vector<char>(8, static_cast<char>('a' + flow_data.first/1000)));
+    }
+
+    // Acks were routed to the encoder of each flow.
+    for (auto flow = 0u; flow < 3; ++flow)
+    {
+      receiver.find(flow * 1000)->decoder().generate_ack();
+    }
+    forward(receiver, nb_to_sender, sender);
+    for (auto flow = 0u; flow < 3; ++flow)
+    {
+      REQUIRE(sender.find(flow * 1000)->encoder().nb_received_acks() > 0);
+      REQUIRE(sender.find(flow * 1000)->encoder().window() == 0);
+    }
+
+    // Acks of unknown flows are ignored.
+    REQUIRE(sender.close(0));
+    REQUIRE_FALSE(sender.close(0));
+    REQUIRE(sender.size() == 2);
+    receiver.find(0)->decoder().generate_ack();
+    REQUIRE(sender(receiver.packet_handler()[receiver.packet_handler().nb_packets() - 1]) == 0);
+    REQUIRE(sender.size() == 2);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table recovers losses on each flow")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    table_type sender{gf_size, in_order::yes, packet_handler{}, flow_data_handler{}};
+    table_type receiver{gf_size, in_order::yes, packet_handler{}, flow_data_handler{}};
+
+    for (auto flow = 0u; flow < 2; ++flow)
+    {
+      sender.open(flow).encoder().set_rate(2);
+      for (auto i = 0u; i < 2; ++i)
+      {
+        const auto d = std::vector<char>(16, static_cast<char>(flow * 2 + i));
+        sender(flow, data(d.begin(), d.end()));
+      }
+    }
+    // Flow 0: source 0, source 1, repair; flow 1: source 0, source 1, repair.
+    REQUIRE(sender.packet_handler().nb_packets() == 6);
+
+    // Lose the first source of each flow.
+    receiver(sender.packet_handler()[1]);
+    receiver(sender.packet_handler()[2]);
+    receiver(sender.packet_handler()[4]);
+    receiver(sender.packet_handler()[5]);
+
+    const auto& received = receiver.data_handler().data;
+    REQUIRE(received.size() == 4);
+    REQUIRE(receiver.find(0)->decoder().nb_decoded() == 1);
+    REQUIRE(receiver.find(1)->decoder().nb_decoded() == 1);
+    for (const auto& flow_data : received)
+    {
+      REQUIRE(flow_data.second.size() == 16);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table rejects packets without a flow header")
+{
+  table_type table{8, in_order::yes, packet_handler{}, flow_data_handler{}};
+  REQUIRE_THROWS_AS(table(packet{0,0,0}), packet_type_error);
+  REQUIRE_THROWS_AS(table(packet{0,0,0,1,42}), packet_type_error);
+  REQUIRE(table.size() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table bounds sessions opened by incoming packets")
+{
+  table_type sender{8, in_order::yes, packet_handler{}, flow_data_handler{}};
+  table_type receiver{8, in_order::yes, packet_handler{}, flow_data_handler{}};
+  receiver.set_max_sessions(2);
+  receiver.set_admission_handler([](std::uint32_t id){return id != 42;});
+
+  const auto s0 = {'a','b','c','d'};
+  for (const auto flow : {1u, 42u, 2u, 3u})
+  {
+    sender(flow, data{begin(s0), end(s0)});
+  }
+  auto nb_forwarded = 0ul;
+  forward(sender, nb_forwarded, receiver);
+
+  REQUIRE(receiver.size() == 2);
+  REQUIRE(receiver.find(1) != nullptr);
+  REQUIRE(receiver.find(2) != nullptr);
+  REQUIRE(receiver.data_handler().data.size() == 2);
+
+  // The application can still open sessions.
+  receiver.open(3);
+  REQUIRE(receiver.size() == 3);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Idle sessions are small")
+{
+  table_type table{8, in_order::yes, packet_handler{}, flow_data_handler{}};
+  for (auto flow = 0u; flow < 1000; ++flow)
+  {
+    table.open(flow);
+  }
+  REQUIRE(table.size() == 1000);
+  INFO("session " << sizeof(table_type::session) << " bytes");
+  REQUIRE(sizeof(table_type::session) < 800);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,273 @@
+#include <atomic>
+#include <chrono>
+#include <ctime>     // clock
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+
+#include "netcode/sharded_engine.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+struct flow_data_handler
+{
+  std::vector<std::pair<std::uint32_t, std::vector<char>>> data;
+
+  void
+  operator()(std::uint32_t id, const char* src, std::size_t len)
+  {
+    data.emplace_back(id, std::vector<char>(src, src + len));
+  }
+};
+
+using engine_type = sharded_engine<packet_handler, flow_data_handler>;
+
+// The data sent on a flow: its identifier followed by a sequence number.
+ntc::data
+mk_data(std::uint32_t id, std::uint32_t seq)
+{
+  auto d = ntc::data(8);
+  std::copy_n(reinterpret_cast<const char*>(&id), 4, d.data());
+  std::copy_n(reinterpret_cast<const char*>(&seq), 4, d.data() + 4);
+  d.resize(8);
+  return d;
+}
+
+// Send and receive data on several flows through two engines, check that each flow receives all
+// its data in order.
+void
+test_flows(const engine_type::configuration& conf)
+{
+  const auto nb_flows = 40u;
+  const auto nb_data = 50u;
+
+  engine_type sender{conf, 8, in_order::yes, packet_handler{}, flow_data_handler{}};
+  sender.start();
+
+  // Each producer sends data of a subset of flows.
+  std::vector<std::thread> producers;
+  for (auto producer = 0ul; producer < conf.nb_producers; ++producer)
+  {
+    producers.emplace_back([&, producer]
+    {
+      for (auto seq = 0u; seq < nb_data; ++seq)
+      {
+        for (auto id = static_cast<std::uint32_t>(producer); id < nb_flows
+            ; id += static_cast<std::uint32_t>(conf.nb_producers))
+        {
+          auto d = mk_data(id, seq);
+          while (not sender.push(producer, id, std::move(d)))
+          {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+  }
+  for (auto& producer : producers)
+  {
+    producer.join();
+  }
+  sender.stop();
+
+  // Give all sent packets to the receiving engine.
+  engine_type receiver{conf, 8, in_order::yes, packet_handler{}, flow_data_handler{}};
+  receiver.start();
+  for (auto i = 0ul; i < sender.nb_shards(); ++i)
+  {
+    const auto& handler = sender.shard(i).packet_handler();
+    for (auto j = 0ul; j < handler.nb_packets(); ++j)
+    {
+      auto p = handler[j];
+      while (not receiver.push(0, std::move(p)))
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+  receiver.stop();
+
+  // Gather received data by flow.
+  std::map<std::uint32_t, std::vector<std::uint32_t>> received;
+  for (auto i = 0ul; i < receiver.nb_shards(); ++i)
+  {
+    for (const auto& flow_data : receiver.shard(i).data_handler().data)
+    {
+      REQUIRE(flow_data.second.size() == 8);
+      std::uint32_t id;
+      std::uint32_t seq;
+      std::copy_n(flow_data.second.data(), 4, reinterpret_cast<char*>(&id));
+      std::copy_n(flow_data.second.data() + 4, 4, reinterpret_cast<char*>(&seq));
+      REQUIRE(id == flow_data.first);
+      REQUIRE(receiver.shard_index(id) == i);
+      received[id].push_back(seq);
+    }
+  }
+
+  REQUIRE(received.size() == nb_flows);
+  for (const auto& flow : received)
+  {
+    REQUIRE(flow.second.size() == nb_data);
+    for (auto seq = 0u; seq < nb_data; ++seq)
+    {
+      REQUIRE(flow.second[seq] == seq);
+    }
+  }
+
+  if (not conf.work_stealing)
+  {
+    REQUIRE(sender.nb_stolen() == 0);
+    REQUIRE(receiver.nb_stolen() == 0);
+  }
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Sharded engine spreads flows on shards")
+{
+  auto conf = engine_type::configuration{};
+  conf.nb_workers = 4;
+  conf.nb_shards_per_worker = 4;
+  engine_type engine{conf, 8, in_order::yes, packet_handler{}, flow_data_handler{}};
+  REQUIRE(engine.nb_shards() == 16);
+
+  std::vector<std::size_t> nb_flows(engine.nb_shards());
+  for (auto id = 0u; id < 1600; ++id)
+  {
+    nb_flows[engine.shard_index(id)] += 1;
+  }
+  for (const auto nb : nb_flows)
+  {
+    REQUIRE(nb > 50);
+    REQUIRE(nb < 150);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Sharded engine processes flows")
+{
+  auto conf = engine_type::configuration{};
+  conf.nb_workers = 3;
+  conf.nb_shards_per_worker = 2;
+  conf.queue_capacity = 16;
+
+  SECTION("One producer")
+  {
+    conf.nb_producers = 1;
+    test_flows(conf);
+  }
+
+  SECTION("Several producers")
+  {
+    conf.nb_producers = 3;
+    test_flows(conf);
+  }
+
+  SECTION("Without work stealing")
+  {
+    conf.nb_producers = 2;
+    conf.work_stealing = false;
+    test_flows(conf);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Sharded engine rejects packets without a flow header")
+{
+  auto conf = engine_type::configuration{};
+  conf.nb_workers = 1;
+  engine_type engine{conf, 8, in_order::yes, packet_handler{}, flow_data_handler{}};
+  REQUIRE_THROWS_AS(engine.push(0, packet{1,2}), packet_type_error);
+
+  // Garbage with a flow header is dropped by the worker.
+  REQUIRE(engine.push(0, packet{0,0,0,1,42}));
+  engine.start();
+  engine.stop();
+  REQUIRE(engine.shard(engine.shard_index(1)).size() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Sharded engine drops tasks which throw")
+{
+  // Fails to send any packet.
+  struct throwing_packet_handler
+  {
+    void
+    operator()(const char*, std::size_t)
+    {
+      throw std::runtime_error{"no route"};
+    }
+
+    void
+    operator()()
+    {}
+  };
+
+  auto conf = sharded_engine<throwing_packet_handler, flow_data_handler>::configuration{};
+  conf.nb_workers = 1;
+  sharded_engine<throwing_packet_handler, flow_data_handler>
+    engine{conf, 8, in_order::yes, throwing_packet_handler{}, flow_data_handler{}};
+  std::atomic<std::uint32_t> ids_sum{0};
+  engine.set_error_handler([&](std::uint32_t id, std::exception_ptr e)
+                           {
+                             // Called by the worker, Catch's assertions are not thread-safe.
+                             try
+                             {
+                               std::rethrow_exception(e);
+                             }
+                             catch (const std::runtime_error&)
+                             {
+                               ids_sum += id;
+                             }
+                           });
+
+  // The shard is released after a failure, thus the engine can still be stopped and restarted.
+  for (auto round = 0u; round < 2; ++round)
+  {
+    engine.start();
+    for (auto id = 0u; id < 10; ++id)
+    {
+      REQUIRE(engine.push(0, id, mk_data(id, 0)));
+    }
+    engine.stop();
+  }
+  REQUIRE(engine.nb_errors() == 20);
+  REQUIRE(ids_sum == 90);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Sharded engine sleeps when idle")
+{
+  auto conf = engine_type::configuration{};
+  conf.nb_workers = 2;
+  engine_type engine{conf, 8, in_order::yes, packet_handler{}, flow_data_handler{}};
+  engine.start();
+
+  const auto cpu_start = std::clock();
+  std::this_thread::sleep_for(std::chrono::milliseconds{200});
+  const auto cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  REQUIRE(cpu < 0.1);
+
+  // Workers are woken up by new tasks.
+  REQUIRE(engine.push(0, 1, mk_data(1, 0)));
+  engine.stop();
+  REQUIRE(engine.shard(engine.shard_index(1)).size() == 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
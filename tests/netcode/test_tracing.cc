@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+#include "tests/netcode/launch.hh"
+
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/ring_tracing.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+using event = std::tuple<trace_event, std::uint32_t, std::uint32_t>;
+
+struct recording_tracer
+{
+  std::vector<event>* events;
+
+  void
+  operator()(trace_event e, std::uint32_t id, std::uint32_t size)
+  const
+  {
+    events->emplace_back(e, id, size);
+  }
+};
+
+std::size_t
+count(const std::vector<event>& events, trace_event e)
+{
+  const auto has_type = [&](const event& x){return std::get<0>(x) == e;};
+  return static_cast<std::size_t>(std::count_if(events.begin(), events.end(), has_type));
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder and decoder report events to their tracer")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    std::vector<event> enc_events;
+    std::vector<event> dec_events;
+
+    encoder<packet_handler, recording_tracer> enc{ gf_size, packet_handler{}
+                                                 , recording_tracer{&enc_events}};
+    enc.set_rate(2);
+    decoder<packet_handler, data_handler, recording_tracer> dec{ gf_size, in_order::yes
+                                                               , packet_handler{}, data_handler{}
+                                                               , recording_tracer{&dec_events}};
+    dec.set_ack_nb_packets(100);
+
+    const auto s0 = {'a','b','c','d'};
+    enc(data{begin(s0), end(s0)});
+    const auto s1 = {'e','f','g','h'};
+    enc(data{begin(s1), end(s1)});
+    REQUIRE(enc.packet_handler().nb_packets() == 3 /* 2 sources + 1 repair */);
+
+    REQUIRE(count(enc_events, trace_event::source_committed) == 2);
+    REQUIRE(count(enc_events, trace_event::repair_emitted) == 1);
+    REQUIRE(enc_events[0] == event(trace_event::source_committed, 0, 4));
+
+    SECTION("Lost source")
+    {
+      dec(enc.packet_handler()[1]);
+      dec(enc.packet_handler()[2]);
+      REQUIRE(count(dec_events, trace_event::source_received) == 1);
+      REQUIRE(count(dec_events, trace_event::repair_received) == 1);
+      REQUIRE(count(dec_events, trace_event::repair_useless) == 0);
+      REQUIRE(count(dec_events, trace_event::source_delivered) == 2);
+      REQUIRE(std::get<1>(dec_events.back()) == 1 /* delivered in order */);
+    }
+
+    SECTION("Useless repair")
+    {
+      dec(enc.packet_handler()[0]);
+      dec(enc.packet_handler()[1]);
+      dec(enc.packet_handler()[2]);
+      REQUIRE(count(dec_events, trace_event::source_received) == 2);
+      REQUIRE(count(dec_events, trace_event::repair_useless) == 1);
+      REQUIRE(std::get<0>(dec_events.back()) == trace_event::repair_useless);
+      REQUIRE(std::get<1>(dec_events.back()) == 0);
+    }
+
+    SECTION("Ack")
+    {
+      dec(enc.packet_handler()[0]);
+      dec.generate_ack();
+      REQUIRE(dec_events.back() == event(trace_event::ack_sent, 1, 0));
+      enc(dec.packet_handler()[0]);
+      REQUIRE(std::get<0>(enc_events.back()) == trace_event::ack_received);
+      REQUIRE(std::get<1>(enc_events.back()) == 1);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Ring tracing records are drained by another thread")
+{
+  trace_collector collector{1024};
+
+  encoder<packet_handler, ring_tracing> enc{8, packet_handler{}, ring_tracing{collector, 42}};
+  enc.set_rate(4);
+
+  std::thread producer{[&]
+  {
+    const auto s = {'a','b','c','d'};
+    for (auto i = 0; i < 100; ++i)
+    {
+      enc(data{begin(s), end(s)});
+    }
+  }};
+  producer.join();
+
+  auto nb_sources = 0ul;
+  auto last_date = std::int64_t{0};
+  const auto nb = collector.drain([&](const trace_record& r)
+  {
+    REQUIRE(r.tag == 42);
+    REQUIRE(r.date >= last_date);
+    last_date = r.date;
+    if (r.event == trace_event::source_committed)
+    {
+      REQUIRE(r.id == nb_sources);
+      ++nb_sources;
+    }
+  });
+  REQUIRE(nb == 125 /* 100 sources, 25 repairs */);
+  REQUIRE(nb_sources == 100);
+  REQUIRE(collector.nb_dropped() == 0);
+  REQUIRE(collector.drain([](const trace_record&){}) == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Ring tracing drops records when a ring is full")
+{
+  trace_collector collector{4};
+  const auto tracer = ring_tracing{collector};
+  for (auto i = 0u; i < 10; ++i)
+  {
+    tracer(trace_event::source_delivered, i, 0);
+  }
+  REQUIRE(collector.nb_dropped() == 6);
+
+  std::vector<std::uint32_t> ids;
+  collector.drain([&](const trace_record& r){ids.push_back(r.id);});
+  REQUIRE((ids == std::vector<std::uint32_t>{0, 1, 2, 3}));
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -10,9 +10,10 @@ class burst
 {
 public:
 
-  burst(unsigned int good, unsigned int bad)
+  burst( unsigned int good, unsigned int bad
+       , std::default_random_engine::result_type seed = std::default_random_engine::default_seed)
     : m_state{state::good}
-    , m_gen{}
+    , m_gen{seed}
     , m_dist{1, 100}
     , m_good{good}
     , m_bad{bad}
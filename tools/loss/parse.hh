@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept> // invalid_argument
+#include <string>
+
+#include "tools/loss/burst.hh"
+#include "tools/loss/uniform.hh"
+
+namespace loss {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Build a loss model from its description
+///
+/// - none
+/// - uniform:T, lose a packet with probability (100 - T)%
+/// - burst:G,B, Gilbert-Elliott, stay in good state with G%, in bad state with B%
+/// @throw std::exception if the description is invalid
+inline
+std::function<bool()>
+parse(const std::string& desc, std::uint32_t seed)
+{
+  if (desc == "none")
+  {
+    return []{return false;};
+  }
+  else if (desc.compare(0, 8, "uniform:") == 0)
+  {
+    return uniform{static_cast<unsigned int>(std::stoul(desc.substr(8))), seed};
+  }
+  else if (desc.compare(0, 6, "burst:") == 0)
+  {
+    const auto comma = desc.find(',');
+    if (comma == std::string::npos)
+    {
+      throw std::invalid_argument{desc};
+    }
+    return burst{ static_cast<unsigned int>(std::stoul(desc.substr(6, comma - 6)))
+                , static_cast<unsigned int>(std::stoul(desc.substr(comma + 1)))
+                , seed};
+  }
+  throw std::invalid_argument{desc};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace loss
@@ -11,8 +11,10 @@ class uniform
 {
 public:
 
-  explicit uniform(unsigned int threshold)
-    : m_gen{}
+  explicit uniform( unsigned int threshold
+                  , std::default_random_engine::result_type seed
+                      = std::default_random_engine::default_seed)
+    : m_gen{seed}
     , m_dist{1, 100}
     , m_threshold{threshold}
   {
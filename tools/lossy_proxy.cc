@@ -1,151 +1,549 @@
-#include <array>
+#include <algorithm> // max, min
+#include <cerrno>
 #include <chrono>
+#include <cstdlib>   // exit
+#include <cstring>   // memcpy, memset, strerror
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <stdexcept> // runtime_error
 #include <string>
+#include <vector>
 
-#include <boost/asio.hpp>
+#include <arpa/inet.h>  // inet_pton
+#include <netdb.h>      // getaddrinfo
+#include <netinet/in.h> // sockaddr_in
+#include <poll.h>       // ppoll
+#include <sys/socket.h> // sendmmsg, recvmmsg
+#include <unistd.h>     // close
 
 #include "tools/loss/burst.hh"
 #include "tools/loss/stream.hh"
 #include "tools/loss/uniform.hh"
+#include "tools/shaping/link.hh"
+#include "tools/shaping/timer_wheel.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
-static std::size_t a_to_b_losses = 0;
-static std::size_t b_to_a_losses = 0;
+// Forward datagrams between a client (A), which sends to from_port, and a server (B). Each
+// direction is a link with its own loss model, followed by a queue limited by a bandwidth, then by
+// a propagation delay. Delayed packets are held in a timer wheel.
 
-static std::size_t a_to_b_total = 0;
-static std::size_t b_to_a_total = 0;
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+using clock_type = std::chrono::steady_clock;
+using duration = std::chrono::nanoseconds;
+
+/*------------------------------------------------------------------------------------------------*/
+
+constexpr auto max_packet_size = 65536ul;
 
 // Frequency of report display
-static unsigned int display_timer = 5;
+constexpr auto display_period = std::chrono::seconds{5};
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct configuration
+{
+  shaping::link_configuration link;
+
+  // The number of packets received or sent with a single system call.
+  std::size_t batch = 64;
+
+  // The precision of delays.
+  duration tick = std::chrono::microseconds{100};
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+class udp_socket final
+{
+public:
+
+  udp_socket(const udp_socket&) = delete;
+  udp_socket& operator=(const udp_socket&) = delete;
+
+  explicit udp_socket(unsigned short port)
+    : m_fd{::socket(AF_INET, SOCK_DGRAM, 0)}
+  {
+    if (m_fd < 0)
+    {
+      throw std::runtime_error{std::string{"socket: "} + std::strerror(errno)};
+    }
+    const auto buffer_size = 8 * 1024 * 1024;
+    ::setsockopt(m_fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    ::setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    auto addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(m_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+      ::close(m_fd);
+      throw std::runtime_error{std::string{"bind: "} + std::strerror(errno)};
+    }
+  }
+
+  ~udp_socket()
+  {
+    ::close(m_fd);
+  }
+
+  int
+  fd()
+  const noexcept
+  {
+    return m_fd;
+  }
+
+private:
+
+  const int m_fd;
+};
 
 /*------------------------------------------------------------------------------------------------*/
 
-using boost::asio::ip::address_v4;
-using boost::asio::ip::udp;
+sockaddr_in
+resolve(const std::string& host, const std::string& port)
+{
+  auto hints = addrinfo{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo* res = nullptr;
+  if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 or res == nullptr)
+  {
+    throw std::runtime_error{"Can't resolve " + host + ":" + port};
+  }
+  auto addr = sockaddr_in{};
+  std::memcpy(&addr, res->ai_addr, sizeof(addr));
+  ::freeaddrinfo(res);
+  return addr;
+}
 
 /*------------------------------------------------------------------------------------------------*/
 
+// Packets waiting in the wheel or to be sent; buffers are recycled.
+class packet_pool
+{
+public:
+
+  std::uint32_t
+  acquire(const char* data, std::size_t size)
+  {
+    auto index = std::uint32_t{0};
+    if (m_free.empty())
+    {
+      index = static_cast<std::uint32_t>(m_buffers.size());
+      m_buffers.emplace_back();
+    }
+    else
+    {
+      index = m_free.back();
+      m_free.pop_back();
+    }
+    m_buffers[index].assign(data, data + size);
+    return index;
+  }
+
+  void
+  release(std::uint32_t index)
+  {
+    m_free.push_back(index);
+  }
+
+  std::vector<char>&
+  operator[](std::uint32_t index)
+  noexcept
+  {
+    return m_buffers[index];
+  }
+
+private:
+
+  std::vector<std::vector<char>> m_buffers;
+  std::vector<std::uint32_t> m_free;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Buffers and headers for recvmmsg or sendmmsg.
+struct batch
+{
+  std::vector<char> buffers;
+  std::vector<iovec> iovecs;
+  std::vector<sockaddr_in> addresses;
+  std::vector<mmsghdr> messages;
+
+  explicit batch(std::size_t size, bool receive)
+    : buffers(receive ? size * max_packet_size : 0)
+    , iovecs(size)
+    , addresses(size)
+    , messages(size)
+  {
+    for (auto i = 0ul; i < size; ++i)
+    {
+      if (receive)
+      {
+        iovecs[i].iov_base = buffers.data() + i * max_packet_size;
+        iovecs[i].iov_len = max_packet_size;
+      }
+      std::memset(&messages[i], 0, sizeof(mmsghdr));
+      messages[i].msg_hdr.msg_name = &addresses[i];
+      messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+      messages[i].msg_hdr.msg_iov = &iovecs[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// One way of the proxy.
+template <typename Loss>
+struct direction
+{
+  const char* name;
+  int in_fd;
+  int out_fd;
+
+  // Where packets are sent; A is known when it sends its first packet.
+  sockaddr_in* destination;
+
+  shaping::link<Loss> link;
+  shaping::timer_wheel<std::uint32_t> wheel;
+
+  // Packets to send now.
+  std::vector<std::uint32_t> ready;
+
+  std::size_t nb_sent = 0;
+  std::size_t nb_send_errors = 0;
+
+  direction( const char* n, int in, int out, sockaddr_in* dst, const configuration& conf
+           , Loss loss)
+    : name{n}
+    , in_fd{in}
+    , out_fd{out}
+    , destination{dst}
+    , link{conf.link, std::move(loss)}
+    , wheel{conf.tick, 4096}
+    , ready{}
+  {}
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+duration
+now(clock_type::time_point start)
+{
+  return std::chrono::duration_cast<duration>(clock_type::now() - start);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Receive pending packets, give them to the link. Stop after a few batches to release packets
+// in time under a sustained load.
 template <typename Loss>
 void
-listen( udp::socket& in_socket, udp::endpoint& in_endpoint
-      , udp::socket& out_socket, udp::endpoint& out_endpoint
-      , std::array<char, 4096>& buffer, Loss&& loss, std::size_t& losses, std::size_t& total)
+receive( direction<Loss>& dir, batch& b, packet_pool& pool, sockaddr_in* source
+       , clock_type::time_point start)
 {
-  in_socket.async_receive_from( boost::asio::buffer(buffer), in_endpoint
-                              , [&](const boost::system::error_code& err, std::size_t sz)
-                                {
-                                  if (err)
-                                  {
-                                    throw std::runtime_error(err.message());
-                                  }
-
-                                  // Apply forward/drop packet only if receiving a packet (size > 0)
-                                  if (sz != 0)
-                                  {
-                                    total += 1;
-
-                                    if (not loss())
-                                    {
-                                      out_socket.send_to(boost::asio::buffer(buffer, sz),
-                                                         out_endpoint);
-                                    }
-                                    else
-                                    {
-                                      losses += 1;
-                                    }
-
-                                  }
-
-                                  listen( in_socket, in_endpoint, out_socket, out_endpoint, buffer
-                                        , std::forward<Loss>(loss), losses, total);
-                                }
-                              );
+  for (auto nb_batches = 0; nb_batches < 16; ++nb_batches)
+  {
+    for (auto& m : b.messages)
+    {
+      m.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+    const auto res = ::recvmmsg( dir.in_fd, b.messages.data()
+                               , static_cast<unsigned int>(b.messages.size()), MSG_DONTWAIT
+                               , nullptr);
+    if (res <= 0)
+    {
+      return;
+    }
+    const auto date = now(start);
+    for (auto i = 0ul; i < static_cast<std::size_t>(res); ++i)
+    {
+      if (source)
+      {
+        *source = b.addresses[i];
+      }
+      const auto data = static_cast<const char*>(b.iovecs[i].iov_base);
+      const auto size = static_cast<std::size_t>(b.messages[i].msg_len);
+      dir.link(date, size, [&](duration delivery)
+      {
+        const auto index = pool.acquire(data, size);
+        if (delivery <= date)
+        {
+          dir.ready.push_back(index);
+        }
+        else
+        {
+          dir.wheel.schedule(delivery, index);
+        }
+      });
+    }
+    if (static_cast<std::size_t>(res) < b.messages.size())
+    {
+      return;
+    }
+  }
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
+// Send all ready packets.
+template <typename Loss>
 void
-display(boost::asio::steady_timer& timer)
+send(direction<Loss>& dir, batch& b, packet_pool& pool)
 {
-  timer.expires_from_now(std::chrono::seconds(display_timer));
-  timer.async_wait([&](const boost::system::error_code& err)
-                   {
-                     if (err)
-                     {
-                       throw std::runtime_error(err.message());
-                     }
-                     std::cout << " losses "
-                               << a_to_b_losses << " , "  << b_to_a_losses
-                               << " || total "
-                               << a_to_b_total << " , " << b_to_a_total
-                               << " || % "
-                               << ( static_cast<float>(a_to_b_losses)
-                                  / static_cast<float>(a_to_b_total)) * 100
-                               << " , "
-                               << ( static_cast<float>(b_to_a_losses)
-                                  / static_cast<float>(b_to_a_total)) * 100
-                               << std::endl;
-                     display(timer);
-                   });
+  if (dir.destination->sin_family != AF_INET)
+  {
+    // A didn't send anything yet.
+    for (const auto index : dir.ready)
+    {
+      pool.release(index);
+    }
+    dir.ready.clear();
+    return;
+  }
+  const auto batch_size = b.messages.size();
+  for (auto first = 0ul; first < dir.ready.size(); first += batch_size)
+  {
+    const auto nb = std::min(batch_size, dir.ready.size() - first);
+    for (auto i = 0ul; i < nb; ++i)
+    {
+      auto& buffer = pool[dir.ready[first + i]];
+      b.iovecs[i].iov_base = buffer.data();
+      b.iovecs[i].iov_len = buffer.size();
+      b.addresses[i] = *dir.destination;
+    }
+    auto done = 0ul;
+    while (done < nb)
+    {
+      const auto res = ::sendmmsg( dir.out_fd, b.messages.data() + done
+                                 , static_cast<unsigned int>(nb - done), 0);
+      if (res < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        // E.g. ECONNREFUSED when nobody listens on the destination, drop the first packet.
+        ++dir.nb_send_errors;
+        ++done;
+        continue;
+      }
+      done += static_cast<std::size_t>(res);
+      dir.nb_sent += static_cast<std::size_t>(res);
+    }
+  }
+  for (const auto index : dir.ready)
+  {
+    pool.release(index);
+  }
+  dir.ready.clear();
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 template <typename Loss>
 void
-proxy( unsigned short a_port, const std::string& b_ip, const std::string& b_port, Loss&& loss
-     , Loss&& loss_inverse)
+display(const direction<Loss>& dir)
 {
-  boost::asio::io_service io;
+  const auto& stats = dir.link.statistics();
+  const auto total = static_cast<double>(std::max<std::size_t>(stats.nb_packets, 1));
+  std::cout << dir.name << ": total " << stats.nb_packets << " || sent " << dir.nb_sent
+            << " || losses " << stats.nb_lost << " (" << std::fixed << std::setprecision(2)
+            << static_cast<double>(stats.nb_lost) / total * 100 << "%)"
+            << " || queue drops " << stats.nb_queue_drops
+            << " || reordered " << stats.nb_reordered
+            << " || duplicated " << stats.nb_duplicated
+            << " || in flight " << dir.wheel.size()
+            << " || send errors " << dir.nb_send_errors << '\n';
+}
 
-  udp::socket a_socket{io, udp::endpoint{udp::v4(), a_port}};
-  udp::endpoint a_endpoint;
+/*------------------------------------------------------------------------------------------------*/
 
-  udp::socket b_socket{io, udp::endpoint(udp::v4(), 0)};
-  udp::resolver resolver(io);
-  udp::endpoint b_endpoint = *resolver.resolve({udp::v4(), b_ip, b_port});
+template <typename Loss>
+void
+proxy( unsigned short a_port, const std::string& b_ip, const std::string& b_port
+     , const configuration& conf, Loss loss, Loss loss_inverse)
+{
+  udp_socket a_socket{a_port};
+  udp_socket b_socket{0};
+  auto a_endpoint = sockaddr_in{};
+  auto b_endpoint = resolve(b_ip, b_port);
+
+  auto a_to_b = direction<Loss>{ "A -> B", a_socket.fd(), b_socket.fd(), &b_endpoint, conf
+                               , std::move(loss)};
+  auto b_to_a = direction<Loss>{ "B -> A", b_socket.fd(), a_socket.fd(), &a_endpoint, conf
+                               , std::move(loss_inverse)};
+
+  auto pool = packet_pool{};
+  auto receive_batch = batch{conf.batch, true};
+  auto send_batch = batch{conf.batch, false};
+
+  const auto start = clock_type::now();
+  auto next_display = duration{display_period};
+
+  pollfd fds[2];
+  fds[0].fd = a_socket.fd();
+  fds[0].events = POLLIN;
+  fds[1].fd = b_socket.fd();
+  fds[1].events = POLLIN;
+
+  while (true)
+  {
+    // Sleep until a packet arrives, or until the wheels have packets to release.
+    auto wake_up = next_display;
+    if (not a_to_b.wheel.empty())
+    {
+      wake_up = std::min(wake_up, a_to_b.wheel.next_date());
+    }
+    if (not b_to_a.wheel.empty())
+    {
+      wake_up = std::min(wake_up, b_to_a.wheel.next_date());
+    }
+    const auto timeout = std::max(duration{0}, wake_up - now(start));
+    auto ts = timespec{};
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    if (::ppoll(fds, 2, &ts, nullptr) < 0 and errno != EINTR)
+    {
+      throw std::runtime_error{std::string{"ppoll: "} + std::strerror(errno)};
+    }
 
-  boost::asio::steady_timer timer{io, std::chrono::seconds(display_timer)};
+    if (fds[0].revents & POLLIN)
+    {
+      receive(a_to_b, receive_batch, pool, &a_endpoint, start);
+    }
+    if (fds[1].revents & POLLIN)
+    {
+      receive(b_to_a, receive_batch, pool, nullptr, start);
+    }
 
-  std::array<char, 4096> a_to_b;
-  std::array<char, 4096> b_to_a;
+    const auto date = now(start);
+    a_to_b.wheel.advance(date, [&](std::uint32_t index){a_to_b.ready.push_back(index);});
+    b_to_a.wheel.advance(date, [&](std::uint32_t index){b_to_a.ready.push_back(index);});
+    send(a_to_b, send_batch, pool);
+    send(b_to_a, send_batch, pool);
 
+    if (date >= next_display)
+    {
+      display(a_to_b);
+      display(b_to_a);
+      next_display = date + display_period;
+    }
+  }
+}
 
-  listen( a_socket, a_endpoint, b_socket, b_endpoint, a_to_b, std::forward<Loss>(loss)
-        , a_to_b_losses, a_to_b_total);
+/*------------------------------------------------------------------------------------------------*/
 
-  listen( b_socket, b_endpoint, a_socket, a_endpoint, b_to_a, std::forward<Loss>(loss_inverse)
-       , b_to_a_losses, b_to_a_total);
+[[noreturn]]
+void
+usage(const char* name)
+{
+  std::cerr
+    << "Usage:\n"
+    << name << " from_port to_ip to_port burst p_good p_bad <p_good inverse> <p_bad inverse>"
+    << " [options]\n"
+    << name << " from_port to_ip to_port uniform p <p inverse> [options]\n"
+    << name << " from_port to_ip to_port file <filename> <filename inverse> [options]\n"
+    << "\nOptions, applied to both directions:\n"
+    << "  --delay ms          propagation delay\n"
+    << "  --jitter ms         delays are uniformly distributed in [delay - jitter, delay + jitter]\n"
+    << "  --reorder p         percentage of packets which are not delayed, thus reordered\n"
+    << "  --duplicate p       percentage of packets which are delivered twice\n"
+    << "  --rate kbit/s       bandwidth, unlimited by default\n"
+    << "  --queue n           number of packets waiting for the bandwidth (1000)\n"
+    << "  --batch n           number of packets per system call (64)\n"
+    << "  --tick us           precision of delays (100)\n"
+    << "  --seed n            seed of jitter, reordering and duplication (1)\n";
+  std::exit(1);
+}
 
-  display(timer);
+/*------------------------------------------------------------------------------------------------*/
 
-  io.run();
+configuration
+read_options(int first, int argc, char** argv)
+{
+  auto conf = configuration{};
+  const auto milliseconds = [](const char* s)
+  {
+    return std::chrono::duration_cast<duration>(std::chrono::duration<double, std::milli>{
+                                                  std::stod(s)});
+  };
+  try
+  {
+    for (auto i = first; i < argc; i += 2)
+    {
+      const auto arg = std::string{argv[i]};
+      if (i + 1 == argc)
+      {
+        usage(argv[0]);
+      }
+      const auto value = argv[i + 1];
+      if (arg == "--delay")
+      {
+        conf.link.delay = milliseconds(value);
+      }
+      else if (arg == "--jitter")
+      {
+        conf.link.jitter = milliseconds(value);
+      }
+      else if (arg == "--reorder")
+      {
+        conf.link.reorder = static_cast<unsigned int>(std::stoul(value));
+      }
+      else if (arg == "--duplicate")
+      {
+        conf.link.duplicate = static_cast<unsigned int>(std::stoul(value));
+      }
+      else if (arg == "--rate")
+      {
+        conf.link.rate = std::stoull(value) * 1000;
+      }
+      else if (arg == "--queue")
+      {
+        conf.link.queue_size = std::stoul(value);
+      }
+      else if (arg == "--batch")
+      {
+        conf.batch = std::max(1ul, std::min(1024ul, std::stoul(value)));
+      }
+      else if (arg == "--tick")
+      {
+        conf.tick = std::chrono::microseconds{std::max(1ul, std::stoul(value))};
+      }
+      else if (arg == "--seed")
+      {
+        conf.link.seed = static_cast<std::uint32_t>(std::stoul(value));
+      }
+      else
+      {
+        usage(argv[0]);
+      }
+    }
+  }
+  catch (const std::exception&)
+  {
+    usage(argv[0]);
+  }
+  return conf;
 }
 
+} // namespace unnamed
+
 /*------------------------------------------------------------------------------------------------*/
 
 int
 main(int argc, char** argv)
 {
-  const auto usage = [&]
-  {
-    std::cerr << "Usage:\n";
-    std::cerr << argv[0]
-              << " from_port to_ip to_port burst p_good p_bad <p_good inverse> <p_bad inverse>\n";
-    std::cerr << argv[0]
-              << " from_port to_ip to_port uniform p <p inverse>\n";
-    std::cerr << argv[0]
-              << " from_port to_ip to_port file <filename> <filename inverse>\n";
-    std::exit(1);
-  };
-
-  if (argc != 7 and argc != 9)
+  if (argc < 7)
   {
-    usage();
+    usage(argv[0]);
   }
   try
   {
@@ -155,12 +553,16 @@ main(int argc, char** argv)
 
     if (std::strncmp(argv[4], "burst", 6) == 0)
     {
+      if (argc < 9)
+      {
+        usage(argv[0]);
+      }
       const auto p_good = static_cast<unsigned int>(std::atoi(argv[5]));
       const auto p_bad = static_cast<unsigned int>(std::atoi(argv[6]));
       const auto p_good_inv = static_cast<unsigned int>(std::atoi(argv[7]));
-      const auto p_bad_inv = static_cast<unsigned int>(std::atoi(argv[8]));      
+      const auto p_bad_inv = static_cast<unsigned int>(std::atoi(argv[8]));
 
-      proxy( from_port, to_ip, to_port, loss::burst{p_good, p_bad}
+      proxy( from_port, to_ip, to_port, read_options(9, argc, argv), loss::burst{p_good, p_bad}
            , loss::burst{p_good_inv, p_bad_inv});
     }
     else if (std::strncmp(argv[4], "uniform", 8) == 0)
@@ -168,7 +570,8 @@ main(int argc, char** argv)
       const auto p = static_cast<unsigned int>(std::atoi(argv[5]));
       const auto p_inv = static_cast<unsigned int>(std::atoi(argv[6]));
 
-      proxy(from_port, to_ip, to_port, loss::uniform{100 - p}, loss::uniform{100 - p_inv});
+      proxy( from_port, to_ip, to_port, read_options(7, argc, argv), loss::uniform{100 - p}
+           , loss::uniform{100 - p_inv});
     }
     else if (std::strncmp(argv[4], "file", 5) == 0)
     {
@@ -182,16 +585,18 @@ main(int argc, char** argv)
       {
         std::cerr << "Can't open file " << argv[6] << '\n';
       }
-      proxy(from_port, to_ip, to_port, loss::stream{loss_file_a}, loss::stream{loss_file_b});
+      proxy( from_port, to_ip, to_port, read_options(7, argc, argv), loss::stream{loss_file_a}
+           , loss::stream{loss_file_b});
     }
     else
     {
-      usage();
+      usage(argv[0]);
     }
   }
   catch (const std::exception& e)
   {
     std::cerr << e.what() << '\n';
+    return 2;
   }
   return 0;
 }
@@ -1,103 +1,374 @@
+#include <algorithm> // copy_n
+#include <chrono>
+#include <cstdlib>   // exit
+#include <iomanip>
 #include <iostream>
-#include <fstream>
-#include <stdexcept> // runtime_error
+#include <string>
+#include <thread>
+#include <utility>   // pair
+#include <vector>
 
-#define NTC_DUMP_PACKETS
-#include "netcode/packet.hh"
-#undef NTC_DUMP_PACKETS
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+#include "netcode/detail/packet_type.hh"
+#include "netcode/capture_file.hh"
 #include "netcode/decoder.hh"
-#include "netcode/detail/serialize_packet.hh"
+#include "netcode/encoder.hh"
+#include "netcode/errors.hh"
+#include "netcode/packet.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
-struct packet_handler
+namespace /* unnamed */ {
+
+using clock_type = std::chrono::steady_clock;
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct configuration
 {
+  // Sleep between packets to reproduce the dates of the capture.
+  bool paced = false;
+
+  // Re-encode delivered data.
+  bool encode = true;
+
+  // The number of times the capture is replayed.
+  std::size_t repetitions = 1;
+
+  std::string path;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Collect the acks generated by the decoder, with the number of data delivered at this time.
+struct ack_handler
+{
+  std::vector<std::pair<std::size_t, ntc::packet>>* acks;
+  const std::size_t* nb_delivered;
+  ntc::packet current;
+
   void
-  operator()(const char*, std::size_t)
-  noexcept
-  {}
+  operator()(const char* data, std::size_t sz)
+  {
+    const auto size = current.size();
+    current.resize(size + sz);
+    std::copy_n(data, sz, current.data() + size);
+  }
 
   void
   operator()()
-  noexcept
-  {}
+  {
+    acks->emplace_back(*nb_delivered, std::move(current));
+    current = ntc::packet{};
+  }
 };
 
 /*------------------------------------------------------------------------------------------------*/
 
+// Count delivered data, keep them to be re-encoded if asked to.
 struct data_handler
+{
+  std::vector<ntc::data>* delivered;
+  std::size_t* nb_delivered;
+  std::size_t* nb_delivered_bytes;
+
+  void
+  operator()(const char* data, std::size_t sz)
+  {
+    ++*nb_delivered;
+    *nb_delivered_bytes += sz;
+    if (delivered)
+    {
+      delivered->emplace_back(data, data + sz);
+    }
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct null_packet_handler
 {
   void
   operator()(const char*, std::size_t)
   noexcept
   {}
+
+  void
+  operator()()
+  noexcept
+  {}
 };
 
 /*------------------------------------------------------------------------------------------------*/
 
-int
-main(int argc, const char** argv)
+// A read-only mapping of a whole file.
+class mapped_file final
 {
-  if (argc != 2)
+public:
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  explicit mapped_file(const std::string& path)
+    : m_data{nullptr}
+    , m_size{0}
   {
-    std::cerr << "Usage:\n" << argv[0] << " dump_file\n";
-    std::exit(1);
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+      throw std::runtime_error{"Can't open " + path};
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 or st.st_size == 0)
+    {
+      ::close(fd);
+      throw std::runtime_error{"Can't read " + path};
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+    const auto addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+      throw std::runtime_error{"Can't map " + path};
+    }
+    ::madvise(addr, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(addr);
   }
 
-  try
+  ~mapped_file()
+  {
+    ::munmap(const_cast<char*>(m_data), m_size);
+  }
+
+  const char*
+  data()
+  const noexcept
+  {
+    return m_data;
+  }
+
+  std::size_t
+  size()
+  const noexcept
   {
-    std::ifstream dump_file{argv[1]};
-    if (not dump_file.is_open())
+    return m_size;
+  }
+
+private:
+
+  const char* m_data;
+  std::size_t m_size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+[[noreturn]]
+void
+usage(const char* name)
+{
+  std::cerr
+    << "Usage:\n" << name << " [--paced] [--no-encode] [--repetitions n] capture_file\n\n"
+    << "Received sources and repairs are given to a decoder, received acks to an encoder. By\n"
+    << "default, packets are replayed as fast as possible; --paced reproduces their dates.\n"
+    << "Delivered data are then re-encoded, with the acks generated by the decoder.\n";
+  std::exit(1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+configuration
+read_configuration(int argc, const char** argv)
+{
+  auto conf = configuration{};
+  for (auto i = 1; i < argc; ++i)
+  {
+    const auto arg = std::string{argv[i]};
+    try
     {
-      std::cerr << "Can't open " << argv[1] << '\n';
-      std::exit(2);
+      if (arg == "--paced")
+      {
+        conf.paced = true;
+      }
+      else if (arg == "--no-encode")
+      {
+        conf.encode = false;
+      }
+      else if (arg == "--repetitions" and i + 1 < argc)
+      {
+        conf.repetitions = std::stoul(argv[++i]);
+      }
+      else if (conf.path.empty() and arg.compare(0, 2, "--") != 0)
+      {
+        conf.path = arg;
+      }
+      else
+      {
+        usage(argv[0]);
+      }
     }
+    catch (const std::exception&)
+    {
+      usage(argv[0]);
+    }
+  }
+  if (conf.path.empty() or conf.repetitions == 0)
+  {
+    usage(argv[0]);
+  }
+  return conf;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+double
+seconds(clock_type::duration d)
+{
+  return std::chrono::duration<double>(d).count();
+}
 
-    packet_handler dummy;
-    ntc::detail::packetizer<packet_handler> packetizer{dummy};
+/*------------------------------------------------------------------------------------------------*/
 
-    ntc::decoder<packet_handler, data_handler> decoder{ 8, ntc::in_order::yes, packet_handler{}
-                                                      , data_handler{}};
+void
+report(const char* what, std::size_t nb, std::size_t bytes, clock_type::duration d)
+{
+  const auto s = seconds(d);
+  std::cout << std::left << std::setw(10) << what << std::right
+            << std::setw(12) << nb << " packets "
+            << std::setw(14) << bytes << " bytes "
+            << std::fixed << std::setprecision(3) << std::setw(10) << s * 1000. << " ms "
+            << std::setprecision(1) << std::setw(10)
+            << (s > 0 ? static_cast<double>(bytes) / s / 1e6 : 0.) << " MB/s "
+            << std::setw(12) << (s > 0 ? static_cast<double>(nb) / s : 0.) << " packets/s\n";
+}
 
-    while (true)
-    {
-      const auto packet = ntc::detail::serialize_packet::read(dump_file);
+/*------------------------------------------------------------------------------------------------*/
 
-      if (dump_file.peek() == std::char_traits<char>::eof())
+void
+replay(const configuration& conf, const mapped_file& file)
+{
+  ntc::capture_reader reader{file.data(), file.size()};
+  const auto gf_size = reader.header().galois_field_size;
+  const auto ordered = reader.header().in_order ? ntc::in_order::yes : ntc::in_order::no;
+
+  std::cout << "capture: GF(2^" << +gf_size << "), "
+            << (ordered == ntc::in_order::yes ? "in order" : "out of order") << ", "
+            << (reader.indexed() ? std::to_string(reader.nb_records()) + " records"
+                                 : std::string{"not indexed"})
+            << '\n';
+
+  for (auto repetition = 0ul; repetition < conf.repetitions; ++repetition)
+  {
+    auto acks = std::vector<std::pair<std::size_t, ntc::packet>>{};
+    auto delivered = std::vector<ntc::data>{};
+    auto nb_delivered = 0ul;
+    auto nb_delivered_bytes = 0ul;
+
+    ntc::decoder<ack_handler, data_handler>
+      dec{ gf_size, ordered, ack_handler{&acks, &nb_delivered, ntc::packet{}}
+         , data_handler{conf.encode ? &delivered : nullptr, &nb_delivered, &nb_delivered_bytes}};
+    ntc::encoder<null_packet_handler> captured_enc{gf_size, null_packet_handler{}};
+
+    auto nb_packets = 0ul;
+    auto nb_bytes = 0ul;
+    auto nb_invalid = 0ul;
+    auto nb_captured_acks = 0ul;
+
+    reader.rewind();
+    auto p = ntc::captured_packet{};
+    auto first_date = std::int64_t{0};
+    const auto start = clock_type::now();
+    while (reader.next(p))
+    {
+      if (p.direction != ntc::capture_direction::received or p.size == 0)
       {
-        break;
+        continue;
       }
-
-      switch (ntc::detail::get_packet_type(packet))
+      if (conf.paced)
       {
-        case ntc::detail::packet_type::ack:
+        if (nb_packets == 0 and nb_captured_acks == 0)
         {
-          throw std::runtime_error{"ack"};
+          first_date = p.date;
         }
-
-        case ntc::detail::packet_type::repair:
+        std::this_thread::sleep_until(start + std::chrono::nanoseconds{p.date - first_date});
+      }
+      try
+      {
+        if (ntc::detail::get_packet_type(p.data, p.size) == ntc::detail::packet_type::ack)
         {
-          packetizer.read_repair(ntc::packet{packet});
-          break;
+          ++nb_captured_acks;
+          captured_enc(ntc::packet(p.data, p.data + p.size));
         }
-
-        case ntc::detail::packet_type::source:
+        else
         {
-          packetizer.read_source(ntc::packet{packet});
-          break;
+          ++nb_packets;
+          nb_bytes += p.size;
+          dec(p.data, p.size);
         }
       }
+      catch (const ntc::packet_type_error&)
+      {
+        ++nb_invalid;
+      }
+      catch (const ntc::overflow_error&)
+      {
+        // Packets are captured before being read, truncated ones included.
+        ++nb_invalid;
+      }
+    }
+    const auto decoding = clock_type::now() - start;
+
+    std::cout << "\nrepetition " << repetition << '\n';
+    report("decoder", nb_packets, nb_bytes, decoding);
+    std::cout << "          " << dec.nb_received_sources() << " sources, "
+              << dec.nb_received_repairs() << " repairs, " << nb_delivered << " delivered ("
+              << nb_delivered_bytes << " bytes), " << dec.nb_decoded() << " decoded, "
+              << dec.nb_useless_repairs() << " useless repairs, "
+              << dec.nb_failed_full_decodings() << " failed decodings, "
+              << nb_invalid << " invalid packets, " << nb_captured_acks << " captured acks\n";
 
-      decoder(std::move(packet));
+    if (conf.encode and not delivered.empty())
+    {
+      // Give acks to the encoder when as many data were delivered as when they were generated.
+      ntc::encoder<null_packet_handler> enc{gf_size, null_packet_handler{}};
+      auto ack = acks.begin();
+      const auto encoding_start = clock_type::now();
+      for (auto i = 0ul; i < delivered.size(); ++i)
+      {
+        for (; ack != acks.end() and ack->first <= i; ++ack)
+        {
+          enc(std::move(ack->second));
+        }
+        enc(std::move(delivered[i]));
+      }
+      const auto encoding = clock_type::now() - encoding_start;
+      report("encoder", delivered.size(), nb_delivered_bytes, encoding);
+      std::cout << "          " << enc.nb_sent_sources() << " sources, "
+                << enc.nb_sent_repairs() << " repairs, " << enc.nb_received_acks() << " acks\n";
     }
   }
-  catch (const ntc::packet_type_error& e)
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, const char** argv)
+{
+  const auto conf = read_configuration(argc, argv);
+  try
   {
-    std::cerr << "Invalid packet type " << +e.error_packet.data()[0] << '\n';
+    const mapped_file file{conf.path};
+    replay(conf, file);
   }
   catch (const std::exception& e)
   {
     std::cerr << e.what() << '\n';
+    return 2;
   }
   return 0;
 }
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm> // max
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <utility>   // move
+
+namespace shaping {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The characteristics of a link, on top of its loss model
+struct link_configuration
+{
+  /// @brief The propagation delay
+  std::chrono::nanoseconds delay{0};
+
+  /// @brief The delay of a packet is uniformly distributed in [delay - jitter, delay + jitter]
+  ///
+  /// Jitter alone doesn't reorder packets: a packet never overtakes the previous one.
+  std::chrono::nanoseconds jitter{0};
+
+  /// @brief The percentage of packets which are not delayed, thus overtake delayed ones
+  unsigned int reorder = 0;
+
+  /// @brief The percentage of packets which are delivered twice
+  unsigned int duplicate = 0;
+
+  /// @brief The bandwidth in bits per second, 0 for an unlimited bandwidth
+  std::uint64_t rate = 0;
+
+  /// @brief The number of packets waiting for the bandwidth, more are dropped
+  std::size_t queue_size = 1000;
+
+  /// @brief The seed of the random generator used for jitter, reordering and duplication
+  std::uint32_t seed = 1;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Statistics of a link
+struct link_statistics
+{
+  /// @brief The number of packets given to the link
+  std::size_t nb_packets = 0;
+
+  /// @brief The number of packets dropped by the loss model
+  std::size_t nb_lost = 0;
+
+  /// @brief The number of packets dropped because the queue was full
+  std::size_t nb_queue_drops = 0;
+
+  /// @brief The number of packets delivered twice
+  std::size_t nb_duplicated = 0;
+
+  /// @brief The number of packets which were not delayed
+  std::size_t nb_reordered = 0;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tell when packets sent on a link are delivered
+///
+/// A packet first waits in a queue for the bandwidth, then is delayed by the propagation delay.
+/// The link doesn't hold packets nor read a clock: dates are given by the caller and computed
+/// delivery dates are given back, thus it can be driven by a real or by a virtual clock.
+/// @tparam Loss A callable which returns true when a packet should be lost
+template <typename Loss>
+class link
+{
+public:
+
+  using duration = std::chrono::nanoseconds;
+
+  link(const link_configuration& conf, Loss loss)
+    : m_conf(conf)
+    , m_loss(std::move(loss))
+    , m_gen{conf.seed}
+    , m_percent{1, 100}
+    , m_jitter{-conf.jitter.count(), conf.jitter.count()}
+    , m_departures{}
+    , m_link_free{0}
+    , m_last_delivery{0}
+    , m_stats{}
+  {}
+
+  /// @brief Send a packet on the link
+  /// @param now The date at which the packet is sent
+  /// @param size The number of bytes of the packet
+  /// @param deliver Called with the delivery date of each copy of the packet, if any
+  template <typename Fn>
+  void
+  operator()(duration now, std::size_t size, Fn&& deliver)
+  {
+    ++m_stats.nb_packets;
+    if (m_loss())
+    {
+      ++m_stats.nb_lost;
+      return;
+    }
+
+    auto departure = now;
+    if (m_conf.rate != 0)
+    {
+      // Packets which finished their serialization left the queue.
+      while (not m_departures.empty() and m_departures.front() <= now)
+      {
+        m_departures.pop_front();
+      }
+      if (m_departures.size() >= m_conf.queue_size)
+      {
+        ++m_stats.nb_queue_drops;
+        return;
+      }
+      const auto serialization = duration{static_cast<duration::rep>(
+        static_cast<double>(size) * 8e9 / static_cast<double>(m_conf.rate))};
+      m_link_free = std::max(m_link_free, now) + serialization;
+      departure = m_link_free;
+      m_departures.push_back(departure);
+    }
+
+    auto delivery = departure;
+    if (m_conf.reorder != 0 and m_percent(m_gen) <= m_conf.reorder)
+    {
+      ++m_stats.nb_reordered;
+    }
+    else
+    {
+      delivery += std::max(duration{0}, m_conf.delay + duration{m_jitter(m_gen)});
+      delivery = std::max(delivery, m_last_delivery);
+      m_last_delivery = delivery;
+    }
+
+    deliver(delivery);
+    if (m_conf.duplicate != 0 and m_percent(m_gen) <= m_conf.duplicate)
+    {
+      ++m_stats.nb_duplicated;
+      deliver(delivery);
+    }
+  }
+
+  /// @brief Get the statistics of the link
+  const link_statistics&
+  statistics()
+  const noexcept
+  {
+    return m_stats;
+  }
+
+private:
+
+  const link_configuration m_conf;
+  Loss m_loss;
+  std::mt19937 m_gen;
+  std::uniform_int_distribution<unsigned int> m_percent;
+  std::uniform_int_distribution<duration::rep> m_jitter;
+
+  /// @brief The dates at which queued packets finish their serialization
+  std::deque<duration> m_departures;
+
+  /// @brief The date at which the last queued packet finishes its serialization
+  duration m_link_free;
+
+  /// @brief The delivery date of the last packet which was delayed
+  duration m_last_delivery;
+
+  link_statistics m_stats;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace shaping
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm> // max
+#include <chrono>
+#include <cstdint>
+#include <utility> // move
+#include <vector>
+
+namespace shaping {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A hashed timer wheel which releases values when their date is reached
+///
+/// Dates are durations since an arbitrary epoch, thus the wheel can be driven by a real or by a
+/// virtual clock. A value is released at the first call to advance() following its date, with a
+/// precision of a tick. Scheduling and releasing are done in constant time; values scheduled
+/// further than a turn of the wheel stay in their slot for several turns.
+template <typename T>
+class timer_wheel
+{
+public:
+
+  using duration = std::chrono::nanoseconds;
+
+  /// @param tick The duration covered by a slot
+  /// @param nb_slots The number of slots, rounded up to the next power of 2
+  timer_wheel(duration tick, std::size_t nb_slots)
+    : m_tick{tick.count() > 0 ? tick : duration{1}}
+    , m_slots(round_up(nb_slots))
+    , m_current{0}
+    , m_size{0}
+  {}
+
+  /// @brief Schedule a value, released as soon as possible if its date is already past
+  void
+  schedule(duration date, T value)
+  {
+    const auto tick = std::max(ticks(date), m_current);
+    m_slots[tick & (m_slots.size() - 1)].push_back(entry{date, std::move(value)});
+    ++m_size;
+  }
+
+  /// @brief Release all values whose date is not after @p now, in the order of their slots
+  /// @param fn Called with each released value, it shall not schedule values
+  template <typename Fn>
+  void
+  advance(duration now, Fn&& fn)
+  {
+    const auto last = std::max(ticks(now), m_current);
+    if (m_size == 0)
+    {
+      m_current = last;
+      return;
+    }
+    // After a long pause, visit each slot only once.
+    const auto first = last - m_current >= m_slots.size() ? last - m_slots.size() + 1 : m_current;
+    for (auto tick = first; tick <= last and m_size != 0; ++tick)
+    {
+      auto& slot = m_slots[tick & (m_slots.size() - 1)];
+      auto kept = 0ul;
+      for (auto i = 0ul; i < slot.size(); ++i)
+      {
+        if (slot[i].date <= now)
+        {
+          --m_size;
+          fn(std::move(slot[i].value));
+        }
+        else
+        {
+          // A later turn of the wheel.
+          if (kept != i)
+          {
+            slot[kept] = std::move(slot[i]);
+          }
+          ++kept;
+        }
+      }
+      slot.resize(kept);
+    }
+    m_current = last;
+  }
+
+  /// @brief Get the start of the first tick which has a scheduled value
+  /// @pre not empty()
+  ///
+  /// It's a lower bound of the next date of a value: when the slot holds values of later turns,
+  /// advance() releases nothing at this date.
+  duration
+  next_date()
+  const noexcept
+  {
+    for (auto tick = m_current; tick < m_current + m_slots.size(); ++tick)
+    {
+      if (not m_slots[tick & (m_slots.size() - 1)].empty())
+      {
+        return duration{static_cast<duration::rep>(tick) * m_tick.count()};
+      }
+    }
+    return duration{static_cast<duration::rep>(m_current) * m_tick.count()};
+  }
+
+  /// @brief Tell if there are no scheduled values
+  bool
+  empty()
+  const noexcept
+  {
+    return m_size == 0;
+  }
+
+  /// @brief Get the number of scheduled values
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+private:
+
+  struct entry
+  {
+    duration date;
+    T value;
+  };
+
+  static
+  std::size_t
+  round_up(std::size_t n)
+  noexcept
+  {
+    auto res = std::size_t{1};
+    while (res < n)
+    {
+      res *= 2;
+    }
+    return res;
+  }
+
+  std::uint64_t
+  ticks(duration date)
+  const noexcept
+  {
+    return date.count() > 0 ? static_cast<std::uint64_t>(date.count() / m_tick.count()) : 0;
+  }
+
+  /// @brief The duration covered by a slot
+  const duration m_tick;
+
+  /// @brief The values, in the slot of their tick modulo the number of slots
+  std::vector<std::vector<entry>> m_slots;
+
+  /// @brief The last tick given to advance()
+  std::uint64_t m_current;
+
+  /// @brief The number of scheduled values
+  std::size_t m_size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace shaping
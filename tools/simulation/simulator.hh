@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm> // copy_n, fill, min
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>   // move
+#include <vector>
+
+#include "netcode/cached_clock.hh"
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/histogram.hh"
+
+#include "tools/loss/parse.hh"
+#include "tools/shaping/link.hh"
+
+namespace simulation {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The parameters of a simulation
+struct configuration
+{
+  /// @brief The number of data given to the encoder
+  std::size_t nb_data = 100000;
+
+  /// @brief The size of data
+  std::uint16_t data_size = 1024;
+
+  /// @brief The number of data given to the encoder per second of simulated time
+  std::size_t data_rate = 10000;
+
+  std::uint8_t galois_field_size = 8;
+  ntc::in_order ordered = ntc::in_order::yes;
+
+  /// @brief See ntc::encoder::set_rate
+  std::size_t code_rate = 5;
+
+  /// @brief See ntc::encoder::set_window_size
+  std::size_t window_size = 64;
+
+  /// @brief See ntc::decoder::set_ack_period, in simulated time
+  std::chrono::milliseconds ack_period{100};
+
+  /// @brief See ntc::decoder::set_ack_nb_packets
+  std::uint16_t ack_nb_packets = 50;
+
+  /// @brief The loss model from the encoder to the decoder (see loss::parse)
+  std::string forward_loss = "none";
+
+  /// @brief The loss model from the decoder to the encoder (see loss::parse)
+  std::string backward_loss = "none";
+
+  /// @brief The link from the encoder to the decoder
+  shaping::link_configuration forward_link;
+
+  /// @brief The link from the decoder to the encoder
+  shaping::link_configuration backward_link;
+
+  /// @brief The seed of loss models
+  std::uint32_t seed = 1;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief What a simulation measured
+struct result
+{
+  /// @brief The date of the last event, in simulated time
+  std::chrono::nanoseconds duration{0};
+
+  /// @brief The wall-clock time taken by the simulation
+  std::chrono::nanoseconds wall_time{0};
+
+  std::size_t nb_events = 0;
+  std::size_t nb_data = 0;
+  std::size_t nb_delivered = 0;
+  std::size_t nb_decoded = 0;
+  std::size_t nb_sent_sources = 0;
+  std::size_t nb_sent_repairs = 0;
+  std::size_t nb_sent_acks = 0;
+  std::size_t nb_received_acks = 0;
+
+  /// @brief The number of bytes of given data
+  std::size_t data_bytes = 0;
+
+  /// @brief The number of bytes sent by the encoder
+  std::size_t forward_bytes = 0;
+
+  /// @brief The number of bytes sent by the decoder
+  std::size_t backward_bytes = 0;
+
+  /// @brief The statistics of the link from the encoder to the decoder
+  shaping::link_statistics forward_link;
+
+  /// @brief The statistics of the link from the decoder to the encoder
+  shaping::link_statistics backward_link;
+
+  /// @brief The time between giving a data to the encoder and its delivery by the decoder
+  ntc::histogram latency;
+
+  /// @brief Delivered bits per second of simulated time
+  double
+  goodput()
+  const noexcept
+  {
+    const auto s = std::chrono::duration<double>(duration).count();
+    return s > 0 ? static_cast<double>(nb_delivered) * 8 * (static_cast<double>(data_bytes)
+                                                           / static_cast<double>(nb_data)) / s
+                 : 0.;
+  }
+
+  /// @brief Bytes sent by the encoder in addition to data, relative to data
+  double
+  overhead()
+  const noexcept
+  {
+    return data_bytes != 0 ? static_cast<double>(forward_bytes) / static_cast<double>(data_bytes)
+                             - 1.
+                           : 0.;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A discrete-event simulation of an encoder and a decoder connected by two links
+///
+/// Time is virtual: events are processed in the order of their dates, as fast as possible. All
+/// randomness comes from seeded generators, thus a configuration always gives the same result.
+/// The decoder's ack period elapses in simulated time, through a cached clock.
+class simulator
+{
+public:
+
+  explicit simulator(const configuration& conf)
+    : m_conf(conf)
+    , m_now{0}
+    , m_events{}
+    , m_next_event_id{0}
+    , m_packets{}
+    , m_free_packets{}
+    , m_forward{conf.forward_link, loss::parse(conf.forward_loss, conf.seed)}
+    , m_backward{conf.backward_link, loss::parse(conf.backward_loss, conf.seed + 1)}
+    , m_sent_dates(conf.nb_data)
+    , m_clock{ntc::cached_clock::time_point{}}
+    , m_result{}
+    , m_encoder{conf.galois_field_size, packet_handler{this, true, ntc::packet{}}}
+    , m_decoder{ conf.galois_field_size, conf.ordered, packet_handler{this, false, ntc::packet{}}
+               , data_handler{this}}
+  {
+    m_encoder.set_rate(conf.code_rate);
+    m_encoder.set_window_size(conf.window_size);
+    m_decoder.set_ack_period(conf.ack_period);
+    m_decoder.set_clock(&m_clock);
+    m_decoder.set_ack_nb_packets(conf.ack_nb_packets);
+  }
+
+  /// @brief Run the simulation until all events are processed
+  /// @note A simulator runs only once
+  result
+  operator()()
+  {
+    const auto start = std::chrono::steady_clock::now();
+    if (m_conf.nb_data != 0)
+    {
+      push(event{std::chrono::nanoseconds{0}, 0, event_type::data, 0});
+    }
+    while (not m_events.empty())
+    {
+      const auto e = m_events.top();
+      m_events.pop();
+      m_now = e.date;
+      m_clock.set(ntc::cached_clock::time_point{m_now});
+      ++m_result.nb_events;
+      switch (e.type)
+      {
+        case event_type::data:        send_data(e.index); break;
+        case event_type::to_decoder:  receive_packet(e.index); break;
+        case event_type::to_encoder:  receive_ack(e.index); break;
+      }
+    }
+    m_result.duration = m_now;
+    m_result.wall_time = std::chrono::steady_clock::now() - start;
+    m_result.nb_decoded = m_decoder.nb_decoded();
+    m_result.nb_sent_sources = m_encoder.nb_sent_sources();
+    m_result.nb_sent_repairs = m_encoder.nb_sent_repairs();
+    m_result.nb_sent_acks = m_decoder.nb_sent_acks();
+    m_result.nb_received_acks = m_encoder.nb_received_acks();
+    m_result.forward_link = m_forward.statistics();
+    m_result.backward_link = m_backward.statistics();
+    return std::move(m_result);
+  }
+
+private:
+
+  enum class event_type : std::uint8_t {data, to_decoder, to_encoder};
+
+  struct event
+  {
+    std::chrono::nanoseconds date;
+
+    /// @brief Break ties between events of the same date, in the order they were created
+    std::uint64_t id;
+
+    event_type type;
+
+    /// @brief The identifier of a data, or the index of a packet
+    std::uint32_t index;
+
+    bool
+    operator>(const event& other)
+    const noexcept
+    {
+      return date != other.date ? date > other.date : id > other.id;
+    }
+  };
+
+  /// @brief Send packets of the encoder or of the decoder on their link
+  struct packet_handler
+  {
+    simulator* sim;
+    bool forward;
+    ntc::packet current;
+
+    void
+    operator()(const char* data, std::size_t len)
+    {
+      const auto size = current.size();
+      current.resize(size + len);
+      std::copy_n(data, len, current.data() + size);
+    }
+
+    void
+    operator()()
+    {
+      sim->send_packet(forward, std::move(current));
+      current = ntc::packet{};
+    }
+  };
+
+  /// @brief Measure latencies of delivered data
+  struct data_handler
+  {
+    simulator* sim;
+
+    void
+    operator()(const char* data, std::size_t)
+    {
+      sim->deliver(data);
+    }
+  };
+
+  void
+  push(event e)
+  {
+    e.id = m_next_event_id++;
+    m_events.push(e);
+  }
+
+  void
+  send_data(std::uint32_t id)
+  {
+    auto data = ntc::data(m_conf.data_size);
+    auto data_as_int = reinterpret_cast<std::uint32_t*>(data.data());
+    std::fill(data_as_int, data_as_int + m_conf.data_size / sizeof(std::uint32_t), id);
+    data.resize(m_conf.data_size);
+    m_sent_dates[id] = m_now;
+    ++m_result.nb_data;
+    m_result.data_bytes += m_conf.data_size;
+    m_encoder(std::move(data));
+
+    if (id + 1 < m_conf.nb_data)
+    {
+      const auto interval = std::chrono::nanoseconds{
+        1000000000 / static_cast<std::int64_t>(std::max<std::size_t>(m_conf.data_rate, 1))};
+      push(event{m_sent_dates[id] + interval, 0, event_type::data, id + 1});
+    }
+  }
+
+  void
+  send_packet(bool forward, ntc::packet&& p)
+  {
+    const auto size = p.size();
+    (forward ? m_result.forward_bytes : m_result.backward_bytes) += size;
+    auto& link = forward ? m_forward : m_backward;
+    auto nb_copies = 0u;
+    link(m_now, size, [&](std::chrono::nanoseconds delivery)
+    {
+      // A duplicated packet needs another copy.
+      const auto index = acquire(nb_copies++ == 0 ? std::move(p) : ntc::packet{p});
+      push(event{delivery, 0, forward ? event_type::to_decoder : event_type::to_encoder, index});
+    });
+  }
+
+  void
+  receive_packet(std::uint32_t index)
+  {
+    m_decoder(std::move(m_packets[index]));
+    release(index);
+  }
+
+  void
+  receive_ack(std::uint32_t index)
+  {
+    m_encoder(std::move(m_packets[index]));
+    release(index);
+  }
+
+  void
+  deliver(const char* data)
+  {
+    const auto id = *reinterpret_cast<const std::uint32_t*>(data);
+    ++m_result.nb_delivered;
+    m_result.latency.record(static_cast<std::uint64_t>((m_now - m_sent_dates[id]).count()));
+  }
+
+  std::uint32_t
+  acquire(ntc::packet&& p)
+  {
+    if (m_free_packets.empty())
+    {
+      m_packets.emplace_back(std::move(p));
+      return static_cast<std::uint32_t>(m_packets.size() - 1);
+    }
+    const auto index = m_free_packets.back();
+    m_free_packets.pop_back();
+    m_packets[index] = std::move(p);
+    return index;
+  }
+
+  void
+  release(std::uint32_t index)
+  {
+    m_free_packets.push_back(index);
+  }
+
+  const configuration m_conf;
+
+  /// @brief The current date, in simulated time
+  std::chrono::nanoseconds m_now;
+
+  std::priority_queue<event, std::vector<event>, std::greater<event>> m_events;
+  std::uint64_t m_next_event_id;
+
+  /// @brief Packets in flight, referenced by events
+  std::vector<ntc::packet> m_packets;
+  std::vector<std::uint32_t> m_free_packets;
+
+  shaping::link<std::function<bool()>> m_forward;
+  shaping::link<std::function<bool()>> m_backward;
+
+  /// @brief When each data was given to the encoder
+  std::vector<std::chrono::nanoseconds> m_sent_dates;
+
+  /// @brief Dates the decoder's acks in simulated time
+  ntc::cached_clock m_clock;
+
+  result m_result;
+
+  ntc::encoder<packet_handler> m_encoder;
+  ntc::decoder<packet_handler, data_handler> m_decoder;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Run simulations on several threads
+/// @return The results, in the order of configurations
+inline
+std::vector<result>
+run(const std::vector<configuration>& confs, std::size_t nb_threads)
+{
+  auto results = std::vector<result>(confs.size());
+  std::atomic<std::size_t> next{0};
+  const auto worker = [&]
+  {
+    for (auto i = next++; i < confs.size(); i = next++)
+    {
+      results[i] = simulator{confs[i]}();
+    }
+  };
+  auto threads = std::vector<std::thread>{};
+  for (auto i = 1ul; i < std::min(nb_threads, confs.size()); ++i)
+  {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  return results;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace simulation
@@ -0,0 +1,283 @@
+#include <algorithm> // max, min
+#include <chrono>
+#include <cstdlib>   // exit
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tools/simulation/simulator.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Simulate an encoder and a decoder over modelled links for each combination of the given
+// parameters, on all cores, then print one CSV line per combination.
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Parameters which can be swept, each combination is simulated.
+struct sweep
+{
+  simulation::configuration base;
+  std::vector<std::size_t> code_rates = {5};
+  std::vector<std::size_t> window_sizes = {64};
+  std::vector<std::size_t> ack_periods = {100}; // ms
+  std::vector<std::size_t> ack_nb_packets = {50};
+  std::vector<std::string> losses;
+  std::vector<double> delays = {0}; // ms
+  std::vector<std::uint64_t> bandwidths = {0}; // kbit/s
+  std::size_t nb_threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+[[noreturn]]
+void
+usage(const char* name)
+{
+  std::cerr
+    << "Usage:\n" << name << " [options]\n"
+    << "\nParameters followed by 'list' accept comma-separated values, all combinations are"
+    << " simulated:\n"
+    << "  --data n             number of data (100000)\n"
+    << "  --size bytes         size of data (1024)\n"
+    << "  --data-rate n        data per second of simulated time (10000)\n"
+    << "  --gf w               size of the Galois field (8)\n"
+    << "  --rate list          sources per repair (5)\n"
+    << "  --window list        maximal window size (64)\n"
+    << "  --ack-period list    ack period in ms, 0 to disable (100)\n"
+    << "  --ack-packets list   received packets per ack (50)\n"
+    << "  --loss model         loss model from the encoder, may be repeated (none)\n"
+    << "  --ack-loss model     loss model from the decoder (none)\n"
+    << "  --delay list         one-way delay in ms (0)\n"
+    << "  --jitter ms          one-way jitter (0)\n"
+    << "  --bandwidth list     bandwidth from the encoder in kbit/s, 0 for unlimited (0)\n"
+    << "  --queue n            packets waiting for the bandwidth (1000)\n"
+    << "  --seed n             seed of loss models (1)\n"
+    << "  --threads n          number of simulations run in parallel (all cores)\n"
+    << "\nLoss models: none, uniform:T (lose with probability (100 - T)%), burst:G,B (Gilbert-"
+    << "Elliott,\nstay in good state with G%, in bad state with B%).\n";
+  std::exit(1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename T, typename Fn>
+std::vector<T>
+parse_list(const std::string& s, Fn&& parse)
+{
+  auto res = std::vector<T>{};
+  auto start = 0ul;
+  while (start <= s.size())
+  {
+    const auto comma = std::min(s.find(',', start), s.size());
+    res.push_back(parse(s.substr(start, comma - start)));
+    start = comma + 1;
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+sweep
+read_configuration(int argc, const char** argv)
+{
+  auto conf = sweep{};
+  const auto to_size = [](const std::string& s){return std::stoul(s);};
+  const auto to_double = [](const std::string& s){return std::stod(s);};
+  const auto to_ms = [](double ms)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::duration<double, std::milli>{ms});
+  };
+  if (argc % 2 == 0)
+  {
+    usage(argv[0]);
+  }
+  for (auto i = 1; i + 1 < argc; i += 2)
+  {
+    const auto arg = std::string{argv[i]};
+    const auto value = std::string{argv[i + 1]};
+    try
+    {
+      if (arg == "--data")
+      {
+        conf.base.nb_data = std::stoul(value);
+      }
+      else if (arg == "--size")
+      {
+        conf.base.data_size = static_cast<std::uint16_t>(std::stoul(value));
+      }
+      else if (arg == "--data-rate")
+      {
+        conf.base.data_rate = std::stoul(value);
+      }
+      else if (arg == "--gf")
+      {
+        conf.base.galois_field_size = static_cast<std::uint8_t>(std::stoul(value));
+      }
+      else if (arg == "--rate")
+      {
+        conf.code_rates = parse_list<std::size_t>(value, to_size);
+      }
+      else if (arg == "--window")
+      {
+        conf.window_sizes = parse_list<std::size_t>(value, to_size);
+      }
+      else if (arg == "--ack-period")
+      {
+        conf.ack_periods = parse_list<std::size_t>(value, to_size);
+      }
+      else if (arg == "--ack-packets")
+      {
+        conf.ack_nb_packets = parse_list<std::size_t>(value, to_size);
+      }
+      else if (arg == "--loss")
+      {
+        loss::parse(value, 0);
+        conf.losses.push_back(value);
+      }
+      else if (arg == "--ack-loss")
+      {
+        loss::parse(value, 0);
+        conf.base.backward_loss = value;
+      }
+      else if (arg == "--delay")
+      {
+        conf.delays = parse_list<double>(value, to_double);
+      }
+      else if (arg == "--jitter")
+      {
+        conf.base.forward_link.jitter = to_ms(std::stod(value));
+        conf.base.backward_link.jitter = conf.base.forward_link.jitter;
+      }
+      else if (arg == "--bandwidth")
+      {
+        conf.bandwidths = parse_list<std::uint64_t>(value, to_size);
+      }
+      else if (arg == "--queue")
+      {
+        conf.base.forward_link.queue_size = std::stoul(value);
+      }
+      else if (arg == "--seed")
+      {
+        conf.base.seed = static_cast<std::uint32_t>(std::stoul(value));
+        conf.base.forward_link.seed = conf.base.seed;
+        conf.base.backward_link.seed = conf.base.seed + 1;
+      }
+      else if (arg == "--threads")
+      {
+        conf.nb_threads = std::max(1ul, std::stoul(value));
+      }
+      else
+      {
+        usage(argv[0]);
+      }
+    }
+    catch (const std::exception&)
+    {
+      usage(argv[0]);
+    }
+  }
+  if (conf.losses.empty())
+  {
+    conf.losses.push_back("none");
+  }
+  if (  conf.base.data_size < sizeof(std::uint32_t)
+     or conf.base.data_size % sizeof(std::uint32_t) != 0)
+  {
+    usage(argv[0]);
+  }
+  return conf;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::vector<simulation::configuration>
+combinations(const sweep& s)
+{
+  auto res = std::vector<simulation::configuration>{};
+  for (const auto& loss : s.losses)
+  for (const auto delay : s.delays)
+  for (const auto bandwidth : s.bandwidths)
+  for (const auto code_rate : s.code_rates)
+  for (const auto window_size : s.window_sizes)
+  for (const auto ack_period : s.ack_periods)
+  for (const auto ack_nb_packets : s.ack_nb_packets)
+  {
+    auto conf = s.base;
+    conf.forward_loss = loss;
+    conf.forward_link.delay = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::duration<double, std::milli>{delay});
+    conf.backward_link.delay = conf.forward_link.delay;
+    conf.forward_link.rate = bandwidth * 1000;
+    conf.code_rate = code_rate;
+    conf.window_size = window_size;
+    conf.ack_period = std::chrono::milliseconds{ack_period};
+    conf.ack_nb_packets = static_cast<std::uint16_t>(ack_nb_packets);
+    res.push_back(conf);
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+double
+ms(std::uint64_t ns)
+{
+  return static_cast<double>(ns) / 1e6;
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, const char** argv)
+{
+  const auto conf = read_configuration(argc, argv);
+  const auto confs = combinations(conf);
+  const auto start = std::chrono::steady_clock::now();
+  const auto results = simulation::run(confs, conf.nb_threads);
+  const auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+  std::cout << "loss,delay_ms,bandwidth_kbps,rate,window,ack_period_ms,ack_packets,"
+            << "delivered,decoded,sources,repairs,acks,goodput_mbps,overhead,ack_overhead,"
+            << "latency_p50_ms,latency_p99_ms,latency_p999_ms,latency_max_ms,"
+            << "simulated_s,wall_s,events_per_s\n";
+  auto nb_events = 0ul;
+  for (auto i = 0ul; i < confs.size(); ++i)
+  {
+    const auto& c = confs[i];
+    const auto& r = results[i];
+    const auto wall_s = std::chrono::duration<double>(r.wall_time).count();
+    nb_events += r.nb_events;
+    std::cout << std::fixed << std::setprecision(3)
+              << '"' << c.forward_loss << '"' << ',' << ms(static_cast<std::uint64_t>(
+                                                            c.forward_link.delay.count()))
+              << ',' << c.forward_link.rate / 1000 << ',' << c.code_rate << ',' << c.window_size
+              << ',' << c.ack_period.count()
+              << ',' << c.ack_nb_packets << ',' << r.nb_delivered << ',' << r.nb_decoded
+              << ',' << r.nb_sent_sources << ',' << r.nb_sent_repairs << ',' << r.nb_sent_acks
+              << ',' << r.goodput() / 1e6 << ',' << std::setprecision(4) << r.overhead()
+              << ',' << static_cast<double>(r.backward_bytes)
+                        / static_cast<double>(std::max<std::size_t>(r.data_bytes, 1))
+              << std::setprecision(3)
+              << ',' << ms(r.latency.percentile(50)) << ',' << ms(r.latency.percentile(99))
+              << ',' << ms(r.latency.percentile(99.9)) << ',' << ms(r.latency.max())
+              << ',' << std::chrono::duration<double>(r.duration).count() << ',' << wall_s
+              << ',' << std::setprecision(0)
+              << (wall_s > 0 ? static_cast<double>(r.nb_events) / wall_s : 0.) << '\n';
+  }
+  std::cerr << confs.size() << " simulations, " << nb_events << " events in " << std::fixed
+            << std::setprecision(3) << wall.count() << " s on " << conf.nb_threads
+            << " threads\n";
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
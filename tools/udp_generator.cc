@@ -0,0 +1,661 @@
+#include <algorithm> // min, max
+#include <bitset>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>   // exit
+#include <cstring>   // memset, strerror
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept> // runtime_error
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>  // inet_pton
+#include <netinet/in.h> // sockaddr_in
+#include <sys/socket.h> // sendmmsg, recvmmsg
+#include <unistd.h>     // close
+
+#include <boost/endian/conversion.hpp>
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Send numbered packets of several flows at a given rate, or receive and validate them.
+//
+// Each packet starts with a header (flow, sequence number, size), followed by bytes which are a
+// function of the header. Thus, the sink detects losses, reordering, duplication and corruption
+// without any shared state with the generator.
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+using clock_type = std::chrono::steady_clock;
+
+/*------------------------------------------------------------------------------------------------*/
+
+constexpr auto header_size = 3 * sizeof(std::uint32_t);
+
+constexpr auto max_packet_size = 65507ul;
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct configuration
+{
+  bool client = false;
+  std::string host = "127.0.0.1";
+  unsigned short port = 0;
+
+  // Client: total number of packets, for all flows. Server: stop after this number of packets.
+  std::size_t nb_packets = 1024 * 1024;
+
+  // Packets per second, for all flows; 0 to send as fast as possible.
+  std::size_t rate = 0;
+
+  // The number of packets given to a single sendmmsg/recvmmsg.
+  std::size_t batch = 32;
+
+  std::size_t nb_flows = 1;
+
+  // fixed:N, uniform:MIN,MAX or bimodal:SMALL,LARGE,P (P% of small packets).
+  std::string sizes = "fixed:1024";
+
+  std::uint32_t seed = 1;
+
+  // Server: stop when nothing was received during this period, after a first packet.
+  std::chrono::milliseconds idle_timeout{2000};
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+[[noreturn]]
+void
+usage(const char* name)
+{
+  std::cerr
+    << "Usage:\n"
+    << name << " client host port [--nb-packets n] [--rate pps] [--flows n] [--sizes dist]\n"
+    << "                          [--batch n] [--seed n]\n"
+    << name << " server port [--host ip] [--nb-packets n] [--batch n] [--idle-timeout ms]\n"
+    << "\nSize distributions:\n"
+    << "  fixed:N              all packets have N bytes\n"
+    << "  uniform:MIN,MAX      uniformly distributed in [MIN, MAX]\n"
+    << "  bimodal:S,L,P        S bytes with probability P%, L bytes otherwise\n"
+    << "\nSizes are at least " << header_size << " bytes. Use lossy_proxy between client and server"
+    << " to\nemulate a lossy link.\n";
+  std::exit(1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+configuration
+read_configuration(int argc, const char** argv)
+{
+  if (argc < 3)
+  {
+    usage(argv[0]);
+  }
+  auto conf = configuration{};
+  auto i = 2;
+  const auto mode = std::string{argv[1]};
+  try
+  {
+    if (mode == "client" and argc >= 4)
+    {
+      conf.client = true;
+      conf.host = argv[2];
+      conf.port = static_cast<unsigned short>(std::stoul(argv[3]));
+      i = 4;
+    }
+    else if (mode == "server")
+    {
+      conf.port = static_cast<unsigned short>(std::stoul(argv[2]));
+      i = 3;
+    }
+    else
+    {
+      usage(argv[0]);
+    }
+
+    for (; i + 1 < argc; i += 2)
+    {
+      const auto arg = std::string{argv[i]};
+      const auto value = std::string{argv[i + 1]};
+      if (arg == "--nb-packets")
+      {
+        conf.nb_packets = std::stoul(value);
+      }
+      else if (arg == "--rate" and conf.client)
+      {
+        conf.rate = std::stoul(value);
+      }
+      else if (arg == "--flows" and conf.client)
+      {
+        conf.nb_flows = std::max(1ul, std::stoul(value));
+      }
+      else if (arg == "--sizes" and conf.client)
+      {
+        conf.sizes = value;
+      }
+      else if (arg == "--seed" and conf.client)
+      {
+        conf.seed = static_cast<std::uint32_t>(std::stoul(value));
+      }
+      else if (arg == "--batch")
+      {
+        conf.batch = std::max(1ul, std::min(1024ul, std::stoul(value)));
+      }
+      else if (arg == "--host" and not conf.client)
+      {
+        conf.host = value;
+      }
+      else if (arg == "--idle-timeout" and not conf.client)
+      {
+        conf.idle_timeout = std::chrono::milliseconds{std::stoul(value)};
+      }
+      else
+      {
+        usage(argv[0]);
+      }
+    }
+  }
+  catch (const std::exception&)
+  {
+    usage(argv[0]);
+  }
+  if (i != argc)
+  {
+    usage(argv[0]);
+  }
+  return conf;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Draw sizes of packets from a distribution
+/// @throw std::exception if the description is invalid
+class size_distribution
+{
+public:
+
+  size_distribution(const std::string& description, std::uint32_t seed)
+    : m_gen{seed}
+    , m_small{0}
+    , m_large{0}
+    , m_small_percent{0}
+    , m_uniform{false}
+  {
+    const auto colon = description.find(':');
+    const auto kind = description.substr(0, colon);
+    const auto values = parse_values(description.substr(colon + 1));
+    if (kind == "fixed" and values.size() == 1)
+    {
+      m_small = m_large = values[0];
+      m_small_percent = 100;
+    }
+    else if (kind == "uniform" and values.size() == 2 and values[0] <= values[1])
+    {
+      m_small = values[0];
+      m_large = values[1];
+      m_uniform = true;
+    }
+    else if (kind == "bimodal" and values.size() == 3 and values[2] <= 100)
+    {
+      m_small = values[0];
+      m_large = values[1];
+      m_small_percent = values[2];
+    }
+    else
+    {
+      throw std::invalid_argument{description};
+    }
+    if (  colon == std::string::npos or std::min(m_small, m_large) < header_size
+       or std::max(m_small, m_large) > max_packet_size)
+    {
+      throw std::invalid_argument{description};
+    }
+  }
+
+  std::size_t
+  operator()()
+  {
+    if (m_uniform)
+    {
+      return std::uniform_int_distribution<std::size_t>{m_small, m_large}(m_gen);
+    }
+    return std::uniform_int_distribution<std::size_t>{0, 99}(m_gen) < m_small_percent
+         ? m_small
+         : m_large;
+  }
+
+private:
+
+  static
+  std::vector<std::size_t>
+  parse_values(const std::string& s)
+  {
+    auto res = std::vector<std::size_t>{};
+    auto start = 0ul;
+    while (start <= s.size())
+    {
+      const auto comma = std::min(s.find(',', start), s.size());
+      res.push_back(std::stoul(s.substr(start, comma - start)));
+      start = comma + 1;
+    }
+    return res;
+  }
+
+  std::mt19937 m_gen;
+  std::size_t m_small;
+  std::size_t m_large;
+  std::size_t m_small_percent;
+  bool m_uniform;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// The content of a packet is a function of its flow, its sequence number and the position.
+inline
+char
+content(std::uint32_t flow, std::uint32_t seq, std::size_t i)
+noexcept
+{
+  return static_cast<char>((seq * 131u + flow * 31u + static_cast<std::uint32_t>(i)) & 0xff);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+write_packet(char* buffer, std::uint32_t flow, std::uint32_t seq, std::size_t size)
+noexcept
+{
+  const std::uint32_t header[] = { boost::endian::native_to_big(flow)
+                                 , boost::endian::native_to_big(seq)
+                                 , boost::endian::native_to_big(static_cast<std::uint32_t>(size))};
+  std::memcpy(buffer, header, header_size);
+  for (auto i = header_size; i < size; ++i)
+  {
+    buffer[i] = content(flow, seq, i);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+sockaddr_in
+make_address(const std::string& host, unsigned short port)
+{
+  auto addr = sockaddr_in{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1)
+  {
+    throw std::runtime_error{"Invalid IPv4 address " + host};
+  }
+  return addr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+class udp_socket final
+{
+public:
+
+  udp_socket(const udp_socket&) = delete;
+  udp_socket& operator=(const udp_socket&) = delete;
+
+  udp_socket()
+    : m_fd{::socket(AF_INET, SOCK_DGRAM, 0)}
+  {
+    if (m_fd < 0)
+    {
+      throw std::runtime_error{std::string{"socket: "} + std::strerror(errno)};
+    }
+    // Absorb bursts, especially when the peer is slower than us.
+    const auto buffer_size = 8 * 1024 * 1024;
+    ::setsockopt(m_fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    ::setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+  }
+
+  ~udp_socket()
+  {
+    ::close(m_fd);
+  }
+
+  int
+  fd()
+  const noexcept
+  {
+    return m_fd;
+  }
+
+private:
+
+  const int m_fd;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+client(const configuration& conf)
+{
+  udp_socket sock;
+  auto to = make_address(conf.host, conf.port);
+  auto sizes = size_distribution{conf.sizes, conf.seed};
+
+  // One buffer per packet of a batch.
+  auto buffers = std::vector<char>(conf.batch * max_packet_size);
+  auto iovecs = std::vector<iovec>(conf.batch);
+  auto messages = std::vector<mmsghdr>(conf.batch);
+  for (auto i = 0ul; i < conf.batch; ++i)
+  {
+    iovecs[i].iov_base = buffers.data() + i * max_packet_size;
+    std::memset(&messages[i], 0, sizeof(mmsghdr));
+    messages[i].msg_hdr.msg_name = &to;
+    messages[i].msg_hdr.msg_namelen = sizeof(to);
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  auto seqs = std::vector<std::uint32_t>(conf.nb_flows, 0);
+  auto nb_sent = 0ul;
+  auto nb_bytes = 0ul;
+  auto nb_failed = 0ul;
+  auto next_flow = 0ul;
+  const auto start = clock_type::now();
+  auto last_report = start;
+  auto last_nb_sent = 0ul;
+
+  while (nb_sent < conf.nb_packets)
+  {
+    const auto nb = std::min(conf.batch, conf.nb_packets - nb_sent);
+    if (conf.rate != 0)
+    {
+      // Send a batch when its first packet is due.
+      const auto due = start + std::chrono::duration_cast<clock_type::duration>(
+                         std::chrono::duration<double>( static_cast<double>(nb_sent)
+                                                      / static_cast<double>(conf.rate)));
+      std::this_thread::sleep_until(due);
+    }
+
+    for (auto i = 0ul; i < nb; ++i)
+    {
+      const auto size = sizes();
+      const auto flow = static_cast<std::uint32_t>(next_flow);
+      write_packet(static_cast<char*>(iovecs[i].iov_base), flow, seqs[next_flow]++, size);
+      iovecs[i].iov_len = size;
+      nb_bytes += size;
+      next_flow = (next_flow + 1) % conf.nb_flows;
+    }
+
+    // A partial send is retried with the remaining packets.
+    auto done = 0ul;
+    while (done < nb)
+    {
+      const auto res = ::sendmmsg( sock.fd(), messages.data() + done
+                                 , static_cast<unsigned int>(nb - done), 0);
+      if (res < 0)
+      {
+        if (errno == EINTR or errno == EAGAIN or errno == ENOBUFS)
+        {
+          continue;
+        }
+        // E.g. ECONNREFUSED reported for a previous packet when nobody listens yet.
+        ++nb_failed;
+        ++done;
+        continue;
+      }
+      done += static_cast<std::size_t>(res);
+    }
+    nb_sent += nb;
+
+    const auto now = clock_type::now();
+    if (now - last_report >= std::chrono::seconds{1})
+    {
+      const auto s = std::chrono::duration<double>(now - last_report).count();
+      std::cerr << "sent " << nb_sent << " packets @ "
+                << static_cast<double>(nb_sent - last_nb_sent) / s << " packets/s\r";
+      last_report = now;
+      last_nb_sent = nb_sent;
+    }
+  }
+
+  const auto s = std::chrono::duration<double>(clock_type::now() - start).count();
+  std::cout << "sent " << nb_sent << " packets, " << nb_bytes << " bytes, on " << conf.nb_flows
+            << " flows in " << std::fixed << std::setprecision(3) << s << " s: "
+            << std::setprecision(0) << static_cast<double>(nb_sent) / s << " packets/s, "
+            << std::setprecision(1) << static_cast<double>(nb_bytes) * 8 / s / 1e6 << " Mbit/s"
+            << " (" << nb_failed << " send errors)\n";
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// What the sink knows about a flow.
+struct flow_statistics
+{
+  // The sequence number following the greatest received one.
+  std::uint32_t next = 0;
+
+  std::size_t received = 0;
+  std::size_t bytes = 0;
+  std::size_t reordered = 0;
+  std::size_t duplicated = 0;
+  std::size_t corrupted = 0;
+
+  // Received sequence numbers in [next - window, next), to tell late packets from duplicates.
+  static constexpr auto window = 4096ul;
+  std::bitset<window> seen;
+
+  void
+  receive(std::uint32_t seq, std::size_t size)
+  {
+    ++received;
+    bytes += size;
+    if (seq >= next)
+    {
+      // Forget sequence numbers which leave the window.
+      for (auto s = next; s < seq and s - next < window; ++s)
+      {
+        seen.reset(s % window);
+      }
+      seen.set(seq % window);
+      next = seq + 1;
+    }
+    else if (next - seq > window or not seen.test(seq % window))
+    {
+      // Late packets older than the window can't be told from duplicates, count them as late.
+      if (next - seq <= window)
+      {
+        seen.set(seq % window);
+      }
+      ++reordered;
+    }
+    else
+    {
+      ++duplicated;
+    }
+  }
+
+  std::size_t
+  lost()
+  const noexcept
+  {
+    const auto unique = received - duplicated - corrupted;
+    return next > unique ? next - unique : 0;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+validate(const char* data, std::size_t size, std::uint32_t& flow, std::uint32_t& seq)
+noexcept
+{
+  if (size < header_size)
+  {
+    return false;
+  }
+  std::uint32_t header[3];
+  std::memcpy(header, data, header_size);
+  flow = boost::endian::big_to_native(header[0]);
+  seq = boost::endian::big_to_native(header[1]);
+  if (boost::endian::big_to_native(header[2]) != size)
+  {
+    return false;
+  }
+  for (auto i = header_size; i < size; ++i)
+  {
+    if (data[i] != content(flow, seq, i))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+server(const configuration& conf)
+{
+  udp_socket sock;
+  const auto addr = make_address(conf.host, conf.port);
+  if (::bind(sock.fd(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+  {
+    throw std::runtime_error{std::string{"bind: "} + std::strerror(errno)};
+  }
+  // Wake up regularly to report and to detect the end of the test.
+  auto timeout = timeval{};
+  timeout.tv_usec = 100000;
+  ::setsockopt(sock.fd(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  auto buffers = std::vector<char>(conf.batch * max_packet_size);
+  auto iovecs = std::vector<iovec>(conf.batch);
+  auto messages = std::vector<mmsghdr>(conf.batch);
+  for (auto i = 0ul; i < conf.batch; ++i)
+  {
+    iovecs[i].iov_base = buffers.data() + i * max_packet_size;
+    iovecs[i].iov_len = max_packet_size;
+    std::memset(&messages[i], 0, sizeof(mmsghdr));
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  auto flows = std::vector<flow_statistics>{};
+  auto nb_received = 0ul;
+  auto nb_invalid = 0ul;
+  auto first = clock_type::time_point{};
+  auto last = clock_type::time_point{};
+  auto last_report = clock_type::now();
+  auto last_nb_received = 0ul;
+
+  while (nb_received < conf.nb_packets)
+  {
+    const auto res = ::recvmmsg( sock.fd(), messages.data(), static_cast<unsigned int>(conf.batch)
+                               , MSG_WAITFORONE, nullptr);
+    const auto now = clock_type::now();
+    if (res < 0 and errno != EAGAIN and errno != EWOULDBLOCK and errno != EINTR)
+    {
+      throw std::runtime_error{std::string{"recvmmsg: "} + std::strerror(errno)};
+    }
+    if (res > 0)
+    {
+      if (nb_received == 0)
+      {
+        first = now;
+      }
+      last = now;
+    }
+    for (auto i = 0; i < res; ++i)
+    {
+      ++nb_received;
+      const auto data = static_cast<const char*>(iovecs[static_cast<std::size_t>(i)].iov_base);
+      const auto size = static_cast<std::size_t>(messages[static_cast<std::size_t>(i)].msg_len);
+      auto flow = std::uint32_t{0};
+      auto seq = std::uint32_t{0};
+      if (not validate(data, size, flow, seq) or flow > (1u << 16))
+      {
+        ++nb_invalid;
+        continue;
+      }
+      if (flow >= flows.size())
+      {
+        flows.resize(flow + 1);
+      }
+      flows[flow].receive(seq, size);
+    }
+
+    if (now - last_report >= std::chrono::seconds{1})
+    {
+      const auto s = std::chrono::duration<double>(now - last_report).count();
+      std::cerr << "received " << nb_received << " packets @ "
+                << static_cast<double>(nb_received - last_nb_received) / s << " packets/s\r";
+      last_report = now;
+      last_nb_received = nb_received;
+    }
+    if (nb_received > 0 and now - last >= conf.idle_timeout)
+    {
+      break;
+    }
+  }
+
+  auto total = flow_statistics{};
+  std::cout << "flow     received        bytes   lost  reordered  duplicated\n";
+  for (auto f = 0ul; f < flows.size(); ++f)
+  {
+    const auto& stats = flows[f];
+    if (stats.received == 0)
+    {
+      continue;
+    }
+    std::cout << std::setw(4) << f << std::setw(13) << stats.received << std::setw(13)
+              << stats.bytes << std::setw(7) << stats.lost() << std::setw(11) << stats.reordered
+              << std::setw(12) << stats.duplicated << '\n';
+    total.received += stats.received;
+    total.bytes += stats.bytes;
+    total.reordered += stats.reordered;
+    total.duplicated += stats.duplicated;
+    total.next += stats.next;
+  }
+  const auto s = std::chrono::duration<double>(last - first).count();
+  const auto expected = static_cast<double>(std::max<std::size_t>(total.next, 1));
+  std::cout << "received " << nb_received << " packets (" << nb_invalid << " invalid), "
+            << total.bytes << " bytes in " << std::fixed << std::setprecision(3) << s << " s: "
+            << std::setprecision(0) << (s > 0 ? static_cast<double>(nb_received) / s : 0.)
+            << " packets/s, " << std::setprecision(1)
+            << (s > 0 ? static_cast<double>(total.bytes) * 8 / s / 1e6 : 0.) << " Mbit/s\n"
+            << "loss " << std::setprecision(3)
+            << static_cast<double>(total.lost()) / expected * 100 << "%, reordering "
+            << static_cast<double>(total.reordered) / expected * 100 << "%, duplication "
+            << static_cast<double>(total.duplicated) / expected * 100 << "%\n";
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, const char** argv)
+{
+  const auto conf = read_configuration(argc, argv);
+  try
+  {
+    if (conf.client)
+    {
+      client(conf);
+    }
+    else
+    {
+      server(conf);
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << '\n';
+    return 2;
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/